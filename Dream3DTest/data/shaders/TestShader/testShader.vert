@@ -1,14 +1,18 @@
 
+///////////////////////////////////////////////////////////
+// Autobindings, from the uniform blocks when available
+#ifdef UNIFORM_BLOCKS
+#include "../autobindings.glsl"
+#else
+uniform mat4	u_worldViewProjectionMatrix;
+#endif
+
 ///////////////////////////////////////////////////////////
 // Attributes
 attribute vec4 	a_position;
 attribute vec2 	a_texCoord;
 attribute vec2 	a_color;
 
-///////////////////////////////////////////////////////////
-// Uniforms
-uniform mat4	u_worldViewProjectionMatrix;
-
 ///////////////////////////////////////////////////////////
 // Varyings
 varying vec2	v_texCoord;
@@ -0,0 +1,40 @@
+///////////////////////////////////////////////////////////
+// AUTOBINDING UNIFORM BLOCKS
+//
+// Include first, before any declaration, where
+// UNIFORM_BLOCKS is defined (Effect defines it when
+// UniformBlocks is running):
+//	#ifdef UNIFORM_BLOCKS
+//	#include "autobindings.glsl"
+//	#else
+//	uniform mat4 u_worldViewProjectionMatrix;
+//	#endif
+//
+// Declares the autobindings as members of two std140
+// blocks filled by UniformBlocks on the CPU side. Material
+// autobindings for these names need no changes, they are
+// skipped once the names resolve to block members.
+// Layouts must match UniformBlocks::FrameData/ObjectData.
+///////////////////////////////////////////////////////////
+#extension GL_ARB_uniform_buffer_object : require
+
+// Active camera and scene, rewritten when the camera changes
+layout(std140) uniform FrameBlock
+{
+	mat4	u_viewMatrix;
+	mat4	u_projectionMatrix;
+	mat4	u_viewProjectionMatrix;
+	vec3	u_cameraWorldPosition;
+	vec3	u_cameraViewPosition;
+	vec3	u_sceneAmbientColor;
+};
+
+// The drawn node, written once per frame
+layout(std140) uniform ObjectBlock
+{
+	mat4	u_worldMatrix;
+	mat4	u_worldViewMatrix;
+	mat4	u_worldViewProjectionMatrix;
+	mat4	u_inverseTransposeWorldMatrix;
+	mat4	u_inverseTransposeWorldViewMatrix;
+};
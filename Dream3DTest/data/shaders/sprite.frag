@@ -1,3 +1,7 @@
+#ifdef TEXTURE_ARRAY
+#extension GL_EXT_texture_array : require
+#endif
+
 #ifdef OPENGL_ES
 #ifdef GL_FRAGMENT_PRECISION_HIGH
 precision highp float;
@@ -8,15 +12,23 @@ precision mediump float;
 
 ///////////////////////////////////////////////////////////
 // Uniforms
+#ifdef TEXTURE_ARRAY
+uniform sampler2DArray u_texture;
+#else
 uniform sampler2D u_texture;
+#endif
 
 ///////////////////////////////////////////////////////////
 // Varyings
-varying vec2 v_texCoord;
+varying vec3 v_texCoord;
 varying vec4 v_color;
 
 
 void main()
 {
-    gl_FragColor = v_color * texture2D(u_texture, v_texCoord);
+#ifdef TEXTURE_ARRAY
+    gl_FragColor = v_color * texture2DArray(u_texture, v_texCoord);
+#else
+    gl_FragColor = v_color * texture2D(u_texture, v_texCoord.xy);
+#endif
 }
\ No newline at end of file
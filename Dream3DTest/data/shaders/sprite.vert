@@ -1,7 +1,7 @@
 ///////////////////////////////////////////////////////////
 // Attributes
 attribute vec3 a_position;
-attribute vec2 a_texCoord;
+attribute vec3 a_texCoord;		// z is the layer of a texture array
 attribute vec4 a_color;
 
 ///////////////////////////////////////////////////////////
@@ -10,7 +10,7 @@ uniform mat4 u_projectionMatrix;
 
 ///////////////////////////////////////////////////////////
 // Varyings
-varying vec2 v_texCoord;
+varying vec3 v_texCoord;
 varying vec4 v_color;
 
 
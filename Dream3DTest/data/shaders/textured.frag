@@ -40,6 +40,9 @@ void main()
 { 
 	// Ambient component
 	_baseColor = texture2D(u_diffuseTexture, v_texCoord);
+	#if defined(INSTANCING)
+		_baseColor *= v_color;
+	#endif
 	gl_FragColor.a = _baseColor.a;
 
 	#if defined(LIGHTING_ENABLED)
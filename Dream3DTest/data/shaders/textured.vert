@@ -11,6 +11,10 @@
 #define DIRECTIONAL_LIGHT_COUNT 0
 #endif
 
+#if defined(SKINNING) && !defined(SKINNING_JOINT_COUNT)
+#define SKINNING_JOINT_COUNT 128
+#endif
+
 #if (POINT_LIGHT_COUNT > 0) || (SPOT_LIGHT_COUNT > 0) || (DIRECTIONAL_LIGHT_COUNT > 0)
 #define LIGHTING_ENABLED
 #endif
@@ -21,11 +25,26 @@
 attribute vec3 	a_position;
 attribute vec4 	a_color;
 attribute vec2 	a_texCoord;
+#if defined(INSTANCING)
+attribute mat4 	a_instanceWorld;		// rows of the instance world matrix
+attribute vec4 	a_instanceColor;
+#endif
+#if defined(SKINNING)
+attribute vec4 	a_blendIndices;			// four joints per vertex
+attribute vec4 	a_blendWeights;
+#endif
 
 ///////////////////////////////////////////////////////////
 // UNIFORMS
 ///////////////////////////////////////////////////////////
+#if defined(INSTANCING)
+uniform mat4 	u_viewProjectionMatrix;
+#else
 uniform mat4 	u_worldViewProjectionMatrix;
+#endif
+#if defined(SKINNING)
+uniform vec4 	u_matrixPalette[SKINNING_JOINT_COUNT * 3];	// 3x4 rows per joint
+#endif
 
 ///////////////////////////////////////////////////////////
 // VARYINGS
@@ -34,9 +53,28 @@ varying vec2 	v_texCoord;
 varying vec4 	v_color;
 ///////////////////////////////////////////////////////////
 
+#if defined(SKINNING)
+vec3 skinPosition(vec4 vPosition, float fJoint, float fWeight)
+{
+	int iRow = int(fJoint) * 3;
+	return vec3(dot(u_matrixPalette[iRow], vPosition),
+				dot(u_matrixPalette[iRow + 1], vPosition),
+				dot(u_matrixPalette[iRow + 2], vPosition)) * fWeight;
+}
+#endif
+
 vec4 getVertexPosition()
 {
+#if defined(SKINNING)
+	vec4 vPosition = vec4(a_position, 1.0);
+	vec3 vSkinned = skinPosition(vPosition, a_blendIndices.x, a_blendWeights.x)
+				  + skinPosition(vPosition, a_blendIndices.y, a_blendWeights.y)
+				  + skinPosition(vPosition, a_blendIndices.z, a_blendWeights.z)
+				  + skinPosition(vPosition, a_blendIndices.w, a_blendWeights.w);
+	return vec4(vSkinned, 1.0);
+#else
     return vec4(a_position, 1.0);
+#endif
 }
 
 vec2 getVertexTexCoord()
@@ -46,7 +84,11 @@ vec2 getVertexTexCoord()
 
 vec4 getVertexColor()
 {
+#if defined(INSTANCING)
+	return a_instanceColor;
+#else
 	return a_color;
+#endif
 }
 
 #if defined(LIGHTING_ENABLED)
@@ -55,7 +97,12 @@ vec4 getVertexColor()
 
 void main()
 {
+#if defined(INSTANCING)
+	// Engine matrices reach the shader transposed, multiply from the left
+    vec4 vPosition = (getVertexPosition() * a_instanceWorld) * u_viewProjectionMatrix;
+#else
     vec4 vPosition = u_worldViewProjectionMatrix * getVertexPosition();
+#endif
     gl_Position = vPosition;
 	
 	#if defined(LIGHTING_ENABLED)
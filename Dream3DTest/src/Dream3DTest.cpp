@@ -40,6 +40,7 @@ O -'        .'''       .'                                     "8b d8"   Veilleux
 
 #include "Engine/Properties.h"
 #include "Engine/MD5Model.h"
+#include "Engine/MD5UpdateScheduler.h"
 #include "Engine/MD5Animation.h"
 #include "Engine/Material.h"
 #include "Engine/Technique.h"
@@ -105,6 +106,7 @@ Node* g_pGridNode;
 Node* objMonkeyNode;
 
 std::vector<MD5Model*>	v_pMD5Models;
+MD5UpdateScheduler*		g_pMD5Scheduler;
 
 SpriteBatch* createSpriteBatch();
 SpriteBatch* gSpriteBatch;
@@ -593,7 +595,7 @@ void Dream3DTest::initialize() {
 	//////////////////////////////////////////////
 
 	//////////////////////////////////////////////
-	glEnable(GL_DEPTH_TEST);
+	GLStateCache::setEnabled(GL_DEPTH_TEST, true);
 
 	magniQuadModelNode = createHearthStoneCoolShaderModelNode("data/box.material#magni");
 	{
@@ -1045,6 +1047,7 @@ void Dream3DTest::loadSceneUsingAssimp(const char* pFilename, Vector3& vPosition
 
 #ifdef TEST_MD5_MODELS
 void initMD5Models(Scene* pScene) {
+	g_pMD5Scheduler = MD5UpdateScheduler::create();
 	for(int i = 0; i < 1; i++) {
 		MD5Model* pMD5Model = new MD5Model();
 
@@ -1058,7 +1061,11 @@ void initMD5Models(Scene* pScene) {
 		//	md5ModelNode->getModel()->setMaterial("data/MD5Models/boblamp/bob_lamp_update/bob_body.material", 5);
 
 
+		// Falls back to the CPU when the palette does not fit the vertex uniforms
+		pMD5Model->setSkinningMode(MD5Model::SKINNING_GPU);
 		Node* pMd5ModelNode = pMD5Model->loadModel("data/MD5Models/doom3/hellknight/hellknight1.md5mesh");
+		// #box skins with the SKINNING define, #boxCPU takes the posed mesh
+		std::string sMaterial = (pMD5Model->getSkinningMode() == MD5Model::SKINNING_GPU) ? ".material#box" : ".material#boxCPU";
 		//m_pMD5Model->loadAnim("data/MD5Models/doom3/hellknight/attack2.md5anim");
 		//m_pMD5Model->loadAnim("data/MD5Models/doom3/hellknight/attack3.md5anim");
 		////m_pMD5Model->loadAnim("data/MD5Models/doom3/hellknight/chest.md5anim");
@@ -1077,10 +1084,10 @@ void initMD5Models(Scene* pScene) {
 		//m_pMD5Model->loadAnim("data/MD5Models/doom3/hellknight/turret_attack.md5anim");
 		pMD5Model->loadAnim("data/MD5Models/doom3/hellknight/walk7.md5anim");
 		//m_pMD5Model->loadAnim("data/MD5Models/doom3/hellknight/walk7_left.md5anim");
-		pMd5ModelNode->getModel()->setMaterial("data/MD5Models/doom3/hellknight/hellknight.material#box", 0);
-		pMd5ModelNode->getModel()->setMaterial("data/MD5Models/doom3/hellknight/gob2.material#box", 1);
-		pMd5ModelNode->getModel()->setMaterial("data/MD5Models/doom3/hellknight/gob.material#box", 2);
-		pMd5ModelNode->getModel()->setMaterial("data/MD5Models/doom3/hellknight/tongue.material#box", 3);
+		pMd5ModelNode->getModel()->setMaterial(("data/MD5Models/doom3/hellknight/hellknight" + sMaterial).c_str(), 0);
+		pMd5ModelNode->getModel()->setMaterial(("data/MD5Models/doom3/hellknight/gob2" + sMaterial).c_str(), 1);
+		pMd5ModelNode->getModel()->setMaterial(("data/MD5Models/doom3/hellknight/gob" + sMaterial).c_str(), 2);
+		pMd5ModelNode->getModel()->setMaterial(("data/MD5Models/doom3/hellknight/tongue" + sMaterial).c_str(), 3);
 
 		//Node* pMd5ModelNode = pMD5Model->loadModel("data/MD5Models/doom3/cacodemon/cacodemon.md5mesh");
 		//pMD5Model->loadAnim("data/MD5Models/doom3/cacodemon/walk.md5anim");
@@ -1155,6 +1162,7 @@ void initMD5Models(Scene* pScene) {
 			pScene->addNode(pMd5ModelNode);
 
 			v_pMD5Models.push_back(pMD5Model);
+			g_pMD5Scheduler->add(pMD5Model);
 		}
 	}
 }
@@ -1843,10 +1851,8 @@ void Dream3DTest::update(float deltaTimeMs) {
 #ifndef USE_YAGUI
 	m_pScene->getActiveCamera()->update(deltaTimeMs);
 #ifdef TEST_MD5_MODELS
-	for (int i = 0; i < 1; i++) {
-		MD5Model* pMD5Model = (MD5Model*)v_pMD5Models[i];
-		pMD5Model->update(deltaTimeMs);
-	}
+	// Off-screen models only advance their time
+	g_pMD5Scheduler->update(deltaTimeMs, m_pScene->getActiveCamera());
 #endif
 	
 	// Log Camera pos
@@ -0,0 +1,50 @@
+#ifndef BATCHMATH_H
+#define BATCHMATH_H
+
+#include <cstddef>
+#include "Common/Vectors.h"
+#include "Common/Matrices.h"
+
+///////////////////////////////////////////////////////////////////////////
+// Batched transforms over many points / matrices in one call.
+//
+// The point and vector functions work on structure-of-arrays streams
+// (separate x, y and z arrays) so the inner loops run 4 (SSE2) or 8 (AVX2)
+// elements per iteration, using the backend picked by MathSIMD.
+// Output arrays may be the same arrays as the inputs.
+//
+// Points are column vectors multiplied by the rows of m, with the
+// translation in m[3], m[7], m[11] as scene and joint matrices keep it
+// (Matrix4::getTranslation, MD5Model::jointToMatrix):
+// out = m * (x, y, z) + w * (m[3], m[7], m[11]), element for element
+// the same as Matrix4::operator*(const Vector3&) plus the translation.
+// Matrix4::transformPoint reads m[12..14] instead and is not matched.
+///////////////////////////////////////////////////////////////////////////
+class BatchMath {
+
+	public:
+		// out = (x, y, z, 1) transformed by m
+		static void		transformPoints(const Matrix4& m, const float* xs, const float* ys, const float* zs, float* outXs, float* outYs, float* outZs, size_t n);
+		// out = (x, y, z, 0) transformed by m
+		static void		transformVectors(const Matrix4& m, const float* xs, const float* ys, const float* zs, float* outXs, float* outYs, float* outZs, size_t n);
+
+		// Array-of-Vector3 convenience, de-interleaves into SoA blocks internally.
+		static void		transformPoints(const Matrix4& m, const Vector3* src, Vector3* dst, size_t n);
+		static void		transformVectors(const Matrix4& m, const Vector3* src, Vector3* dst, size_t n);
+
+		// dst[i] = lhs * rhs[i]
+		static void		multiplyMatrices(const Matrix4& lhs, const Matrix4* rhs, Matrix4* dst, size_t n);
+		// dst[i] = lhs[i] * rhs[i]
+		static void		multiplyMatrices(const Matrix4* lhs, const Matrix4* rhs, Matrix4* dst, size_t n);
+
+		// In place, same rule as Vector3::normalize(), ~zero vectors are left untouched.
+		static void		normalizeVectors(float* xs, float* ys, float* zs, size_t n);
+		static void		normalizeVectors(Vector3* vectors, size_t n);
+
+		// Checks the active backend against per element Matrix4 row products
+		// over pseudo-random matrices and odd counts, so both the SIMD loops
+		// and their scalar tails are covered. fTolerance of 0 is bit-exact.
+		static bool		verify(float fTolerance = 0.0f, unsigned int iIterations = 64);
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include "Common/Vectors.h"
+#include "Common/Matrices.h"
+
+struct BoundingSphere;
+
+///////////////////////////////////////////////////////////////////////////
+// Axis aligned bounding box. A default constructed box is empty (min > max)
+// and grows with merge().
+//
+// transform() follows the scene convention used by Node world matrices:
+// row-major, p' = M * p with the translation in m[3], m[7], m[11].
+///////////////////////////////////////////////////////////////////////////
+struct BoundingBox
+{
+	Vector3 min;
+	Vector3 max;
+
+	BoundingBox();
+	BoundingBox(const Vector3& vMin, const Vector3& vMax);
+
+	void		set(const Vector3& vMin, const Vector3& vMax);
+	void		setEmpty();
+	bool		isEmpty() const;
+
+	void		merge(const Vector3& point);
+	void		merge(const BoundingBox& box);
+
+	Vector3		getCenter() const;
+	Vector3		getHalfExtents() const;
+	bool		intersects(const BoundingBox& box) const;
+	bool		intersects(const BoundingSphere& sphere) const;
+	bool		contains(const Vector3& point) const;
+
+	// Box enclosing this box after m (exact for affine m, never smaller)
+	void		transform(const Matrix4& m, BoundingBox* dst) const;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// Bounding sphere, negative radius means empty.
+///////////////////////////////////////////////////////////////////////////
+struct BoundingSphere
+{
+	Vector3 center;
+	float	radius;
+
+	BoundingSphere();
+	BoundingSphere(const Vector3& vCenter, float fRadius);
+
+	void		set(const Vector3& vCenter, float fRadius);
+	void		set(const BoundingBox& box);		// sphere around the box corners
+	bool		isEmpty() const;
+
+	void		merge(const BoundingSphere& sphere);
+	bool		intersects(const BoundingSphere& sphere) const;
+
+	// Sphere after m, the radius grows with the largest axis scale of m
+	void		transform(const Matrix4& m, BoundingSphere* dst) const;
+};
+
+#endif
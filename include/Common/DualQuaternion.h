@@ -0,0 +1,77 @@
+/* -*- c++ -*- */
+/////////////////////////////////////////////////////////////////////////////
+//
+// DualQuaternion.h
+//
+// Unit dual quaternion, a rigid transform (rotation + translation) stored
+// in 8 numbers. Used for skinning: blending dual quaternions and
+// renormalizing (DLB) keeps volume at bent joints where blending matrices
+// collapses ("candy wrapper"), and it is half the size of a 4x3 matrix.
+//
+// q = real + eps * dual, with real = rotation and
+// dual = 0.5 * <0, translation> * real.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef DUALQUATERNION_H
+#define DUALQUATERNION_H
+
+#include "Common/Quaternion.h"
+
+template <typename Real>
+class DualQuaternion {
+	public:
+		// Constructors
+		DualQuaternion () { }
+		DualQuaternion (const Quaternion<Real> &real, const Quaternion<Real> &dual)
+			: _real (real), _dual (dual) { }
+		DualQuaternion (const Quaternion<Real> &rotation, const Vector3 &translation);
+
+	public:
+		// Public interface
+		void identity ();
+		void normalize ();
+		void set (const Quaternion<Real> &rotation, const Vector3 &translation);
+
+		Quaternion<Real> rotation () const;
+		Vector3 translation () const;
+
+		// Apply to a point (rotation + translation) or a direction (rotation only)
+		void transformPoint (Vector3 &v) const;
+		void transformVector (Vector3 &v) const;
+
+		// Dual quaternion operations
+		DualQuaternion<Real> operator+ (const DualQuaternion<Real> &dq) const;
+		DualQuaternion<Real> &operator+= (const DualQuaternion<Real> &dq);
+
+		DualQuaternion<Real> operator* (const DualQuaternion<Real> &dq) const;		// this transform applied after dq
+		DualQuaternion<Real> &operator*= (const DualQuaternion<Real> &dq);
+
+		DualQuaternion<Real> operator* (Real k) const;
+		DualQuaternion<Real> &operator*= (Real k);
+
+		DualQuaternion<Real> operator~ () const;	// Inverse of a unit dual quaternion
+
+	public:
+		// Member variables
+		Quaternion<Real> _real;
+		Quaternion<Real> _dual;
+};
+
+// Predefined DualQuaternion types
+typedef DualQuaternion<float> DualQuaternionf;
+typedef DualQuaternion<double> DualQuaterniond;
+
+//
+// Nonmember DualQuaternion functions
+//
+
+// Dual quaternion linear blending: sum(weights[i] * dq[i]) with each term
+// flipped onto the hemisphere of dq[0], then normalized.
+template <typename Real>
+DualQuaternion<Real> BlendDLB (const DualQuaternion<Real> *dq, const Real *weights, int count);
+
+// Include inline function definitions
+#include "DualQuaternion.inl"
+
+#endif // DUALQUATERNION_H
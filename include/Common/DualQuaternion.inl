@@ -0,0 +1,194 @@
+/* -*- c++ -*- */
+/////////////////////////////////////////////////////////////////////////////
+//
+// DualQuaternion.inl
+//
+// Inline implementation of DualQuaternion<Real>.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+// --------------------------------------------------------------------------
+// DualQuaternion::DualQuaternion / set
+//
+// Build from a unit rotation quaternion and a translation.
+// --------------------------------------------------------------------------
+
+template <typename Real>
+inline
+DualQuaternion<Real>::DualQuaternion (const Quaternion<Real> &rotation, const Vector3 &translation) {
+
+	set (rotation, translation);
+}
+
+template <typename Real>
+inline void
+DualQuaternion<Real>::set (const Quaternion<Real> &rotation, const Vector3 &translation) {
+
+	_real = rotation;
+	_dual = (Quaternion<Real> (0.0, translation.x, translation.y, translation.z) * rotation) * (Real)0.5;
+}
+
+// --------------------------------------------------------------------------
+// DualQuaternion::identity
+// --------------------------------------------------------------------------
+
+template <typename Real>
+inline void
+DualQuaternion<Real>::identity () {
+
+	_real.identity ();
+	_dual._w = _dual._x = _dual._y = _dual._z = 0.0;
+}
+
+// --------------------------------------------------------------------------
+// DualQuaternion::normalize
+//
+// Make the real part unit length and the dual part orthogonal to it, which
+// is required after blending.
+// --------------------------------------------------------------------------
+
+template <typename Real>
+inline void
+DualQuaternion<Real>::normalize () {
+
+	Real mag = std::sqrt (DotProduct (_real, _real));
+
+	// Check for bogus length, to protect against divide by zero
+	if (mag > 0.0)
+	{
+		Real oneOverMag = 1.0 / mag;
+
+		_real *= oneOverMag;
+		_dual *= oneOverMag;
+		_dual -= _real * DotProduct (_real, _dual);
+	}
+}
+
+// --------------------------------------------------------------------------
+// DualQuaternion::rotation / translation
+// --------------------------------------------------------------------------
+
+template <typename Real>
+inline Quaternion<Real>
+DualQuaternion<Real>::rotation () const {
+
+	return _real;
+}
+
+template <typename Real>
+inline Vector3
+DualQuaternion<Real>::translation () const {
+
+	// t = 2 * dual * ~real
+	Quaternion<Real> t = _dual * ~_real;
+	return Vector3 (2.0f * t._x, 2.0f * t._y, 2.0f * t._z);
+}
+
+// --------------------------------------------------------------------------
+// DualQuaternion::transformPoint / transformVector
+// --------------------------------------------------------------------------
+
+template <typename Real>
+inline void
+DualQuaternion<Real>::transformPoint (Vector3 &v) const {
+
+	_real.rotate (v);
+	v += translation ();
+}
+
+template <typename Real>
+inline void
+DualQuaternion<Real>::transformVector (Vector3 &v) const {
+
+	_real.rotate (v);
+}
+
+// --------------------------------------------------------------------------
+//
+// Operators
+//
+// --------------------------------------------------------------------------
+
+template <typename Real>
+inline DualQuaternion<Real>
+DualQuaternion<Real>::operator+ (const DualQuaternion<Real> &dq) const
+{
+  return DualQuaternion<Real> (_real + dq._real, _dual + dq._dual);
+}
+
+template <typename Real>
+inline DualQuaternion<Real> &
+DualQuaternion<Real>::operator+= (const DualQuaternion<Real> &dq)
+{
+  _real += dq._real;
+  _dual += dq._dual;
+  return *this;
+}
+
+template <typename Real>
+inline DualQuaternion<Real>
+DualQuaternion<Real>::operator* (const DualQuaternion<Real> &dq) const
+{
+  // (r1 + eps d1)(r2 + eps d2) = r1r2 + eps (r1d2 + d1r2)
+  return DualQuaternion<Real> (_real * dq._real, (_real * dq._dual) + (_dual * dq._real));
+}
+
+template <typename Real>
+inline DualQuaternion<Real> &
+DualQuaternion<Real>::operator*= (const DualQuaternion<Real> &dq)
+{
+  *this = *this * dq;
+  return *this;
+}
+
+template <typename Real>
+inline DualQuaternion<Real>
+DualQuaternion<Real>::operator* (Real k) const
+{
+  return DualQuaternion<Real> (_real * k, _dual * k);
+}
+
+template <typename Real>
+inline DualQuaternion<Real> &
+DualQuaternion<Real>::operator*= (Real k)
+{
+  _real *= k;
+  _dual *= k;
+  return *this;
+}
+
+// Inverse, for unit dual quaternions only
+template <typename Real>
+inline DualQuaternion<Real>
+DualQuaternion<Real>::operator~ () const
+{
+  return DualQuaternion<Real> (~_real, ~_dual);
+}
+
+// --------------------------------------------------------------------------
+// BlendDLB
+//
+// Dual quaternion linear blending (Kavan et al.).
+// --------------------------------------------------------------------------
+
+template <typename Real>
+inline DualQuaternion<Real>
+BlendDLB (const DualQuaternion<Real> *dq, const Real *weights, int count)
+{
+  assert (count > 0);
+
+  DualQuaternion<Real> res = dq[0] * weights[0];
+
+  for (int i = 1; i < count; i++)
+    {
+      // q and -q are the same transform, blend along the shortest path
+      Real w = weights[i];
+      if (DotProduct (dq[0]._real, dq[i]._real) < 0.0)
+	w = -w;
+
+      res += dq[i] * w;
+    }
+
+  res.normalize ();
+  return res;
+}
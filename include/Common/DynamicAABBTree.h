@@ -0,0 +1,90 @@
+#ifndef DYNAMIC_AABB_TREE_H
+#define DYNAMIC_AABB_TREE_H
+
+#include "Common/Bounds.h"
+#include "Common/Frustum.h"
+#include "Common/Ray.h"
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////
+// Dynamic bounding volume hierarchy over axis aligned boxes.
+//
+// Every proxy is a leaf holding a "fat" box, the proxy's box grown by a
+// margin. Moving a proxy only touches the tree when its new box leaves the
+// fat one, so small per-frame motion costs a containment test. Leaves are
+// inserted by surface area heuristic and the tree is kept balanced with
+// AVL style rotations on the way back up.
+//
+// Queries report the user data of every leaf whose fat box passes, which
+// is a conservative candidate set; callers refine with exact bounds.
+///////////////////////////////////////////////////////////////////////////
+class DynamicAABBTree {
+
+	public:
+		// Leaf test for raycast(), returns the hit distance or < 0 for a miss
+		typedef float (*RaycastCallback)(void* pUserData, const Ray& ray, float fMaxDistance, void* pContext);
+
+		static const int NULL_PROXY = -1;
+
+		DynamicAABBTree(float fMargin = 0.1f);
+		~DynamicAABBTree();
+
+		int						createProxy(const BoundingBox& box, void* pUserData);
+		void					destroyProxy(int iProxy);
+		bool					moveProxy(int iProxy, const BoundingBox& box);	// true when the proxy was reinserted
+		void					clear();
+
+		void*					getUserData(int iProxy) const;
+		const BoundingBox&		getFatBox(int iProxy) const;
+		unsigned int			getProxyCount() const;
+		int						getHeight() const;
+		float					getMargin() const;
+		void					setMargin(float fMargin);		// applies to boxes inserted afterwards
+
+		// Dirty list for deferred refits, each proxy is listed once
+		void					markDirty(int iProxy);
+		void					takeDirtyProxies(std::vector<int>& vProxies);	// swaps the list out and clears it
+
+		void					query(const BoundingBox& box, std::vector<void*>& vResults) const;
+		void					query(const BoundingSphere& sphere, std::vector<void*>& vResults) const;
+		void					query(const Frustum& frustum, std::vector<void*>& vResults) const;
+		void					query(const Ray& ray, float fMaxDistance, std::vector<void*>& vResults) const;
+
+		// Closest leaf along the ray. Without a callback the fat box distance
+		// counts as the hit, otherwise the callback decides and the search
+		// range shrinks to every hit it reports.
+		void*					raycast(const Ray& ray, float fMaxDistance, RaycastCallback pCallback = NULL, void* pContext = NULL, float* pDistance = NULL) const;
+	private:
+		struct TreeNode {
+			BoundingBox		box;
+			void*			pUserData;
+			int				iParent;		// next free node while on the free list
+			int				iChild1;
+			int				iChild2;
+			int				iHeight;		// leaf = 0, free = -1
+			bool			bDirty;
+
+			bool			isLeaf() const { return iChild1 == NULL_PROXY; }
+		};
+
+		DynamicAABBTree(const DynamicAABBTree& copy);
+		DynamicAABBTree& operator=(const DynamicAABBTree&);
+
+		int						allocateNode();
+		void					freeNode(int iNode);
+		void					insertLeaf(int iLeaf);
+		void					removeLeaf(int iLeaf);
+		int						balance(int iNode);
+		void					collectLeaves(int iNode, std::vector<void*>& vResults) const;
+
+		std::vector<TreeNode>	m_vNodes;
+		int						m_iRoot;
+		int						m_iFreeList;
+		unsigned int			m_iProxyCount;
+		float					m_fMargin;
+
+		std::vector<int>		m_vDirtyProxies;
+		mutable std::vector<int>	m_vStack;		// traversal scratch
+};
+
+#endif
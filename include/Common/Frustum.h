@@ -0,0 +1,55 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include "Common/Vectors.h"
+#include "Common/Matrices.h"
+#include "Common/Bounds.h"
+
+///////////////////////////////////////////////////////////////////////////
+// Plane n.p + d = 0, points with a positive distance are in front.
+///////////////////////////////////////////////////////////////////////////
+struct Plane
+{
+	Vector3 normal;
+	float	d;
+
+	Plane();
+	Plane(const Vector3& vNormal, float fD);
+
+	void		set(float a, float b, float c, float fD);	// normalizes
+	float		distance(const Vector3& point) const;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// Six clip planes extracted from a view projection matrix (Gribb/Hartmann).
+// The matrix is row-major as returned by Camera::getViewProjectionMatrix(),
+// all planes point inwards.
+///////////////////////////////////////////////////////////////////////////
+class Frustum {
+
+	public:
+		enum PlaneIndex {
+			PLANE_LEFT = 0,
+			PLANE_RIGHT,
+			PLANE_BOTTOM,
+			PLANE_TOP,
+			PLANE_NEAR,
+			PLANE_FAR,
+			PLANE_COUNT
+		};
+
+		Frustum();
+		Frustum(const Matrix4& viewProjection);
+
+		void					set(const Matrix4& viewProjection);
+		const Plane&			getPlane(unsigned int i) const;
+
+		bool					intersects(const Vector3& point) const;
+		bool					intersects(const BoundingSphere& sphere) const;
+		bool					intersects(const BoundingBox& box) const;
+		bool					contains(const BoundingBox& box) const;		// entirely inside
+	private:
+		Plane					m_Planes[PLANE_COUNT];
+};
+
+#endif
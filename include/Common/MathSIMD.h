@@ -0,0 +1,76 @@
+#ifndef MATHSIMD_H
+#define MATHSIMD_H
+
+#include <cstddef>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define MATH_SIMD_X86
+#endif
+
+// Per-function instruction set for GCC/Clang, MSVC allows intrinsics anywhere.
+#if defined(MATH_SIMD_X86) && !defined(_MSC_VER)
+#define MATH_SIMD_TARGET_SSE2		__attribute__((target("sse2")))
+#define MATH_SIMD_TARGET_AVX2		__attribute__((target("avx2")))
+#else
+#define MATH_SIMD_TARGET_SSE2
+#define MATH_SIMD_TARGET_AVX2
+#endif
+
+#if defined(_MSC_VER)
+#define MATH_ALIGN16				__declspec(align(16))
+#else
+#define MATH_ALIGN16				__attribute__((aligned(16)))
+#endif
+
+///////////////////////////////////////////////////////////////////////////
+// SIMD kernels used by Matrix4 / Vector4.
+//
+// All matrices are plain float[16] in the layout used by Matrix4::operator*
+// i.e. dst[r*4+c] = sum(a[r*4+k] * b[k*4+c]).
+// The backend (scalar, SSE2 or AVX2) is selected on first use from CPUID,
+// and can be forced with setBackend() for debugging / comparison.
+// Inputs do not need to be 16-byte aligned (Matrix4 lives inside heap
+// objects, which are only 8-byte aligned on Win32), dst may alias a or b.
+///////////////////////////////////////////////////////////////////////////
+class MathSIMD {
+
+	public:
+		enum Backend {
+			BACKEND_SCALAR = 0,
+			BACKEND_SSE2,
+			BACKEND_AVX2
+		};
+
+		static Backend		getBackend();
+		static Backend		setBackend(Backend backend);				// clamps to what the CPU supports, returns the active backend
+		static Backend		detectBackend();							// best backend supported by the CPU/OS
+		static const char*	getBackendName(Backend backend);
+
+		static void			multiplyMatrix(const float* a, const float* b, float* dst);
+		static bool			invertMatrix(const float* m, float* dst);	// false (dst untouched) if the matrix is singular
+		static void			transformVector(const float* m, const float* v, float* dst);	// dst = v.x*row0 + v.y*row1 + v.z*row2 + v.w*row3
+
+		// Scalar reference implementations, always available.
+		static void			multiplyMatrixScalar(const float* a, const float* b, float* dst);
+		static bool			invertMatrixScalar(const float* m, float* dst);
+		static void			transformVectorScalar(const float* m, const float* v, float* dst);
+
+		// Compares the active backend against the scalar reference over a set
+		// of pseudo-random matrices. fTolerance of 0 requires bit-exact results.
+		// Returns the largest absolute difference found in pMaxError.
+		static bool			verify(float fTolerance = 0.0f, unsigned int iIterations = 1024, float* pMaxError = NULL);
+	private:
+		typedef void		(*MultiplyMatrixFn)(const float* a, const float* b, float* dst);
+		typedef bool		(*InvertMatrixFn)(const float* m, float* dst);
+		typedef void		(*TransformVectorFn)(const float* m, const float* v, float* dst);
+
+		static void			bindBackend(Backend backend);
+
+		static Backend				m_Backend;
+		static bool					m_bInitialized;
+		static MultiplyMatrixFn		m_pfnMultiplyMatrix;
+		static InvertMatrixFn		m_pfnInvertMatrix;
+		static TransformVectorFn	m_pfnTransformVector;
+};
+
+#endif
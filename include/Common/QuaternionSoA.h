@@ -0,0 +1,79 @@
+#ifndef QUATERNIONSOA_H
+#define QUATERNIONSOA_H
+
+#include <cstddef>
+#include "Common/Quaternion.h"
+
+///////////////////////////////////////////////////////////////////////////
+// Many float quaternions stored as separate w/x/y/z streams.
+//
+// Meant for whole skeletons: interpolate / normalize all joints of a frame
+// with one call, 4 joints per SSE2 iteration. Streams are 16-byte aligned
+// and padded to a multiple of 4 with identity quaternions, so the batch
+// loops have no scalar tail.
+//
+// slerp() uses a polynomial correction of nlerp instead of sin/acos
+// (max error ~1.5e-3 rad for unit inputs), Slerp() from Quaternion.h
+// remains the exact version.
+///////////////////////////////////////////////////////////////////////////
+class QuaternionSoA {
+
+	public:
+		QuaternionSoA();
+		QuaternionSoA(size_t iCount);
+		QuaternionSoA(const QuaternionSoA& copy);
+		~QuaternionSoA();
+
+		QuaternionSoA&		operator=(const QuaternionSoA& copy);
+
+		void				resize(size_t iCount);				// new elements are identity
+		size_t				size() const		{ return m_iCount; }
+
+		void				set(size_t i, const Quaternionf& q);
+		Quaternionf			get(size_t i) const;
+
+		void				load(const Quaternionf* src, size_t iCount);	// resize + copy from AoS
+		void				store(Quaternionf* dst) const;					// copy size() quaternions to AoS
+
+		float*				w()					{ return m_pW; }
+		float*				x()					{ return m_pX; }
+		float*				y()					{ return m_pY; }
+		float*				z()					{ return m_pZ; }
+		const float*		w() const			{ return m_pW; }
+		const float*		x() const			{ return m_pX; }
+		const float*		y() const			{ return m_pY; }
+		const float*		z() const			{ return m_pZ; }
+
+		void				normalize();
+
+		// dst[i] = interpolate(a[i], b[i], t) along the shortest arc. a, b and dst
+		// must have the same size, dst may be a or b.
+		static void			nlerp(const QuaternionSoA& a, const QuaternionSoA& b, float t, QuaternionSoA& dst);
+		static void			slerp(const QuaternionSoA& a, const QuaternionSoA& b, float t, QuaternionSoA& dst);
+		// nlerp() on bare streams of iCount quaternions, e.g. the frames of an
+		// AnimationClip, without alignment or padding. dst may be a or b.
+		static void			nlerp(const float* aw, const float* ax, const float* ay, const float* az,
+									const float* bw, const float* bx, const float* by, const float* bz,
+									float t, float* dw, float* dx, float* dy, float* dz, size_t iCount);
+
+		// v[i] rotated by quaternion i, or by quaternion pIndices[i] if given.
+		// Vectors are SoA streams of iCount elements, out may be the input.
+		void				rotate(const float* xs, const float* ys, const float* zs, float* outXs, float* outYs, float* outZs, size_t iCount, const unsigned int* pIndices = NULL) const;
+
+		// Checks rotate() against Quaternion::rotate, nlerp() against the scalar
+		// shortest arc nlerp and DualQuaternion against rotation plus translation,
+		// on unit quaternions with w <= 0 as MD5Model::computeQuatW rebuilds them.
+		static bool			verify(float fTolerance = 0.00001f);
+	private:
+		void				allocate(size_t iCapacity);
+
+		float*				m_pData;		// unaligned allocation, streams live inside
+		float*				m_pW;
+		float*				m_pX;
+		float*				m_pY;
+		float*				m_pZ;
+		size_t				m_iCount;
+		size_t				m_iCapacity;	// per stream, multiple of 4
+};
+
+#endif
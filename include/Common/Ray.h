@@ -0,0 +1,27 @@
+#ifndef RAY_H
+#define RAY_H
+
+#include "Common/Vectors.h"
+#include "Common/Bounds.h"
+
+///////////////////////////////////////////////////////////////////////////
+// Half line origin + t * direction, t >= 0. The direction is kept unit
+// length so distances returned by the intersection tests are world units.
+///////////////////////////////////////////////////////////////////////////
+struct Ray
+{
+	Vector3 origin;
+	Vector3 direction;
+
+	Ray();
+	Ray(const Vector3& vOrigin, const Vector3& vDirection);
+
+	void		set(const Vector3& vOrigin, const Vector3& vDirection);	// normalizes the direction
+	Vector3		getPoint(float fDistance) const;
+
+	// Distance to the first hit, 0 when the origin is inside
+	bool		intersects(const BoundingBox& box, float* pDistance = NULL) const;
+	bool		intersects(const BoundingSphere& sphere, float* pDistance = NULL) const;
+};
+
+#endif
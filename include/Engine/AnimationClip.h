@@ -0,0 +1,91 @@
+#ifndef ANIMATION_CLIP_H
+#define ANIMATION_CLIP_H
+
+#include "Engine/Base.h"
+#include "Common/Vectors.h"
+#include "Common/Quaternion.h"
+
+///////////////////////////////////////////////////////////////////////////
+// A skeletal animation baked into one contiguous block, frame after frame.
+// Each frame is SoA: every joint's position x, then every y, ... then the
+// orientation components.
+//
+// FORMAT_FLOAT keeps 28 bytes per joint and frame. FORMAT_QUANTIZED keeps
+// 12: positions in 16 bits over the clip's bounds, orientations as
+// smallest-three (the largest component is dropped and rebuilt, the other
+// three take 15 bits each, the 2 bit index of the dropped one rides in the
+// top bits of the first two).
+//
+// sample() finds the two frames around a time directly from the frame
+// rate and blends them with lerp/nlerp, without branching per joint. The
+// orientations go through QuaternionSoA::nlerp() straight from the frame
+// streams when every joint is sampled, gathered or decoded to streams on
+// the stack otherwise.
+//
+// getData() is the whole block as it sits in memory. createInPlace()
+// samples such a block where it lies, e.g. in a mapped file, without a
+// copy.
+///////////////////////////////////////////////////////////////////////////
+class AnimationClip {
+
+	public:
+		enum Format {
+			FORMAT_FLOAT,
+			FORMAT_QUANTIZED
+		};
+
+		~AnimationClip();
+
+		// pPositions and pOrientations hold iFrameCount * iJointCount poses,
+		// [frame][joint], orientations of unit length
+		static AnimationClip*	create(unsigned int iJointCount, unsigned int iFrameCount, float fFrameRate, const Vector3* pPositions, const Quaternionf* pOrientations, Format eFormat = FORMAT_FLOAT);
+		// pData holds getDataSize() bytes from getData() of a clip of the same
+		// shape, it has to outlive the clip and be 4 byte aligned
+		static AnimationClip*	createInPlace(unsigned int iJointCount, unsigned int iFrameCount, float fFrameRate, Format eFormat, const Vector3& vPositionMin, const Vector3& vPositionScale, const unsigned char* pData);
+
+		unsigned int			getJointCount() const;
+		unsigned int			getFrameCount() const;
+		float					getFrameRate() const;
+		float					getDuration() const;		// in seconds, the last frame blends back into the first
+		Format					getFormat() const;
+		unsigned int			getDataSize() const;		// bytes of baked poses
+		static unsigned int		getDataSize(unsigned int iJointCount, unsigned int iFrameCount, Format eFormat);
+		const unsigned char*	getData() const;
+		const Vector3&			getPositionMin() const;		// FORMAT_QUANTIZED position range
+		const Vector3&			getPositionScale() const;
+
+		// Poses at fTime seconds, wrapped into the clip. Both arrays take
+		// getJointCount() elements.
+		void					sample(float fTime, Vector3* pPositions, Quaternionf* pOrientations) const;
+		// Only the listed joints, the other elements are left as they are
+		void					sample(float fTime, Vector3* pPositions, Quaternionf* pOrientations, const unsigned short* pJoints, unsigned int iJointCount) const;
+	private:
+		AnimationClip(unsigned int iJointCount, unsigned int iFrameCount, float fFrameRate, Format eFormat);
+		AnimationClip(const AnimationClip& copy);
+
+		void					bakeFloat(const Vector3* pPositions, const Quaternionf* pOrientations);
+		void					bakeQuantized(const Vector3* pPositions, const Quaternionf* pOrientations);
+
+		// pJoints NULL for every joint
+		void					sampleFloat(unsigned int iFrame0, unsigned int iFrame1, float fBlend, const unsigned short* pJoints, unsigned int iJointCount, Vector3* pPositions, Quaternionf* pOrientations) const;
+		void					sampleQuantized(unsigned int iFrame0, unsigned int iFrame1, float fBlend, const unsigned short* pJoints, unsigned int iJointCount, Vector3* pPositions, Quaternionf* pOrientations) const;
+
+		// Streams as in a frame: position x, y, z then orientation x, y, z, w, of
+		// iCount joints going to pJoints (or from iFirst on without pJoints)
+		static void				blend(const float* const* pStreams0, const float* const* pStreams1, float fBlend, unsigned int iCount, const unsigned short* pJoints, unsigned int iFirst, Vector3* pPositions, Quaternionf* pOrientations);
+
+		unsigned int			m_iJointCount;
+		unsigned int			m_iFrameCount;
+		float					m_fFrameRate;
+		Format					m_eFormat;
+
+		const unsigned char*	m_pData;
+		unsigned char*			m_pOwnedData;				// NULL for clips made in place
+		unsigned int			m_iFrameSize;				// bytes
+
+		// FORMAT_QUANTIZED position range
+		Vector3					m_vPositionMin;
+		Vector3					m_vPositionScale;			// max - min, over 65535
+};
+
+#endif
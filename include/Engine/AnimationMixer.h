@@ -0,0 +1,117 @@
+#ifndef ANIMATION_MIXER_H
+#define ANIMATION_MIXER_H
+
+#include "Engine/Base.h"
+#include "Engine/AnimationClip.h"
+#include <vector>
+
+// Layers of a mixer, and clips blending at once within a layer
+#define ANIMATION_MIXER_LAYERS			4
+#define ANIMATION_MIXER_LAYER_CLIPS		4
+
+///////////////////////////////////////////////////////////////////////////
+// Plays several AnimationClips on one skeleton.
+//
+// Each layer blends its clips by weight, and play() crossfades to a clip
+// by fading the layer's other clips out. Layers then apply in index
+// order, over the bind pose:
+// - LAYER_BLEND layers lerp the pose toward their own.
+// - LAYER_ADDITIVE layers add their motion relative to each clip's first
+//   frame.
+// Both go through the layer weight times a per joint mask, and times the
+// sum of the layer's clip weights where that is below 1, so a clip fading
+// in alone or a layer being cleared only covers part of the pose.
+//
+// Clips hold model space poses. Blending happens on parent relative
+// poses, and the result goes back to model space once. Clips are only
+// read, so one clip can drive any number of mixers. Every buffer is sized
+// by create(), so play() and update() do not allocate.
+///////////////////////////////////////////////////////////////////////////
+class AnimationMixer {
+
+	public:
+		enum LayerMode {
+			LAYER_BLEND,
+			LAYER_ADDITIVE
+		};
+
+		~AnimationMixer();
+
+		// Parents precede their children, -1 for roots. The bind pose is in
+		// model space.
+		static AnimationMixer*	create(unsigned int iJointCount, const int* pParents, const Vector3* pBindPositions, const Quaternionf* pBindOrientations);
+
+		unsigned int			getJointCount() const;
+
+		void					setLayerMode(unsigned int iLayer, LayerMode eMode);
+		void					setLayerWeight(unsigned int iLayer, float fWeight);
+		void					setLayerMask(unsigned int iLayer, const float* pJointWeights);		// getJointCount() weights, NULL for all 1
+		void					clearLayer(unsigned int iLayer, float fFadeTime = 0.0f);
+
+		// Crossfades the layer to pClip alone over fFadeTime seconds
+		void					play(unsigned int iLayer, const AnimationClip* pClip, float fFadeTime = 0.0f);
+		// Moves one clip of the layer to fWeight, 0 fades it out
+		void					blend(unsigned int iLayer, const AnimationClip* pClip, float fWeight, float fFadeTime = 0.0f);
+		void					setClipSpeed(unsigned int iLayer, const AnimationClip* pClip, float fSpeed);
+
+		bool					isActive() const;		// any clip playing
+		void					update(float fDeltaTime);		// in ms, like MD5Animation
+
+		// Model space pose of the last update()
+		const Vector3*			getPositions() const;
+		const Quaternionf*		getOrientations() const;
+
+		// Runs fades and partial blends on a one joint skeleton and checks
+		// the pose against the expected weights
+		static bool				verify();
+	private:
+		struct ClipState {
+			const AnimationClip*	pClip;
+			float					fTime;
+			float					fSpeed;
+			float					fWeight;
+			float					fTargetWeight;
+			float					fFadeRate;			// weight per second
+			std::vector<Vector3>		vReferencePositions;	// first frame, parent relative, for additive layers
+			std::vector<Quaternionf>	vReferenceOrientations;
+		};
+
+		struct Layer {
+			LayerMode				eMode;
+			float					fWeight;
+			std::vector<float>		vMask;
+			ClipState				clips[ANIMATION_MIXER_LAYER_CLIPS];
+		};
+
+		AnimationMixer(unsigned int iJointCount, const int* pParents);
+		AnimationMixer(const AnimationMixer& copy);
+
+		ClipState*				findClip(unsigned int iLayer, const AnimationClip* pClip);
+		ClipState*				addClip(unsigned int iLayer, const AnimationClip* pClip);
+		void					fadeTo(ClipState* pState, float fWeight, float fFadeTime);
+
+		void					sampleLocal(const AnimationClip* pClip, float fTime, Vector3* pPositions, Quaternionf* pOrientations);
+		void					toLocal(Vector3* pPositions, Quaternionf* pOrientations) const;
+		void					toModel(const Vector3* pLocalPositions, const Quaternionf* pLocalOrientations, Vector3* pPositions, Quaternionf* pOrientations) const;
+		float					evaluateLayer(Layer& layer);		// how much of the pose the layer covers, 0 to 1
+
+		unsigned int			m_iJointCount;
+		std::vector<int>		m_vParents;
+		Layer					m_Layers[ANIMATION_MIXER_LAYERS];
+
+		// Parent relative
+		std::vector<Vector3>		m_vBindPositions;
+		std::vector<Quaternionf>	m_vBindOrientations;
+		std::vector<Vector3>		m_vPosePositions;
+		std::vector<Quaternionf>	m_vPoseOrientations;
+		std::vector<Vector3>		m_vLayerPositions;
+		std::vector<Quaternionf>	m_vLayerOrientations;
+		std::vector<Vector3>		m_vSamplePositions;
+		std::vector<Quaternionf>	m_vSampleOrientations;
+
+		// Model space result
+		std::vector<Vector3>		m_vPositions;
+		std::vector<Quaternionf>	m_vOrientations;
+};
+
+#endif
@@ -1,7 +1,7 @@
 #ifndef BASE_H
 #define BASE_H
 
-//#define USE_VAO
+#define USE_VAO
 
 #ifndef USE_VAO
 	//#define USE_VERTEX_POINTERS
@@ -38,6 +38,8 @@ typedef GLuint RenderBufferHandle;	/** Render buffer handle. */
 #define VERTEX_ATTRIBUTE_BLENDWEIGHTS_NAME          "a_blendWeights"
 #define VERTEX_ATTRIBUTE_BLENDINDICES_NAME          "a_blendIndices"
 #define VERTEX_ATTRIBUTE_TEXCOORD_PREFIX_NAME       "a_texCoord"
+#define VERTEX_ATTRIBUTE_INSTANCE_WORLD_NAME        "a_instanceWorld"
+#define VERTEX_ATTRIBUTE_INSTANCE_COLOR_NAME        "a_instanceColor"
 
 #define gl_Vertex 			0
 #define gl_Normal 			1
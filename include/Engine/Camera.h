@@ -5,6 +5,8 @@
 #include "Common/Vectors.h"
 #include "Common/Matrices.h"
 #include "Common/Rectangle.h"
+#include "Common/Frustum.h"
+#include "Common/Ray.h"
 #include "Engine/Transform.h"
 #include "Engine/Node.h"
 
@@ -53,8 +55,9 @@ class Camera {
 		
 		const Matrix4&	getInverseViewMatrix();
 		const Matrix4&	getInverseViewProjectionMatrix();
+		const Frustum&	getFrustum();		// world space, follows the view projection
 
-		void					pickRay(const Rectangle_& viewport, float x, float y/*, Ray* dst*/) ;
+		void					pickRay(const Rectangle_& viewport, float x, float y, Ray* dst);
 
 		void					unproject(const Rectangle_& viewport, float x, float y, float depth, Vector3* dst);
 
@@ -64,6 +67,7 @@ class Camera {
 		Node*				getNode() const;
 		void					setNode(Node* node);
 		void					setDirty(int iDirty);
+		unsigned int			getVersion() const;		// changes whenever the view or projection does, unique across cameras
 	private:
 		Camera(int x, int y, int w, int h, float iFieldOfView, float fNearPlane, float fFarPlane);
 		Camera(int x, int y, int w, int h, float fNearPlane, float fFarPlane);
@@ -88,8 +92,12 @@ class Camera {
 
 		Matrix4			m_MatrixInverseView;
 		Matrix4			m_MatrixInverseViewProjection;
+		Frustum			m_Frustum;
 
 		Node*			m_pNode;
+		unsigned int	m_iVersion;
+
+		static unsigned int	m_iVersionCounter;
 };
 
 #endif
\ No newline at end of file
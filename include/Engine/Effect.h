@@ -24,9 +24,11 @@ class Effect {
 		Uniform*								getUniform(const char* sUniformName) const;
 		Uniform*								getUniform(unsigned int iIndex) const;
 		unsigned int							getUniformCount() const;
+		unsigned int							getUniformBlocks() const;		// UniformBlocks::Block bits the program declares
 
 		static void								QueryAndStoreVertexAttribsMetaData(Effect* pEffect);
 		static void								QueryAndStoreUniforms(Effect* pEffect);
+		static void								QueryAndBindUniformBlocks(Effect* pEffect);
 
 		void									setValue(Uniform* uniform, float value);
 		void									setValue(Uniform* uniform, const float* values, unsigned int count = 1);
@@ -50,6 +52,7 @@ class Effect {
 		std::string								m_sProgramID;
 		std::map<std::string, VertexAttribute>	m_mVertexAttributes;
 		mutable std::map<std::string, Uniform*> m_mUniforms;
+		unsigned int							m_iUniformBlocks;
 };
 
 /**
@@ -65,6 +68,7 @@ public:
 	const char*			getName() { return m_sName.c_str(); };
 	const GLenum		getType() const { return m_eType; };
 	Effect*				getEffect() const { return m_pEffect; }
+	GLint				getLocation() const { return m_iLocation; }		// -1 for uniform block members
 
 private:
 	Uniform(const Uniform& copy);
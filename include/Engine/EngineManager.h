@@ -5,6 +5,9 @@
 #include "Engine/MouseManager.h"
 #include "Engine/Timer.h"
 #include "Engine/Base.h"
+#include "Engine/GLStateCache.h"
+#include "Engine/UniformBlocks.h"
+#include "Engine/MeshBatch.h"
 #ifdef USE_YAGUI
 #include "Engine/UI/WWidgetManager.h"
 #endif
@@ -64,6 +67,10 @@ class EngineManager {
 		void					frame();
 		void					updateFPS();
 		unsigned int		getFPS();
+		unsigned int		getWorldMatrixUpdateCount();		// Node world matrices recomputed during the last frame
+		const GLStateCache::Counters&	getGLStateCounters();	// GL calls issued and filtered during the last frame
+		const UniformBlocks::Stats&		getUniformBlockStats();	// uniform block writes and binds during the last frame
+		const MeshBatch::Stats&			getMeshBatchStats();	// MeshBatch allocations during the last frame
 
 		virtual void			initialize() = 0;
 		virtual void			update(float elapsedTime) = 0;
@@ -92,6 +99,10 @@ class EngineManager {
 
 		unsigned int					m_iFrameCount;
 		unsigned int					m_iFrameRate;
+		unsigned int					m_iWorldMatrixUpdateCount;
+		GLStateCache::Counters			m_GLStateCounters;
+		UniformBlocks::Stats			m_UniformBlockStats;
+		MeshBatch::Stats				m_MeshBatchStats;
 		double							m_dLastElapsedFPSTimeMs;
 };
 
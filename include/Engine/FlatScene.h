@@ -0,0 +1,106 @@
+#ifndef FLATSCENE_H
+#define FLATSCENE_H
+
+#include "Engine/Base.h"
+#include "Common/Vectors.h"
+#include "Common/Matrices.h"
+
+class Scene;
+class Node;
+class Model;
+
+///////////////////////////////////////////////////////////////////////////
+// Data-oriented alternative to a Scene/Node hierarchy for large numbers of
+// static or simply animated objects.
+//
+// Every node attribute lives in parallel arrays indexed the same way and
+// kept sorted parent-before-child (depth-first), so update() resolves all
+// world matrices in one front-to-back sweep and render() draws in array
+// order. Nodes are referred to by NodeHandle, which stays valid until the
+// node is destroyed while array indices move on re-sorting/compaction.
+// Handles carry a generation, so one kept past its node's destruction
+// fails isValid() (and asserts in the accessors) even after the slot was
+// reused, unless the slot went through 4095 reuses in between.
+//
+// Cameras stay regular Nodes of the Scene passed to create(), which also
+// provides the active camera and ambient color for material autobindings.
+// Each model binds to a Node of its own, outside the hierarchy, that
+// update() feeds the resolved world matrix. Per node caches (derived
+// matrices, uniform blocks) therefore stay per model.
+///////////////////////////////////////////////////////////////////////////
+class FlatScene {
+
+	public:
+		typedef unsigned int NodeHandle;
+		static const NodeHandle INVALID_HANDLE = 0xFFFFFFFF;
+
+		virtual ~FlatScene();
+
+		static FlatScene*		create(Scene* pScene);
+
+		NodeHandle				createNode(NodeHandle parent = INVALID_HANDLE);
+		void					destroyNode(NodeHandle handle);		// destroys the whole subtree and its models
+		void					destroyAllNodes();
+		bool					isValid(NodeHandle handle) const;
+		unsigned int			getNodeCount() const;
+
+		void					setParent(NodeHandle handle, NodeHandle parent);
+		NodeHandle				getParent(NodeHandle handle) const;
+
+		// Local transform, same composition as Transform::getTransformedModelMatrix()
+		void					setPosition(NodeHandle handle, const Vector3& vPosition);
+		const Vector3&			getPosition(NodeHandle handle) const;
+		void					setRotation(NodeHandle handle, const Vector3& vAngles);	// degrees around X, Y, Z
+		const Vector3&			getRotation(NodeHandle handle) const;
+		void					setScale(NodeHandle handle, const Vector3& vScale);
+		const Vector3&			getScale(NodeHandle handle) const;
+
+		const Matrix4&			getWorldMatrix(NodeHandle handle) const;	// as of the last update()
+
+		void					setModel(NodeHandle handle, Model* pModel);	// takes ownership
+		Model*					getModel(NodeHandle handle) const;
+		void					setVisible(NodeHandle handle, bool bVisible);
+		bool					isVisible(NodeHandle handle) const;
+
+		void					update();
+		void					render(bool bWireframe = false);
+
+		unsigned int			getWorldMatrixUpdateCount() const;		// recomputed by the last update()
+	private:
+		enum NodeFlags {
+			FLAG_DIRTY_LOCAL = 0x01,
+			FLAG_DIRTY_WORLD = 0x02,
+			FLAG_WORLD_CHANGED = 0x04,		// world was recomputed in the current sweep, children must follow
+			FLAG_VISIBLE = 0x08
+		};
+
+		FlatScene(Scene* pScene);
+		FlatScene(const FlatScene& copy);
+		FlatScene& operator=(const FlatScene&);
+
+		unsigned int			getIndex(NodeHandle handle) const;
+		void					sort();
+		void					compact(const std::vector<bool>& vRemove);
+
+		Scene*						m_pScene;
+
+		// Per node, all indexed alike
+		std::vector<Vector3>		m_vTranslations;
+		std::vector<Vector3>		m_vRotations;
+		std::vector<Vector3>		m_vScales;
+		std::vector<Matrix4>		m_vLocalMatrices;
+		std::vector<Matrix4>		m_vWorldMatrices;
+		std::vector<int>			m_vParents;			// index of the parent, -1 for roots, always less than own index
+		std::vector<Model*>			m_vModels;
+		std::vector<Node*>			m_vBindingNodes;	// autobinding target of the model, NULL without one
+		std::vector<unsigned char>	m_vFlags;
+		std::vector<NodeHandle>		m_vHandles;			// index -> handle
+
+		std::vector<unsigned int>	m_vHandleToIndex;
+		std::vector<NodeHandle>		m_vFreeHandles;
+
+		bool						m_bNeedsSort;
+		unsigned int				m_iWorldMatrixUpdateCount;
+};
+
+#endif
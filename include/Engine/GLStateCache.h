@@ -0,0 +1,130 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include "Engine/Base.h"
+
+///////////////////////////////////////////////////////////////////////////
+// Shadow of the GL state the engine sets while drawing.
+//
+// Effect, Texture, RenderState::StateBlock and SpriteBatch go through
+// here instead of calling GL directly. A call that would set a value the
+// shadow already holds is dropped. Tracked are the current program, the
+// active unit and the texture bound per unit, GL_TEXTURE_2D enable per
+// unit, blend/cull/depth/scissor enables, blend func, depth mask, sampler
+// parameters per texture object and uniform values per program.
+//
+// Code that changes any of this state with raw GL calls must call
+// invalidate() afterwards, the shadow is then rebuilt from scratch by the
+// next calls (every call after invalidate() reaches GL).
+///////////////////////////////////////////////////////////////////////////
+class GLStateCache {
+
+	public:
+		enum CallType {
+			USE_PROGRAM = 0,
+			ACTIVE_TEXTURE,
+			BIND_TEXTURE,
+			ENABLE,					// glEnable and glDisable
+			BLEND_FUNC,
+			DEPTH_MASK,
+			TEX_PARAMETER,
+			UNIFORM,
+			CALL_TYPE_COUNT
+		};
+
+		struct Counters {
+			unsigned int	iIssued[CALL_TYPE_COUNT];		// calls that reached GL
+			unsigned int	iFiltered[CALL_TYPE_COUNT];		// calls dropped as redundant
+
+			unsigned int	getIssuedCount() const;
+			unsigned int	getFilteredCount() const;
+		};
+
+		static const unsigned int MAX_TEXTURE_UNITS = 32;
+
+		static void				useProgram(GLuint hProgram);
+		static void				activeTexture(unsigned int iUnit);		// 0 based, not GL_TEXTUREi
+		static void				bindTexture(GLenum eTarget, GLuint hTexture);	// on the active unit
+		static void				setEnabled(GLenum eCap, bool bEnable);
+		static void				blendFunc(GLenum eSrc, GLenum eDst);
+		static void				depthMask(bool bEnable);
+
+		// Texture object bound to the active unit
+		static void				texParameter(GLenum eTarget, GLuint hTexture, GLenum ePName, GLint iValue);
+
+		// Uniforms of the current program. Returns false when the shadow
+		// already holds the bytes for iLocation, the caller skips glUniform*
+		// then. iLocationCount is the number of locations an array covers.
+		static bool				uniformChanged(GLint iLocation, const void* pData, unsigned int iBytes, unsigned int iLocationCount = 1);
+
+		// Forget GL objects that are about to be deleted
+		static void				programDeleted(GLuint hProgram);
+		static void				textureDeleted(GLuint hTexture);
+
+		static void				invalidate();
+
+		static void				setEnabled(bool bEnable);			// disabled passes every call through
+		static bool				isEnabled();
+
+		static const Counters&	getCounters();
+		static Counters			resetCounters();					// returns the counters collected since the last reset
+	private:
+		enum Cap {
+			CAP_BLEND = 0,
+			CAP_CULL_FACE,
+			CAP_DEPTH_TEST,
+			CAP_SCISSOR_TEST,
+			CAP_COUNT
+		};
+
+		// Zero is unknown so the zero initialized statics start out unknown
+		enum TriState {
+			STATE_UNKNOWN = 0,
+			STATE_OFF,
+			STATE_ON
+		};
+
+		struct TextureParameters {
+			GLint		iWrapS;
+			GLint		iWrapT;
+			GLint		iMinFilter;
+			GLint		iMagFilter;
+		};
+
+		struct UniformSlot {
+			std::vector<unsigned char>	vData;			// empty = unknown
+			GLint						iOwner;			// first location of the array covering this one, -1 = none
+		};
+
+		typedef std::vector<UniformSlot>	UniformTable;
+
+		GLStateCache();
+
+		static bool				filter(CallType eType, bool bRedundant);
+		static int				getCapIndex(GLenum eCap);
+		static GLint*			getTextureParameter(GLuint hTexture, GLenum ePName);
+
+		static bool				m_bEnabled;
+		static Counters			m_Counters;
+
+		static GLuint			m_hProgram;
+		static bool				m_bProgramKnown;
+		static UniformTable*	m_pUniforms;		// table of m_hProgram
+
+		static unsigned int		m_iActiveUnit;
+		static bool				m_bActiveUnitKnown;
+		static GLuint			m_hTextures[MAX_TEXTURE_UNITS];
+		static bool				m_bTextureKnown[MAX_TEXTURE_UNITS];
+		static int				m_iTexture2DEnabled[MAX_TEXTURE_UNITS];
+
+		static int				m_iCaps[CAP_COUNT];
+		static GLenum			m_eBlendSrc;
+		static GLenum			m_eBlendDst;
+		static bool				m_bBlendFuncKnown;
+		static int				m_iDepthMask;
+
+		static std::map<GLuint, UniformTable>			m_mUniformTables;
+		static std::vector<TextureParameters>			m_vTextureParameters;	// by texture name
+};
+
+#endif
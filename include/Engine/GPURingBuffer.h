@@ -0,0 +1,78 @@
+#ifndef GPU_RING_BUFFER_H
+#define GPU_RING_BUFFER_H
+
+#include "Engine/Base.h"
+
+///////////////////////////////////////////////////////////////////////////
+// Buffer object for data written by the CPU once and read by the GPU in
+// the same frame (per-draw uniforms, streamed vertices).
+//
+// The storage is split into segments, one per frame in flight. Writes go
+// to the current segment at increasing offsets through unsynchronized
+// range mappings; a segment is written again only after the fence placed
+// at the end of its frame has signalled, so the driver never has to wait
+// or copy. When a segment runs out of space the whole buffer is orphaned
+// and writing restarts at its beginning.
+//
+// beginFrame() moves on once per frame counted by advanceFrame(), which
+// EngineManager calls, so every user of a ring may call it. endFrame()
+// likewise fences the segment after the last draw reading from it.
+///////////////////////////////////////////////////////////////////////////
+class GPURingBuffer {
+
+	public:
+		~GPURingBuffer();
+		static GPURingBuffer*	create(GLenum eTarget, unsigned int iSegmentSize, unsigned int iSegmentCount = 3);
+
+		static void				advanceFrame();
+
+		void					beginFrame();		// moves to the next segment, waits until the GPU released it
+		void					endFrame();			// fences the segment written this frame
+
+		// Reserves iBytes at an offset aligned to iAlignment and maps them.
+		// Returns NULL when the request is larger than a segment.
+		void*					map(unsigned int iBytes, unsigned int iAlignment, unsigned int* pOffset);
+		void					unmap();
+
+		bool					write(const void* pData, unsigned int iBytes, unsigned int iAlignment, unsigned int* pOffset);
+
+		// Copies iBytes at iOffset of pSource to the start of the current
+		// segment, which must be empty, for data still to be drawn when a
+		// ring is replaced. Returns the offset of the copy.
+		unsigned int			adopt(const GPURingBuffer* pSource, unsigned int iOffset, unsigned int iBytes);
+
+		// True when map() of iBytes would fit the current segment without
+		// orphaning the buffer
+		bool					fits(unsigned int iBytes, unsigned int iAlignment) const;
+
+		GLuint					getBuffer() const;
+		GLenum					getTarget() const;
+		unsigned int			getSegmentSize() const;
+
+		// Bumped whenever earlier offsets stop being valid (buffer orphaned)
+		unsigned int			getGeneration() const;
+		unsigned int			getOrphanCount() const;		// segment overflows since creation
+	private:
+		GPURingBuffer(GLenum eTarget, unsigned int iSegmentSize, unsigned int iSegmentCount);
+		GPURingBuffer(const GPURingBuffer& copy);
+		GPURingBuffer& operator=(const GPURingBuffer&);
+
+		void					orphan();
+		void					deleteFences();
+
+		GLenum					m_eTarget;
+		GLuint					m_hBuffer;
+		unsigned int			m_iSegmentSize;
+		unsigned int			m_iSegmentCount;
+		unsigned int			m_iSegment;
+		unsigned int			m_iHead;			// next free byte in the current segment
+		std::vector<GLsync>		m_vFences;			// per segment, NULL = free
+		unsigned int			m_iGeneration;
+		unsigned int			m_iOrphanCount;
+		unsigned int			m_iBegunFrame;		// frame of the last segment change
+		bool					m_bMapped;
+
+		static unsigned int		m_iFrame;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef INSTANCED_MODEL_H
+#define INSTANCED_MODEL_H
+
+#include "Engine/Base.h"
+#include "Common/Matrices.h"
+
+class Model;
+class Pass;
+class Effect;
+class VertexAttributeBinding;
+
+///////////////////////////////////////////////////////////////////////////
+// Draws many copies of a Model's mesh, one draw call per mesh part and
+// pass whatever the instance count.
+//
+// Per instance world matrices and colors go to an instance VBO read
+// through a_instanceWorld (mat4 holding the rows of Matrix4::m) and
+// a_instanceColor, both advancing once per instance. The model's
+// materials opt in with the INSTANCING define of textured.vert; the model
+// keeps its own node binding for the camera.
+//
+// Without ARB_instanced_arrays/ARB_draw_instanced the instances are
+// transformed on the CPU into one merged vertex array, drawn with
+// a_instanceWorld held at identity and a_instanceColor per vertex, so the
+// same materials work on both paths. That path transforms float
+// positions, normals, tangents and binormals, packed elements are copied
+// as they are.
+///////////////////////////////////////////////////////////////////////////
+class InstancedModel {
+
+	public:
+		// Layout of the instance VBO
+		struct Instance {
+			float			world[16];		// Matrix4::m
+			float			color[4];
+		};
+
+		~InstancedModel();
+		static InstancedModel*	create(Model* pModel, unsigned int iMaxInstances);	// pModel is not owned
+		static bool				isHardwareInstancingSupported();
+
+		Model*					getModel() const;
+		unsigned int			getMaxInstances() const;
+		unsigned int			getInstanceCount() const;
+		bool					isHardwareInstanced() const;
+
+		// Replaces all instances, pColors may be NULL for white. Instances past
+		// getMaxInstances() are dropped.
+		void					setInstances(const Matrix4* pWorldMatrices, const Vector4* pColors, unsigned int iCount);
+		void					draw();
+	private:
+		struct PassBinding {
+			Pass*					pPass;
+			Effect*					pEffect;		// the binding is rebuilt when the pass changes effect
+			VertexAttributeBinding*	pBinding;
+		};
+
+		InstancedModel(Model* pModel, unsigned int iMaxInstances, bool bHardware);
+		InstancedModel(const InstancedModel& copy);
+
+		VertexAttributeBinding*	getBinding(Pass* pPass);
+		void					drawPart(int iPartIndex);
+
+		// CPU fallback
+		void					readSource();
+		void					merge();
+
+		Model*					m_pModel;
+		unsigned int			m_iMaxInstances;
+		unsigned int			m_iInstanceCount;
+		bool					m_bHardware;
+
+		std::vector<Instance>	m_vInstances;
+		VBOHandle				m_hInstanceVBO;
+		std::vector<PassBinding>	m_vBindings;
+
+		// Merged arrays are sized for m_iMaxInstances up front so the client
+		// pointers held by the bindings stay valid.
+		std::vector<float>		m_vSourceVertices;
+		std::vector<float>		m_vMergedVertices;
+		std::vector<float>		m_vMergedColors;
+		std::vector< std::vector<unsigned int> >	m_vMergedIndices;	// per mesh part
+		std::vector<unsigned int>					m_vPartIndexCounts;
+		bool					m_bMergeDirty;
+};
+
+#endif
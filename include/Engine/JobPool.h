@@ -0,0 +1,53 @@
+#ifndef JOB_POOL_H
+#define JOB_POOL_H
+
+#include "Engine/Base.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+///////////////////////////////////////////////////////////////////////////
+// A fixed set of worker threads running batches of numbered jobs.
+//
+// run() hands the job indices [0, iJobCount) to the workers and to the
+// calling thread through one atomic counter and returns once every job
+// has finished. Jobs writing to disjoint parts of a shared buffer need no
+// further synchronization, the caller sees all their writes after run().
+// Jobs run off the GL thread and must not make GL calls.
+///////////////////////////////////////////////////////////////////////////
+class JobPool {
+
+	public:
+		typedef void (*JobFunction)(void* pContext, unsigned int iJob);
+
+		~JobPool();
+		static JobPool*		create(unsigned int iThreadCount);		// includes the calling thread, 1 runs every job inline
+		static unsigned int	getHardwareThreadCount();
+
+		unsigned int		getThreadCount() const;
+		void				run(JobFunction pFunction, void* pContext, unsigned int iJobCount);
+	private:
+		JobPool(unsigned int iThreadCount);
+		JobPool(const JobPool& copy);
+
+		void				workerMain();
+		void				execute();
+
+		std::vector<std::thread>	m_vThreads;
+
+		std::mutex					m_Mutex;
+		std::condition_variable		m_WakeCondition;
+		std::condition_variable		m_DoneCondition;
+		unsigned int				m_iGeneration;		// one per run(), wakes the workers
+		unsigned int				m_iBusyWorkers;
+		bool						m_bQuit;
+
+		JobFunction					m_pFunction;
+		void*						m_pContext;
+		unsigned int				m_iJobCount;
+		std::atomic<unsigned int>	m_iNextJob;
+};
+
+#endif
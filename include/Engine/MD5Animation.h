@@ -5,22 +5,35 @@
 #include "Common/CCString.h"
 #include "Common/Vectors.h"
 #include "Common/Quaternion.h"
+#include "Common/Bounds.h"
+#include "Engine/AnimationClip.h"
 #include <vector>
 
+class MappedFile;
+
+/////////////////////////////////////////////////////////////////////////////
+// An md5anim, baked at load time into an AnimationClip of model space
+// joint poses. The per frame skeletons are only built while loading.
+//
+// Animations are immutable once loaded and shared: create() returns the
+// cached instance for a file and format with one more reference, and
+// release() frees it with the last one. Playback time and poses belong to
+// each MD5Model. Loading and releasing happen on the main thread.
+//
+// The first load of a file bakes it through MD5Binary; later loads map the
+// baked file and sample its clip in place, skipping the text.
+//
+// getBounds() serves the per frame bounds of the file, so a model can be
+// culled at any time of the animation without posing it.
+/////////////////////////////////////////////////////////////////////////////
 class MD5Animation {
 
 	public:
-		MD5Animation();
-		virtual ~MD5Animation();
-
-		// Load an animation from the animation file
-		bool		loadAnimation(const char* sFileName);
+		// NULL if the file can't be read
+		static MD5Animation*	create(const char* sFileName, AnimationClip::Format eFormat = AnimationClip::FORMAT_FLOAT);
 
-		// Update this animation's joint set.
-		void		update(float fDeltaTime);
-
-		// Draw the animated skeleton
-		void		render();
+		void		addRef();
+		void		release();
 
 		// The JointInfo stores the information necessary to build the 
 		// skeletons for each frame
@@ -76,33 +89,52 @@ class MD5Animation {
 		};
 		typedef std::vector<FrameSkeleton*>		FrameSkeletonList;
 
-		const FrameSkeleton*	getSkeletion() const {
-			return m_pAnimatedSkeleton;
-		}
-
 		int	getNumJoints() const {
 			return m_iNumJoints;
 		}
 
 		const JointInfo*	getJointInfo(unsigned int iIndex) const {
-			GP_ASSERT( iIndex > 0 && iIndex < m_vJointInfos.size() );
+			GP_ASSERT( iIndex < m_vJointInfos.size() );
 			return m_vJointInfos[iIndex];
 		}
+
+		const AnimationClip*	getClip() const {
+			return m_pClip;
+		}
+
+		// Model space box around the pose at fTime seconds, wrapped like the
+		// clip: the bounds of the two frames it lies between. False if the
+		// file has no bounds.
+		bool		getBounds(float fTime, BoundingBox* pBox) const;
 	protected:
 
 		JointInfoList				m_vJointInfos;
 		BoundList					m_vBounds;
 		BaseFrameList			m_vBaseFrames;
 		FrameDataList			m_vFrames;
-		FrameSkeletonList		m_vSkeletons;			// All the skeletons for all the frames
+		FrameSkeletonList		m_vSkeletons;			// All the skeletons for all the frames, while loading
 
-		FrameSkeleton*			m_pAnimatedSkeleton;
+		AnimationClip*			m_pClip;
+		MappedFile*				m_pMapping;				// holds the clip's poses when loaded baked
 
 		// Build the frame skeleton for a particular frame
 		void		buildFrameSkeleton( FrameSkeletonList& skeletons, const JointInfoList& jointInfo, const BaseFrameList& baseFrames, const FrameData* frameData );
-		void		interpolateSkeletons( FrameSkeleton* finalSkeleton, const FrameSkeleton* skeleton0, const FrameSkeleton* skeleton1, float fInterpolate );
+		void		bakeClip( AnimationClip::Format eFormat );
+		void		clear();
 
 	private:
+		MD5Animation();
+		MD5Animation(const MD5Animation& copy);
+		virtual ~MD5Animation();
+
+		// Load an animation from the animation file
+		bool		loadAnimation(const char* sFileName, AnimationClip::Format eFormat);
+		bool		loadBinary(const char* sFileName, AnimationClip::Format eFormat);
+		bool		writeBinary(const char* sFileName) const;
+
+		std::string	m_sCacheKey;
+		int			m_iRefCount;
+
 		int		m_iMD5Version;
 		int		m_iNumFrames;
 		int		m_iNumJoints;
@@ -111,7 +143,6 @@ class MD5Animation {
 
 		float		m_fAnimDuration;
 		float		m_fFrameDuration;
-		float		m_fAnimTime;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,93 @@
+#ifndef MD5_BINARY_H
+#define MD5_BINARY_H
+
+#include "Engine/Base.h"
+#include <vector>
+#include <string>
+
+class MappedFile;
+
+// Bumped whenever a payload layout changes, older files are baked again
+#define MD5_BINARY_VERSION			1
+#define MD5_BINARY_MESH_MAGIC		0x424D3544		// "D5MB"
+#define MD5_BINARY_ANIM_MAGIC		0x4241354D		// "M5AB"
+#define MD5_BINARY_NAME_SIZE		64
+#define MD5_BINARY_SHADER_SIZE		128
+
+///////////////////////////////////////////////////////////////////////////
+// The baked form of md5mesh and md5anim files, written next to the text
+// file with a 'b' appended to its name ("walk7.md5animb").
+//
+// A header stamps the payload with the format version, the size and
+// modification time of the text file it came from, and an FNV-1a checksum
+// of the payload.
+// open() maps the file and only hands it out when all of them match, so a
+// stale or damaged file falls back to the text and is baked again.
+//
+// Payloads are flat arrays of 4 byte fields in the layout the runtime
+// uses, MD5Model and MD5Animation define their contents.
+///////////////////////////////////////////////////////////////////////////
+class MD5Binary {
+
+	public:
+		struct Header {
+			unsigned int	iMagic;
+			unsigned int	iVersion;
+			unsigned int	iSourceSize;
+			unsigned int	iSourceTime;
+			unsigned int	iPayloadSize;
+			unsigned int	iChecksum;
+		};
+
+		// Walks a mapped payload, NULL once a read would run past its end
+		class Reader {
+			public:
+				Reader(const unsigned char* pData, unsigned int iSize)
+					: m_pCursor(pData)
+					, m_pEnd(pData + iSize)
+				{ }
+
+				template<typename T>
+				const T*	read(unsigned int iCount = 1) {
+					unsigned int iSize = iCount * sizeof(T);
+					if(m_pCursor == NULL || (unsigned int)(m_pEnd - m_pCursor) < iSize) {
+						m_pCursor = NULL;
+						return NULL;
+					}
+					const T* p = (const T*)m_pCursor;
+					m_pCursor += iSize;
+					return p;
+				}
+
+				bool		isValid() const { return m_pCursor != NULL; }
+			private:
+				const unsigned char*	m_pCursor;
+				const unsigned char*	m_pEnd;
+		};
+
+		// Whether loads try the baked files and write them, on by default
+		static void				setEnabled(bool bEnabled);
+		static bool				isEnabled();
+
+		static std::string		getPath(const char* sSourceFile);
+
+		// The payload of a valid baked file sits at getData() + sizeof(Header)
+		static MappedFile*		open(const char* sSourceFile, unsigned int iMagic);
+		static bool				write(const char* sSourceFile, unsigned int iMagic, const std::vector<unsigned char>& vPayload);
+
+		template<typename T>
+		static void				append(std::vector<unsigned char>& vPayload, const T* pData, unsigned int iCount = 1) {
+			const unsigned char* pBytes = (const unsigned char*)pData;
+			vPayload.insert(vPayload.end(), pBytes, pBytes + iCount * sizeof(T));
+		}
+
+		static unsigned int		checksum(const unsigned char* pData, unsigned int iSize);
+	private:
+		MD5Binary();
+
+		static bool				getSourceStamp(const char* sSourceFile, unsigned int* pSize, unsigned int* pTime);
+
+		static bool				m_bEnabled;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef MD5_LOAD_BENCHMARK_H
+#define MD5_LOAD_BENCHMARK_H
+
+#include "Engine/Base.h"
+
+///////////////////////////////////////////////////////////////////////////
+// Compares loading an md5mesh and an md5anim from their text against
+// their MD5Binary baked files.
+// Needs a current GL context, the mesh times cover MD5Model::loadModel()
+// with its vertex buffer. Every load starts cold for the caches, the model
+// or animation of the previous one is freed first. One untimed load bakes
+// the files before the baked loads are timed.
+///////////////////////////////////////////////////////////////////////////
+class MD5LoadBenchmark {
+
+	public:
+		struct Result {
+			unsigned int	iLoadCount;
+			double			dTextMeshMs;			// per load
+			double			dBinaryMeshMs;
+			double			dTextAnimMs;
+			double			dBinaryAnimMs;
+		};
+
+		static bool		run(const char* sMeshPath, const char* sAnimPath, unsigned int iLoadCount, Result* pResult);
+		static void		runAll(const char* sMeshPath, const char* sAnimPath);		// printed to stdout
+	private:
+		MD5LoadBenchmark();
+
+		static bool		loadMesh(const char* sMeshPath);
+		static bool		loadAnim(const char* sAnimPath);
+};
+
+#endif
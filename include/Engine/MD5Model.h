@@ -5,43 +5,116 @@
 #include "Common/Vectors.h"
 #include "Common/Matrices.h"
 #include "Common/Quaternion.h"
+#include "Common/DualQuaternion.h"
 #include "Common/CCString.h"
 #include "Common/RandomAccessFile.h"
+#include "Common/Bounds.h"
 #include "Engine/MD5Animation.h"
+#include "Engine/AnimationMixer.h"
 #include <vector>
 
+// Joints a GPU skinned model may have, matches the default SKINNING_JOINT_COUNT
+// of textured.vert
+#define MD5_MAX_GPU_JOINTS			128
+// Vertex uniform vectors kept free for the rest of the material
+#define MD5_RESERVED_UNIFORM_VECTORS	32
+// Vertices per CPU skinning job of updateAll()
+#define MD5_SKINNING_JOB_VERTICES		2048
+
+/////////////////////////////////////////////////////////////////////////////
+// Loads an md5mesh and plays an md5anim on it.
+//
+// SKINNING_CPU blends every vertex into a dynamic VBO each update.
+// SKINNING_GPU converts the weights at load time into the four strongest
+// influences per vertex (a_blendIndices/a_blendWeights) and only updates
+// the joint palette, which the materials read through the MATRIX_PALETTE
+// autobinding with the SKINNING define of textured.vert. Models with more
+// joints than the vertex uniforms can hold fall back to the CPU.
+//
+// updateAll() advances many models at once on a JobPool: one job per
+// animation, then the CPU skinned vertices cut into ranges of
+// MD5_SKINNING_JOB_VERTICES, each job writing its own part of the
+// model's staging copy. Every model is uploaded once afterwards from the
+// calling thread. A range is skinned joint by joint: the weights of each
+// joint go through BatchMath::transformPoints with the joint matrix and
+// are added to their vertices scaled by their bias.
+//
+// getMixer() plays layered and crossfaded AnimationClips instead of the
+// model's own animation while any of its clips is playing. Clips are only
+// read, so one loaded MD5Animation can feed the mixers of every instance.
+//
+// Models loading the same md5mesh share one MeshData: joints, weights,
+// triangles and the bind pose, read once and freed with the last model.
+// Animations are shared the same way through MD5Animation::create(). A
+// model only keeps its playback time, pose, palette and vertex buffer.
+// The first read of an md5mesh bakes it through MD5Binary, with the bind
+// pose, inverse bind pose and joint radii already computed; later reads
+// copy the mapped baked file instead of parsing the text.
+//
+// While the model's own animation plays, GPU skinned and skipped models
+// take their mesh bounds from the md5anim's per frame bounds, so their
+// nodes cull with the pose without skinning anything.
+// skipUpdate() and setLeafJointsDropped() are the animation LOD that
+// MD5UpdateScheduler drives: a skipped model only advances its bounds and
+// catches the time up on its next update, and dropped leaf joints are not
+// sampled but follow their parents as in the bind pose, through a dual
+// quaternion kept per leaf. The mixer always poses every joint.
 /////////////////////////////////////////////////////////////////////////////
 class Node;
 class Mesh;
 class Model;
+class JobPool;
 
 class MD5Model {
 
 	public:
+		enum SkinningMode {
+			SKINNING_CPU,
+			SKINNING_GPU
+		};
+
 		MD5Model()
-			: m_iMD5Version(10)
-			, m_iNumJoints(0)
-			, m_iNumMeshes(0)
+			: m_pMeshData(NULL)
 			, m_bHasAnimation(false)
+			, m_fAnimTime(0.0f)
 			, m_LocalToWorldMatrix()
 			, m_pMD5Animation(NULL)
 			, m_pModel(NULL)
 			, m_iStride(0)
+			, m_eSkinningMode(SKINNING_CPU)
+			, m_pPose(NULL)
+			, m_pMixer(NULL)
+			, m_bMixing(false)
+			, m_fSkippedTime(0.0f)
+			, m_bLeafJointsDropped(false)
 		{
-			m_Joints.clear();
-			m_Meshes.clear();
-
-			m_pMD5Animation = new MD5Animation();
 		};
 
 		~MD5Model();
 
 		Node*			loadModel( const char* sFileName );
-		bool				loadAnim( const char* sFileName );
+		bool				loadAnim( const char* sFileName, AnimationClip::Format eFormat = AnimationClip::FORMAT_FLOAT );
 		bool				checkAnimation( MD5Animation* pMD5Animation );
 		void				update( float fDeltaTime );
+		static void		updateAll( MD5Model** ppModels, unsigned int iCount, float fDeltaTime, JobPool* pPool = NULL );	// no pool runs on the calling thread
 		void				render();
 
+		// Set before loadModel(), getSkinningMode() then tells the mode in use
+		void				setSkinningMode( SkinningMode eMode );
+		SkinningMode	getSkinningMode() const;
+		static unsigned int	getMaxGPUJoints();
+		unsigned int		getVertexCount() const;
+
+		// Created on first use, after loadModel()
+		AnimationMixer*	getMixer();
+
+		// Animation LOD, fDeltaTime in ms like update()
+		void				skipUpdate( float fDeltaTime );
+		void				setLeafJointsDropped( bool bDropped );
+		bool				getLeafJointsDropped() const;
+
+		Node*			getNode() const;
+
 		static void		computeQuatW( Quaternionf& qOrient );
 	protected:
 		typedef std::vector<Vector3>		PositionBuffer;
@@ -138,23 +211,111 @@ class MD5Model {
 			IndexBuffer		m_IndexBuffer;		// Vertex index buffer
 		};
 		typedef std::vector<Mesh_*>	MeshList;
+
+		// Weights of one joint, transformed by its matrix in one batch
+		struct SkinRun {
+			unsigned int	iJoint;
+			unsigned int	iFirst;
+			unsigned int	iCount;
+		};
+
+		// An md5mesh as read from the file, shared by every model loading it
+		struct MeshData {
+			MeshData()
+				: m_iRefCount(1)
+				, m_iMD5Version(10)
+				, m_iNumJoints(0)
+				, m_iNumMeshes(0)
+				, m_iNumVertices(0)
+			{ }
+			~MeshData();
+
+			std::string			m_sPath;
+			int					m_iRefCount;
+
+			int					m_iMD5Version;
+			int					m_iNumJoints;
+			int					m_iNumMeshes;
+			unsigned int		m_iNumVertices;
+
+			JointList			m_Joints;
+			MeshList			m_Meshes;
+
+			std::vector<unsigned int>	m_vMeshVertexStart;		// first vertex of each Mesh_ in the VBO
+			std::vector<float>			m_vInverseBindPose;		// 3x4 rows per joint
+			std::vector<float>			m_vJointRadii;			// farthest bind pose vertex each joint moves
+
+			// Joints without children, for dropping them at a distance
+			std::vector<unsigned short>	m_vInnerJoints;			// roots and joints with children
+			std::vector<unsigned short>	m_vLeafJoints;
+			std::vector<unsigned char>	m_vLeafJointFlags;		// per joint, 1 for leaves
+			std::vector<DualQuaternionf>	m_vLeafBindTransforms;	// per joint, relative to the parent in the bind pose
+
+			// CPU skinning, the weights of each block of MD5_SKINNING_JOB_VERTICES
+			// grouped into one run per joint, positions in joint space as streams
+			std::vector<float>			m_vSkinX;
+			std::vector<float>			m_vSkinY;
+			std::vector<float>			m_vSkinZ;
+			std::vector<float>			m_vSkinBias;
+			std::vector<unsigned int>	m_vSkinVertex;			// VBO vertex each weight adds to
+			std::vector<SkinRun>		m_vSkinRuns;
+			std::vector<unsigned int>	m_vSkinBlockRuns;		// first run of each block, and the run count last
+		};
+
+		static MeshData*	acquireMeshData( const char* sFileName );		// cached, or read
+		static void		releaseMeshData( MeshData* pData );
+		static MeshData*	readMeshData( const char* sFileName );
+		static MeshData*	readBinaryMeshData( const char* sFileName );
+		static bool		writeBinaryMeshData( const MeshData* pData, const char* sFileName );
+		static void		computeLeafJoints( MeshData* pData );
+		static void		computeSkinRuns( MeshData* pData );
 	
 		// Prepare the mesh for rendering
 		// Compute vertex positions and normals
-		bool		updateMesh( Mesh_* mesh );
-		bool		updateMesh( const MD5Animation::FrameSkeleton* pFrameSkeleton );
-		bool		updateNormals( Mesh_* mesh );
+		static bool	updateMesh( const JointList& joints, Mesh_* mesh );
+		static bool	updateNormals( Mesh_* mesh );
+
+		// CPU skinning, jobs write disjoint ranges of m_vStaging, each one block of m_vSkinBlockRuns
+		void		skinVertices( const MD5Animation::FrameSkeleton* pFrameSkeleton, unsigned int iFirst, unsigned int iCount, BoundingBox* pBox );
+		void		uploadVertices( const BoundingBox& poseBox );
+
+		// GPU skinning
+		static void	computeBindPose( MeshData* pData );
+		void		computeBlendWeights( const Mesh_* pMesh, const Vertex* pVertex, float* pIndices, float* pWeights ) const;
+		bool		updatePalette( const MD5Animation::FrameSkeleton* pFrameSkeleton );
+		bool		updateAnimationBounds( float fTime );		// false without md5anim bounds
+		static void	jointToMatrix( const Quaternionf& qOrient, const Vector3& vPos, float* pRows );
 
 		Node*	createModel();
 	private:
-		int					m_iMD5Version;
-		int					m_iNumJoints;
-		int					m_iNumMeshes;
+		struct AnimateContext {
+			MD5Model**		ppModels;
+			float			fDeltaTime;
+		};
 
-		bool					m_bHasAnimation;
+		struct SkinningJob {
+			MD5Model*		pModel;
+			unsigned int	iFirst;
+			unsigned int	iCount;
+			BoundingBox		box;		// of the vertices skinned by the job
+		};
+
+		static void	animateJob( void* pContext, unsigned int iJob );
+		static void	skinJob( void* pContext, unsigned int iJob );
+		static void	runJobs( JobPool* pPool, void (*pFunction)(void*, unsigned int), void* pContext, unsigned int iJobCount );
 
-		JointList			m_Joints;
-		MeshList			m_Meshes;
+		bool		isAnimated() const;
+		void		samplePose( const AnimationClip* pClip, float fTime );
+		void		setPose( const Vector3* pPositions, const Quaternionf* pOrientations );
+		void		poseLeafJoints( Vector3* pPositions, Quaternionf* pOrientations ) const;
+
+		static std::vector<SkinningJob>		m_vSkinningJobs;		// reused by every updateAll()
+		static std::map<std::string, MeshData*>	m_MeshDataCache;
+
+		MeshData*			m_pMeshData;
+
+		bool					m_bHasAnimation;
+		float					m_fAnimTime;			// in seconds
 
 		MD5Animation*	m_pMD5Animation;
 		Model*				m_pModel;
@@ -162,6 +323,22 @@ class MD5Model {
 		Matrix4				m_LocalToWorldMatrix;			
 
 		int					m_iStride;
+
+		SkinningMode		m_eSkinningMode;
+		std::vector<Vector4>	m_vMatrixPalette;		// animated joint * inverse bind pose, 3 rows per joint
+
+		std::vector<float>			m_vStaging;				// CPU skinned vertices, uploaded in one piece
+
+		// The animation's or the mixer's pose, skinned by this model
+		MD5Animation::FrameSkeleton*	m_pPose;
+		std::vector<Vector3>			m_vPosePositions;
+		std::vector<Quaternionf>		m_vPoseOrientations;
+
+		AnimationMixer*					m_pMixer;
+		bool							m_bMixing;				// m_pMixer had clips at the last update
+
+		float							m_fSkippedTime;			// ms passed to skipUpdate() since the last update
+		bool							m_bLeafJointsDropped;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef MD5_SKINNING_BENCHMARK_H
+#define MD5_SKINNING_BENCHMARK_H
+
+#include "Engine/Base.h"
+
+///////////////////////////////////////////////////////////////////////////
+// Measures CPU skinned vertices per second through MD5Model::updateAll()
+// with a JobPool of 1, 2, 4 and 8 threads.
+// Needs a current GL context for the meshes; every frame advances all
+// instances by 1/60 s and uploads them, the time covers animation,
+// skinning jobs and uploads. One warm up frame sizes the job list.
+///////////////////////////////////////////////////////////////////////////
+class MD5SkinningBenchmark {
+
+	public:
+		struct Result {
+			unsigned int	iInstanceCount;
+			unsigned int	iThreadCount;
+			unsigned int	iFrameCount;
+			unsigned int	iVertexCount;			// skinned per frame, all instances
+			double			dUpdateMs;				// per frame
+			double			dVerticesPerSec;
+		};
+
+		static bool		run(const char* sMeshPath, const char* sAnimPath, unsigned int iInstanceCount, unsigned int iThreadCount, unsigned int iFrameCount, Result* pResult);
+		static void		runAll(const char* sMeshPath, const char* sAnimPath);		// 16 instances, printed to stdout
+	private:
+		MD5SkinningBenchmark();
+};
+
+#endif
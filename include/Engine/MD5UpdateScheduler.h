@@ -0,0 +1,93 @@
+#ifndef MD5_UPDATE_SCHEDULER_H
+#define MD5_UPDATE_SCHEDULER_H
+
+#include "Engine/Base.h"
+#include <vector>
+#include <cfloat>
+
+class MD5Model;
+class Camera;
+class JobPool;
+
+///////////////////////////////////////////////////////////////////////////
+// Decides each frame which MD5Models animate, and how finely, so a crowd
+// costs what can be seen of it.
+//
+// A model whose node is outside the camera frustum only skips the update,
+// its bounds still follow the animation. Visible models pick an LOD from
+// their node's distance to the camera:
+// - below fReducedDistance they update every frame,
+// - from there on every iReducedInterval frames,
+// - from fLeafDistance their leaf joints are dropped,
+// - from fFrozenDistance the pose stays where it is.
+// A skipped model keeps the time it missed and catches up on its next
+// update, so LOD changes never shift an animation.
+//
+// iUpdateBudget caps the models posed in one update(). The due models
+// past it skip this frame, and the ones waiting longest go first on the
+// next, so every model keeps getting its turn. 0 updates all due models.
+//
+// Models are not owned, remove() them before deleting them.
+///////////////////////////////////////////////////////////////////////////
+class MD5UpdateScheduler {
+
+	public:
+		struct Settings {
+			Settings()
+				: fReducedDistance(FLT_MAX)
+				, iReducedInterval(2)
+				, fLeafDistance(FLT_MAX)
+				, fFrozenDistance(FLT_MAX)
+				, iUpdateBudget(0)
+			{ }
+
+			float			fReducedDistance;		// world units from the camera
+			unsigned int	iReducedInterval;		// frames
+			float			fLeafDistance;
+			float			fFrozenDistance;
+			unsigned int	iUpdateBudget;			// models per update(), 0 for no cap
+		};
+
+		// Models of the last update(), each counted once
+		struct Stats {
+			unsigned int	iUpdated;
+			unsigned int	iCulled;
+			unsigned int	iReduced;				// not due at their reduced rate
+			unsigned int	iFrozen;
+			unsigned int	iDeferred;				// due, over the budget
+		};
+
+		~MD5UpdateScheduler();
+		static MD5UpdateScheduler*	create(const Settings& settings = Settings());
+
+		void					setSettings(const Settings& settings);
+		const Settings&			getSettings() const;
+
+		void					add(MD5Model* pModel);
+		void					remove(MD5Model* pModel);
+		unsigned int			getModelCount() const;
+
+		// fDeltaTime in ms. Without a camera every model updates at full
+		// detail, within the budget.
+		void					update(float fDeltaTime, Camera* pCamera, JobPool* pPool = NULL);
+		const Stats&			getStats() const;
+	private:
+		struct Entry {
+			MD5Model*		pModel;
+			unsigned int	iFramesWaiting;		// since its last update
+		};
+
+		MD5UpdateScheduler(const Settings& settings);
+		MD5UpdateScheduler(const MD5UpdateScheduler& copy);
+
+		static bool				waitsLonger(const Entry* pA, const Entry* pB);
+
+		Settings				m_Settings;
+		Stats					m_Stats;
+
+		std::vector<Entry>		m_vEntries;
+		std::vector<Entry*>		m_vDueEntries;		// reused by every update()
+		std::vector<MD5Model*>	m_vDueModels;
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include "Engine/Base.h"
+#include <windows.h>
+
+///////////////////////////////////////////////////////////////////////////
+// A file mapped read only into memory. The pages are read on first touch
+// and stay valid until the MappedFile is deleted.
+///////////////////////////////////////////////////////////////////////////
+class MappedFile {
+
+	public:
+		~MappedFile();
+
+		// NULL if the file can't be opened or is empty
+		static MappedFile*		create(const char* sFileName);
+
+		const unsigned char*	getData() const;
+		unsigned int			getSize() const;
+	private:
+		MappedFile();
+		MappedFile(const MappedFile& copy);
+
+		HANDLE					m_hFile;
+		HANDLE					m_hMapping;
+		const unsigned char*	m_pData;
+		unsigned int			m_iSize;
+};
+
+#endif
@@ -53,8 +53,8 @@ class MaterialParameter {
 		template <class ClassType, class ParameterType>
 		void							bindValue(ClassType* classInstance, ParameterType(ClassType::*valueMethod)() const);
 
-		//template <class ClassType, class ParameterType>
-		//void							bindValue(ClassType* classInstance, ParameterType(ClassType::*valueMethod)() const, unsigned int (ClassType::*countMethod)() const);
+		template <class ClassType, class ParameterType>
+		void							bindValue(ClassType* classInstance, ParameterType(ClassType::*valueMethod)() const, unsigned int (ClassType::*countMethod)() const);
 	private:
 		~MaterialParameter();
 		MaterialParameter&				operator=(const MaterialParameter&);
@@ -160,15 +160,15 @@ void MaterialParameter::bindValue(ClassType* classInstance, ParameterType(ClassT
 	m_Type = MaterialParameter::METHOD;
 }
 
-//template <class ClassType, class ParameterType>
-//void MaterialParameter::bindValue(ClassType* classInstance, ParameterType(ClassType::*valueMethod)() const, unsigned int (ClassType::*countMethod)() const)
-//{
-//	clearValue();
-//
-//	m_Value.method = new MethodArrayBinding<ClassType, ParameterType>(this, classInstance, valueMethod, countMethod);
-//	m_bDynamic = true;
-//	m_Type = MaterialParameter::METHOD;
-//}
+template <class ClassType, class ParameterType>
+void MaterialParameter::bindValue(ClassType* classInstance, ParameterType(ClassType::*valueMethod)() const, unsigned int (ClassType::*countMethod)() const)
+{
+	clearValue();
+
+	m_Value.method = new MethodArrayBinding<ClassType, ParameterType>(this, classInstance, valueMethod, countMethod);
+	m_bDynamic = true;
+	m_Type = MaterialParameter::METHOD;
+}
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -3,6 +3,8 @@
 
 #include "Engine/Base.h"
 #include "Engine/VertexFormat.h"
+#include "Common/Bounds.h"
+#include <atomic>
 
 class MeshPart;
 class VertexAttributeBinding;
@@ -32,13 +34,21 @@ class Mesh {
 		unsigned int			getVertexSize() const;
 		VBOHandle				getVertexBuffer() const;
 		bool						isDynamic() const;
-		GLvoid*					getMapBuffer();
+		GLvoid*					getMapBuffer();		// dynamic meshes come back undefined, write every vertex
 		void						unmapBuffer();
 
 		PrimitiveType			getPrimitiveType() const;
 		void					setPrimitiveType(Mesh::PrimitiveType type);
 		void					setVertexData(const float* vertexData, unsigned int vertexStart, unsigned int vertexCount);
 
+		// Local space bounds, grown by setVertexData() from the POSITION element.
+		// Meshes filled through getMapBuffer() must set them explicitly.
+		const BoundingBox&		getBoundingBox() const;
+		void					setBoundingBox(const BoundingBox& box);
+		const BoundingSphere&	getBoundingSphere() const;
+		void					setBoundingSphere(const BoundingSphere& sphere);
+		unsigned int			getBoundsVersion() const;		// changes with the bounds, unique across meshes
+
 		MeshPart*				addMeshPart(Mesh::PrimitiveType primitiveType, Mesh::IndexFormat indexFormat, unsigned int indexCount, bool isDynamic = false);
 		unsigned int			getMeshPartCount() const;
 		MeshPart*				getMeshPart(unsigned int index);
@@ -46,6 +56,8 @@ class Mesh {
 		Mesh(const VertexFormat& vertexFormat);
 		Mesh(const Mesh& copy);
 
+		void				computeBounds(const float* vertexData, unsigned int vertexCount, bool bMerge);
+
 		const VertexFormat	m_VertexFormat;
 		unsigned int		m_iVertexCount;
 		VBOHandle			m_hVBO;
@@ -54,6 +66,12 @@ class Mesh {
 
 		MeshPart**			m_ppMeshParts;
 		unsigned int		m_iPartCount;
+
+		BoundingBox			m_BoundingBox;
+		BoundingSphere		m_BoundingSphere;
+		unsigned int		m_iBoundsVersion;
+
+		static std::atomic<unsigned int>	m_iBoundsVersionCounter;	// bumped from animation jobs too
 };
 
 #endif
\ No newline at end of file
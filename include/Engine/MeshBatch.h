@@ -9,24 +9,75 @@ class VertexAttributeBinding;
 class Mesh;
 class Texture;
 class Material;
-
+class GPURingBuffer;
+
+///////////////////////////////////////////////////////////////////////////
+// Geometry collected between start() and stop() and drawn by render().
+//
+// Indices are stored as INDEX16 or INDEX32, chosen at creation. They are
+// relative to the sub-draw (chunk) they belong to: an add() that would
+// take the current chunk past the range of the index format starts a new
+// chunk, and render() issues one draw per chunk with the vertex pointers
+// offset to its first vertex. A 16-bit batch can so hold any number of
+// vertices without its indices wrapping.
+//
+// Streaming batches (the default where ARB_map_buffer_range exists) have
+// add() write straight into mapped ranges of a vertex and an index
+// GPURingBuffer, one segment per frame in flight, so nothing is copied
+// again or synchronized at render(). A batch that outgrows its mapped
+// range continues in a new one, which also starts a new chunk. The rings
+// move to their next segment once per frame, however often the batch is
+// started. When they run out mid-frame, larger rings replace them and the
+// chunks not drawn yet are copied over, so draws only ever go out from
+// render().
+//
+// Other batches keep the vertices in client memory. A batch that runs
+// out of capacity grows once to at least twice its size (and never less
+// than the grow size), or straight to what the add() needs. Client
+// storage is kept across frames and goes back to a pool shared by all
+// batches when a batch grows or dies, so batches created again with the
+// same format reuse it. Steady state frames allocate nothing, which the
+// Stats counters show.
+///////////////////////////////////////////////////////////////////////////
 class MeshBatch {
 
 	public:
-		static MeshBatch*		create(const VertexFormat& vertexFormat, Mesh::PrimitiveType primitiveType, const char* materialUrl, bool bIndexed, unsigned int iInitialCapacity = 1024, unsigned int iGrowSize = 1024);
-		static MeshBatch*		create(const VertexFormat& vertexFormat, Mesh::PrimitiveType primitiveType, Material* material, bool bIndexed, unsigned int iInitialCapacity = 1024, unsigned int iGrowSize = 1024);
+		struct Stats {
+			unsigned int		iAllocations;		// heap blocks, chunk lists and rings allocated
+			unsigned int		iAllocatedBytes;
+			unsigned int		iPoolReuses;		// storage taken from the pool instead
+			unsigned int		iResizes;
+		};
+
+		static MeshBatch*		create(const VertexFormat& vertexFormat, Mesh::PrimitiveType primitiveType, const char* materialUrl, bool bIndexed, unsigned int iInitialCapacity = 1024, unsigned int iGrowSize = 1024, Mesh::IndexFormat indexFormat = Mesh::INDEX16);
+		static MeshBatch*		create(const VertexFormat& vertexFormat, Mesh::PrimitiveType primitiveType, Material* material, bool bIndexed, unsigned int iInitialCapacity = 1024, unsigned int iGrowSize = 1024, Mesh::IndexFormat indexFormat = Mesh::INDEX16);
 
 		unsigned int			getCapacity() const;
 		void					setCapacity(unsigned int iCapacity);
+		void					reserve(unsigned int iVertexCount, unsigned int iIndexCount = 0);	// grows once for that much geometry
 		const VertexFormat&		getVertexFormat() const;
+		Mesh::IndexFormat		getIndexFormat() const;
+		unsigned int			getChunkCount() const;		// draws issued per pass by render()
 
+		// Indices of either size are accepted whatever the index format
 		template <class T>
 		void					add(T* vertices, unsigned int vertexCount, unsigned short* pIndices = NULL, unsigned int iIndexCount = 0);
+		template <class T>
+		void					add(T* vertices, unsigned int vertexCount, unsigned int* pIndices, unsigned int iIndexCount);
+		// Vertices already laid out as getVertexFormat(), for packed formats with no matching struct
+		void					addVertices(const void* pVertices, unsigned int vertexCount, const unsigned short* pIndices = NULL, unsigned int iIndexCount = 0);
 
 		void					start();
 		void					stop();
 		void					render();
 
+		bool					isStreaming() const;
+		static void				setStreamingEnabled(bool bEnable);		// for batches created afterwards
+		static bool				isStreamingEnabled();
+
+		static Stats			resetStats();		// returns the stats collected since the last reset
+		static void				purgeStoragePool();	// frees the storage no batch uses
+
 		Material*				getMaterial() const;
 		void					setTexture(const char* path, bool generateMipmaps = false);
 		void					setTexture(Texture* pTexture, bool generateMipmaps = false);
@@ -36,9 +87,36 @@ class MeshBatch {
 
 		~MeshBatch();
 	private:
-		MeshBatch(const VertexFormat& vertexFormat, Mesh::PrimitiveType primitiveType, Material* pMaterial, bool bIndexed, unsigned int iInitialCapacity, unsigned int iGrowSize);
+		MeshBatch(const VertexFormat& vertexFormat, Mesh::PrimitiveType primitiveType, Material* pMaterial, bool bIndexed, unsigned int iInitialCapacity, unsigned int iGrowSize, Mesh::IndexFormat indexFormat);
 		
+		struct Chunk {
+			unsigned int		iVertexOffset;		// bytes into the vertex ring, or into m_pVertices
+			unsigned int		iIndexOffset;		// bytes into the index ring, or into m_pIndices
+			unsigned int		iVertexCount;
+			unsigned int		iIndexCount;
+		};
+
+		struct StorageBlock {
+			unsigned char*		pData;
+			unsigned int		iSize;
+		};
+
 		bool					resize(unsigned int iCapacity);
+		bool					grow(unsigned int iVertexCount, unsigned int iIndexCount);
+		unsigned int			getVertexCapacity(unsigned int iCapacity) const;
+		unsigned int			getCapacityForVertices(unsigned int iVertexCount) const;
+		void					addData(const void* pVertices, unsigned int iVertexCount, const void* pIndices, unsigned int iSourceIndexSize, unsigned int iIndexCount);
+		void					closeChunk();
+		void					drawChunks();
+
+		static unsigned char*	acquireStorage(unsigned int iBytes, unsigned int* pSize);
+		static void				releaseStorage(unsigned char* pData, unsigned int iSize);
+
+		// Streaming
+		void					createRings(unsigned int iSegmentSize);
+		void					mapRange();
+		void					unmapRange();
+		void					nextRange();
 
 		void					updateVertexAttributeBinding();
 		void					setVertexAttributeBinding(VertexAttributeBinding* vaBinding);
@@ -46,6 +124,9 @@ class MeshBatch {
 
 		const VertexFormat&		m_VertexFormat;
 		Mesh::PrimitiveType		m_PrimitiveType;
+		Mesh::IndexFormat		m_IndexFormat;
+		unsigned int			m_iIndexSize;
+		unsigned int			m_iMaxChunkVertices;	// vertices addressable by the index format
 
 		Material*				m_pMaterial;
 		
@@ -62,71 +143,46 @@ class MeshBatch {
 		unsigned char*			m_pVertices;
 		unsigned char*			m_pVerticesPtr;
 
-		unsigned short*			m_pIndices;
-		unsigned short*			m_pIndicesPtr;
+		unsigned char*			m_pIndices;
+		unsigned char*			m_pIndicesPtr;
+
+		unsigned int			m_iVertexStorageSize;	// bytes behind the client arrays
+		unsigned int			m_iIndexStorageSize;
 
 		Texture*				m_pTexture;
+
+		std::vector<Chunk>		m_vChunks;			// filled chunks not drawn yet
+		unsigned int			m_iChunkVertexStart;	// counts when the open chunk began
+		unsigned int			m_iChunkIndexStart;
+		unsigned int			m_iLastIndex;		// last index written, mapped memory is never read back
+
+		bool					m_bStreaming;
+		GPURingBuffer*			m_pVertexRing;
+		GPURingBuffer*			m_pIndexRing;
+		unsigned int			m_iRangeVertexOffset;
+		unsigned int			m_iRangeIndexOffset;
+		bool					m_bMapped;
+		bool					m_bFenced;			// render() fenced the frame's ranges
+
+		static bool				m_bStreamingEnabled;
+		static std::vector<StorageBlock>	m_vStoragePool;
+		static Stats			m_Stats;
 };
 
 template<class T>
 inline void MeshBatch::add(T* vertices, unsigned int vertexCount, unsigned short* pIndices, unsigned int iIndexCount) {
-	GP_ASSERT(vertices);
 	GP_ASSERT(sizeof(T) == m_VertexFormat.getVertexSize());
+	addData(vertices, vertexCount, pIndices, sizeof(unsigned short), iIndexCount);
+}
+
+template<class T>
+inline void MeshBatch::add(T* vertices, unsigned int vertexCount, unsigned int* pIndices, unsigned int iIndexCount) {
+	GP_ASSERT(sizeof(T) == m_VertexFormat.getVertexSize());
+	addData(vertices, vertexCount, pIndices, sizeof(unsigned int), iIndexCount);
+}
 
-	unsigned int newVertexCount = m_iVertexCount + vertexCount;
-	unsigned int newIndexCount = m_iIndexCount + iIndexCount;
-	if (m_PrimitiveType == Mesh::TRIANGLE_STRIP && m_iVertexCount > 0)
-		newIndexCount += 2; // need an extra 2 indices for connecting strips with degenerate triangles
-
-	// Do we need to grow the batch?
-	while (newVertexCount > m_iVertexCapacity || (m_bIndexed && newIndexCount > m_iIndexCapacity))
-	{
-		if (m_iGrowSize == 0)
-			return; // growing disabled, just clip batch
-		if (!resize(m_iCapacity + m_iGrowSize))
-			return; // failed to grow
-	}
-
-	// Copy vertex data.
-	GP_ASSERT(m_pVerticesPtr);
-	unsigned int vBytes = vertexCount * m_VertexFormat.getVertexSize();
-	memcpy(m_pVerticesPtr, vertices, vBytes);
-
-	// Copy index data.
-	if (m_bIndexed)
-	{
-		GP_ASSERT(pIndices);
-		GP_ASSERT(m_pIndicesPtr);
-
-		if (m_iVertexCount == 0)
-		{
-			// Simply copy values directly into the start of the index array.
-			memcpy(m_pIndicesPtr, pIndices, iIndexCount * sizeof(unsigned short));
-		}
-		else
-		{
-			if (m_PrimitiveType == Mesh::TRIANGLE_STRIP)
-			{
-				// Create a degenerate triangle to connect separate triangle strips
-				// by duplicating the previous and next vertices.
-				m_pIndicesPtr[0] = *(m_pIndicesPtr-1);
-				m_pIndicesPtr[1] = m_iVertexCount;
-				m_pIndicesPtr += 2;
-			}
-
-			// Loop through all indices and insert them, with their values offset by
-			// 'vertexCount' so that they are relative to the first newly inserted vertex.
-			for (unsigned int i = 0; i < iIndexCount; ++i)
-			{
-				m_pIndicesPtr[i] = pIndices[i] + m_iVertexCount;
-			}
-		}
-		m_pIndicesPtr += iIndexCount;
-		m_iIndexCount = newIndexCount;
-	}
-
-	m_pVerticesPtr += vBytes;
-	m_iVertexCount = newVertexCount;
+inline void MeshBatch::addVertices(const void* pVertices, unsigned int vertexCount, const unsigned short* pIndices, unsigned int iIndexCount) {
+	addData(pVertices, vertexCount, pIndices, sizeof(unsigned short), iIndexCount);
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -182,7 +182,8 @@ class MeshObjLoader {
 	private:
 		bool	readObjFile();
 		void	fillInObjectInfo();
-		void	computeNormals();
+		void	computeNormals(S3DObject* pObject);		// from the faces, for objects without normals
+		void	normalizeNormals(S3DObject* pObject);		// the normals read from the file
 
 		S3DModel				m_Model;
 
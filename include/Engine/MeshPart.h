@@ -23,7 +23,7 @@ class MeshPart {
 
 		static MeshPart*		create(Mesh* mesh, unsigned int meshIndex, Mesh::PrimitiveType primitiveType, Mesh::IndexFormat indexFormat, unsigned int indexCount, bool isDynamic = false);
 
-		GLvoid*						getMapBuffer();
+		GLvoid*						getMapBuffer();		// dynamic parts come back undefined, write every index
 		void							unmapBuffer();
 	private:
 		MeshPart();
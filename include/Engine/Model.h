@@ -9,6 +9,7 @@ class VertexAttributeBinding;
 class Texture;
 class Node;
 class Material;
+struct Vector4;
 
 class Model {
 
@@ -18,8 +19,9 @@ class Model {
 		static Model*	create(Mesh* pMesh);
 		Mesh*			getMesh() const;
 		unsigned int	getMeshPartCount() const;
-		//Node*			getNode() const;
+		Node*			getNode() const;
 		void			draw(bool bWireFrame = false);
+		void			drawPart(int iPartIndex, bool bWireframe = false);	// geometry only, the caller binds a pass; -1 draws the whole mesh
 
 		void			setVertexAttributeBinding(VertexAttributeBinding* vaBinding);
 		void			setTexture(const char* path, bool generateMipmaps = false);
@@ -31,6 +33,12 @@ class Model {
 		void			setMaterial(Material* pMaterial, int iPartIndex = -1);
 		Material*	getMaterial(int iPartIndex = -1);
 		void			setMaterialNodeBinding(Material* pMaterial);
+
+		// Joint matrices for the MATRIX_PALETTE autobinding, three vec4 rows per
+		// joint. The palette is not owned and must outlive the model's draws.
+		void			setMatrixPalette(const Vector4* pPalette, unsigned int iVectorCount);
+		const Vector4*	getMatrixPalette() const;
+		unsigned int	getMatrixPaletteSize() const;		// in vec4s
 	private:
 		Model(Mesh* pMesh);
 		
@@ -43,6 +51,9 @@ class Model {
 		unsigned int			m_iPartCount;
 		Material*				m_pMaterial;
 		Material**				m_pPartMaterials;
+
+		const Vector4*			m_pMatrixPalette;
+		unsigned int			m_iMatrixPaletteSize;
 };
 
 #endif
\ No newline at end of file
@@ -3,16 +3,35 @@
 
 #include "Engine/Base.h"
 #include "Engine/Transform.h"
+#include "Common/Bounds.h"
 #include <Common/CCString.h>
+#include <atomic>
 
 class Scene;
 class Camera;
 class Model;
 struct Matrix4;
+class Frustum;
+class DynamicAABBTree;
 
 class Node : public Transform {
 
+	friend class FlatScene;
+	friend class Scene;
+	friend class UniformBlocks;
+
 	public:
+		enum NodeDirtyBits {
+			NODE_DIRTY_WORLD = 0x01,
+			NODE_DIRTY_INV_TRANS_WORLD = 0x02,
+			NODE_DIRTY_WORLD_VIEW = 0x04,
+			NODE_DIRTY_WORLD_VIEW_PROJ = 0x08,
+			NODE_DIRTY_INV_TRANS_WORLD_VIEW = 0x10,
+			NODE_DIRTY_BOUNDS = 0x20,
+			NODE_DIRTY_CAMERA = NODE_DIRTY_WORLD_VIEW | NODE_DIRTY_WORLD_VIEW_PROJ | NODE_DIRTY_INV_TRANS_WORLD_VIEW,
+			NODE_DIRTY_ALL = NODE_DIRTY_WORLD | NODE_DIRTY_INV_TRANS_WORLD | NODE_DIRTY_BOUNDS | NODE_DIRTY_CAMERA
+		};
+
 		Node(const char* id);
 		virtual ~Node();
 
@@ -66,12 +85,28 @@ class Node : public Transform {
 		Vector3			getRightVectorWorld() const;
 		Vector3			getUpVectorWorld() const;
 
+		// World space bounds of the model's mesh (empty without a model)
+		const BoundingBox&		getWorldBoundingBox() const;
+		const BoundingSphere&	getWorldBoundingSphere() const;
+		bool			isVisible(const Frustum& frustum) const;	// models without bounds always pass
+
 		void			render(bool bWireframe);
+
+		// Number of world matrices recomputed since the last reset, reset
+		// returns the count it cleared (EngineManager resets it every frame).
+		static unsigned int		getWorldMatrixUpdateCount();
+		static unsigned int		resetWorldMatrixUpdateCount();
 	protected:
+		virtual void	transformChanged();
+
 		Scene*			m_pScene;
 		Node*			m_pNextSibling;
 		Node*			m_pPrevSibling;
 	private:
+		Camera*			validateCameraCache() const;
+		void			validateBounds() const;
+		void			setResolvedWorldMatrix(const Matrix4& world);	// world computed elsewhere (FlatScene), derived matrices follow
+
 		CCString		m_sID;
 
 		Model*			m_pModel;
@@ -83,6 +118,37 @@ class Node : public Transform {
 		unsigned int	m_iChildCount;
 
 		mutable Matrix4	m_MatrixWorld;
+		mutable unsigned int	m_iDirtyBits;
+
+		// Derived matrices for autobindings, the camera dependent ones are
+		// tagged with the active camera and its version when computed.
+		// The const getters fill these caches on demand, and with them the
+		// world matrices of the ancestors and the camera's own matrices. A
+		// node is therefore not safe to read from several threads at once,
+		// nor while another thread reads a node sharing its parents or its
+		// camera, unless those matrices were brought up to date first.
+		mutable Matrix4	m_MatrixWorldView;
+		mutable Matrix4	m_MatrixWorldViewProjection;
+		mutable Matrix4	m_MatrixInverseTransposeWorld;
+		mutable Matrix4	m_MatrixInverseTransposeWorldView;
+		mutable Camera*			m_pCacheCamera;
+		mutable unsigned int	m_iCacheCameraVersion;
+
+		// World bounds, tagged with the mesh bounds version they came from
+		mutable BoundingBox		m_WorldBoundingBox;
+		mutable BoundingSphere	m_WorldBoundingSphere;
+		mutable unsigned int	m_iBoundsVersion;
+
+		// Leaf in the scene's spatial index, refitted when the transform changes
+		DynamicAABBTree*		m_pSpatialIndex;
+		int						m_iSpatialProxy;
+
+		// Where UniformBlocks wrote this node's object block, valid while
+		// the serial matches its own. Reset whenever the world matrix changes.
+		mutable unsigned int	m_iObjectBlockSerial;
+		mutable unsigned int	m_iObjectBlockOffset;
+
+		static std::atomic<unsigned int>	m_iWorldMatrixUpdateCount;
 };
 
 #endif
@@ -27,9 +27,13 @@ class Pass : public RenderState {
 
 		Effect*						getEffect() const;
 
-		void						bind();
+		void						bind(bool bBindEffect = true);		// false when the effect is known to be current
 		void						unbind();
 
+		// Same, with pBinding standing in for the pass's own vertex attribute binding
+		void						bind(VertexAttributeBinding* pBinding, bool bBindEffect = true);
+		void						unbind(VertexAttributeBinding* pBinding);
+
 		Effect*						m_pEffect; //Check how this is been accessed directly in Gameplay even when its private !!!
 	private:
 									Pass(const Pass& copy);
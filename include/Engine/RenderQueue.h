@@ -0,0 +1,119 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "Engine/Base.h"
+
+class Model;
+class Pass;
+class Effect;
+class Material;
+class Texture;
+class Mesh;
+
+///////////////////////////////////////////////////////////////////////////
+// Collects draws for a frame and submits them sorted by state.
+//
+// submit() expands a model into one item per mesh part and technique pass
+// and gives each a 64 bit key. Passes without blending come first, most
+// expensive state change first:
+//
+//	63		0
+//	62..60	pass index		(passes of multi-pass techniques stay in order)
+//	59..50	effect
+//	49..40	texture			(first sampler of the pass chain)
+//	39..29	material
+//	28..16	mesh
+//	15..0	depth			(front to back)
+//
+// Blended passes follow, sorted back to front so they composite as in
+// scene order. State only breaks ties between equal depths:
+//
+//	63		1
+//	62..47	depth			(inverted, back to front)
+//	46..0	pass index, effect, texture, material and mesh as above
+//
+// State objects get small ids in order of first submission each frame.
+// Keys are radix sorted and execute() binds an effect or pass only when
+// it differs from the previous item. Materials are cloned per node, so
+// passes, and with them their textures, are rarely shared between items:
+// in practice the effect bind is what sorting saves.
+///////////////////////////////////////////////////////////////////////////
+class RenderQueue {
+
+	public:
+		struct Stats {
+			unsigned int	iDrawCount;
+			unsigned int	iEffectChanges;
+			unsigned int	iPassChanges;			// RenderState::bind() of the material parameters
+			unsigned int	iTextureChanges;
+			unsigned int	iMeshChanges;
+		};
+
+		~RenderQueue();
+		static RenderQueue*		create();
+
+		void					clear();
+		void					submit(Model* pModel, float fDepth);	// fDepth >= 0, distance from the eye
+		unsigned int			getItemCount() const;
+
+		void					sort();
+		void					execute(bool bWireframe = false);
+
+		void					setSortingEnabled(bool bEnable);	// disabled executes in submission order
+		bool					isSortingEnabled() const;
+
+		// State changes the last executed frame would need in submission
+		// order and the ones execute() actually issued.
+		const Stats&			getUnsortedStats() const;
+		const Stats&			getSortedStats() const;
+	private:
+		struct Item {
+			Model*			pModel;
+			Pass*			pPass;
+			Effect*			pEffect;
+			Texture*		pTexture;
+			Mesh*			pMesh;
+			int				iPartIndex;
+		};
+
+		// Pointer -> dense id, open addressing, reset every frame
+		class IDTable {
+			public:
+				IDTable();
+				void			clear();
+				unsigned int	getID(const void* p);
+			private:
+				void			grow();
+
+				std::vector<const void*>	m_vKeys;
+				std::vector<unsigned int>	m_vIDs;
+				unsigned int				m_iCount;
+		};
+
+		RenderQueue();
+		RenderQueue(const RenderQueue& copy);
+		RenderQueue& operator=(const RenderQueue&);
+
+		void					computeStats(const unsigned int* pOrder, Stats* pStats) const;
+
+		std::vector<Item>				m_vItems;
+		std::vector<unsigned long long>	m_vKeys;
+		std::vector<unsigned int>		m_vOrder;
+
+		// Radix sort scratch, kept so sorting a frame does not allocate
+		std::vector<unsigned long long>	m_vSortKeys;
+		std::vector<unsigned long long>	m_vSortKeysOut;
+		std::vector<unsigned int>		m_vSortOrder;
+
+		IDTable					m_EffectIDs;
+		IDTable					m_TextureIDs;
+		IDTable					m_MaterialIDs;
+		IDTable					m_MeshIDs;
+
+		bool					m_bSortingEnabled;
+		bool					m_bSorted;
+		Stats					m_UnsortedStats;
+		Stats					m_SortedStats;
+};
+
+#endif
@@ -4,6 +4,8 @@
 #include "Engine/Base.h"
 #include "Common/Matrices.h"
 
+class Texture;
+
 class RenderState {
 
 	friend class Material;
@@ -96,6 +98,8 @@ class RenderState {
 		StateBlock*						getStateBlock() const;
 		void							setNodeBinding(Node* node);
 		MaterialParameter*				getParameter(const char* sName) const;
+		Texture*						getPrimaryTexture() const;		// first sampler parameter here or in a parent
+		bool							isBlendEnabled() const;			// blending in effect when bound, here or from a parent
 
 		const char*						autoBindingToString(RenderState::AutoBinding autoBinding);
 		void							setParameterAutoBinding(const char* pName, AutoBinding autoBinding);
@@ -127,6 +131,8 @@ class RenderState {
 		const Matrix4&					autoBindingGetInverseTransposeWorldViewMatrix() const;
 		Vector3							autoBindingGetCameraWorldPosition() const;
 		Vector3							autoBindingGetCameraViewPosition() const;
+		const Vector4*					autoBindingGetMatrixPalette() const;
+		unsigned int					autoBindingGetMatrixPaletteSize() const;
 		const Vector3&					autoBindingGetAmbientColor() const;
 
 		Node*							m_pNodeBinding;
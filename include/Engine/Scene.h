@@ -7,6 +7,11 @@
 
 class Node;
 class Camera;
+class Frustum;
+class DynamicAABBTree;
+class RenderQueue;
+struct BoundingSphere;
+struct Ray;
 
 class Scene {
 
@@ -33,8 +38,40 @@ class Scene {
 
 
 		void			render();
+
+		// Models outside the active camera's frustum are skipped by render()
+		void			setFrustumCulling(bool bEnable);
+		bool			isFrustumCulling() const;
+		unsigned int	getVisibleNodeCount() const;	// drawn by the last render()
+		unsigned int	getCulledNodeCount() const;		// rejected by the last render()
+
+		// Bounding volume hierarchy over the nodes with models. It is refitted
+		// from the transforms that changed since the last update, render()
+		// culls through it and the queries below use it instead of a full
+		// walk. Disabled by default.
+		void				setSpatialIndexEnabled(bool bEnable);
+		bool				isSpatialIndexEnabled() const;
+		DynamicAABBTree*	getSpatialIndex() const;
+		void				updateSpatialIndex();
+
+		// Draw through a state sorted queue instead of traversal order
+		void			setRenderQueueEnabled(bool bEnable);
+		RenderQueue*	getRenderQueue() const;
+
+		// Nodes whose world bounds touch the volume
+		void			queryNodes(const Frustum& frustum, std::vector<Node*>& vNodes);
+		void			queryNodes(const BoundingSphere& sphere, std::vector<Node*>& vNodes);
+		Node*			pickNode(const Ray& ray, float* pDistance = NULL);	// closest hit on world bounds
 	private:
+		friend class Node;
+
 		Scene();
+
+		void			renderNode(Node* pNode, bool bWireframe, const Frustum* pFrustum);
+		void			drawNode(Node* pNode, bool bWireframe);
+		void			indexNode(Node* pNode, bool bRecursive);
+		void			unindexNode(Node* pNode);
+		void			collectNodes(Node* pNode, std::vector<Node*>& vNodes) const;
 		
 		CCString		m_sID;
 		Camera*			m_pActiveCamera;
@@ -42,6 +79,17 @@ class Scene {
 		Node*			m_pLastNode;
 		unsigned int	m_iNodeCount;
 		Vector3			m_AmbientColor;
+
+		bool			m_bFrustumCulling;
+		unsigned int	m_iVisibleNodeCount;
+		unsigned int	m_iCulledNodeCount;
+
+		DynamicAABBTree*	m_pSpatialIndex;
+		std::vector<int>	m_vDirtyProxies;
+		std::vector<void*>	m_vQueryResults;
+		std::vector<Node*>	m_vQueryNodes;
+
+		RenderQueue*		m_pRenderQueue;
 };
 
 #endif
\ No newline at end of file
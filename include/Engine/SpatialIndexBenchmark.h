@@ -0,0 +1,36 @@
+#ifndef SPATIAL_INDEX_BENCHMARK_H
+#define SPATIAL_INDEX_BENCHMARK_H
+
+#include "Engine/Base.h"
+
+///////////////////////////////////////////////////////////////////////////
+// Compares DynamicAABBTree queries against a brute force scan over the same
+// random boxes (constant density, so larger counts mean a larger world).
+// Each tree query is refined with the exact test the scan uses and the
+// result counts are checked to match.
+///////////////////////////////////////////////////////////////////////////
+class SpatialIndexBenchmark {
+
+	public:
+		struct Result {
+			unsigned int	iProxyCount;
+			unsigned int	iQueryCount;
+			int				iTreeHeight;
+			double			dBuildMs;
+			double			dRefitMs;				// moving a tenth of the proxies
+			double			dTreeFrustumMs;
+			double			dBruteFrustumMs;
+			double			dTreeRayMs;
+			double			dBruteRayMs;
+			double			dTreeRadiusMs;
+			double			dBruteRadiusMs;
+			unsigned int	iMismatchCount;			// queries where tree and scan disagree, should be 0
+		};
+
+		static void		run(unsigned int iProxyCount, unsigned int iQueryCount, Result* pResult);
+		static void		runAll();		// 1k, 10k and 100k proxies, printed to stdout
+	private:
+		SpatialIndexBenchmark();
+};
+
+#endif
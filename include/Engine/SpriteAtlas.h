@@ -0,0 +1,84 @@
+#ifndef SPRITE_ATLAS_H
+#define SPRITE_ATLAS_H
+
+#include "Engine/Base.h"
+#include "Engine/Texture.h"
+
+class Image;
+
+///////////////////////////////////////////////////////////////////////////
+// Packs loose images into RGBA pages of a fixed size at runtime.
+//
+// Placement is skyline bottom-left: each page keeps the top edge of what
+// was packed so far as a list of segments, and an image goes where its
+// bottom ends lowest. Every add() returns a region with the page and the
+// UVs of the image there, in the orientation of the source rows.
+//
+// The pages are kept in memory and turned into textures on request,
+// either one TEXTURE_2D per page or one TEXTURE_2D_ARRAY holding every
+// page as a layer. With the latter a single SpriteBatch draws sprites of
+// all pages, picking the layer per sprite from the region. Textures are
+// owned by the caller (usually a SpriteBatch).
+///////////////////////////////////////////////////////////////////////////
+class SpriteAtlas {
+
+	public:
+		struct Region {
+			unsigned int	iPage;			// also the layer of createTextureArray()
+			float			u1;
+			float			v1;
+			float			u2;
+			float			v2;
+			unsigned int	iWidth;			// source size in pixels
+			unsigned int	iHeight;
+		};
+
+		~SpriteAtlas();
+		static SpriteAtlas*	create(unsigned int iPageWidth = 1024, unsigned int iPageHeight = 1024, unsigned int iPadding = 1);
+
+		// Each returns the index of the new region, or -1 when the image is
+		// larger than a page or could not be read
+		int					add(const unsigned char* pPixels, unsigned int iWidth, unsigned int iHeight, Texture::Format format);
+		int					add(const Image* pImage);
+		int					add(const char* sPath);
+		int					add(Texture* pTexture);		// read back from GL
+
+		unsigned int		getRegionCount() const;
+		const Region&		getRegion(unsigned int iIndex) const;
+		unsigned int		getPageCount() const;
+		unsigned int		getPageWidth() const;
+		unsigned int		getPageHeight() const;
+		float				getOccupancy(unsigned int iPage) const;	// packed area over page area
+
+		Texture*			createPageTexture(unsigned int iPage, bool generateMipmaps = false) const;
+		Texture*			createTextureArray(bool generateMipmaps = false) const;
+	private:
+		struct SkylineNode {
+			unsigned int	x;
+			unsigned int	y;
+			unsigned int	iWidth;
+		};
+
+		struct Page {
+			std::vector<unsigned char>	vPixels;		// RGBA
+			std::vector<SkylineNode>	vSkyline;
+			unsigned int				iUsedArea;
+		};
+
+		SpriteAtlas(unsigned int iPageWidth, unsigned int iPageHeight, unsigned int iPadding);
+		SpriteAtlas(const SpriteAtlas& copy);
+
+		void				addPage();
+		bool				fit(const Page& page, unsigned int iNode, unsigned int iWidth, unsigned int iHeight, unsigned int* pY) const;
+		bool				pack(Page& page, unsigned int iWidth, unsigned int iHeight, unsigned int* pX, unsigned int* pY);
+		void				blit(Page& page, unsigned int x, unsigned int y, const unsigned char* pPixels, unsigned int iWidth, unsigned int iHeight, Texture::Format format);
+
+		unsigned int		m_iPageWidth;
+		unsigned int		m_iPageHeight;
+		unsigned int		m_iPadding;
+
+		std::vector<Page*>	m_vPages;
+		std::vector<Region>	m_vRegions;
+};
+
+#endif
@@ -6,15 +6,43 @@
 #include "Common/Vectors.h"
 #include "Common/Matrices.h"
 #include "Engine/Texture.h"
+#include "Engine/SpriteAtlas.h"
 
 class MeshBatch;
 class Effect;
 
+///////////////////////////////////////////////////////////////////////////
+// Screen or world space quads drawn through one MeshBatch, all from the
+// texture given at creation.
+//
+// The texture may be a TEXTURE_2D_ARRAY (SpriteAtlas::createTextureArray
+// for instance). The layer is then part of each vertex, taken from
+// setLayer() or from the atlas region drawn, so sprites of every layer
+// share the batch and its single draw call. Only array batches carry it,
+// it is added when their vertices are packed (SpriteLayerVertex).
+//
+// Sprites are built as float vertices and go to the batch in the vertex
+// layout chosen at creation. Compact layouts pack them first, trading a
+// few conversions per vertex for fewer bytes copied and sent to the GPU.
+///////////////////////////////////////////////////////////////////////////
 class SpriteBatch {
 
 	public:
-		static SpriteBatch* create(const char* pTexturePath, Effect* pEffect = NULL, unsigned int iInitialCapacity = 0);
-		static SpriteBatch* create(Texture* pTexture, Effect* pEffect = NULL, unsigned int iInitialCapacity = 0);
+		enum VertexLayout {
+			VERTEX_FLOAT = 0x00,				// xyz, uv, rgba as floats (36 bytes, 40 with a layer)
+			VERTEX_PACKED_COLOR = 0x01,			// rgba as normalized bytes
+			VERTEX_HALF_UV = 0x02,				// uv and layer as half floats, float without ARB_half_float_vertex
+			VERTEX_UNORM16_UV = 0x04,			// uv as normalized shorts, within [0, 1] only, half for array textures
+			VERTEX_2D = 0x08,					// xy only, z is dropped
+			VERTEX_COMPACT = VERTEX_PACKED_COLOR | VERTEX_HALF_UV		// 20 bytes, 24 with a layer
+		};
+
+		static SpriteBatch* create(const char* pTexturePath, Effect* pEffect = NULL, unsigned int iInitialCapacity = 0, unsigned int iVertexLayout = VERTEX_FLOAT);
+		static SpriteBatch* create(Texture* pTexture, Effect* pEffect = NULL, unsigned int iInitialCapacity = 0, unsigned int iVertexLayout = VERTEX_FLOAT);
+		virtual ~SpriteBatch();
+
+		unsigned int getVertexLayout() const;	// as resolved for this device and texture
+		unsigned int getVertexSize() const;
 		
 		void start();
 		void stop();
@@ -36,6 +64,12 @@ class SpriteBatch {
 
 		void draw(const Vector3& position, const Vector3& right, const Vector3& forward, float width, float height, float u1, float v1, float u2, float v2, const Vector4& color, const Vector2& rotationPoint, float rotationAngle);
 
+		// Draws an atlas region, selecting its page as the layer
+		void draw(float x, float y, float width, float height, const SpriteAtlas::Region& region, const Vector4& color = Vector4::one());
+
+		void setLayer(unsigned int iLayer);		// texture array layer of the sprites drawn next
+		unsigned int getLayer() const;
+
 		void setClip(int x, int y, int width, int height);
 		void resetClip();
 
@@ -55,19 +89,39 @@ class SpriteBatch {
 			float A;
 		};
 
+		// VERTEX_FLOAT layout of TEXTURE_2D_ARRAY batches, the layer follows uv
+		struct SpriteLayerVertex {
+			float X;
+			float Y;
+			float Z;
+
+			float U;
+			float V;
+			float W;
+
+			float R;
+			float G;
+			float B;
+			float A;
+		};
+
 		SpriteBatch();
-		virtual ~SpriteBatch();
 
 		void draw(SpriteBatch::SpriteVertex* pVertices, unsigned int iVertexCount, unsigned short* pIndices, unsigned int iIndexCount);
 
 		void addSprite(float x, float y, float width, float height, float u1, float v1, float u2, float v2, const Vector4& color, SpriteVertex* vertices);
 		void addSprite(float x, float y, float width, float height, float u1, float v1, float u2, float v2, const Vector4& color, const Vector4& clip, SpriteBatch::SpriteVertex* vertices);
+		void pack(const SpriteVertex* pVertices, unsigned int iVertexCount, unsigned char* pOut) const;
 		
 		MeshBatch*			m_pMeshBatch;
 		Texture::Sampler*	m_pSampler;
 		bool				m_bCustomEffect;
 		float				m_fTextureWidthRatio;
 		float				m_fTextureHeightRatio;
+		float				m_fLayer;
+		unsigned int		m_iVertexLayout;
+		bool				m_bLayered;			// texture array, m_fLayer is added at pack()
+		std::vector<unsigned char>	m_vPacked;
 		Vector4				m_ClipRect;
 		mutable Matrix4		m_ProjectionMatrix;
 };
@@ -0,0 +1,40 @@
+#ifndef SPRITE_BATCH_BENCHMARK_H
+#define SPRITE_BATCH_BENCHMARK_H
+
+#include "Engine/Base.h"
+
+///////////////////////////////////////////////////////////////////////////
+// Measures sprites per millisecond through SpriteBatch, with MeshBatch
+// streaming into mapped ring buffers and with client memory vertices,
+// and with float or compact sprite vertices.
+// Needs a current GL context; every frame is start(), iSpriteCount
+// draw() calls, stop(). Submission time is taken on the CPU alone, total
+// time also waits for the GPU with glFinish(). The timed frames follow
+// two warm up frames and should not allocate. The vertex size of the
+// batch is checked against the one its resolved layout implies.
+///////////////////////////////////////////////////////////////////////////
+class SpriteBatchBenchmark {
+
+	public:
+		struct Result {
+			unsigned int	iSpriteCount;
+			unsigned int	iFrameCount;
+			bool			bStreaming;
+			unsigned int	iVertexLayout;			// SpriteBatch::VertexLayout as resolved
+			unsigned int	iVertexSize;
+			unsigned int	iExpectedVertexSize;	// from iVertexLayout, 36 for VERTEX_FLOAT as the texture is no array
+			double			dSubmitMs;				// per frame
+			double			dTotalMs;				// per frame, including glFinish()
+			double			dSpritesPerMs;			// from dTotalMs
+			unsigned int	iSteadyAllocations;		// MeshBatch allocations over the timed frames, 0 once warmed up
+		};
+
+		static bool		run(unsigned int iSpriteCount, unsigned int iFrameCount, bool bStreaming, Result* pResult, unsigned int iVertexLayout = 0);
+		static void		runAll();		// 1k, 10k and 50k sprites, streaming float and compact and client float, printed to stdout
+	private:
+		SpriteBatchBenchmark();
+
+		static unsigned int	getExpectedVertexSize(unsigned int iVertexLayout);
+};
+
+#endif
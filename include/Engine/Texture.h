@@ -44,7 +44,8 @@ class Texture {
 		enum Type
 		{
 			TEXTURE_2D = GL_TEXTURE_2D,
-			TEXTURE_CUBE = GL_TEXTURE_CUBE_MAP
+			TEXTURE_CUBE = GL_TEXTURE_CUBE_MAP,
+			TEXTURE_2D_ARRAY = GL_TEXTURE_2D_ARRAY
 		};
 
 		/**
@@ -60,9 +61,19 @@ class Texture {
 
 		static Texture*	createTGA(const char* path, bool generateMipmaps);
 
+		/**
+		 * Creates a TEXTURE_2D_ARRAY of iLayers width x height layers, data
+		 * holds the layers one after the other or is NULL. Needs
+		 * EXT_texture_array.
+		 */
+		static Texture* createArray(Format format, unsigned int width, unsigned int height, unsigned int iLayers, unsigned char* data = NULL, bool generateMipmaps = false);
+		static bool		isArraySupported();
+
 		Format getFormat() const;
 		unsigned int getWidth() const;
 		unsigned int getHeight() const;
+		unsigned int getLayerCount() const;
+		void setLayerData(unsigned int iLayer, unsigned char* data);		// replaces one layer of an array texture
 		void generateMipmaps();
 		bool isMipmapped() const;
 		bool isCompressed() const;
@@ -126,6 +137,7 @@ class Texture {
 		Format			m_Format;
 		unsigned int	m_iWidth;
 		unsigned int	m_iHeight;
+		unsigned int	m_iLayers;
 		bool			m_bMipmapped;
 		bool			m_bCached;
 		bool			m_bCompressed;
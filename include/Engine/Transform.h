@@ -51,6 +51,10 @@ class Transform {
 		void					setDirty(unsigned int bits);
 		const Matrix4&			getTransformedModelMatrix() const;
 		const Matrix4&			getTransformedViewMatrix() const;
+	protected:
+		// Called whenever the local transform changes, lets derived classes
+		// invalidate whatever they cache on top of it.
+		virtual void			transformChanged();
 	private:
 		mutable Matrix4			m_Matrix;
 		mutable Vector3			m_vScale;
@@ -0,0 +1,103 @@
+#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+
+#include "Engine/Base.h"
+#include "Common/Matrices.h"
+
+class Node;
+class Camera;
+class Scene;
+class GPURingBuffer;
+
+///////////////////////////////////////////////////////////////////////////
+// Autobindings packed into std140 uniform blocks.
+//
+// Shaders opt in by including data/shaders/autobindings.glsl, which
+// declares FrameBlock (camera and scene values) and ObjectBlock (node
+// matrices). Effect binds the blocks it finds to FRAME_BLOCK_BINDING and
+// OBJECT_BLOCK_BINDING; autobound material parameters that resolve to
+// block members are skipped.
+//
+// Block data goes to a GPURingBuffer. FrameBlock is written once per
+// active camera change, ObjectBlock once per node and frame. Every later
+// pass drawing the node only rebinds the range, and only when it differs
+// from the one bound.
+///////////////////////////////////////////////////////////////////////////
+class UniformBlocks {
+
+	public:
+		enum Block {
+			FRAME_BLOCK = 0x01,
+			OBJECT_BLOCK = 0x02
+		};
+
+		enum BindingPoint {
+			FRAME_BLOCK_BINDING = 0,
+			OBJECT_BLOCK_BINDING = 1
+		};
+
+		// Layouts match autobindings.glsl (std140, column major mat4 = Matrix4::m
+		// as uploaded by Effect::setValue, vec3 padded to vec4)
+		struct FrameData {
+			float		view[16];
+			float		projection[16];
+			float		viewProjection[16];
+			float		cameraWorldPosition[4];
+			float		cameraViewPosition[4];
+			float		ambientColor[4];
+		};
+
+		struct ObjectData {
+			float		world[16];
+			float		worldView[16];
+			float		worldViewProjection[16];
+			float		inverseTransposeWorld[16];
+			float		inverseTransposeWorldView[16];
+		};
+
+		struct Stats {
+			unsigned int	iFrameWrites;
+			unsigned int	iObjectWrites;
+			unsigned int	iRangeBinds;
+			unsigned int	iRangeBindsFiltered;
+		};
+
+		static bool				isSupported();		// needs uniform buffer objects and map buffer range
+		static void				initialize(unsigned int iSegmentSize = 256 * 1024);
+		static void				finalize();
+		static bool				isInitialized();
+
+		static const char*		getBlockName(Block eBlock);
+
+		static void				beginFrame();
+		static void				endFrame();
+
+		// Makes the blocks in iBlocks (Block bits) current for pNode
+		static void				bind(const Node* pNode, unsigned int iBlocks);
+
+		static Stats			resetStats();		// returns the stats collected since the last reset
+	private:
+		UniformBlocks();
+
+		static void				validateFrame(const Node* pNode);
+		static void				bindRange(BindingPoint eBindingPoint, unsigned int iOffset, unsigned int iSize);
+
+		static GPURingBuffer*	m_pRing;
+		static unsigned int		m_iAlignment;
+		static unsigned int		m_iSerial;			// changes whenever object offsets from before become unusable
+		static unsigned int		m_iRingGeneration;
+
+		// Source of the frame block written last
+		static const Camera*	m_pFrameCamera;
+		static unsigned int		m_iFrameCameraVersion;
+		static Vector3			m_FrameAmbientColor;
+		static unsigned int		m_iFrameOffset;
+		static bool				m_bFrameValid;
+
+		static unsigned int		m_iBoundOffsets[2];
+		static bool				m_bBoundValid[2];
+
+		static Stats			m_Stats;
+};
+
+#endif
@@ -11,6 +11,24 @@ class VertexAttributeBinding {
 	public:
 		static VertexAttributeBinding*	create(Mesh* mesh, Effect* pEffect);
 		static VertexAttributeBinding*	create(const VertexFormat& vertexFormat, void* vertexPointer, Effect* pEffect);
+		static VertexAttributeBinding*	createUnique(Mesh* mesh, Effect* pEffect);		// not shared, for bindings given extra streams
+		static VertexAttributeBinding*	createStreamed(const VertexFormat& vertexFormat, VBOHandle hBuffer, Effect* pEffect);	// vertices in hBuffer from setBaseOffset() on
+
+		// Sources the effect attribute sName from a stream other than the mesh
+		// buffer (hBuffer, or client memory when 0). Matrix attributes take
+		// iColumns consecutive locations iSize floats apart. A non zero iDivisor
+		// advances the attribute per instance. Returns false when the effect
+		// does not use the attribute.
+		bool							setStreamAttribute(const char* sName, VBOHandle hBuffer, GLint iSize, unsigned int iColumns, GLsizei iStride, const void* pointer, GLuint iDivisor);
+
+		// Mesh bindings are backed by a VAO when this is true, the rest
+		// replay their attribute pointers on every bind().
+		static bool						isHardwareVAOSupported();
+
+		// Byte offset added to every attribute pointer at bind(), lets one
+		// binding walk ranges of a streaming buffer or client array (not used
+		// with VAOs)
+		void							setBaseOffset(unsigned int iOffset);
 
 		void							bind();
 		void							unbind();
@@ -25,16 +43,22 @@ class VertexAttributeBinding {
 				GLboolean		m_bNormalized;
 				unsigned int	m_iStride;
 				void*			m_pPointer;
+				bool			m_bStream;		// sourced from m_hBuffer instead of the mesh buffer
+				VBOHandle		m_hBuffer;
+				GLuint			m_iDivisor;
 		};
 
 		VertexAttributeBinding();
 		static VertexAttributeBinding*	create(Mesh* mesh, const VertexFormat& vertexFormat, void* vertexPointer, Effect* pEffect);
 		void setVertexAttributeBinding(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLvoid* pointer);
+		void bindAttributes();
+		void unbindAttributes();
 
 #ifdef USE_VAO
 		VAOHandle			m_hVAO;
 #endif
 		VertexAttribute*	m_pAttributes;
+		unsigned int		m_iBaseOffset;
 		Mesh*				m_pMesh;
 		Effect*				m_pEffect;
 };
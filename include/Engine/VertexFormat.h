@@ -36,13 +36,22 @@ class VertexFormat {
 			FOUR = 4
 		};
 
+		enum DATA_TYPE {
+			FLOAT = GL_FLOAT,
+			HALF_FLOAT = GL_HALF_FLOAT,			// needs ARB_half_float_vertex
+			UNSIGNED_BYTE = GL_UNSIGNED_BYTE,
+			UNSIGNED_SHORT = GL_UNSIGNED_SHORT,
+			SHORT = GL_SHORT
+		};
+
 		/**
 		 * Defines a single element within a vertex format.
 		 *
-		 * All vertex elements are assumed to be of type float, but can
-		 * have a varying number of float values (1-4), which is represented
-		 * by the size attribute. Additionally, vertex elements are assumed
-		 * to be tightly packed.
+		 * Vertex elements are of type float unless given another data type,
+		 * and have a varying number of values (1-4), which is represented
+		 * by the size attribute. Integer values can be normalized to [0, 1]
+		 * ([-1, 1] when signed) by the GL. Vertex elements are assumed to be
+		 * tightly packed; keep them at multiples of 4 bytes.
 		 */
 		class Element {
 			public:
@@ -52,8 +61,13 @@ class VertexFormat {
 				//Number of values in an element
 				unsigned int size;
 
+				//Type of the values and whether integers are normalized
+				DATA_TYPE dataType;
+				bool normalized;
+
 				Element();
-				Element(TYPE type, unsigned int size);
+				Element(TYPE type, unsigned int size, DATA_TYPE dataType = FLOAT, bool normalized = false);
+				unsigned int getByteSize() const;
 				bool operator == (Element& e) const;
 				bool operator != (Element& e) const;
 			private:
@@ -64,6 +78,7 @@ class VertexFormat {
 
 		const Element& getElement(unsigned int index) const;
 		unsigned int getElementCount() const;
+		unsigned int getElementOffset(unsigned int index) const;		// in bytes
 		unsigned int getVertexSize() const;
 		bool operator == (VertexFormat& f) const;
 		bool operator != (VertexFormat& f) const;
@@ -0,0 +1,315 @@
+#include "Common/BatchMath.h"
+#include "Common/MathSIMD.h"
+#include <cmath>
+#include <cstring>
+
+#ifdef MATH_SIMD_X86
+	#include <emmintrin.h>
+	#include <immintrin.h>
+#endif
+
+// Elements per de-interleaved block for the Vector3 helpers (3 KB of stack per stream set).
+#define BATCH_BLOCK_SIZE			256
+#define BATCH_NORMALIZE_EPSILON		0.000001f
+// Covers two AVX2 iterations and a scalar tail
+#define BATCH_VERIFY_COUNT			19
+
+///////////////////////////////////////////////////////////////////////////
+// scalar
+///////////////////////////////////////////////////////////////////////////
+static void transformScalar(const float* m, float w, const float* xs, const float* ys, const float* zs, float* ox, float* oy, float* oz, size_t i, size_t n) {
+
+	for(; i < n; i++) {
+		float x = xs[i], y = ys[i], z = zs[i];
+
+		ox[i] = x * m[0] + y * m[1] + z * m[2]  + w * m[3];
+		oy[i] = x * m[4] + y * m[5] + z * m[6]  + w * m[7];
+		oz[i] = x * m[8] + y * m[9] + z * m[10] + w * m[11];
+	}
+}
+
+static void normalizeScalar(float* xs, float* ys, float* zs, size_t i, size_t n) {
+
+	for(; i < n; i++) {
+		float x = xs[i], y = ys[i], z = zs[i];
+		float xxyyzz = x*x + y*y + z*z;
+		if(xxyyzz < BATCH_NORMALIZE_EPSILON)
+			continue;
+
+		float invLength = 1.0f / sqrtf(xxyyzz);
+		xs[i] = x * invLength;
+		ys[i] = y * invLength;
+		zs[i] = z * invLength;
+	}
+}
+
+#ifdef MATH_SIMD_X86
+///////////////////////////////////////////////////////////////////////////
+// SSE2, 4 elements per iteration
+///////////////////////////////////////////////////////////////////////////
+MATH_SIMD_TARGET_SSE2
+static size_t transformSSE2(const float* m, float w, const float* xs, const float* ys, const float* zs, float* ox, float* oy, float* oz, size_t n) {
+
+	__m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2  = _mm_set1_ps(m[2]);
+	__m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6  = _mm_set1_ps(m[6]);
+	__m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+	__m128 tx = _mm_set1_ps(w * m[3]), ty = _mm_set1_ps(w * m[7]), tz = _mm_set1_ps(w * m[11]);
+
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4) {
+		__m128 x = _mm_loadu_ps(xs + i);
+		__m128 y = _mm_loadu_ps(ys + i);
+		__m128 z = _mm_loadu_ps(zs + i);
+
+		__m128 rx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m0), _mm_mul_ps(y, m1)), _mm_mul_ps(z, m2)),  tx);
+		__m128 ry = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m4), _mm_mul_ps(y, m5)), _mm_mul_ps(z, m6)),  ty);
+		__m128 rz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m8), _mm_mul_ps(y, m9)), _mm_mul_ps(z, m10)), tz);
+
+		_mm_storeu_ps(ox + i, rx);
+		_mm_storeu_ps(oy + i, ry);
+		_mm_storeu_ps(oz + i, rz);
+	}
+
+	return i;
+}
+
+MATH_SIMD_TARGET_SSE2
+static size_t normalizeSSE2(float* xs, float* ys, float* zs, size_t n) {
+
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 epsilon = _mm_set1_ps(BATCH_NORMALIZE_EPSILON);
+
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4) {
+		__m128 x = _mm_loadu_ps(xs + i);
+		__m128 y = _mm_loadu_ps(ys + i);
+		__m128 z = _mm_loadu_ps(zs + i);
+
+		__m128 xxyyzz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+		__m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(xxyyzz));
+
+		// Lanes below epsilon keep their input, like Vector3::normalize().
+		__m128 keep = _mm_cmplt_ps(xxyyzz, epsilon);
+		invLength = _mm_or_ps(_mm_and_ps(keep, one), _mm_andnot_ps(keep, invLength));
+
+		_mm_storeu_ps(xs + i, _mm_mul_ps(x, invLength));
+		_mm_storeu_ps(ys + i, _mm_mul_ps(y, invLength));
+		_mm_storeu_ps(zs + i, _mm_mul_ps(z, invLength));
+	}
+
+	return i;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// AVX2, 8 elements per iteration
+///////////////////////////////////////////////////////////////////////////
+MATH_SIMD_TARGET_AVX2
+static size_t transformAVX2(const float* m, float w, const float* xs, const float* ys, const float* zs, float* ox, float* oy, float* oz, size_t n) {
+
+	__m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2  = _mm256_set1_ps(m[2]);
+	__m256 m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]), m6  = _mm256_set1_ps(m[6]);
+	__m256 m8 = _mm256_set1_ps(m[8]), m9 = _mm256_set1_ps(m[9]), m10 = _mm256_set1_ps(m[10]);
+	__m256 tx = _mm256_set1_ps(w * m[3]), ty = _mm256_set1_ps(w * m[7]), tz = _mm256_set1_ps(w * m[11]);
+
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8) {
+		__m256 x = _mm256_loadu_ps(xs + i);
+		__m256 y = _mm256_loadu_ps(ys + i);
+		__m256 z = _mm256_loadu_ps(zs + i);
+
+		__m256 rx = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m0), _mm256_mul_ps(y, m1)), _mm256_mul_ps(z, m2)),  tx);
+		__m256 ry = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m4), _mm256_mul_ps(y, m5)), _mm256_mul_ps(z, m6)),  ty);
+		__m256 rz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m8), _mm256_mul_ps(y, m9)), _mm256_mul_ps(z, m10)), tz);
+
+		_mm256_storeu_ps(ox + i, rx);
+		_mm256_storeu_ps(oy + i, ry);
+		_mm256_storeu_ps(oz + i, rz);
+	}
+
+	_mm256_zeroupper();
+	return i;
+}
+
+MATH_SIMD_TARGET_AVX2
+static size_t normalizeAVX2(float* xs, float* ys, float* zs, size_t n) {
+
+	__m256 one = _mm256_set1_ps(1.0f);
+	__m256 epsilon = _mm256_set1_ps(BATCH_NORMALIZE_EPSILON);
+
+	size_t i = 0;
+	for(; i + 8 <= n; i += 8) {
+		__m256 x = _mm256_loadu_ps(xs + i);
+		__m256 y = _mm256_loadu_ps(ys + i);
+		__m256 z = _mm256_loadu_ps(zs + i);
+
+		__m256 xxyyzz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+		__m256 invLength = _mm256_div_ps(one, _mm256_sqrt_ps(xxyyzz));
+		invLength = _mm256_blendv_ps(invLength, one, _mm256_cmp_ps(xxyyzz, epsilon, _CMP_LT_OQ));
+
+		_mm256_storeu_ps(xs + i, _mm256_mul_ps(x, invLength));
+		_mm256_storeu_ps(ys + i, _mm256_mul_ps(y, invLength));
+		_mm256_storeu_ps(zs + i, _mm256_mul_ps(z, invLength));
+	}
+
+	_mm256_zeroupper();
+	return i;
+}
+#endif // MATH_SIMD_X86
+
+///////////////////////////////////////////////////////////////////////////
+// dispatch
+///////////////////////////////////////////////////////////////////////////
+static void transformSoA(const float* m, float w, const float* xs, const float* ys, const float* zs, float* ox, float* oy, float* oz, size_t n) {
+
+	size_t i = 0;
+#ifdef MATH_SIMD_X86
+	switch(MathSIMD::getBackend()) {
+		case MathSIMD::BACKEND_AVX2:
+			i = transformAVX2(m, w, xs, ys, zs, ox, oy, oz, n);
+		break;
+		case MathSIMD::BACKEND_SSE2:
+			i = transformSSE2(m, w, xs, ys, zs, ox, oy, oz, n);
+		break;
+		default:
+		break;
+	}
+#endif
+	transformScalar(m, w, xs, ys, zs, ox, oy, oz, i, n);
+}
+
+static void transformAoS(const float* m, float w, const Vector3* src, Vector3* dst, size_t n) {
+
+	float xs[BATCH_BLOCK_SIZE], ys[BATCH_BLOCK_SIZE], zs[BATCH_BLOCK_SIZE];
+
+	for(size_t start = 0; start < n; start += BATCH_BLOCK_SIZE) {
+		size_t count = (n - start < BATCH_BLOCK_SIZE) ? n - start : BATCH_BLOCK_SIZE;
+
+		for(size_t i = 0; i < count; i++) {
+			xs[i] = src[start + i].x;
+			ys[i] = src[start + i].y;
+			zs[i] = src[start + i].z;
+		}
+
+		transformSoA(m, w, xs, ys, zs, xs, ys, zs, count);
+
+		for(size_t i = 0; i < count; i++) {
+			dst[start + i].set(xs[i], ys[i], zs[i]);
+		}
+	}
+}
+
+void BatchMath::transformPoints(const Matrix4& m, const float* xs, const float* ys, const float* zs, float* outXs, float* outYs, float* outZs, size_t n) {
+	transformSoA(m.m, 1.0f, xs, ys, zs, outXs, outYs, outZs, n);
+}
+
+void BatchMath::transformVectors(const Matrix4& m, const float* xs, const float* ys, const float* zs, float* outXs, float* outYs, float* outZs, size_t n) {
+	transformSoA(m.m, 0.0f, xs, ys, zs, outXs, outYs, outZs, n);
+}
+
+void BatchMath::transformPoints(const Matrix4& m, const Vector3* src, Vector3* dst, size_t n) {
+	transformAoS(m.m, 1.0f, src, dst, n);
+}
+
+void BatchMath::transformVectors(const Matrix4& m, const Vector3* src, Vector3* dst, size_t n) {
+	transformAoS(m.m, 0.0f, src, dst, n);
+}
+
+void BatchMath::multiplyMatrices(const Matrix4& lhs, const Matrix4* rhs, Matrix4* dst, size_t n) {
+
+	// Copy lhs once, dst may alias rhs and lhs may be one of the dst elements.
+	float a[16];
+	memcpy(a, lhs.m, sizeof(a));
+
+	for(size_t i = 0; i < n; i++) {
+		MathSIMD::multiplyMatrix(a, rhs[i].m, dst[i].m);
+	}
+}
+
+void BatchMath::multiplyMatrices(const Matrix4* lhs, const Matrix4* rhs, Matrix4* dst, size_t n) {
+
+	for(size_t i = 0; i < n; i++) {
+		MathSIMD::multiplyMatrix(lhs[i].m, rhs[i].m, dst[i].m);
+	}
+}
+
+void BatchMath::normalizeVectors(float* xs, float* ys, float* zs, size_t n) {
+
+	size_t i = 0;
+#ifdef MATH_SIMD_X86
+	switch(MathSIMD::getBackend()) {
+		case MathSIMD::BACKEND_AVX2:
+			i = normalizeAVX2(xs, ys, zs, n);
+		break;
+		case MathSIMD::BACKEND_SSE2:
+			i = normalizeSSE2(xs, ys, zs, n);
+		break;
+		default:
+		break;
+	}
+#endif
+	normalizeScalar(xs, ys, zs, i, n);
+}
+
+void BatchMath::normalizeVectors(Vector3* vectors, size_t n) {
+
+	float xs[BATCH_BLOCK_SIZE], ys[BATCH_BLOCK_SIZE], zs[BATCH_BLOCK_SIZE];
+
+	for(size_t start = 0; start < n; start += BATCH_BLOCK_SIZE) {
+		size_t count = (n - start < BATCH_BLOCK_SIZE) ? n - start : BATCH_BLOCK_SIZE;
+
+		for(size_t i = 0; i < count; i++) {
+			xs[i] = vectors[start + i].x;
+			ys[i] = vectors[start + i].y;
+			zs[i] = vectors[start + i].z;
+		}
+
+		normalizeVectors(xs, ys, zs, count);
+
+		for(size_t i = 0; i < count; i++) {
+			vectors[start + i].set(xs[i], ys[i], zs[i]);
+		}
+	}
+}
+
+static float randomValue(unsigned int& iSeed) {
+	// Same LCG as MathSIMD::verify, reproducible across runs and compilers.
+	iSeed = iSeed * 1664525u + 1013904223u;
+	return ((float)((iSeed >> 8) & 0xFFFF) / 65535.0f) * 20.0f - 10.0f;
+}
+
+bool BatchMath::verify(float fTolerance, unsigned int iIterations) {
+
+	unsigned int iSeed = 0xBA7C4u;
+	float xs[BATCH_VERIFY_COUNT], ys[BATCH_VERIFY_COUNT], zs[BATCH_VERIFY_COUNT];
+	float px[BATCH_VERIFY_COUNT], py[BATCH_VERIFY_COUNT], pz[BATCH_VERIFY_COUNT];
+	float vx[BATCH_VERIFY_COUNT], vy[BATCH_VERIFY_COUNT], vz[BATCH_VERIFY_COUNT];
+
+	for(unsigned int i = 0; i < iIterations; i++) {
+		Matrix4 m;
+		for(int j = 0; j < 16; j++) {
+			m.m[j] = randomValue(iSeed);
+		}
+		for(int j = 0; j < BATCH_VERIFY_COUNT; j++) {
+			xs[j] = randomValue(iSeed);
+			ys[j] = randomValue(iSeed);
+			zs[j] = randomValue(iSeed);
+		}
+
+		transformPoints(m, xs, ys, zs, px, py, pz, BATCH_VERIFY_COUNT);
+		transformVectors(m, xs, ys, zs, vx, vy, vz, BATCH_VERIFY_COUNT);
+
+		Vector3 translation;
+		m.getTranslation(&translation);
+		for(int j = 0; j < BATCH_VERIFY_COUNT; j++) {
+			Vector3 vector = m * Vector3(xs[j], ys[j], zs[j]);
+			Vector3 point = vector + translation;
+
+			if(fabs(point.x - px[j]) > fTolerance || fabs(point.y - py[j]) > fTolerance || fabs(point.z - pz[j]) > fTolerance)
+				return false;
+			if(fabs(vector.x - vx[j]) > fTolerance || fabs(vector.y - vy[j]) > fTolerance || fabs(vector.z - vz[j]) > fTolerance)
+				return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,205 @@
+#include "Common/Bounds.h"
+#include <cmath>
+#include <cfloat>
+
+///////////////////////////////////////////////////////////////////////////
+// BoundingBox
+///////////////////////////////////////////////////////////////////////////
+BoundingBox::BoundingBox() {
+	setEmpty();
+}
+
+BoundingBox::BoundingBox(const Vector3& vMin, const Vector3& vMax)
+	:	min(vMin),
+		max(vMax) {
+}
+
+void BoundingBox::set(const Vector3& vMin, const Vector3& vMax) {
+	min = vMin;
+	max = vMax;
+}
+
+void BoundingBox::setEmpty() {
+	min.set(FLT_MAX, FLT_MAX, FLT_MAX);
+	max.set(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+}
+
+bool BoundingBox::isEmpty() const {
+	return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+void BoundingBox::merge(const Vector3& point) {
+
+	if(point.x < min.x) min.x = point.x;
+	if(point.y < min.y) min.y = point.y;
+	if(point.z < min.z) min.z = point.z;
+
+	if(point.x > max.x) max.x = point.x;
+	if(point.y > max.y) max.y = point.y;
+	if(point.z > max.z) max.z = point.z;
+}
+
+void BoundingBox::merge(const BoundingBox& box) {
+
+	if(box.isEmpty())
+		return;
+
+	merge(box.min);
+	merge(box.max);
+}
+
+Vector3 BoundingBox::getCenter() const {
+	return Vector3((min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f);
+}
+
+Vector3 BoundingBox::getHalfExtents() const {
+	return Vector3((max.x - min.x) * 0.5f, (max.y - min.y) * 0.5f, (max.z - min.z) * 0.5f);
+}
+
+bool BoundingBox::intersects(const BoundingBox& box) const {
+
+	return	!(box.min.x > max.x || box.max.x < min.x ||
+			  box.min.y > max.y || box.max.y < min.y ||
+			  box.min.z > max.z || box.max.z < min.z);
+}
+
+bool BoundingBox::intersects(const BoundingSphere& sphere) const {
+
+	if(isEmpty() || sphere.isEmpty())
+		return false;
+
+	// Squared distance from the sphere center to the box
+	float d = 0.0f;
+	const float* c = &sphere.center.x;
+	const float* bMin = &min.x;
+	const float* bMax = &max.x;
+	for(int i = 0; i < 3; i++) {
+		if(c[i] < bMin[i])
+			d += (bMin[i] - c[i]) * (bMin[i] - c[i]);
+		else if(c[i] > bMax[i])
+			d += (c[i] - bMax[i]) * (c[i] - bMax[i]);
+	}
+
+	return d <= sphere.radius * sphere.radius;
+}
+
+bool BoundingBox::contains(const Vector3& point) const {
+
+	return	point.x >= min.x && point.x <= max.x &&
+			point.y >= min.y && point.y <= max.y &&
+			point.z >= min.z && point.z <= max.z;
+}
+
+void BoundingBox::transform(const Matrix4& m, BoundingBox* dst) const {
+
+	if(isEmpty()) {
+		dst->setEmpty();
+		return;
+	}
+
+	// Transform the center, the new half extents are the absolute matrix
+	// applied to the old ones (Arvo).
+	Vector3 c = getCenter();
+	Vector3 e = getHalfExtents();
+
+	Vector3 center(	m[0]*c.x + m[1]*c.y + m[2]*c.z  + m[3],
+					m[4]*c.x + m[5]*c.y + m[6]*c.z  + m[7],
+					m[8]*c.x + m[9]*c.y + m[10]*c.z + m[11]);
+
+	Vector3 extents(fabsf(m[0])*e.x + fabsf(m[1])*e.y + fabsf(m[2])*e.z,
+					fabsf(m[4])*e.x + fabsf(m[5])*e.y + fabsf(m[6])*e.z,
+					fabsf(m[8])*e.x + fabsf(m[9])*e.y + fabsf(m[10])*e.z);
+
+	dst->min = center - extents;
+	dst->max = center + extents;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// BoundingSphere
+///////////////////////////////////////////////////////////////////////////
+BoundingSphere::BoundingSphere()
+	:	center(),
+		radius(-1.0f) {
+}
+
+BoundingSphere::BoundingSphere(const Vector3& vCenter, float fRadius)
+	:	center(vCenter),
+		radius(fRadius) {
+}
+
+void BoundingSphere::set(const Vector3& vCenter, float fRadius) {
+	center = vCenter;
+	radius = fRadius;
+}
+
+void BoundingSphere::set(const BoundingBox& box) {
+
+	if(box.isEmpty()) {
+		center.set(0.0f, 0.0f, 0.0f);
+		radius = -1.0f;
+		return;
+	}
+
+	center = box.getCenter();
+	radius = box.getHalfExtents().length();
+}
+
+bool BoundingSphere::isEmpty() const {
+	return radius < 0.0f;
+}
+
+void BoundingSphere::merge(const BoundingSphere& sphere) {
+
+	if(sphere.isEmpty())
+		return;
+
+	if(isEmpty()) {
+		*this = sphere;
+		return;
+	}
+
+	Vector3 v = sphere.center - center;
+	float d = v.length();
+
+	// One sphere already holds the other.
+	if(d + sphere.radius <= radius)
+		return;
+	if(d + radius <= sphere.radius) {
+		*this = sphere;
+		return;
+	}
+
+	float fNewRadius = (d + radius + sphere.radius) * 0.5f;
+	center += v * ((fNewRadius - radius) / d);
+	radius = fNewRadius;
+}
+
+bool BoundingSphere::intersects(const BoundingSphere& sphere) const {
+
+	Vector3 v = sphere.center - center;
+	float r = radius + sphere.radius;
+	return v.dot(v) <= r * r;
+}
+
+void BoundingSphere::transform(const Matrix4& m, BoundingSphere* dst) const {
+
+	if(isEmpty()) {
+		*dst = *this;
+		return;
+	}
+
+	Vector3 c = center;
+	dst->center.set(m[0]*c.x + m[1]*c.y + m[2]*c.z  + m[3],
+					m[4]*c.x + m[5]*c.y + m[6]*c.z  + m[7],
+					m[8]*c.x + m[9]*c.y + m[10]*c.z + m[11]);
+
+	// Largest scale among the basis columns
+	float sx = m[0]*m[0] + m[4]*m[4] + m[8]*m[8];
+	float sy = m[1]*m[1] + m[5]*m[5] + m[9]*m[9];
+	float sz = m[2]*m[2] + m[6]*m[6] + m[10]*m[10];
+	float s = sx;
+	if(sy > s) s = sy;
+	if(sz > s) s = sz;
+
+	dst->radius = radius * sqrtf(s);
+}
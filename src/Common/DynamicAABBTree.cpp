@@ -0,0 +1,583 @@
+#include "Common/DynamicAABBTree.h"
+#include "Engine/Base.h"
+#include <cfloat>
+
+// Half surface area, the SAH cost of a box
+static float getArea(const BoundingBox& box) {
+
+	float dx = box.max.x - box.min.x;
+	float dy = box.max.y - box.min.y;
+	float dz = box.max.z - box.min.z;
+	return dx * dy + dy * dz + dz * dx;
+}
+
+static BoundingBox getUnion(const BoundingBox& a, const BoundingBox& b) {
+
+	BoundingBox box = a;
+	box.merge(b);
+	return box;
+}
+
+static bool containsBox(const BoundingBox& outer, const BoundingBox& inner) {
+
+	return	outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+			inner.max.x <= outer.max.x && inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+}
+
+DynamicAABBTree::DynamicAABBTree(float fMargin)
+	:	m_vNodes(),
+		m_iRoot(NULL_PROXY),
+		m_iFreeList(NULL_PROXY),
+		m_iProxyCount(0),
+		m_fMargin(fMargin),
+		m_vDirtyProxies(),
+		m_vStack()
+{
+
+}
+
+DynamicAABBTree::~DynamicAABBTree() {
+
+}
+
+void DynamicAABBTree::clear() {
+
+	m_vNodes.clear();
+	m_vDirtyProxies.clear();
+	m_iRoot = NULL_PROXY;
+	m_iFreeList = NULL_PROXY;
+	m_iProxyCount = 0;
+}
+
+int DynamicAABBTree::allocateNode() {
+
+	int iNode;
+	if(m_iFreeList != NULL_PROXY) {
+		iNode = m_iFreeList;
+		m_iFreeList = m_vNodes[iNode].iParent;
+	}
+	else {
+		iNode = (int)m_vNodes.size();
+		m_vNodes.push_back(TreeNode());
+	}
+
+	TreeNode& node = m_vNodes[iNode];
+	node.pUserData = NULL;
+	node.iParent = NULL_PROXY;
+	node.iChild1 = NULL_PROXY;
+	node.iChild2 = NULL_PROXY;
+	node.iHeight = 0;
+	node.bDirty = false;
+
+	return iNode;
+}
+
+void DynamicAABBTree::freeNode(int iNode) {
+
+	TreeNode& node = m_vNodes[iNode];
+	node.iParent = m_iFreeList;
+	node.iHeight = -1;
+	m_iFreeList = iNode;
+}
+
+int DynamicAABBTree::createProxy(const BoundingBox& box, void* pUserData) {
+
+	int iProxy = allocateNode();
+
+	Vector3 vMargin(m_fMargin, m_fMargin, m_fMargin);
+	TreeNode& node = m_vNodes[iProxy];
+	node.box.set(box.min - vMargin, box.max + vMargin);
+	node.pUserData = pUserData;
+
+	insertLeaf(iProxy);
+	++m_iProxyCount;
+
+	return iProxy;
+}
+
+void DynamicAABBTree::destroyProxy(int iProxy) {
+
+	GP_ASSERT( iProxy >= 0 && iProxy < (int)m_vNodes.size() );
+	GP_ASSERT( m_vNodes[iProxy].isLeaf() );
+
+	if(m_vNodes[iProxy].bDirty) {
+		std::vector<int>::iterator it = std::find(m_vDirtyProxies.begin(), m_vDirtyProxies.end(), iProxy);
+		if(it != m_vDirtyProxies.end())
+			m_vDirtyProxies.erase(it);
+	}
+
+	removeLeaf(iProxy);
+	freeNode(iProxy);
+	--m_iProxyCount;
+}
+
+bool DynamicAABBTree::moveProxy(int iProxy, const BoundingBox& box) {
+
+	GP_ASSERT( iProxy >= 0 && iProxy < (int)m_vNodes.size() );
+	GP_ASSERT( m_vNodes[iProxy].isLeaf() );
+
+	if(containsBox(m_vNodes[iProxy].box, box))
+		return false;
+
+	removeLeaf(iProxy);
+
+	Vector3 vMargin(m_fMargin, m_fMargin, m_fMargin);
+	m_vNodes[iProxy].box.set(box.min - vMargin, box.max + vMargin);
+
+	insertLeaf(iProxy);
+	return true;
+}
+
+void* DynamicAABBTree::getUserData(int iProxy) const {
+
+	GP_ASSERT( iProxy >= 0 && iProxy < (int)m_vNodes.size() );
+	return m_vNodes[iProxy].pUserData;
+}
+
+const BoundingBox& DynamicAABBTree::getFatBox(int iProxy) const {
+
+	GP_ASSERT( iProxy >= 0 && iProxy < (int)m_vNodes.size() );
+	return m_vNodes[iProxy].box;
+}
+
+unsigned int DynamicAABBTree::getProxyCount() const {
+	return m_iProxyCount;
+}
+
+int DynamicAABBTree::getHeight() const {
+	return (m_iRoot == NULL_PROXY) ? 0 : m_vNodes[m_iRoot].iHeight;
+}
+
+float DynamicAABBTree::getMargin() const {
+	return m_fMargin;
+}
+
+void DynamicAABBTree::setMargin(float fMargin) {
+	m_fMargin = fMargin;
+}
+
+void DynamicAABBTree::markDirty(int iProxy) {
+
+	GP_ASSERT( iProxy >= 0 && iProxy < (int)m_vNodes.size() );
+
+	TreeNode& node = m_vNodes[iProxy];
+	if(!node.bDirty) {
+		node.bDirty = true;
+		m_vDirtyProxies.push_back(iProxy);
+	}
+}
+
+void DynamicAABBTree::takeDirtyProxies(std::vector<int>& vProxies) {
+
+	vProxies.clear();
+	vProxies.swap(m_vDirtyProxies);
+
+	for(unsigned int i = 0; i < vProxies.size(); i++) {
+		m_vNodes[vProxies[i]].bDirty = false;
+	}
+}
+
+void DynamicAABBTree::insertLeaf(int iLeaf) {
+
+	if(m_iRoot == NULL_PROXY) {
+		m_iRoot = iLeaf;
+		m_vNodes[iLeaf].iParent = NULL_PROXY;
+		return;
+	}
+
+	// Walk down to the cheapest sibling
+	BoundingBox leafBox = m_vNodes[iLeaf].box;
+	int iIndex = m_iRoot;
+	while(!m_vNodes[iIndex].isLeaf()) {
+
+		const TreeNode& node = m_vNodes[iIndex];
+		int iChild1 = node.iChild1;
+		int iChild2 = node.iChild2;
+
+		float fArea = getArea(node.box);
+		float fCombinedArea = getArea(getUnion(node.box, leafBox));
+
+		// Cost of pairing with this node, and the cost pushed down to the children
+		float fCost = 2.0f * fCombinedArea;
+		float fInheritanceCost = 2.0f * (fCombinedArea - fArea);
+
+		const TreeNode& child1 = m_vNodes[iChild1];
+		float fCost1 = getArea(getUnion(leafBox, child1.box)) + fInheritanceCost;
+		if(!child1.isLeaf())
+			fCost1 -= getArea(child1.box);
+
+		const TreeNode& child2 = m_vNodes[iChild2];
+		float fCost2 = getArea(getUnion(leafBox, child2.box)) + fInheritanceCost;
+		if(!child2.isLeaf())
+			fCost2 -= getArea(child2.box);
+
+		if(fCost < fCost1 && fCost < fCost2)
+			break;
+
+		iIndex = (fCost1 < fCost2) ? iChild1 : iChild2;
+	}
+
+	int iSibling = iIndex;
+
+	// New parent for the sibling and the leaf
+	int iOldParent = m_vNodes[iSibling].iParent;
+	int iNewParent = allocateNode();
+	TreeNode& newParent = m_vNodes[iNewParent];
+	newParent.iParent = iOldParent;
+	newParent.box = getUnion(leafBox, m_vNodes[iSibling].box);
+	newParent.iHeight = m_vNodes[iSibling].iHeight + 1;
+	newParent.iChild1 = iSibling;
+	newParent.iChild2 = iLeaf;
+
+	if(iOldParent != NULL_PROXY) {
+		if(m_vNodes[iOldParent].iChild1 == iSibling)
+			m_vNodes[iOldParent].iChild1 = iNewParent;
+		else
+			m_vNodes[iOldParent].iChild2 = iNewParent;
+	}
+	else {
+		m_iRoot = iNewParent;
+	}
+
+	m_vNodes[iSibling].iParent = iNewParent;
+	m_vNodes[iLeaf].iParent = iNewParent;
+
+	// Refit and rebalance the ancestors
+	iIndex = m_vNodes[iLeaf].iParent;
+	while(iIndex != NULL_PROXY) {
+
+		iIndex = balance(iIndex);
+
+		TreeNode& node = m_vNodes[iIndex];
+		const TreeNode& child1 = m_vNodes[node.iChild1];
+		const TreeNode& child2 = m_vNodes[node.iChild2];
+		node.iHeight = 1 + std::max(child1.iHeight, child2.iHeight);
+		node.box = getUnion(child1.box, child2.box);
+
+		iIndex = node.iParent;
+	}
+}
+
+void DynamicAABBTree::removeLeaf(int iLeaf) {
+
+	if(iLeaf == m_iRoot) {
+		m_iRoot = NULL_PROXY;
+		return;
+	}
+
+	int iParent = m_vNodes[iLeaf].iParent;
+	int iGrandParent = m_vNodes[iParent].iParent;
+	int iSibling = (m_vNodes[iParent].iChild1 == iLeaf) ? m_vNodes[iParent].iChild2 : m_vNodes[iParent].iChild1;
+
+	if(iGrandParent != NULL_PROXY) {
+
+		// Replace the parent by the sibling
+		if(m_vNodes[iGrandParent].iChild1 == iParent)
+			m_vNodes[iGrandParent].iChild1 = iSibling;
+		else
+			m_vNodes[iGrandParent].iChild2 = iSibling;
+		m_vNodes[iSibling].iParent = iGrandParent;
+		freeNode(iParent);
+
+		int iIndex = iGrandParent;
+		while(iIndex != NULL_PROXY) {
+
+			iIndex = balance(iIndex);
+
+			TreeNode& node = m_vNodes[iIndex];
+			const TreeNode& child1 = m_vNodes[node.iChild1];
+			const TreeNode& child2 = m_vNodes[node.iChild2];
+			node.box = getUnion(child1.box, child2.box);
+			node.iHeight = 1 + std::max(child1.iHeight, child2.iHeight);
+
+			iIndex = node.iParent;
+		}
+	}
+	else {
+		m_iRoot = iSibling;
+		m_vNodes[iSibling].iParent = NULL_PROXY;
+		freeNode(iParent);
+	}
+
+	m_vNodes[iLeaf].iParent = NULL_PROXY;
+}
+
+int DynamicAABBTree::balance(int iA) {
+
+	TreeNode& A = m_vNodes[iA];
+	if(A.isLeaf() || A.iHeight < 2)
+		return iA;
+
+	int iB = A.iChild1;
+	int iC = A.iChild2;
+	TreeNode& B = m_vNodes[iB];
+	TreeNode& C = m_vNodes[iC];
+
+	int iBalance = C.iHeight - B.iHeight;
+
+	// Rotate C up
+	if(iBalance > 1) {
+
+		int iF = C.iChild1;
+		int iG = C.iChild2;
+		TreeNode& F = m_vNodes[iF];
+		TreeNode& G = m_vNodes[iG];
+
+		C.iChild1 = iA;
+		C.iParent = A.iParent;
+		A.iParent = iC;
+
+		if(C.iParent != NULL_PROXY) {
+			if(m_vNodes[C.iParent].iChild1 == iA)
+				m_vNodes[C.iParent].iChild1 = iC;
+			else
+				m_vNodes[C.iParent].iChild2 = iC;
+		}
+		else {
+			m_iRoot = iC;
+		}
+
+		if(F.iHeight > G.iHeight) {
+			C.iChild2 = iF;
+			A.iChild2 = iG;
+			G.iParent = iA;
+			A.box = getUnion(B.box, G.box);
+			C.box = getUnion(A.box, F.box);
+			A.iHeight = 1 + std::max(B.iHeight, G.iHeight);
+			C.iHeight = 1 + std::max(A.iHeight, F.iHeight);
+		}
+		else {
+			C.iChild2 = iG;
+			A.iChild2 = iF;
+			F.iParent = iA;
+			A.box = getUnion(B.box, F.box);
+			C.box = getUnion(A.box, G.box);
+			A.iHeight = 1 + std::max(B.iHeight, F.iHeight);
+			C.iHeight = 1 + std::max(A.iHeight, G.iHeight);
+		}
+
+		return iC;
+	}
+
+	// Rotate B up
+	if(iBalance < -1) {
+
+		int iD = B.iChild1;
+		int iE = B.iChild2;
+		TreeNode& D = m_vNodes[iD];
+		TreeNode& E = m_vNodes[iE];
+
+		B.iChild1 = iA;
+		B.iParent = A.iParent;
+		A.iParent = iB;
+
+		if(B.iParent != NULL_PROXY) {
+			if(m_vNodes[B.iParent].iChild1 == iA)
+				m_vNodes[B.iParent].iChild1 = iB;
+			else
+				m_vNodes[B.iParent].iChild2 = iB;
+		}
+		else {
+			m_iRoot = iB;
+		}
+
+		if(D.iHeight > E.iHeight) {
+			B.iChild2 = iD;
+			A.iChild1 = iE;
+			E.iParent = iA;
+			A.box = getUnion(C.box, E.box);
+			B.box = getUnion(A.box, D.box);
+			A.iHeight = 1 + std::max(C.iHeight, E.iHeight);
+			B.iHeight = 1 + std::max(A.iHeight, D.iHeight);
+		}
+		else {
+			B.iChild2 = iE;
+			A.iChild1 = iD;
+			D.iParent = iA;
+			A.box = getUnion(C.box, D.box);
+			B.box = getUnion(A.box, E.box);
+			A.iHeight = 1 + std::max(C.iHeight, D.iHeight);
+			B.iHeight = 1 + std::max(A.iHeight, E.iHeight);
+		}
+
+		return iB;
+	}
+
+	return iA;
+}
+
+void DynamicAABBTree::collectLeaves(int iNode, std::vector<void*>& vResults) const {
+
+	const TreeNode& node = m_vNodes[iNode];
+	if(node.isLeaf()) {
+		vResults.push_back(node.pUserData);
+		return;
+	}
+
+	collectLeaves(node.iChild1, vResults);
+	collectLeaves(node.iChild2, vResults);
+}
+
+void DynamicAABBTree::query(const BoundingBox& box, std::vector<void*>& vResults) const {
+
+	if(m_iRoot == NULL_PROXY)
+		return;
+
+	m_vStack.clear();
+	m_vStack.push_back(m_iRoot);
+	while(!m_vStack.empty()) {
+
+		const TreeNode& node = m_vNodes[m_vStack.back()];
+		m_vStack.pop_back();
+
+		if(!node.box.intersects(box))
+			continue;
+
+		if(node.isLeaf()) {
+			vResults.push_back(node.pUserData);
+		}
+		else {
+			m_vStack.push_back(node.iChild1);
+			m_vStack.push_back(node.iChild2);
+		}
+	}
+}
+
+void DynamicAABBTree::query(const BoundingSphere& sphere, std::vector<void*>& vResults) const {
+
+	if(m_iRoot == NULL_PROXY || sphere.isEmpty())
+		return;
+
+	m_vStack.clear();
+	m_vStack.push_back(m_iRoot);
+	while(!m_vStack.empty()) {
+
+		const TreeNode& node = m_vNodes[m_vStack.back()];
+		m_vStack.pop_back();
+
+		if(!node.box.intersects(sphere))
+			continue;
+
+		if(node.isLeaf()) {
+			vResults.push_back(node.pUserData);
+		}
+		else {
+			m_vStack.push_back(node.iChild1);
+			m_vStack.push_back(node.iChild2);
+		}
+	}
+}
+
+void DynamicAABBTree::query(const Frustum& frustum, std::vector<void*>& vResults) const {
+
+	if(m_iRoot == NULL_PROXY)
+		return;
+
+	m_vStack.clear();
+	m_vStack.push_back(m_iRoot);
+	while(!m_vStack.empty()) {
+
+		int iNode = m_vStack.back();
+		m_vStack.pop_back();
+
+		const TreeNode& node = m_vNodes[iNode];
+		if(!frustum.intersects(node.box))
+			continue;
+
+		if(node.isLeaf()) {
+			vResults.push_back(node.pUserData);
+		}
+		// Whole subtree inside, no further plane tests
+		else if(frustum.contains(node.box)) {
+			collectLeaves(iNode, vResults);
+		}
+		else {
+			m_vStack.push_back(node.iChild1);
+			m_vStack.push_back(node.iChild2);
+		}
+	}
+}
+
+void DynamicAABBTree::query(const Ray& ray, float fMaxDistance, std::vector<void*>& vResults) const {
+
+	if(m_iRoot == NULL_PROXY)
+		return;
+
+	m_vStack.clear();
+	m_vStack.push_back(m_iRoot);
+	while(!m_vStack.empty()) {
+
+		const TreeNode& node = m_vNodes[m_vStack.back()];
+		m_vStack.pop_back();
+
+		float fDistance;
+		if(!ray.intersects(node.box, &fDistance) || fDistance > fMaxDistance)
+			continue;
+
+		if(node.isLeaf()) {
+			vResults.push_back(node.pUserData);
+		}
+		else {
+			m_vStack.push_back(node.iChild1);
+			m_vStack.push_back(node.iChild2);
+		}
+	}
+}
+
+void* DynamicAABBTree::raycast(const Ray& ray, float fMaxDistance, RaycastCallback pCallback, void* pContext, float* pDistance) const {
+
+	void* pClosest = NULL;
+	if(m_iRoot == NULL_PROXY)
+		return NULL;
+
+	m_vStack.clear();
+	m_vStack.push_back(m_iRoot);
+	while(!m_vStack.empty()) {
+
+		const TreeNode& node = m_vNodes[m_vStack.back()];
+		m_vStack.pop_back();
+
+		float fDistance;
+		if(!ray.intersects(node.box, &fDistance) || fDistance > fMaxDistance)
+			continue;
+
+		if(node.isLeaf()) {
+			if(pCallback)
+				fDistance = pCallback(node.pUserData, ray, fMaxDistance, pContext);
+
+			if(fDistance >= 0.0f && fDistance <= fMaxDistance) {
+				fMaxDistance = fDistance;
+				pClosest = node.pUserData;
+			}
+		}
+		else {
+			// Nearer child popped first
+			float fDistance1 = FLT_MAX;
+			float fDistance2 = FLT_MAX;
+			bool bHit1 = ray.intersects(m_vNodes[node.iChild1].box, &fDistance1);
+			bool bHit2 = ray.intersects(m_vNodes[node.iChild2].box, &fDistance2);
+
+			if(bHit1 && bHit2) {
+				if(fDistance1 < fDistance2) {
+					m_vStack.push_back(node.iChild2);
+					m_vStack.push_back(node.iChild1);
+				}
+				else {
+					m_vStack.push_back(node.iChild1);
+					m_vStack.push_back(node.iChild2);
+				}
+			}
+			else if(bHit1) {
+				m_vStack.push_back(node.iChild1);
+			}
+			else if(bHit2) {
+				m_vStack.push_back(node.iChild2);
+			}
+		}
+	}
+
+	if(pDistance && pClosest)
+		*pDistance = fMaxDistance;
+
+	return pClosest;
+}
@@ -0,0 +1,120 @@
+#include "Common/Frustum.h"
+#include "Engine/Base.h"
+#include <cmath>
+
+///////////////////////////////////////////////////////////////////////////
+// Plane
+///////////////////////////////////////////////////////////////////////////
+Plane::Plane()
+	:	normal(0.0f, 0.0f, 1.0f),
+		d(0.0f) {
+}
+
+Plane::Plane(const Vector3& vNormal, float fD)
+	:	normal(vNormal),
+		d(fD) {
+}
+
+void Plane::set(float a, float b, float c, float fD) {
+
+	float fLength = sqrtf(a*a + b*b + c*c);
+	float fInv = (fLength > 0.0f) ? 1.0f / fLength : 0.0f;
+
+	normal.set(a * fInv, b * fInv, c * fInv);
+	d = fD * fInv;
+}
+
+float Plane::distance(const Vector3& point) const {
+	return normal.x * point.x + normal.y * point.y + normal.z * point.z + d;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Frustum
+///////////////////////////////////////////////////////////////////////////
+Frustum::Frustum() {
+}
+
+Frustum::Frustum(const Matrix4& viewProjection) {
+	set(viewProjection);
+}
+
+void Frustum::set(const Matrix4& m) {
+
+	// Clip space w +/- x,y,z, with row i being m[4i .. 4i+3]
+	m_Planes[PLANE_LEFT].set(	m[12] + m[0],	m[13] + m[1],	m[14] + m[2],	m[15] + m[3]);
+	m_Planes[PLANE_RIGHT].set(	m[12] - m[0],	m[13] - m[1],	m[14] - m[2],	m[15] - m[3]);
+	m_Planes[PLANE_BOTTOM].set(	m[12] + m[4],	m[13] + m[5],	m[14] + m[6],	m[15] + m[7]);
+	m_Planes[PLANE_TOP].set(	m[12] - m[4],	m[13] - m[5],	m[14] - m[6],	m[15] - m[7]);
+	m_Planes[PLANE_NEAR].set(	m[12] + m[8],	m[13] + m[9],	m[14] + m[10],	m[15] + m[11]);
+	m_Planes[PLANE_FAR].set(	m[12] - m[8],	m[13] - m[9],	m[14] - m[10],	m[15] - m[11]);
+}
+
+const Plane& Frustum::getPlane(unsigned int i) const {
+
+	GP_ASSERT(i < PLANE_COUNT);
+	return m_Planes[i];
+}
+
+bool Frustum::intersects(const Vector3& point) const {
+
+	for(unsigned int i = 0; i < PLANE_COUNT; i++) {
+		if(m_Planes[i].distance(point) < 0.0f)
+			return false;
+	}
+
+	return true;
+}
+
+bool Frustum::intersects(const BoundingSphere& sphere) const {
+
+	if(sphere.isEmpty())
+		return false;
+
+	for(unsigned int i = 0; i < PLANE_COUNT; i++) {
+		if(m_Planes[i].distance(sphere.center) < -sphere.radius)
+			return false;
+	}
+
+	return true;
+}
+
+bool Frustum::intersects(const BoundingBox& box) const {
+
+	if(box.isEmpty())
+		return false;
+
+	// Only the corner furthest along each plane normal needs testing. May
+	// report boxes near frustum corners as visible, which is conservative.
+	for(unsigned int i = 0; i < PLANE_COUNT; i++) {
+
+		const Plane& plane = m_Planes[i];
+		Vector3 p(	plane.normal.x >= 0.0f ? box.max.x : box.min.x,
+					plane.normal.y >= 0.0f ? box.max.y : box.min.y,
+					plane.normal.z >= 0.0f ? box.max.z : box.min.z);
+
+		if(plane.distance(p) < 0.0f)
+			return false;
+	}
+
+	return true;
+}
+
+bool Frustum::contains(const BoundingBox& box) const {
+
+	if(box.isEmpty())
+		return false;
+
+	// The corner nearest to the outside of each plane must be in front.
+	for(unsigned int i = 0; i < PLANE_COUNT; i++) {
+
+		const Plane& plane = m_Planes[i];
+		Vector3 n(	plane.normal.x >= 0.0f ? box.min.x : box.max.x,
+					plane.normal.y >= 0.0f ? box.min.y : box.max.y,
+					plane.normal.z >= 0.0f ? box.min.z : box.max.z);
+
+		if(plane.distance(n) < 0.0f)
+			return false;
+	}
+
+	return true;
+}
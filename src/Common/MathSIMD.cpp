@@ -0,0 +1,445 @@
+#include "Common/MathSIMD.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef MATH_SIMD_X86
+	#include <emmintrin.h>
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#else
+		#include <cpuid.h>
+	#endif
+#endif
+
+// Same threshold as Matrices.h, kept local so Common/MathSIMD has no Engine dependency.
+#define MATH_SIMD_TOLERANCE			2e-37f
+
+MathSIMD::Backend				MathSIMD::m_Backend = MathSIMD::BACKEND_SCALAR;
+bool							MathSIMD::m_bInitialized = false;
+MathSIMD::MultiplyMatrixFn		MathSIMD::m_pfnMultiplyMatrix = NULL;
+MathSIMD::InvertMatrixFn		MathSIMD::m_pfnInvertMatrix = NULL;
+MathSIMD::TransformVectorFn		MathSIMD::m_pfnTransformVector = NULL;
+
+///////////////////////////////////////////////////////////////////////////
+// scalar reference
+///////////////////////////////////////////////////////////////////////////
+void MathSIMD::multiplyMatrixScalar(const float* a, const float* b, float* dst) {
+
+	// Support the case where a or b is the same array as dst.
+	float product[16];
+
+	for(int r = 0; r < 4; r++) {
+		const float* row = a + r*4;
+		product[r*4 + 0] = row[0] * b[0] + row[1] * b[4] + row[2] * b[8]  + row[3] * b[12];
+		product[r*4 + 1] = row[0] * b[1] + row[1] * b[5] + row[2] * b[9]  + row[3] * b[13];
+		product[r*4 + 2] = row[0] * b[2] + row[1] * b[6] + row[2] * b[10] + row[3] * b[14];
+		product[r*4 + 3] = row[0] * b[3] + row[1] * b[7] + row[2] * b[11] + row[3] * b[15];
+	}
+
+	memcpy(dst, product, sizeof(float) * 16);
+}
+
+bool MathSIMD::invertMatrixScalar(const float* m, float* dst) {
+
+	float a0 = m[0] * m[5] - m[1] * m[4];
+	float a1 = m[0] * m[6] - m[2] * m[4];
+	float a2 = m[0] * m[7] - m[3] * m[4];
+	float a3 = m[1] * m[6] - m[2] * m[5];
+	float a4 = m[1] * m[7] - m[3] * m[5];
+	float a5 = m[2] * m[7] - m[3] * m[6];
+	float b0 = m[8] * m[13] - m[9] * m[12];
+	float b1 = m[8] * m[14] - m[10] * m[12];
+	float b2 = m[8] * m[15] - m[11] * m[12];
+	float b3 = m[9] * m[14] - m[10] * m[13];
+	float b4 = m[9] * m[15] - m[11] * m[13];
+	float b5 = m[10] * m[15] - m[11] * m[14];
+
+	// Calculate the determinant.
+	float det = a0 * b5 - a1 * b4 + a2 * b3 + a3 * b2 - a4 * b1 + a5 * b0;
+
+	// Close to zero, can't invert.
+	if(fabs(det) <= MATH_SIMD_TOLERANCE)
+		return false;
+
+	// Support the case where m == dst.
+	float inverse[16];
+	inverse[0]  = m[5] * b5 - m[6] * b4 + m[7] * b3;
+	inverse[1]  = -m[1] * b5 + m[2] * b4 - m[3] * b3;
+	inverse[2]  = m[13] * a5 - m[14] * a4 + m[15] * a3;
+	inverse[3]  = -m[9] * a5 + m[10] * a4 - m[11] * a3;
+
+	inverse[4]  = -m[4] * b5 + m[6] * b2 - m[7] * b1;
+	inverse[5]  = m[0] * b5 - m[2] * b2 + m[3] * b1;
+	inverse[6]  = -m[12] * a5 + m[14] * a2 - m[15] * a1;
+	inverse[7]  = m[8] * a5 - m[10] * a2 + m[11] * a1;
+
+	inverse[8]  = m[4] * b4 - m[5] * b2 + m[7] * b0;
+	inverse[9]  = -m[0] * b4 + m[1] * b2 - m[3] * b0;
+	inverse[10] = m[12] * a4 - m[13] * a2 + m[15] * a0;
+	inverse[11] = -m[8] * a4 + m[9] * a2 - m[11] * a0;
+
+	inverse[12] = -m[4] * b3 + m[5] * b1 - m[6] * b0;
+	inverse[13] = m[0] * b3 - m[1] * b1 + m[2] * b0;
+	inverse[14] = -m[12] * a3 + m[13] * a1 - m[14] * a0;
+	inverse[15] = m[8] * a3 - m[9] * a1 + m[10] * a0;
+
+	float invDet = 1.0f / det;
+	for(int i = 0; i < 16; i++) {
+		dst[i] = inverse[i] * invDet;
+	}
+
+	return true;
+}
+
+void MathSIMD::transformVectorScalar(const float* m, const float* v, float* dst) {
+
+	float x = v[0], y = v[1], z = v[2], w = v[3];
+
+	dst[0] = x * m[0] + y * m[4] + z * m[8]  + w * m[12];
+	dst[1] = x * m[1] + y * m[5] + z * m[9]  + w * m[13];
+	dst[2] = x * m[2] + y * m[6] + z * m[10] + w * m[14];
+	dst[3] = x * m[3] + y * m[7] + z * m[11] + w * m[15];
+}
+
+#ifdef MATH_SIMD_X86
+///////////////////////////////////////////////////////////////////////////
+// SSE2
+// The kernels keep the scalar evaluation order (no FMA), so results are
+// bit-identical to the reference path.
+///////////////////////////////////////////////////////////////////////////
+MATH_SIMD_TARGET_SSE2
+static void multiplyMatrixSSE2(const float* a, const float* b, float* dst) {
+
+	__m128 b0 = _mm_loadu_ps(b);
+	__m128 b1 = _mm_loadu_ps(b + 4);
+	__m128 b2 = _mm_loadu_ps(b + 8);
+	__m128 b3 = _mm_loadu_ps(b + 12);
+
+	// All rows of a are read before dst is written, so dst may alias a or b.
+	__m128 a0 = _mm_loadu_ps(a);
+	__m128 a1 = _mm_loadu_ps(a + 4);
+	__m128 a2 = _mm_loadu_ps(a + 8);
+	__m128 a3 = _mm_loadu_ps(a + 12);
+
+	__m128 rows[4] = { a0, a1, a2, a3 };
+	__m128 result[4];
+	for(int r = 0; r < 4; r++) {
+		__m128 row = rows[r];
+		__m128 v = _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+		v = _mm_add_ps(v, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+		v = _mm_add_ps(v, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+		v = _mm_add_ps(v, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(3, 3, 3, 3)), b3));
+		result[r] = v;
+	}
+
+	_mm_storeu_ps(dst,		result[0]);
+	_mm_storeu_ps(dst + 4,	result[1]);
+	_mm_storeu_ps(dst + 8,	result[2]);
+	_mm_storeu_ps(dst + 12,	result[3]);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Same cofactor expansion as invertMatrixScalar(), four lanes at a time.
+//
+// With Vj = (m[4+j], m[j], m[12+j], m[8+j]), Qk = (bk, bk, ak, ak) and
+// N = (+, -, +, -) the rows of the adjugate are:
+//   row0 =  N * (V1*Q5 - V2*Q4 + V3*Q3)
+//   row1 = -N * (V0*Q5 - V2*Q2 + V3*Q1)
+//   row2 =  N * (V0*Q4 - V1*Q2 + V3*Q0)
+//   row3 = -N * (V0*Q3 - V1*Q1 + V2*Q0)
+///////////////////////////////////////////////////////////////////////////
+MATH_SIMD_TARGET_SSE2
+static bool invertMatrixSSE2(const float* m, float* dst) {
+
+	__m128 r0 = _mm_loadu_ps(m);
+	__m128 r1 = _mm_loadu_ps(m + 4);
+	__m128 r2 = _mm_loadu_ps(m + 8);
+	__m128 r3 = _mm_loadu_ps(m + 12);
+
+	// a0..a3 = r0.xxxy * r1.yzwz - r0.yzwz * r1.xxxy, a4 a5 = r0.yz * r1.ww - r0.ww * r1.yz
+	__m128 aLo = _mm_sub_ps(	_mm_mul_ps(_mm_shuffle_ps(r0, r0, _MM_SHUFFLE(1, 0, 0, 0)), _mm_shuffle_ps(r1, r1, _MM_SHUFFLE(2, 3, 2, 1))),
+								_mm_mul_ps(_mm_shuffle_ps(r0, r0, _MM_SHUFFLE(2, 3, 2, 1)), _mm_shuffle_ps(r1, r1, _MM_SHUFFLE(1, 0, 0, 0))));
+	__m128 aHi = _mm_sub_ps(	_mm_mul_ps(_mm_shuffle_ps(r0, r0, _MM_SHUFFLE(3, 3, 2, 1)), _mm_shuffle_ps(r1, r1, _MM_SHUFFLE(3, 3, 3, 3))),
+								_mm_mul_ps(_mm_shuffle_ps(r0, r0, _MM_SHUFFLE(3, 3, 3, 3)), _mm_shuffle_ps(r1, r1, _MM_SHUFFLE(3, 3, 2, 1))));
+	__m128 bLo = _mm_sub_ps(	_mm_mul_ps(_mm_shuffle_ps(r2, r2, _MM_SHUFFLE(1, 0, 0, 0)), _mm_shuffle_ps(r3, r3, _MM_SHUFFLE(2, 3, 2, 1))),
+								_mm_mul_ps(_mm_shuffle_ps(r2, r2, _MM_SHUFFLE(2, 3, 2, 1)), _mm_shuffle_ps(r3, r3, _MM_SHUFFLE(1, 0, 0, 0))));
+	__m128 bHi = _mm_sub_ps(	_mm_mul_ps(_mm_shuffle_ps(r2, r2, _MM_SHUFFLE(3, 3, 2, 1)), _mm_shuffle_ps(r3, r3, _MM_SHUFFLE(3, 3, 3, 3))),
+								_mm_mul_ps(_mm_shuffle_ps(r2, r2, _MM_SHUFFLE(3, 3, 3, 3)), _mm_shuffle_ps(r3, r3, _MM_SHUFFLE(3, 3, 2, 1))));
+
+	MATH_ALIGN16 float a[8];
+	MATH_ALIGN16 float b[8];
+	_mm_store_ps(a, aLo);	_mm_store_ps(a + 4, aHi);
+	_mm_store_ps(b, bLo);	_mm_store_ps(b + 4, bHi);
+
+	float det = a[0] * b[5] - a[1] * b[4] + a[2] * b[3] + a[3] * b[2] - a[4] * b[1] + a[5] * b[0];
+	if(fabs(det) <= MATH_SIMD_TOLERANCE)
+		return false;
+
+	// Vj: transpose of (r1, r0, r3, r2)
+	__m128 v0 = r1, v1 = r0, v2 = r3, v3 = r2;
+	_MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+
+	__m128 q0 = _mm_shuffle_ps(bLo, aLo, _MM_SHUFFLE(0, 0, 0, 0));
+	__m128 q1 = _mm_shuffle_ps(bLo, aLo, _MM_SHUFFLE(1, 1, 1, 1));
+	__m128 q2 = _mm_shuffle_ps(bLo, aLo, _MM_SHUFFLE(2, 2, 2, 2));
+	__m128 q3 = _mm_shuffle_ps(bLo, aLo, _MM_SHUFFLE(3, 3, 3, 3));
+	__m128 q4 = _mm_shuffle_ps(bHi, aHi, _MM_SHUFFLE(0, 0, 0, 0));
+	__m128 q5 = _mm_shuffle_ps(bHi, aHi, _MM_SHUFFLE(1, 1, 1, 1));
+
+	__m128 invDet = _mm_set1_ps(1.0f / det);
+	__m128 signPos = _mm_mul_ps(_mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f), invDet);
+	__m128 signNeg = _mm_mul_ps(_mm_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f), invDet);
+
+	__m128 i0 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(v1, q5), _mm_mul_ps(v2, q4)), _mm_mul_ps(v3, q3));
+	__m128 i1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(v0, q5), _mm_mul_ps(v2, q2)), _mm_mul_ps(v3, q1));
+	__m128 i2 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(v0, q4), _mm_mul_ps(v1, q2)), _mm_mul_ps(v3, q0));
+	__m128 i3 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(v0, q3), _mm_mul_ps(v1, q1)), _mm_mul_ps(v2, q0));
+
+	_mm_storeu_ps(dst,		_mm_mul_ps(i0, signPos));
+	_mm_storeu_ps(dst + 4,	_mm_mul_ps(i1, signNeg));
+	_mm_storeu_ps(dst + 8,	_mm_mul_ps(i2, signPos));
+	_mm_storeu_ps(dst + 12,	_mm_mul_ps(i3, signNeg));
+
+	return true;
+}
+
+MATH_SIMD_TARGET_SSE2
+static void transformVectorSSE2(const float* m, const float* v, float* dst) {
+
+	__m128 r = _mm_mul_ps(_mm_set1_ps(v[0]), _mm_loadu_ps(m));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v[1]), _mm_loadu_ps(m + 4)));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v[2]), _mm_loadu_ps(m + 8)));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v[3]), _mm_loadu_ps(m + 12)));
+
+	_mm_storeu_ps(dst, r);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// AVX2
+// Two rows of the product per 256-bit register. FMA is deliberately not
+// used so that the AVX2 path stays bit-identical to SSE2 and scalar.
+///////////////////////////////////////////////////////////////////////////
+MATH_SIMD_TARGET_AVX2
+static void multiplyMatrixAVX2(const float* a, const float* b, float* dst) {
+
+	__m256 b0 = _mm256_broadcast_ps((const __m128*)(b));
+	__m256 b1 = _mm256_broadcast_ps((const __m128*)(b + 4));
+	__m256 b2 = _mm256_broadcast_ps((const __m128*)(b + 8));
+	__m256 b3 = _mm256_broadcast_ps((const __m128*)(b + 12));
+
+	__m256 a01 = _mm256_loadu_ps(a);
+	__m256 a23 = _mm256_loadu_ps(a + 8);
+
+	__m256 r01 = _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0x00), b0);
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0x55), b1));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0xAA), b2));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(_mm256_shuffle_ps(a01, a01, 0xFF), b3));
+
+	__m256 r23 = _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0x00), b0);
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0x55), b1));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0xAA), b2));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(_mm256_shuffle_ps(a23, a23, 0xFF), b3));
+
+	_mm256_storeu_ps(dst, r01);
+	_mm256_storeu_ps(dst + 8, r23);
+	_mm256_zeroupper();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// CPU feature detection
+///////////////////////////////////////////////////////////////////////////
+static void cpuid(int iLeaf, int iSubLeaf, int regs[4]) {
+#if defined(_MSC_VER)
+	__cpuidex(regs, iLeaf, iSubLeaf);
+#else
+	unsigned int a = 0, b = 0, c = 0, d = 0;
+	__cpuid_count(iLeaf, iSubLeaf, a, b, c, d);
+	regs[0] = a; regs[1] = b; regs[2] = c; regs[3] = d;
+#endif
+}
+
+static unsigned long long xgetbv0() {
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int eax = 0, edx = 0;
+	__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+#endif // MATH_SIMD_X86
+
+MathSIMD::Backend MathSIMD::detectBackend() {
+#ifdef MATH_SIMD_X86
+	int regs[4];
+	cpuid(0, 0, regs);
+	int iMaxLeaf = regs[0];
+
+	cpuid(1, 0, regs);
+	bool bSSE2 = (regs[3] & (1 << 26)) != 0;
+	bool bOSXSave = (regs[2] & (1 << 27)) != 0;
+	bool bAVX = (regs[2] & (1 << 28)) != 0;
+
+	if(!bSSE2)
+		return BACKEND_SCALAR;
+
+	// AVX2 needs the CPU bit and the OS saving the YMM state (XCR0 bits 1 and 2).
+	if(bAVX && bOSXSave && iMaxLeaf >= 7 && (xgetbv0() & 0x6) == 0x6) {
+		cpuid(7, 0, regs);
+		if(regs[1] & (1 << 5))
+			return BACKEND_AVX2;
+	}
+
+	return BACKEND_SSE2;
+#else
+	return BACKEND_SCALAR;
+#endif
+}
+
+const char* MathSIMD::getBackendName(Backend backend) {
+	switch(backend) {
+		case BACKEND_SSE2:	return "SSE2";
+		case BACKEND_AVX2:	return "AVX2";
+		default:			return "Scalar";
+	}
+}
+
+void MathSIMD::bindBackend(Backend backend) {
+
+	m_pfnMultiplyMatrix = multiplyMatrixScalar;
+	m_pfnInvertMatrix = invertMatrixScalar;
+	m_pfnTransformVector = transformVectorScalar;
+
+#ifdef MATH_SIMD_X86
+	if(backend >= BACKEND_SSE2) {
+		m_pfnMultiplyMatrix = multiplyMatrixSSE2;
+		m_pfnInvertMatrix = invertMatrixSSE2;
+		m_pfnTransformVector = transformVectorSSE2;
+	}
+
+	if(backend >= BACKEND_AVX2) {
+		m_pfnMultiplyMatrix = multiplyMatrixAVX2;
+	}
+#else
+	backend = BACKEND_SCALAR;
+#endif
+
+	m_Backend = backend;
+	m_bInitialized = true;
+}
+
+MathSIMD::Backend MathSIMD::getBackend() {
+	if(!m_bInitialized) {
+		bindBackend(detectBackend());
+	}
+
+	return m_Backend;
+}
+
+MathSIMD::Backend MathSIMD::setBackend(Backend backend) {
+
+	Backend supported = detectBackend();
+	bindBackend(backend > supported ? supported : backend);
+
+	return m_Backend;
+}
+
+void MathSIMD::multiplyMatrix(const float* a, const float* b, float* dst) {
+	if(!m_bInitialized) {
+		bindBackend(detectBackend());
+	}
+
+	m_pfnMultiplyMatrix(a, b, dst);
+}
+
+bool MathSIMD::invertMatrix(const float* m, float* dst) {
+	if(!m_bInitialized) {
+		bindBackend(detectBackend());
+	}
+
+	return m_pfnInvertMatrix(m, dst);
+}
+
+void MathSIMD::transformVector(const float* m, const float* v, float* dst) {
+	if(!m_bInitialized) {
+		bindBackend(detectBackend());
+	}
+
+	m_pfnTransformVector(m, v, dst);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// backend vs reference comparison
+///////////////////////////////////////////////////////////////////////////
+static float randomMatrixValue(unsigned int& iSeed) {
+	// Small LCG so results are reproducible across runs and compilers.
+	iSeed = iSeed * 1664525u + 1013904223u;
+	return ((float)((iSeed >> 8) & 0xFFFF) / 65535.0f) * 20.0f - 10.0f;
+}
+
+static float maxAbsDifference(const float* a, const float* b, int iCount) {
+	float fMax = 0.0f;
+	for(int i = 0; i < iCount; i++) {
+		float fDiff = fabs(a[i] - b[i]);
+		if(fDiff > fMax)
+			fMax = fDiff;
+	}
+
+	return fMax;
+}
+
+bool MathSIMD::verify(float fTolerance, unsigned int iIterations, float* pMaxError) {
+
+	getBackend();
+
+	unsigned int iSeed = 0x5EED1234u;
+	float fMaxError = 0.0f;
+	bool bMatch = true;
+
+	for(unsigned int i = 0; i < iIterations; i++) {
+		float a[16], b[16], v[4];
+		for(int j = 0; j < 16; j++) {
+			a[j] = randomMatrixValue(iSeed);
+			b[j] = randomMatrixValue(iSeed);
+		}
+		for(int j = 0; j < 4; j++) {
+			v[j] = randomMatrixValue(iSeed);
+		}
+
+		float ref[16], res[16];
+
+		multiplyMatrixScalar(a, b, ref);
+		m_pfnMultiplyMatrix(a, b, res);
+		float fError = maxAbsDifference(ref, res, 16);
+
+		// In-place must give the same answer.
+		memcpy(res, a, sizeof(res));
+		m_pfnMultiplyMatrix(res, b, res);
+		fError = std::max(fError, maxAbsDifference(ref, res, 16));
+
+		bool bRefInvertible = invertMatrixScalar(a, ref);
+		bool bResInvertible = m_pfnInvertMatrix(a, res);
+		if(bRefInvertible != bResInvertible) {
+			bMatch = false;
+		}
+		else
+		if(bRefInvertible) {
+			fError = std::max(fError, maxAbsDifference(ref, res, 16));
+		}
+
+		transformVectorScalar(a, v, ref);
+		m_pfnTransformVector(a, v, res);
+		fError = std::max(fError, maxAbsDifference(ref, res, 4));
+
+		if(fError > fMaxError)
+			fMaxError = fError;
+	}
+
+	if(pMaxError)
+		*pMaxError = fMaxError;
+
+	return bMatch && fMaxError <= fTolerance;
+}
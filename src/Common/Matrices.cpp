@@ -1,4 +1,5 @@
 #include "Common/Matrices.h"
+#include "Common/MathSIMD.h"
 #include "Engine/Base.h"
 
 ///////////////////////////////////////////////////////////////////////////
@@ -656,78 +657,19 @@ void Matrix4::multiply(const Matrix4& m1, const Matrix4& m2, Matrix4* dst) {
 
 void Matrix4::multiplyMatrix(const float* m1, const float* m2, float* dst) {
 
-	// Support the case where m1 or m2 is the same array as dst.
-	float product[16];
-
-	product[0]  = m1[0] * m2[0]  + m1[4] * m2[1] + m1[8]   * m2[2]  + m1[12] * m2[3];
-	product[1]  = m1[1] * m2[0]  + m1[5] * m2[1] + m1[9]   * m2[2]  + m1[13] * m2[3];
-	product[2]  = m1[2] * m2[0]  + m1[6] * m2[1] + m1[10]  * m2[2]  + m1[14] * m2[3];
-	product[3]  = m1[3] * m2[0]  + m1[7] * m2[1] + m1[11]  * m2[2]  + m1[15] * m2[3];
-
-	product[4]  = m1[0] * m2[4]  + m1[4] * m2[5] + m1[8]   * m2[6]  + m1[12] * m2[7];
-	product[5]  = m1[1] * m2[4]  + m1[5] * m2[5] + m1[9]   * m2[6]  + m1[13] * m2[7];
-	product[6]  = m1[2] * m2[4]  + m1[6] * m2[5] + m1[10]  * m2[6]  + m1[14] * m2[7];
-	product[7]  = m1[3] * m2[4]  + m1[7] * m2[5] + m1[11]  * m2[6]  + m1[15] * m2[7];
-
-	product[8]  = m1[0] * m2[8]  + m1[4] * m2[9] + m1[8]   * m2[10] + m1[12] * m2[11];
-	product[9]  = m1[1] * m2[8]  + m1[5] * m2[9] + m1[9]   * m2[10] + m1[13] * m2[11];
-	product[10] = m1[2] * m2[8]  + m1[6] * m2[9] + m1[10]  * m2[10] + m1[14] * m2[11];
-	product[11] = m1[3] * m2[8]  + m1[7] * m2[9] + m1[11]  * m2[10] + m1[15] * m2[11];
-
-	product[12] = m1[0] * m2[12] + m1[4] * m2[13] + m1[8]  * m2[14] + m1[12] * m2[15];
-	product[13] = m1[1] * m2[12] + m1[5] * m2[13] + m1[9]  * m2[14] + m1[13] * m2[15];
-	product[14] = m1[2] * m2[12] + m1[6] * m2[13] + m1[10] * m2[14] + m1[14] * m2[15];
-	product[15] = m1[3] * m2[12] + m1[7] * m2[13] + m1[11] * m2[14] + m1[15] * m2[15];
-
-	memcpy(dst, product, MATRIX_SIZE);
+	// product[c*4+r] = sum(m1[k*4+r] * m2[c*4+k]), which is the operator* kernel
+	// with the operands swapped. Supports the case where m1 or m2 is dst.
+	MathSIMD::multiplyMatrix(m2, m1, dst);
 }
 
 bool Matrix4::invert(Matrix4* dst) const {
-	float a0 = m[0] * m[5] - m[1] * m[4];
-	float a1 = m[0] * m[6] - m[2] * m[4];
-	float a2 = m[0] * m[7] - m[3] * m[4];
-	float a3 = m[1] * m[6] - m[2] * m[5];
-	float a4 = m[1] * m[7] - m[3] * m[5];
-	float a5 = m[2] * m[7] - m[3] * m[6];
-	float b0 = m[8] * m[13] - m[9] * m[12];
-	float b1 = m[8] * m[14] - m[10] * m[12];
-	float b2 = m[8] * m[15] - m[11] * m[12];
-	float b3 = m[9] * m[14] - m[10] * m[13];
-	float b4 = m[9] * m[15] - m[11] * m[13];
-	float b5 = m[10] * m[15] - m[11] * m[14];
-
-	// Calculate the determinant.
-	float det = a0 * b5 - a1 * b4 + a2 * b3 + a3 * b2 - a4 * b1 + a5 * b0;
-
-	// Close to zero, can't invert.
-	if (fabs(det) <= MATH_TOLERANCE)
-		return false;
-
-	// Support the case where m == dst.
-	Matrix4 inverse;
-	inverse.m[0]  = m[5] * b5 - m[6] * b4 + m[7] * b3;
-	inverse.m[1]  = -m[1] * b5 + m[2] * b4 - m[3] * b3;
-	inverse.m[2]  = m[13] * a5 - m[14] * a4 + m[15] * a3;
-	inverse.m[3]  = -m[9] * a5 + m[10] * a4 - m[11] * a3;
 
-	inverse.m[4]  = -m[4] * b5 + m[6] * b2 - m[7] * b1;
-	inverse.m[5]  = m[0] * b5 - m[2] * b2 + m[3] * b1;
-	inverse.m[6]  = -m[12] * a5 + m[14] * a2 - m[15] * a1;
-	inverse.m[7]  = m[8] * a5 - m[10] * a2 + m[11] * a1;
-
-	inverse.m[8]  = m[4] * b4 - m[5] * b2 + m[7] * b0;
-	inverse.m[9]  = -m[0] * b4 + m[1] * b2 - m[3] * b0;
-	inverse.m[10] = m[12] * a4 - m[13] * a2 + m[15] * a0;
-	inverse.m[11] = -m[8] * a4 + m[9] * a2 - m[11] * a0;
-
-	inverse.m[12] = -m[4] * b3 + m[5] * b1 - m[6] * b0;
-	inverse.m[13] = m[0] * b3 - m[1] * b1 + m[2] * b0;
-	inverse.m[14] = -m[12] * a3 + m[13] * a1 - m[14] * a0;
-	inverse.m[15] = m[8] * a3 - m[9] * a1 + m[10] * a0;
-
-	Matrix4::multiply(inverse, 1.0f / det, dst);
+	if(dst == NULL)
+		return false;
 
-	return true;
+	// Returns false, leaving dst untouched, if the determinant is close to zero.
+	// Supports the case where this == dst.
+	return MathSIMD::invertMatrix(m, dst->m);
 }
 
 void Matrix4::multiply(const Matrix4& m, float scalar, Matrix4* dst) {
@@ -776,10 +718,11 @@ void Matrix4::transformVector(float x, float y, float z, float w, Vector4* dst)
 	if( dst == NULL)
 		return;
 
-	dst->x = x * m[0] + y * m[4] + z * m[8] + w * m[12];
-	dst->y = x * m[1] + y * m[5] + z * m[9] + w * m[13];
-	dst->z = x * m[2] + y * m[6] + z * m[10] + w * m[14];
-	dst->w = x * m[3] + y * m[7] + z * m[11] + w * m[15];
+	float v[4] = { x, y, z, w };
+	float result[4];
+	MathSIMD::transformVector(m, v, result);
+
+	dst->set(result);
 }
 
 void Matrix4::transformVector(float x, float y, float z, float w, Vector3* dst) const {
@@ -787,9 +730,11 @@ void Matrix4::transformVector(float x, float y, float z, float w, Vector3* dst)
 	if (dst == NULL)
 		return;
 
-	dst->x = x * m[0] + y * m[4] + z * m[8] + w * m[12];
-	dst->y = x * m[1] + y * m[5] + z * m[9] + w * m[13];
-	dst->z = x * m[2] + y * m[6] + z * m[10] + w * m[14];
+	float v[4] = { x, y, z, w };
+	float result[4];
+	MathSIMD::transformVector(m, v, result);
+
+	dst->set(result[0], result[1], result[2]);
 }
 
 Matrix4 Matrix4::operator+(const Matrix4& rhs) const
@@ -843,15 +788,14 @@ Vector3 Matrix4::operator*(const Vector3& rhs) const
 
 Matrix4 Matrix4::operator*(const Matrix4& n) const
 {
-	return Matrix4(m[0]*n[0]  + m[1]*n[4]  + m[2]*n[8]  + m[3]*n[12],   m[0]*n[1]  + m[1]*n[5]  + m[2]*n[9]  + m[3]*n[13],   m[0]*n[2]  + m[1]*n[6]  + m[2]*n[10]  + m[3]*n[14],   m[0]*n[3]  + m[1]*n[7]  + m[2]*n[11]  + m[3]*n[15],
-		m[4]*n[0]  + m[5]*n[4]  + m[6]*n[8]  + m[7]*n[12],   m[4]*n[1]  + m[5]*n[5]  + m[6]*n[9]  + m[7]*n[13],   m[4]*n[2]  + m[5]*n[6]  + m[6]*n[10]  + m[7]*n[14],   m[4]*n[3]  + m[5]*n[7]  + m[6]*n[11]  + m[7]*n[15],
-		m[8]*n[0]  + m[9]*n[4]  + m[10]*n[8] + m[11]*n[12],  m[8]*n[1]  + m[9]*n[5]  + m[10]*n[9] + m[11]*n[13],  m[8]*n[2]  + m[9]*n[6]  + m[10]*n[10] + m[11]*n[14],  m[8]*n[3]  + m[9]*n[7]  + m[10]*n[11] + m[11]*n[15],
-		m[12]*n[0] + m[13]*n[4] + m[14]*n[8] + m[15]*n[12],  m[12]*n[1] + m[13]*n[5] + m[14]*n[9] + m[15]*n[13],  m[12]*n[2] + m[13]*n[6] + m[14]*n[10] + m[15]*n[14],  m[12]*n[3] + m[13]*n[7] + m[14]*n[11] + m[15]*n[15]);
+	Matrix4 product;
+	MathSIMD::multiplyMatrix(m, n.m, product.m);
+	return product;
 }
 
 Matrix4& Matrix4::operator*=(const Matrix4& rhs)
 {
-	*this = *this * rhs;
+	MathSIMD::multiplyMatrix(m, rhs.m, m);
 	return *this;
 }
 
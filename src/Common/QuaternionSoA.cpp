@@ -0,0 +1,530 @@
+#include "Common/QuaternionSoA.h"
+#include "Common/DualQuaternion.h"
+#include "Common/MathSIMD.h"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#ifdef MATH_SIMD_X86
+	#include <emmintrin.h>
+#endif
+
+// Covers a few SSE2 iterations and a scalar tail
+#define QUATERNION_SOA_VERIFY_COUNT		19
+
+static size_t roundUp4(size_t n) {
+	return (n + 3) & ~(size_t)3;
+}
+
+QuaternionSoA::QuaternionSoA()
+	:	m_pData(NULL),
+		m_pW(NULL),
+		m_pX(NULL),
+		m_pY(NULL),
+		m_pZ(NULL),
+		m_iCount(0),
+		m_iCapacity(0) {
+}
+
+QuaternionSoA::QuaternionSoA(size_t iCount)
+	:	m_pData(NULL),
+		m_pW(NULL),
+		m_pX(NULL),
+		m_pY(NULL),
+		m_pZ(NULL),
+		m_iCount(0),
+		m_iCapacity(0) {
+
+	resize(iCount);
+}
+
+QuaternionSoA::QuaternionSoA(const QuaternionSoA& copy)
+	:	m_pData(NULL),
+		m_pW(NULL),
+		m_pX(NULL),
+		m_pY(NULL),
+		m_pZ(NULL),
+		m_iCount(0),
+		m_iCapacity(0) {
+
+	*this = copy;
+}
+
+QuaternionSoA::~QuaternionSoA() {
+
+	if(m_pData != NULL) {
+		delete[] m_pData;
+		m_pData = NULL;
+	}
+}
+
+QuaternionSoA& QuaternionSoA::operator=(const QuaternionSoA& copy) {
+
+	if(this == &copy)
+		return *this;
+
+	resize(copy.m_iCount);
+
+	size_t iBytes = m_iCount * sizeof(float);
+	memcpy(m_pW, copy.m_pW, iBytes);
+	memcpy(m_pX, copy.m_pX, iBytes);
+	memcpy(m_pY, copy.m_pY, iBytes);
+	memcpy(m_pZ, copy.m_pZ, iBytes);
+
+	return *this;
+}
+
+void QuaternionSoA::allocate(size_t iCapacity) {
+
+	// 3 extra floats so the first stream can be moved up to a 16-byte boundary.
+	float* pData = new float[iCapacity * 4 + 3];
+	float* pW = (float*)(((size_t)pData + 15) & ~(size_t)15);
+
+	if(m_iCount > 0) {
+		size_t iBytes = m_iCount * sizeof(float);
+		memcpy(pW, m_pW, iBytes);
+		memcpy(pW + iCapacity, m_pX, iBytes);
+		memcpy(pW + iCapacity * 2, m_pY, iBytes);
+		memcpy(pW + iCapacity * 3, m_pZ, iBytes);
+	}
+
+	if(m_pData != NULL)
+		delete[] m_pData;
+
+	m_pData = pData;
+	m_pW = pW;
+	m_pX = pW + iCapacity;
+	m_pY = pW + iCapacity * 2;
+	m_pZ = pW + iCapacity * 3;
+	m_iCapacity = iCapacity;
+}
+
+void QuaternionSoA::resize(size_t iCount) {
+
+	size_t iPadded = roundUp4(iCount);
+	if(iPadded > m_iCapacity)
+		allocate(iPadded);
+
+	// Everything past iCount, padding included, is kept as identity.
+	for(size_t i = (iCount < m_iCount) ? iCount : m_iCount; i < m_iCapacity; i++) {
+		m_pW[i] = 1.0f;
+		m_pX[i] = m_pY[i] = m_pZ[i] = 0.0f;
+	}
+
+	m_iCount = iCount;
+}
+
+void QuaternionSoA::set(size_t i, const Quaternionf& q) {
+
+	assert(i < m_iCount);
+	m_pW[i] = q._w;
+	m_pX[i] = q._x;
+	m_pY[i] = q._y;
+	m_pZ[i] = q._z;
+}
+
+Quaternionf QuaternionSoA::get(size_t i) const {
+
+	assert(i < m_iCount);
+	return Quaternionf(m_pW[i], m_pX[i], m_pY[i], m_pZ[i]);
+}
+
+void QuaternionSoA::load(const Quaternionf* src, size_t iCount) {
+
+	resize(iCount);
+	for(size_t i = 0; i < iCount; i++) {
+		m_pW[i] = src[i]._w;
+		m_pX[i] = src[i]._x;
+		m_pY[i] = src[i]._y;
+		m_pZ[i] = src[i]._z;
+	}
+}
+
+void QuaternionSoA::store(Quaternionf* dst) const {
+
+	for(size_t i = 0; i < m_iCount; i++) {
+		dst[i]._w = m_pW[i];
+		dst[i]._x = m_pX[i];
+		dst[i]._y = m_pY[i];
+		dst[i]._z = m_pZ[i];
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////
+// slerp correction
+//
+// slerp(a, b, t) ~= normalize(lerp(a, b, t')), where t' bends t towards
+// constant angular velocity. The cubic in t and the coefficients fitted
+// over |dot(a, b)| come from Zeux's "Approximating slerp".
+///////////////////////////////////////////////////////////////////////////
+#define SLERP_A0		 1.0904f
+#define SLERP_A1		-3.2452f
+#define SLERP_A2		 3.55645f
+#define SLERP_A3		-1.43519f
+#define SLERP_B0		 0.848013f
+#define SLERP_B1		-1.06021f
+#define SLERP_B2		 0.215638f
+
+///////////////////////////////////////////////////////////////////////////
+// scalar
+///////////////////////////////////////////////////////////////////////////
+static void lerpNormalizeScalar(const float* aw, const float* ax, const float* ay, const float* az,
+								const float* bw, const float* bx, const float* by, const float* bz,
+								float* dw, float* dx, float* dy, float* dz,
+								float t, bool bCorrect, size_t i, size_t n) {
+
+	for(; i < n; i++) {
+		float dot = aw[i]*bw[i] + ax[i]*bx[i] + ay[i]*by[i] + az[i]*bz[i];
+		float d = fabsf(dot);
+
+		float tt = t;
+		if(bCorrect) {
+			float A = SLERP_A0 + d * (SLERP_A1 + d * (SLERP_A2 + d * SLERP_A3));
+			float B = SLERP_B0 + d * (SLERP_B1 + d * SLERP_B2);
+			float k = A * (t - 0.5f) * (t - 0.5f) + B;
+			tt = t + t * (t - 0.5f) * (t - 1.0f) * k;
+		}
+
+		float k0 = 1.0f - tt;
+		float k1 = (dot < 0.0f) ? -tt : tt;
+
+		float w = k0 * aw[i] + k1 * bw[i];
+		float x = k0 * ax[i] + k1 * bx[i];
+		float y = k0 * ay[i] + k1 * by[i];
+		float z = k0 * az[i] + k1 * bz[i];
+
+		float mag = sqrtf(w*w + x*x + y*y + z*z);
+		float oneOverMag = (mag > 0.0f) ? 1.0f / mag : 1.0f;
+
+		dw[i] = w * oneOverMag;
+		dx[i] = x * oneOverMag;
+		dy[i] = y * oneOverMag;
+		dz[i] = z * oneOverMag;
+	}
+}
+
+static void normalizeScalar(float* pw, float* px, float* py, float* pz, size_t n) {
+
+	for(size_t i = 0; i < n; i++) {
+		float mag = sqrtf(pw[i]*pw[i] + px[i]*px[i] + py[i]*py[i] + pz[i]*pz[i]);
+		if(mag > 0.0f) {
+			float oneOverMag = 1.0f / mag;
+			pw[i] *= oneOverMag;
+			px[i] *= oneOverMag;
+			py[i] *= oneOverMag;
+			pz[i] *= oneOverMag;
+		}
+	}
+}
+
+// v' = v + w*t + cross(q, t), with t = 2 * cross(q, v)
+static void rotateScalar(const float* qw, const float* qx, const float* qy, const float* qz,
+						const float* xs, const float* ys, const float* zs,
+						float* ox, float* oy, float* oz,
+						size_t i, size_t n, const unsigned int* pIndices) {
+
+	for(; i < n; i++) {
+		size_t j = (pIndices != NULL) ? pIndices[i] : i;
+		float w = qw[j], x = qx[j], y = qy[j], z = qz[j];
+		float vx = xs[i], vy = ys[i], vz = zs[i];
+
+		float tx = 2.0f * (y * vz - z * vy);
+		float ty = 2.0f * (z * vx - x * vz);
+		float tz = 2.0f * (x * vy - y * vx);
+
+		ox[i] = vx + w * tx + (y * tz - z * ty);
+		oy[i] = vy + w * ty + (z * tx - x * tz);
+		oz[i] = vz + w * tz + (x * ty - y * tx);
+	}
+}
+
+#ifdef MATH_SIMD_X86
+///////////////////////////////////////////////////////////////////////////
+// SSE2, 4 quaternions per iteration
+///////////////////////////////////////////////////////////////////////////
+MATH_SIMD_TARGET_SSE2
+static __m128 invMagnitudeSSE2(__m128 w, __m128 x, __m128 y, __m128 z) {
+
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 mag = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(w, w), _mm_mul_ps(x, x)), _mm_add_ps(_mm_mul_ps(y, y), _mm_mul_ps(z, z))));
+	__m128 valid = _mm_cmpgt_ps(mag, _mm_setzero_ps());
+
+	return _mm_or_ps(_mm_and_ps(valid, _mm_div_ps(one, mag)), _mm_andnot_ps(valid, one));
+}
+
+MATH_SIMD_TARGET_SSE2
+static size_t lerpNormalizeSSE2(const float* aw, const float* ax, const float* ay, const float* az,
+								const float* bw, const float* bx, const float* by, const float* bz,
+								float* dw, float* dx, float* dy, float* dz,
+								float t, bool bCorrect, size_t n) {
+
+	__m128 signMask = _mm_set1_ps(-0.0f);
+	__m128 vt = _mm_set1_ps(t);
+	__m128 one = _mm_set1_ps(1.0f);
+
+	// Terms of the correction that only depend on t
+	float fHalf = t - 0.5f;
+	__m128 vHalfSq = _mm_set1_ps(fHalf * fHalf);
+	__m128 vCubic = _mm_set1_ps(t * fHalf * (t - 1.0f));
+
+	// Unaligned, the streams may also be bare arrays such as clip frames
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4) {
+		__m128 qaw = _mm_loadu_ps(aw + i), qax = _mm_loadu_ps(ax + i), qay = _mm_loadu_ps(ay + i), qaz = _mm_loadu_ps(az + i);
+		__m128 qbw = _mm_loadu_ps(bw + i), qbx = _mm_loadu_ps(bx + i), qby = _mm_loadu_ps(by + i), qbz = _mm_loadu_ps(bz + i);
+
+		__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(qaw, qbw), _mm_mul_ps(qax, qbx)), _mm_add_ps(_mm_mul_ps(qay, qby), _mm_mul_ps(qaz, qbz)));
+		__m128 sign = _mm_and_ps(dot, signMask);
+
+		__m128 tt = vt;
+		if(bCorrect) {
+			__m128 d = _mm_andnot_ps(signMask, dot);
+			__m128 A = _mm_add_ps(_mm_set1_ps(SLERP_A0), _mm_mul_ps(d, _mm_add_ps(_mm_set1_ps(SLERP_A1), _mm_mul_ps(d, _mm_add_ps(_mm_set1_ps(SLERP_A2), _mm_mul_ps(d, _mm_set1_ps(SLERP_A3)))))));
+			__m128 B = _mm_add_ps(_mm_set1_ps(SLERP_B0), _mm_mul_ps(d, _mm_add_ps(_mm_set1_ps(SLERP_B1), _mm_mul_ps(d, _mm_set1_ps(SLERP_B2)))));
+			__m128 k = _mm_add_ps(_mm_mul_ps(A, vHalfSq), B);
+			tt = _mm_add_ps(vt, _mm_mul_ps(vCubic, k));
+		}
+
+		__m128 k0 = _mm_sub_ps(one, tt);
+		__m128 k1 = _mm_xor_ps(tt, sign);
+
+		__m128 w = _mm_add_ps(_mm_mul_ps(k0, qaw), _mm_mul_ps(k1, qbw));
+		__m128 x = _mm_add_ps(_mm_mul_ps(k0, qax), _mm_mul_ps(k1, qbx));
+		__m128 y = _mm_add_ps(_mm_mul_ps(k0, qay), _mm_mul_ps(k1, qby));
+		__m128 z = _mm_add_ps(_mm_mul_ps(k0, qaz), _mm_mul_ps(k1, qbz));
+
+		__m128 invMag = invMagnitudeSSE2(w, x, y, z);
+		_mm_storeu_ps(dw + i, _mm_mul_ps(w, invMag));
+		_mm_storeu_ps(dx + i, _mm_mul_ps(x, invMag));
+		_mm_storeu_ps(dy + i, _mm_mul_ps(y, invMag));
+		_mm_storeu_ps(dz + i, _mm_mul_ps(z, invMag));
+	}
+
+	return i;
+}
+
+MATH_SIMD_TARGET_SSE2
+static void normalizeSSE2(float* pw, float* px, float* py, float* pz, size_t n) {
+
+	for(size_t i = 0; i < n; i += 4) {
+		__m128 w = _mm_load_ps(pw + i), x = _mm_load_ps(px + i), y = _mm_load_ps(py + i), z = _mm_load_ps(pz + i);
+
+		__m128 invMag = invMagnitudeSSE2(w, x, y, z);
+		_mm_store_ps(pw + i, _mm_mul_ps(w, invMag));
+		_mm_store_ps(px + i, _mm_mul_ps(x, invMag));
+		_mm_store_ps(py + i, _mm_mul_ps(y, invMag));
+		_mm_store_ps(pz + i, _mm_mul_ps(z, invMag));
+	}
+}
+
+MATH_SIMD_TARGET_SSE2
+static size_t rotateSSE2(const float* qw, const float* qx, const float* qy, const float* qz,
+						const float* xs, const float* ys, const float* zs,
+						float* ox, float* oy, float* oz,
+						size_t n, const unsigned int* pIndices) {
+
+	__m128 two = _mm_set1_ps(2.0f);
+
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4) {
+		__m128 w, x, y, z;
+		if(pIndices != NULL) {
+			unsigned int j0 = pIndices[i], j1 = pIndices[i + 1], j2 = pIndices[i + 2], j3 = pIndices[i + 3];
+			w = _mm_setr_ps(qw[j0], qw[j1], qw[j2], qw[j3]);
+			x = _mm_setr_ps(qx[j0], qx[j1], qx[j2], qx[j3]);
+			y = _mm_setr_ps(qy[j0], qy[j1], qy[j2], qy[j3]);
+			z = _mm_setr_ps(qz[j0], qz[j1], qz[j2], qz[j3]);
+		}
+		else {
+			w = _mm_load_ps(qw + i);
+			x = _mm_load_ps(qx + i);
+			y = _mm_load_ps(qy + i);
+			z = _mm_load_ps(qz + i);
+		}
+
+		__m128 vx = _mm_loadu_ps(xs + i), vy = _mm_loadu_ps(ys + i), vz = _mm_loadu_ps(zs + i);
+
+		__m128 tx = _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(y, vz), _mm_mul_ps(z, vy)));
+		__m128 ty = _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(z, vx), _mm_mul_ps(x, vz)));
+		__m128 tz = _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(x, vy), _mm_mul_ps(y, vx)));
+
+		_mm_storeu_ps(ox + i, _mm_add_ps(_mm_add_ps(vx, _mm_mul_ps(w, tx)), _mm_sub_ps(_mm_mul_ps(y, tz), _mm_mul_ps(z, ty))));
+		_mm_storeu_ps(oy + i, _mm_add_ps(_mm_add_ps(vy, _mm_mul_ps(w, ty)), _mm_sub_ps(_mm_mul_ps(z, tx), _mm_mul_ps(x, tz))));
+		_mm_storeu_ps(oz + i, _mm_add_ps(_mm_add_ps(vz, _mm_mul_ps(w, tz)), _mm_sub_ps(_mm_mul_ps(x, ty), _mm_mul_ps(y, tx))));
+	}
+
+	return i;
+}
+#endif // MATH_SIMD_X86
+
+///////////////////////////////////////////////////////////////////////////
+// batch operations
+///////////////////////////////////////////////////////////////////////////
+static void lerpNormalize(const float* aw, const float* ax, const float* ay, const float* az,
+						const float* bw, const float* bx, const float* by, const float* bz,
+						float* dw, float* dx, float* dy, float* dz,
+						float t, bool bCorrect, size_t n) {
+
+	size_t i = 0;
+#ifdef MATH_SIMD_X86
+	if(MathSIMD::getBackend() != MathSIMD::BACKEND_SCALAR) {
+		i = lerpNormalizeSSE2(aw, ax, ay, az, bw, bx, by, bz, dw, dx, dy, dz, t, bCorrect, n);
+	}
+#endif
+	lerpNormalizeScalar(aw, ax, ay, az, bw, bx, by, bz, dw, dx, dy, dz, t, bCorrect, i, n);
+}
+
+static void lerpNormalize(const QuaternionSoA& a, const QuaternionSoA& b, float t, bool bCorrect, QuaternionSoA& dst) {
+
+	assert(a.size() == b.size());
+	dst.resize(a.size());
+
+	// Padding lanes are identity in all three, so whole blocks of 4 are safe.
+	lerpNormalize(a.w(), a.x(), a.y(), a.z(), b.w(), b.x(), b.y(), b.z(), dst.w(), dst.x(), dst.y(), dst.z(), t, bCorrect, roundUp4(a.size()));
+}
+
+void QuaternionSoA::nlerp(const QuaternionSoA& a, const QuaternionSoA& b, float t, QuaternionSoA& dst) {
+	lerpNormalize(a, b, t, false, dst);
+}
+
+void QuaternionSoA::nlerp(const float* aw, const float* ax, const float* ay, const float* az,
+						const float* bw, const float* bx, const float* by, const float* bz,
+						float t, float* dw, float* dx, float* dy, float* dz, size_t iCount) {
+	lerpNormalize(aw, ax, ay, az, bw, bx, by, bz, dw, dx, dy, dz, t, false, iCount);
+}
+
+void QuaternionSoA::slerp(const QuaternionSoA& a, const QuaternionSoA& b, float t, QuaternionSoA& dst) {
+	lerpNormalize(a, b, t, true, dst);
+}
+
+void QuaternionSoA::normalize() {
+
+	size_t n = roundUp4(m_iCount);
+#ifdef MATH_SIMD_X86
+	if(MathSIMD::getBackend() != MathSIMD::BACKEND_SCALAR) {
+		normalizeSSE2(m_pW, m_pX, m_pY, m_pZ, n);
+		return;
+	}
+#endif
+	normalizeScalar(m_pW, m_pX, m_pY, m_pZ, n);
+}
+
+void QuaternionSoA::rotate(const float* xs, const float* ys, const float* zs, float* outXs, float* outYs, float* outZs, size_t iCount, const unsigned int* pIndices) const {
+
+	assert(pIndices != NULL || iCount <= m_iCount);
+
+	size_t i = 0;
+#ifdef MATH_SIMD_X86
+	if(MathSIMD::getBackend() != MathSIMD::BACKEND_SCALAR) {
+		i = rotateSSE2(m_pW, m_pX, m_pY, m_pZ, xs, ys, zs, outXs, outYs, outZs, iCount, pIndices);
+	}
+#endif
+	rotateScalar(m_pW, m_pX, m_pY, m_pZ, xs, ys, zs, outXs, outYs, outZs, i, iCount, pIndices);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// verify
+///////////////////////////////////////////////////////////////////////////
+static float randomUnit(unsigned int& iSeed) {
+	// Same LCG as MathSIMD::verify, in [-1, 1]
+	iSeed = iSeed * 1664525u + 1013904223u;
+	return ((float)((iSeed >> 8) & 0xFFFF) / 65535.0f) * 2.0f - 1.0f;
+}
+
+// A unit quaternion with w rebuilt as MD5Model::computeQuatW does, never positive
+static Quaternionf randomMD5Orientation(unsigned int& iSeed) {
+
+	Quaternionf q(0.0f, randomUnit(iSeed), randomUnit(iSeed), randomUnit(iSeed));
+	float fLength = sqrtf(q._x * q._x + q._y * q._y + q._z * q._z);
+	if(fLength > 0.99f) {
+		float fScale = 0.99f / fLength;
+		q._x *= fScale;
+		q._y *= fScale;
+		q._z *= fScale;
+	}
+	q._w = -sqrtf(std::max(0.0f, 1.0f - q._x * q._x - q._y * q._y - q._z * q._z));
+
+	return q;
+}
+
+static float maxDifference(const Vector3& a, const Vector3& b) {
+	return std::max(fabsf(a.x - b.x), std::max(fabsf(a.y - b.y), fabsf(a.z - b.z)));
+}
+
+bool QuaternionSoA::verify(float fTolerance) {
+
+	unsigned int iSeed = 0x9A7E1u;
+	Quaternionf a[QUATERNION_SOA_VERIFY_COUNT], b[QUATERNION_SOA_VERIFY_COUNT];
+	float xs[QUATERNION_SOA_VERIFY_COUNT], ys[QUATERNION_SOA_VERIFY_COUNT], zs[QUATERNION_SOA_VERIFY_COUNT];
+	unsigned int indices[QUATERNION_SOA_VERIFY_COUNT];
+
+	for(size_t i = 0; i < QUATERNION_SOA_VERIFY_COUNT; i++) {
+		a[i] = randomMD5Orientation(iSeed);
+		b[i] = randomMD5Orientation(iSeed);
+		xs[i] = randomUnit(iSeed) * 10.0f;
+		ys[i] = randomUnit(iSeed) * 10.0f;
+		zs[i] = randomUnit(iSeed) * 10.0f;
+		indices[i] = (unsigned int)((i * 7) % QUATERNION_SOA_VERIFY_COUNT);
+	}
+
+	QuaternionSoA soaA, soaB, soaD;
+	soaA.load(a, QUATERNION_SOA_VERIFY_COUNT);
+	soaB.load(b, QUATERNION_SOA_VERIFY_COUNT);
+
+	// rotate() against the Hamilton product q.p.q* of Quaternion::rotate
+	float ox[QUATERNION_SOA_VERIFY_COUNT], oy[QUATERNION_SOA_VERIFY_COUNT], oz[QUATERNION_SOA_VERIFY_COUNT];
+	soaA.rotate(xs, ys, zs, ox, oy, oz, QUATERNION_SOA_VERIFY_COUNT, indices);
+	for(size_t i = 0; i < QUATERNION_SOA_VERIFY_COUNT; i++) {
+		Vector3 v(xs[i], ys[i], zs[i]);
+		a[indices[i]].rotate(v);
+		if(maxDifference(v, Vector3(ox[i], oy[i], oz[i])) > fTolerance * 10.0f)
+			return false;
+	}
+
+	// nlerp() on objects and on bare streams against the scalar shortest arc nlerp
+	float dw[QUATERNION_SOA_VERIFY_COUNT], dx[QUATERNION_SOA_VERIFY_COUNT], dy[QUATERNION_SOA_VERIFY_COUNT], dz[QUATERNION_SOA_VERIFY_COUNT];
+	for(int k = 0; k <= 4; k++) {
+		float t = k * 0.25f;
+		nlerp(soaA, soaB, t, soaD);
+		nlerp(soaA.w(), soaA.x(), soaA.y(), soaA.z(), soaB.w(), soaB.x(), soaB.y(), soaB.z(), t, dw, dx, dy, dz, QUATERNION_SOA_VERIFY_COUNT);
+
+		for(size_t i = 0; i < QUATERNION_SOA_VERIFY_COUNT; i++) {
+			Quaternionf q = a[i] * (1.0f - t) + b[i] * ((DotProduct(a[i], b[i]) < 0.0f) ? -t : t);
+			q.normalize();
+
+			Quaternionf d = soaD.get(i);
+			Quaternionf e(dw[i], dx[i], dy[i], dz[i]);
+			if(fabsf(q._w - d._w) > fTolerance || fabsf(q._x - d._x) > fTolerance || fabsf(q._y - d._y) > fTolerance || fabsf(q._z - d._z) > fTolerance)
+				return false;
+			if(fabsf(q._w - e._w) > fTolerance || fabsf(q._x - e._x) > fTolerance || fabsf(q._y - e._y) > fTolerance || fabsf(q._z - e._z) > fTolerance)
+				return false;
+		}
+	}
+
+	// A dual quaternion moves points like its rotation followed by its translation,
+	// and composes like the rotations and the translation rotated by the outer one
+	for(size_t i = 0; i + 1 < QUATERNION_SOA_VERIFY_COUNT; i++) {
+		Vector3 t0(xs[i], ys[i], zs[i]);
+		Vector3 t1(ys[i + 1], zs[i + 1], xs[i + 1]);
+		DualQuaternionf dq0(a[i], t0);
+		DualQuaternionf dq1(b[i], t1);
+
+		Vector3 p(zs[i], xs[i], ys[i]);
+		Vector3 expected = p;
+		a[i].rotate(expected);
+		expected += t0;
+		Vector3 transformed = p;
+		dq0.transformPoint(transformed);
+		if(maxDifference(expected, transformed) > fTolerance * 10.0f)
+			return false;
+
+		DualQuaternionf dq = dq0 * dq1;
+		Vector3 vTranslation = t1;
+		a[i].rotate(vTranslation);
+		vTranslation += t0;
+		if(maxDifference(dq.translation(), vTranslation) > fTolerance * 10.0f)
+			return false;
+	}
+
+	return true;
+}
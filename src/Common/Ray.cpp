@@ -0,0 +1,91 @@
+#include "Common/Ray.h"
+#include <cmath>
+#include <cfloat>
+
+Ray::Ray()
+	:	origin(0.0f, 0.0f, 0.0f),
+		direction(0.0f, 0.0f, -1.0f) {
+}
+
+Ray::Ray(const Vector3& vOrigin, const Vector3& vDirection) {
+	set(vOrigin, vDirection);
+}
+
+void Ray::set(const Vector3& vOrigin, const Vector3& vDirection) {
+	origin = vOrigin;
+	direction = vDirection;
+	direction.normalize();
+}
+
+Vector3 Ray::getPoint(float fDistance) const {
+	return origin + direction * fDistance;
+}
+
+bool Ray::intersects(const BoundingBox& box, float* pDistance) const {
+
+	if(box.isEmpty())
+		return false;
+
+	// Slab test, a zero direction component gives +/-inf which the min/max
+	// below handle as long as the origin isn't exactly on that slab.
+	float tMin = 0.0f;
+	float tMax = FLT_MAX;
+
+	const float* o = &origin.x;
+	const float* d = &direction.x;
+	const float* bMin = &box.min.x;
+	const float* bMax = &box.max.x;
+
+	for(int i = 0; i < 3; i++) {
+
+		if(d[i] == 0.0f) {
+			if(o[i] < bMin[i] || o[i] > bMax[i])
+				return false;
+			continue;
+		}
+
+		float fInv = 1.0f / d[i];
+		float t0 = (bMin[i] - o[i]) * fInv;
+		float t1 = (bMax[i] - o[i]) * fInv;
+		if(t0 > t1) {
+			float t = t0;
+			t0 = t1;
+			t1 = t;
+		}
+
+		if(t0 > tMin) tMin = t0;
+		if(t1 < tMax) tMax = t1;
+		if(tMin > tMax)
+			return false;
+	}
+
+	if(pDistance)
+		*pDistance = tMin;
+
+	return true;
+}
+
+bool Ray::intersects(const BoundingSphere& sphere, float* pDistance) const {
+
+	if(sphere.isEmpty())
+		return false;
+
+	Vector3 v = origin - sphere.center;
+	float b = v.dot(direction);
+	float c = v.dot(v) - sphere.radius * sphere.radius;
+
+	// Origin outside and pointing away
+	if(c > 0.0f && b > 0.0f)
+		return false;
+
+	float fDiscriminant = b * b - c;
+	if(fDiscriminant < 0.0f)
+		return false;
+
+	if(pDistance) {
+		float t = -b - sqrtf(fDiscriminant);
+		*pDistance = (t < 0.0f) ? 0.0f : t;
+	}
+
+	return true;
+}
@@ -1,5 +1,6 @@
 ﻿#include "Common/Vectors.h"
 #include "Common/Matrices.h"
+#include "Common/MathSIMD.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // functions for Vector2
@@ -236,9 +237,14 @@ Vector3& Vector3::operator*=(const Vector3& rhs) {
 }
 
 Vector3& Vector3::operator*=(const Matrix4& m) {
-	x = x * m.m[0] + y * m.m[3] + z * m.m[6]; 
-	y = x * m.m[1] + y * m.m[4] + z * m.m[7]; 
-	z = x * m.m[2] + y * m.m[5] + z * m.m[8]; 
+	// Same as operator*(const Vector3&, const Matrix4&), i.e. w = 0.
+	float v[4] = { x, y, z, 0.0f };
+	float result[4];
+	MathSIMD::transformVector(m.m, v, result);
+
+	x = result[0];
+	y = result[1];
+	z = result[2];
 	
 	return *this;
 }
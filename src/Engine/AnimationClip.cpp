@@ -0,0 +1,339 @@
+#include "Engine/AnimationClip.h"
+#include "Common/QuaternionSoA.h"
+#include <cmath>
+#include <algorithm>
+
+// Joints blended per QuaternionSoA::nlerp() call, gathered on the stack when
+// they are not already streams
+#define ANIMATION_CLIP_BATCH	64
+
+// Components a smallest-three orientation can keep, +-1/sqrt(2)
+#define SMALLEST_THREE_RANGE	0.70710678f
+
+// Where the three stored components and the rebuilt one go in x, y, z, w,
+// by the index of the dropped component
+static const unsigned char kSmallestThreeOrder[4][4] = {
+	{ 1, 2, 3, 0 },
+	{ 0, 2, 3, 1 },
+	{ 0, 1, 3, 2 },
+	{ 0, 1, 2, 3 }
+};
+
+AnimationClip::AnimationClip(unsigned int iJointCount, unsigned int iFrameCount, float fFrameRate, Format eFormat)
+	:	m_iJointCount(iJointCount),
+		m_iFrameCount(iFrameCount),
+		m_fFrameRate(fFrameRate),
+		m_eFormat(eFormat),
+		m_pData(NULL),
+		m_pOwnedData(NULL),
+		m_iFrameSize(0),
+		m_vPositionMin(0.0f, 0.0f, 0.0f),
+		m_vPositionScale(0.0f, 0.0f, 0.0f)
+{
+	m_iFrameSize = getDataSize(iJointCount, 1, eFormat);
+}
+
+AnimationClip::~AnimationClip() {
+	SAFE_DELETE_ARRAY( m_pOwnedData );
+}
+
+AnimationClip* AnimationClip::create(unsigned int iJointCount, unsigned int iFrameCount, float fFrameRate, const Vector3* pPositions, const Quaternionf* pOrientations, Format eFormat) {
+
+	GP_ASSERT( iJointCount > 0 && iFrameCount > 0 && fFrameRate > 0.0f );
+	GP_ASSERT( pPositions && pOrientations );
+
+	AnimationClip* pClip = new AnimationClip(iJointCount, iFrameCount, fFrameRate, eFormat);
+	pClip->m_pOwnedData = new unsigned char[pClip->getDataSize()];
+	pClip->m_pData = pClip->m_pOwnedData;
+	if(eFormat == FORMAT_FLOAT) {
+		pClip->bakeFloat(pPositions, pOrientations);
+	}
+	else {
+		pClip->bakeQuantized(pPositions, pOrientations);
+	}
+
+	return pClip;
+}
+
+AnimationClip* AnimationClip::createInPlace(unsigned int iJointCount, unsigned int iFrameCount, float fFrameRate, Format eFormat, const Vector3& vPositionMin, const Vector3& vPositionScale, const unsigned char* pData) {
+
+	GP_ASSERT( iJointCount > 0 && iFrameCount > 0 && fFrameRate > 0.0f );
+	GP_ASSERT( pData && ((size_t)pData & 3) == 0 );
+
+	AnimationClip* pClip = new AnimationClip(iJointCount, iFrameCount, fFrameRate, eFormat);
+	pClip->m_pData = pData;
+	pClip->m_vPositionMin = vPositionMin;
+	pClip->m_vPositionScale = vPositionScale;
+
+	return pClip;
+}
+
+unsigned int AnimationClip::getJointCount() const {
+	return m_iJointCount;
+}
+
+unsigned int AnimationClip::getFrameCount() const {
+	return m_iFrameCount;
+}
+
+float AnimationClip::getFrameRate() const {
+	return m_fFrameRate;
+}
+
+float AnimationClip::getDuration() const {
+	return (float)m_iFrameCount / m_fFrameRate;
+}
+
+AnimationClip::Format AnimationClip::getFormat() const {
+	return m_eFormat;
+}
+
+unsigned int AnimationClip::getDataSize() const {
+	return m_iFrameSize * m_iFrameCount;
+}
+
+unsigned int AnimationClip::getDataSize(unsigned int iJointCount, unsigned int iFrameCount, Format eFormat) {
+	return iJointCount * iFrameCount * ((eFormat == FORMAT_FLOAT) ? 7 * sizeof(float) : 6 * sizeof(unsigned short));
+}
+
+const unsigned char* AnimationClip::getData() const {
+	return m_pData;
+}
+
+const Vector3& AnimationClip::getPositionMin() const {
+	return m_vPositionMin;
+}
+
+const Vector3& AnimationClip::getPositionScale() const {
+	return m_vPositionScale;
+}
+
+void AnimationClip::bakeFloat(const Vector3* pPositions, const Quaternionf* pOrientations) {
+
+	unsigned int J = m_iJointCount;
+	for(unsigned int f = 0; f < m_iFrameCount; f++) {
+
+		float* pFrame = (float*)(m_pOwnedData + f * m_iFrameSize);
+		for(unsigned int j = 0; j < J; j++) {
+
+			const Vector3& vPos = pPositions[f * J + j];
+			const Quaternionf& qOrient = pOrientations[f * J + j];
+
+			pFrame[0 * J + j] = vPos.x;
+			pFrame[1 * J + j] = vPos.y;
+			pFrame[2 * J + j] = vPos.z;
+			pFrame[3 * J + j] = qOrient._x;
+			pFrame[4 * J + j] = qOrient._y;
+			pFrame[5 * J + j] = qOrient._z;
+			pFrame[6 * J + j] = qOrient._w;
+		}
+	}
+}
+
+void AnimationClip::bakeQuantized(const Vector3* pPositions, const Quaternionf* pOrientations) {
+
+	unsigned int J = m_iJointCount;
+	unsigned int iPoseCount = m_iFrameCount * J;
+
+	// Positions are spread over the bounds of the whole clip
+	Vector3 vMin = pPositions[0];
+	Vector3 vMax = pPositions[0];
+	for(unsigned int i = 1; i < iPoseCount; i++) {
+		vMin.x = std::min(vMin.x, pPositions[i].x);
+		vMin.y = std::min(vMin.y, pPositions[i].y);
+		vMin.z = std::min(vMin.z, pPositions[i].z);
+		vMax.x = std::max(vMax.x, pPositions[i].x);
+		vMax.y = std::max(vMax.y, pPositions[i].y);
+		vMax.z = std::max(vMax.z, pPositions[i].z);
+	}
+
+	m_vPositionMin = vMin;
+	m_vPositionScale = (vMax - vMin) / 65535.0f;
+
+	float fInverseRange[3];
+	fInverseRange[0] = (vMax.x > vMin.x) ? 65535.0f / (vMax.x - vMin.x) : 0.0f;
+	fInverseRange[1] = (vMax.y > vMin.y) ? 65535.0f / (vMax.y - vMin.y) : 0.0f;
+	fInverseRange[2] = (vMax.z > vMin.z) ? 65535.0f / (vMax.z - vMin.z) : 0.0f;
+
+	for(unsigned int f = 0; f < m_iFrameCount; f++) {
+
+		unsigned short* pFrame = (unsigned short*)(m_pOwnedData + f * m_iFrameSize);
+		for(unsigned int j = 0; j < J; j++) {
+
+			const Vector3& vPos = pPositions[f * J + j];
+			pFrame[0 * J + j] = (unsigned short)((vPos.x - vMin.x) * fInverseRange[0] + 0.5f);
+			pFrame[1 * J + j] = (unsigned short)((vPos.y - vMin.y) * fInverseRange[1] + 0.5f);
+			pFrame[2 * J + j] = (unsigned short)((vPos.z - vMin.z) * fInverseRange[2] + 0.5f);
+
+			// Drop the largest component, made positive as q and -q are the
+			// same rotation
+			const Quaternionf& qOrient = pOrientations[f * J + j];
+			float q[4] = { qOrient._x, qOrient._y, qOrient._z, qOrient._w };
+
+			unsigned int iLargest = 0;
+			for(unsigned int k = 1; k < 4; k++) {
+				if(fabsf(q[k]) > fabsf(q[iLargest]))
+					iLargest = k;
+			}
+			float fSign = (q[iLargest] < 0.0f) ? -1.0f : 1.0f;
+
+			unsigned short c[3];
+			for(unsigned int k = 0; k < 3; k++) {
+
+				float fValue = q[kSmallestThreeOrder[iLargest][k]] * fSign;
+				float fUnit = (fValue / SMALLEST_THREE_RANGE + 1.0f) * 0.5f;
+				fUnit = std::min(std::max(fUnit, 0.0f), 1.0f);
+				c[k] = (unsigned short)(fUnit * 32767.0f + 0.5f);
+			}
+			c[0] |= (iLargest & 1) << 15;
+			c[1] |= (iLargest >> 1) << 15;
+
+			pFrame[3 * J + j] = c[0];
+			pFrame[4 * J + j] = c[1];
+			pFrame[5 * J + j] = c[2];
+		}
+	}
+}
+
+void AnimationClip::sample(float fTime, Vector3* pPositions, Quaternionf* pOrientations) const {
+
+	sample(fTime, pPositions, pOrientations, NULL, m_iJointCount);
+}
+
+void AnimationClip::sample(float fTime, Vector3* pPositions, Quaternionf* pOrientations, const unsigned short* pJoints, unsigned int iJointCount) const {
+
+	GP_ASSERT( pPositions && pOrientations );
+	GP_ASSERT( iJointCount <= m_iJointCount );
+
+	float fDuration = getDuration();
+	float fWrapped = fmodf(fTime, fDuration);
+	if(fWrapped < 0.0f) {
+		fWrapped += fDuration;
+	}
+
+	float fFrame = fWrapped * m_fFrameRate;
+	unsigned int iFrame0 = std::min((unsigned int)fFrame, m_iFrameCount - 1);
+	unsigned int iFrame1 = (iFrame0 + 1 == m_iFrameCount) ? 0 : iFrame0 + 1;
+	float fBlend = fFrame - (float)iFrame0;
+
+	if(m_eFormat == FORMAT_FLOAT) {
+		sampleFloat(iFrame0, iFrame1, fBlend, pJoints, iJointCount, pPositions, pOrientations);
+	}
+	else {
+		sampleQuantized(iFrame0, iFrame1, fBlend, pJoints, iJointCount, pPositions, pOrientations);
+	}
+}
+
+void AnimationClip::sampleFloat(unsigned int iFrame0, unsigned int iFrame1, float fBlend, const unsigned short* pJoints, unsigned int iJointCount, Vector3* pPositions, Quaternionf* pOrientations) const {
+
+	unsigned int J = m_iJointCount;
+	const float* pFrames[2] = {
+		(const float*)(m_pData + iFrame0 * m_iFrameSize),
+		(const float*)(m_pData + iFrame1 * m_iFrameSize)
+	};
+
+	float fGathered[2][7][ANIMATION_CLIP_BATCH];
+
+	for(unsigned int iStart = 0; iStart < iJointCount; iStart += ANIMATION_CLIP_BATCH) {
+
+		unsigned int n = std::min(iJointCount - iStart, (unsigned int)ANIMATION_CLIP_BATCH);
+		const float* pStreams[2][7];
+
+		for(unsigned int f = 0; f < 2; f++) {
+			for(unsigned int c = 0; c < 7; c++) {
+
+				const float* pStream = pFrames[f] + c * J;
+				if(pJoints == NULL) {
+					// Every joint, the frame already is the streams
+					pStreams[f][c] = pStream + iStart;
+					continue;
+				}
+
+				for(unsigned int i = 0; i < n; i++) {
+					fGathered[f][c][i] = pStream[pJoints[iStart + i]];
+				}
+				pStreams[f][c] = fGathered[f][c];
+			}
+		}
+
+		blend(pStreams[0], pStreams[1], fBlend, n, pJoints ? pJoints + iStart : NULL, iStart, pPositions, pOrientations);
+	}
+}
+
+void AnimationClip::sampleQuantized(unsigned int iFrame0, unsigned int iFrame1, float fBlend, const unsigned short* pJoints, unsigned int iJointCount, Vector3* pPositions, Quaternionf* pOrientations) const {
+
+	unsigned int J = m_iJointCount;
+	const unsigned short* pFrames[2] = {
+		(const unsigned short*)(m_pData + iFrame0 * m_iFrameSize),
+		(const unsigned short*)(m_pData + iFrame1 * m_iFrameSize)
+	};
+
+	const float fComponentScale = 2.0f * SMALLEST_THREE_RANGE / 32767.0f;
+	float fDecoded[2][7][ANIMATION_CLIP_BATCH];
+
+	for(unsigned int iStart = 0; iStart < iJointCount; iStart += ANIMATION_CLIP_BATCH) {
+
+		unsigned int n = std::min(iJointCount - iStart, (unsigned int)ANIMATION_CLIP_BATCH);
+		for(unsigned int i = 0; i < n; i++) {
+
+			unsigned int j = pJoints ? pJoints[iStart + i] : iStart + i;
+			for(unsigned int f = 0; f < 2; f++) {
+
+				const unsigned short* pFrame = pFrames[f];
+				fDecoded[f][0][i] = m_vPositionMin.x + pFrame[0 * J + j] * m_vPositionScale.x;
+				fDecoded[f][1][i] = m_vPositionMin.y + pFrame[1 * J + j] * m_vPositionScale.y;
+				fDecoded[f][2][i] = m_vPositionMin.z + pFrame[2 * J + j] * m_vPositionScale.z;
+
+				unsigned short c0 = pFrame[3 * J + j];
+				unsigned short c1 = pFrame[4 * J + j];
+				unsigned short c2 = pFrame[5 * J + j];
+
+				const unsigned char* pOrder = kSmallestThreeOrder[(c0 >> 15) | ((c1 >> 15) << 1)];
+				float a = (c0 & 0x7FFF) * fComponentScale - SMALLEST_THREE_RANGE;
+				float b = (c1 & 0x7FFF) * fComponentScale - SMALLEST_THREE_RANGE;
+				float c = c2 * fComponentScale - SMALLEST_THREE_RANGE;
+
+				// x, y, z, w from the third stream on
+				fDecoded[f][3 + pOrder[0]][i] = a;
+				fDecoded[f][3 + pOrder[1]][i] = b;
+				fDecoded[f][3 + pOrder[2]][i] = c;
+				fDecoded[f][3 + pOrder[3]][i] = sqrtf(std::max(0.0f, 1.0f - a * a - b * b - c * c));
+			}
+		}
+
+		const float* pStreams[2][7];
+		for(unsigned int f = 0; f < 2; f++) {
+			for(unsigned int c = 0; c < 7; c++) {
+				pStreams[f][c] = fDecoded[f][c];
+			}
+		}
+
+		blend(pStreams[0], pStreams[1], fBlend, n, pJoints ? pJoints + iStart : NULL, iStart, pPositions, pOrientations);
+	}
+}
+
+void AnimationClip::blend(const float* const* pStreams0, const float* const* pStreams1, float fBlend, unsigned int iCount, const unsigned short* pJoints, unsigned int iFirst, Vector3* pPositions, Quaternionf* pOrientations) {
+
+	// nlerp along the shortest arc, frames are close enough for it to
+	// stand in for slerp
+	float w[ANIMATION_CLIP_BATCH], x[ANIMATION_CLIP_BATCH], y[ANIMATION_CLIP_BATCH], z[ANIMATION_CLIP_BATCH];
+	QuaternionSoA::nlerp(pStreams0[6], pStreams0[3], pStreams0[4], pStreams0[5],
+						pStreams1[6], pStreams1[3], pStreams1[4], pStreams1[5],
+						fBlend, w, x, y, z, iCount);
+
+	for(unsigned int i = 0; i < iCount; i++) {
+
+		unsigned int j = pJoints ? pJoints[i] : iFirst + i;
+
+		Vector3& vPosition = pPositions[j];
+		vPosition.x = pStreams0[0][i] + (pStreams1[0][i] - pStreams0[0][i]) * fBlend;
+		vPosition.y = pStreams0[1][i] + (pStreams1[1][i] - pStreams0[1][i]) * fBlend;
+		vPosition.z = pStreams0[2][i] + (pStreams1[2][i] - pStreams0[2][i]) * fBlend;
+
+		Quaternionf& qOrientation = pOrientations[j];
+		qOrientation._w = w[i];
+		qOrientation._x = x[i];
+		qOrientation._y = y[i];
+		qOrientation._z = z[i];
+	}
+}
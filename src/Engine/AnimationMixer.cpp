@@ -0,0 +1,398 @@
+#include "Engine/AnimationMixer.h"
+#include <cmath>
+#include <algorithm>
+
+// Shortest arc nlerp, the result is normalized
+static Quaternionf nlerp(const Quaternionf& q0, const Quaternionf& q1, float t) {
+
+	float fDot = q0._w * q1._w + q0._x * q1._x + q0._y * q1._y + q0._z * q1._z;
+	float t1 = (fDot < 0.0f) ? -t : t;
+	float t0 = 1.0f - t;
+
+	Quaternionf q(	q0._w * t0 + q1._w * t1,
+					q0._x * t0 + q1._x * t1,
+					q0._y * t0 + q1._y * t1,
+					q0._z * t0 + q1._z * t1 );
+	q.normalize();
+	return q;
+}
+
+AnimationMixer::AnimationMixer(unsigned int iJointCount, const int* pParents)
+	:	m_iJointCount(iJointCount),
+		m_vParents(pParents, pParents + iJointCount),
+		m_vBindPositions(iJointCount),
+		m_vBindOrientations(iJointCount),
+		m_vPosePositions(iJointCount),
+		m_vPoseOrientations(iJointCount),
+		m_vLayerPositions(iJointCount),
+		m_vLayerOrientations(iJointCount),
+		m_vSamplePositions(iJointCount),
+		m_vSampleOrientations(iJointCount),
+		m_vPositions(iJointCount),
+		m_vOrientations(iJointCount)
+{
+	for(unsigned int i = 0; i < ANIMATION_MIXER_LAYERS; i++) {
+
+		Layer& layer = m_Layers[i];
+		layer.eMode = LAYER_BLEND;
+		layer.fWeight = 1.0f;
+		layer.vMask.assign(iJointCount, 1.0f);
+
+		for(unsigned int j = 0; j < ANIMATION_MIXER_LAYER_CLIPS; j++) {
+			layer.clips[j].pClip = NULL;
+		}
+	}
+}
+
+AnimationMixer::~AnimationMixer() {
+
+}
+
+AnimationMixer* AnimationMixer::create(unsigned int iJointCount, const int* pParents, const Vector3* pBindPositions, const Quaternionf* pBindOrientations) {
+
+	GP_ASSERT( iJointCount > 0 );
+	GP_ASSERT( pParents && pBindPositions && pBindOrientations );
+
+	AnimationMixer* pMixer = new AnimationMixer(iJointCount, pParents);
+	for(unsigned int i = 0; i < iJointCount; i++) {
+
+		GP_ASSERT( pParents[i] < (int)i );
+		pMixer->m_vBindPositions[i] = pBindPositions[i];
+		pMixer->m_vBindOrientations[i] = pBindOrientations[i];
+		pMixer->m_vPositions[i] = pBindPositions[i];
+		pMixer->m_vOrientations[i] = pBindOrientations[i];
+	}
+	pMixer->toLocal(&pMixer->m_vBindPositions[0], &pMixer->m_vBindOrientations[0]);
+
+	return pMixer;
+}
+
+unsigned int AnimationMixer::getJointCount() const {
+	return m_iJointCount;
+}
+
+void AnimationMixer::setLayerMode(unsigned int iLayer, LayerMode eMode) {
+
+	GP_ASSERT( iLayer < ANIMATION_MIXER_LAYERS );
+	m_Layers[iLayer].eMode = eMode;
+}
+
+void AnimationMixer::setLayerWeight(unsigned int iLayer, float fWeight) {
+
+	GP_ASSERT( iLayer < ANIMATION_MIXER_LAYERS );
+	m_Layers[iLayer].fWeight = fWeight;
+}
+
+void AnimationMixer::setLayerMask(unsigned int iLayer, const float* pJointWeights) {
+
+	GP_ASSERT( iLayer < ANIMATION_MIXER_LAYERS );
+	std::vector<float>& vMask = m_Layers[iLayer].vMask;
+
+	if(pJointWeights) {
+		std::copy(pJointWeights, pJointWeights + m_iJointCount, vMask.begin());
+	}
+	else {
+		std::fill(vMask.begin(), vMask.end(), 1.0f);
+	}
+}
+
+void AnimationMixer::clearLayer(unsigned int iLayer, float fFadeTime) {
+
+	GP_ASSERT( iLayer < ANIMATION_MIXER_LAYERS );
+	for(unsigned int i = 0; i < ANIMATION_MIXER_LAYER_CLIPS; i++) {
+
+		ClipState* pState = &m_Layers[iLayer].clips[i];
+		if(pState->pClip) {
+			fadeTo(pState, 0.0f, fFadeTime);
+		}
+	}
+}
+
+void AnimationMixer::play(unsigned int iLayer, const AnimationClip* pClip, float fFadeTime) {
+
+	GP_ASSERT( pClip );
+	ClipState* pState = findClip(iLayer, pClip);
+	if(pState == NULL) {
+		pState = addClip(iLayer, pClip);
+	}
+
+	for(unsigned int i = 0; i < ANIMATION_MIXER_LAYER_CLIPS; i++) {
+
+		ClipState* pOther = &m_Layers[iLayer].clips[i];
+		if(pOther->pClip && pOther != pState) {
+			fadeTo(pOther, 0.0f, fFadeTime);
+		}
+	}
+	fadeTo(pState, 1.0f, fFadeTime);
+}
+
+void AnimationMixer::blend(unsigned int iLayer, const AnimationClip* pClip, float fWeight, float fFadeTime) {
+
+	GP_ASSERT( pClip );
+	ClipState* pState = findClip(iLayer, pClip);
+	if(pState == NULL) {
+		if(fWeight <= 0.0f)
+			return;
+		pState = addClip(iLayer, pClip);
+	}
+
+	fadeTo(pState, fWeight, fFadeTime);
+}
+
+void AnimationMixer::setClipSpeed(unsigned int iLayer, const AnimationClip* pClip, float fSpeed) {
+
+	ClipState* pState = findClip(iLayer, pClip);
+	if(pState) {
+		pState->fSpeed = fSpeed;
+	}
+}
+
+bool AnimationMixer::isActive() const {
+
+	for(unsigned int i = 0; i < ANIMATION_MIXER_LAYERS; i++) {
+		for(unsigned int j = 0; j < ANIMATION_MIXER_LAYER_CLIPS; j++) {
+			if(m_Layers[i].clips[j].pClip)
+				return true;
+		}
+	}
+	return false;
+}
+
+AnimationMixer::ClipState* AnimationMixer::findClip(unsigned int iLayer, const AnimationClip* pClip) {
+
+	GP_ASSERT( iLayer < ANIMATION_MIXER_LAYERS );
+	for(unsigned int i = 0; i < ANIMATION_MIXER_LAYER_CLIPS; i++) {
+		if(m_Layers[iLayer].clips[i].pClip == pClip)
+			return &m_Layers[iLayer].clips[i];
+	}
+	return NULL;
+}
+
+AnimationMixer::ClipState* AnimationMixer::addClip(unsigned int iLayer, const AnimationClip* pClip) {
+
+	GP_ASSERT( pClip->getJointCount() == m_iJointCount );
+
+	// A free slot, otherwise the clip that weighs least
+	Layer& layer = m_Layers[iLayer];
+	ClipState* pState = &layer.clips[0];
+	for(unsigned int i = 0; i < ANIMATION_MIXER_LAYER_CLIPS; i++) {
+
+		ClipState* pSlot = &layer.clips[i];
+		if(pSlot->pClip == NULL) {
+			pState = pSlot;
+			break;
+		}
+		if(pSlot->fWeight < pState->fWeight) {
+			pState = pSlot;
+		}
+	}
+
+	pState->pClip = pClip;
+	pState->fTime = 0.0f;
+	pState->fSpeed = 1.0f;
+	pState->fWeight = 0.0f;
+	pState->fTargetWeight = 0.0f;
+	pState->fFadeRate = 0.0f;
+
+	// Sized on the first use of the slot, kept from then on
+	pState->vReferencePositions.resize(m_iJointCount);
+	pState->vReferenceOrientations.resize(m_iJointCount);
+	sampleLocal(pClip, 0.0f, &pState->vReferencePositions[0], &pState->vReferenceOrientations[0]);
+
+	return pState;
+}
+
+void AnimationMixer::fadeTo(ClipState* pState, float fWeight, float fFadeTime) {
+
+	pState->fTargetWeight = fWeight;
+	if(fFadeTime > 0.0f) {
+		pState->fFadeRate = fabsf(fWeight - pState->fWeight) / fFadeTime;
+		return;
+	}
+
+	pState->fWeight = fWeight;
+	pState->fFadeRate = 0.0f;
+	if(fWeight <= 0.0f) {
+		pState->pClip = NULL;
+	}
+}
+
+void AnimationMixer::sampleLocal(const AnimationClip* pClip, float fTime, Vector3* pPositions, Quaternionf* pOrientations) {
+
+	pClip->sample(fTime, pPositions, pOrientations);
+	toLocal(pPositions, pOrientations);
+}
+
+void AnimationMixer::toLocal(Vector3* pPositions, Quaternionf* pOrientations) const {
+
+	// Children first, their parents are still in model space
+	for(int i = (int)m_iJointCount - 1; i >= 0; i--) {
+
+		int iParent = m_vParents[i];
+		if(iParent < 0)
+			continue;
+
+		Quaternionf qInverseParent = ~pOrientations[iParent];
+		Vector3 vOffset = pPositions[i] - pPositions[iParent];
+		qInverseParent.rotate(vOffset);
+
+		pPositions[i] = vOffset;
+		pOrientations[i] = qInverseParent * pOrientations[i];
+	}
+}
+
+void AnimationMixer::toModel(const Vector3* pLocalPositions, const Quaternionf* pLocalOrientations, Vector3* pPositions, Quaternionf* pOrientations) const {
+
+	for(unsigned int i = 0; i < m_iJointCount; i++) {
+
+		int iParent = m_vParents[i];
+		if(iParent < 0) {
+			pPositions[i] = pLocalPositions[i];
+			pOrientations[i] = pLocalOrientations[i];
+			continue;
+		}
+
+		Vector3 vOffset = pLocalPositions[i];
+		pOrientations[iParent].rotate(vOffset);
+
+		pPositions[i] = pPositions[iParent] + vOffset;
+		pOrientations[i] = pOrientations[iParent] * pLocalOrientations[i];
+		pOrientations[i].normalize();
+	}
+}
+
+float AnimationMixer::evaluateLayer(Layer& layer) {
+
+	// Weighted sum of the clips, or of their motion for additive layers
+	float fTotalWeight = 0.0f;
+	for(unsigned int c = 0; c < ANIMATION_MIXER_LAYER_CLIPS; c++) {
+
+		const ClipState& state = layer.clips[c];
+		if(state.pClip == NULL || state.fWeight <= 0.0f)
+			continue;
+
+		sampleLocal(state.pClip, state.fTime, &m_vSamplePositions[0], &m_vSampleOrientations[0]);
+		if(layer.eMode == LAYER_ADDITIVE) {
+			for(unsigned int i = 0; i < m_iJointCount; i++) {
+				m_vSamplePositions[i] = m_vSamplePositions[i] - state.vReferencePositions[i];
+				m_vSampleOrientations[i] = ~state.vReferenceOrientations[i] * m_vSampleOrientations[i];
+			}
+		}
+
+		// Running normalized blend, the first clip is taken as is
+		fTotalWeight += state.fWeight;
+		float t = state.fWeight / fTotalWeight;
+		for(unsigned int i = 0; i < m_iJointCount; i++) {
+			m_vLayerPositions[i] = Lerp(m_vLayerPositions[i], m_vSamplePositions[i], t);
+			m_vLayerOrientations[i] = nlerp(m_vLayerOrientations[i], m_vSampleOrientations[i], t);
+		}
+	}
+
+	// The blend above is normalized, clips summing to less than 1 (fading in
+	// alone, or out with nothing after them) cover only that much
+	return std::min(fTotalWeight, 1.0f);
+}
+
+void AnimationMixer::update(float fDeltaTime) {
+
+	float fSeconds = fDeltaTime / 1000.0f;
+
+	// Advance clips and fades, faded out clips leave their slot
+	for(unsigned int l = 0; l < ANIMATION_MIXER_LAYERS; l++) {
+		for(unsigned int c = 0; c < ANIMATION_MIXER_LAYER_CLIPS; c++) {
+
+			ClipState& state = m_Layers[l].clips[c];
+			if(state.pClip == NULL)
+				continue;
+
+			state.fTime = fmodf(state.fTime + fSeconds * state.fSpeed, state.pClip->getDuration());
+
+			float fStep = state.fFadeRate * fSeconds;
+			if(state.fWeight < state.fTargetWeight) {
+				state.fWeight = std::min(state.fWeight + fStep, state.fTargetWeight);
+			}
+			else {
+				state.fWeight = std::max(state.fWeight - fStep, state.fTargetWeight);
+			}
+
+			if(state.fTargetWeight <= 0.0f && state.fWeight <= 0.0f) {
+				state.pClip = NULL;
+			}
+		}
+	}
+
+	std::copy(m_vBindPositions.begin(), m_vBindPositions.end(), m_vPosePositions.begin());
+	std::copy(m_vBindOrientations.begin(), m_vBindOrientations.end(), m_vPoseOrientations.begin());
+
+	const Quaternionf qIdentity(1.0f, 0.0f, 0.0f, 0.0f);
+	for(unsigned int l = 0; l < ANIMATION_MIXER_LAYERS; l++) {
+
+		Layer& layer = m_Layers[l];
+		if(layer.fWeight <= 0.0f)
+			continue;
+
+		float fLayerWeight = layer.fWeight * evaluateLayer(layer);
+		if(fLayerWeight <= 0.0f)
+			continue;
+
+		for(unsigned int i = 0; i < m_iJointCount; i++) {
+
+			float w = fLayerWeight * layer.vMask[i];
+			if(layer.eMode == LAYER_BLEND) {
+				m_vPosePositions[i] = Lerp(m_vPosePositions[i], m_vLayerPositions[i], w);
+				m_vPoseOrientations[i] = nlerp(m_vPoseOrientations[i], m_vLayerOrientations[i], w);
+			}
+			else {
+				m_vPosePositions[i] += m_vLayerPositions[i] * w;
+				m_vPoseOrientations[i] = m_vPoseOrientations[i] * nlerp(qIdentity, m_vLayerOrientations[i], w);
+			}
+		}
+	}
+
+	toModel(&m_vPosePositions[0], &m_vPoseOrientations[0], &m_vPositions[0], &m_vOrientations[0]);
+}
+
+const Vector3* AnimationMixer::getPositions() const {
+	return &m_vPositions[0];
+}
+
+const Quaternionf* AnimationMixer::getOrientations() const {
+	return &m_vOrientations[0];
+}
+
+bool AnimationMixer::verify() {
+
+	// One joint held 2 units from its bind position by a still clip
+	const int iParent = -1;
+	const Vector3 vBind(0.0f, 0.0f, 0.0f);
+	const Vector3 vClip[2] = { Vector3(2.0f, 0.0f, 0.0f), Vector3(2.0f, 0.0f, 0.0f) };
+	const Quaternionf qIdentity[2] = { Quaternionf(1.0f, 0.0f, 0.0f, 0.0f), Quaternionf(1.0f, 0.0f, 0.0f, 0.0f) };
+
+	AnimationClip* pClip = AnimationClip::create(1, 2, 1.0f, vClip, qIdentity);
+	AnimationMixer* pMixer = AnimationMixer::create(1, &iParent, &vBind, qIdentity);
+	bool bMatch = true;
+
+	// Half way into a fade-in over the bind pose
+	pMixer->play(0, pClip, 1.0f);
+	pMixer->update(500.0f);
+	bMatch = bMatch && fabsf(pMixer->getPositions()[0].x - 1.0f) < 0.001f;
+
+	pMixer->update(500.0f);
+	bMatch = bMatch && fabsf(pMixer->getPositions()[0].x - 2.0f) < 0.001f;
+
+	// Half way out of it
+	pMixer->clearLayer(0, 1.0f);
+	pMixer->update(500.0f);
+	bMatch = bMatch && fabsf(pMixer->getPositions()[0].x - 1.0f) < 0.001f;
+
+	// A clip blended in at a quarter
+	pMixer->clearLayer(0);
+	pMixer->blend(0, pClip, 0.25f);
+	pMixer->update(0.0f);
+	bMatch = bMatch && fabsf(pMixer->getPositions()[0].x - 0.5f) < 0.001f;
+
+	SAFE_DELETE( pMixer );
+	SAFE_DELETE( pClip );
+
+	return bMatch;
+}
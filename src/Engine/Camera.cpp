@@ -1,6 +1,8 @@
 #include "Engine/Camera.h"
 #include "Engine/EngineManager.h"
 
+unsigned int Camera::m_iVersionCounter = 0;
+
 Camera::Camera(int x, int y, int w, int h, float iFieldOfView, float fNearPlane, float fFarPlane)
 	:	m_iCameraType(PERSPECTIVE),
 		m_iViewX(x),
@@ -23,8 +25,10 @@ Camera::Camera(int x, int y, int w, int h, float iFieldOfView, float fNearPlane,
 
 		m_MatrixInverseView(),
 		m_MatrixInverseViewProjection(),
+		m_Frustum(),
 
-		m_pNode(NULL)
+		m_pNode(NULL),
+		m_iVersion(++m_iVersionCounter)
 {
 	
 }
@@ -50,8 +54,10 @@ Camera::Camera(int x, int y, int w, int h, float fNearPlane, float fFarPlane)
 
 		m_MatrixInverseView(),
 		m_MatrixInverseViewProjection(),
+		m_Frustum(),
 
-		m_pNode(NULL)
+		m_pNode(NULL),
+		m_iVersion(++m_iVersionCounter)
 {
 	m_iViewX = x;
 	m_iViewY = y;
@@ -188,8 +194,7 @@ const Matrix4& Camera::getInverseViewMatrix() {
     * @return The camera inverse view * projection matrix.
     */
 const Matrix4& Camera::getInverseViewProjectionMatrix() {
-	//if(m_iDirty & CAMERA_DIRTY_INV_VIEW_PROJ) 
-	{
+	if(m_iDirty & CAMERA_DIRTY_INV_VIEW_PROJ) {
 		getViewProjectionMatrix().invert(&m_MatrixInverseViewProjection);
 		m_iDirty &= ~CAMERA_DIRTY_INV_VIEW_PROJ;
 	}
@@ -197,6 +202,15 @@ const Matrix4& Camera::getInverseViewProjectionMatrix() {
 	return m_MatrixInverseViewProjection;
 }
 
+const Frustum& Camera::getFrustum() {
+	if(m_iDirty & CAMERA_DIRTY_BOUNDS) {
+		m_Frustum.set(getViewProjectionMatrix());
+		m_iDirty &= ~CAMERA_DIRTY_BOUNDS;
+	}
+
+	return m_Frustum;
+}
+
 void Camera::unproject(const Rectangle_& viewport, float fX, float fY, float fDepth, Vector3* dst) {
 
 	GP_ASSERT( dst );
@@ -226,9 +240,9 @@ void Camera::unproject(const Rectangle_& viewport, float fX, float fY, float fDe
 	dst->set(_vScreen.x, _vScreen.y, _vScreen.z);
 }
 
-void Camera::pickRay(const Rectangle_& viewport, float x, float y/*, Ray* pRay*/) {
+void Camera::pickRay(const Rectangle_& viewport, float x, float y, Ray* pRay) {
 
-	//GP_ASSERT( pRay );
+	GP_ASSERT( pRay );
 
 	// Get the world-space position at the near clip plane.
 	Vector3 vNearPoint;
@@ -241,9 +255,8 @@ void Camera::pickRay(const Rectangle_& viewport, float x, float y/*, Ray* pRay*/
 	// Set the direction of the ray.
 	Vector3 vDirection;
 	vDirection = vFarPoint - vNearPoint;
-	vDirection.normalize();
 
-	//pRay->set(vNearPoint, vDirection);
+	pRay->set(vNearPoint, vDirection);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -256,7 +269,7 @@ void Camera::setPerspective(int x, int y, int w, int h, float iFieldOfView, floa
 	int yViewport = EngineManager::getInstance()->getHeight() - (y + h);
 	int wViewport = w;
 	int hViewport = h;
-	glEnable(GL_SCISSOR_TEST);
+	GLStateCache::setEnabled(GL_SCISSOR_TEST, true);
 	glViewport(xViewport, yViewport, wViewport, hViewport);
 	glScissor(xViewport, yViewport, wViewport, hViewport);
 	////////////////////////////////////////////
@@ -318,6 +331,8 @@ void Camera::setPerspectiveFrustum(float l, float r, float b, float t, float n,
 	m_MatrixProjection[11] = -(2 * f * n) / (f - n);
 	m_MatrixProjection[14] = -1;
 	m_MatrixProjection[15] =  0;
+
+	setDirty(CAMERA_DIRTY_VIEW_PROJ);
 }
 
 void Camera::setOrthographic(int x, int y, int w, int h, float fNearPlane, float fFarPlane) {
@@ -327,7 +342,7 @@ void Camera::setOrthographic(int x, int y, int w, int h, float fNearPlane, float
 	int yViewport = EngineManager::getInstance()->getHeight() - (y + h);
 	int wViewport = w;
 	int hViewport = h;
-	glEnable(GL_SCISSOR_TEST);
+	GLStateCache::setEnabled(GL_SCISSOR_TEST, true);
 	glViewport(xViewport, yViewport, wViewport, hViewport);
 	glScissor(xViewport, yViewport, wViewport, hViewport);
 	////////////////////////////////////////////
@@ -354,6 +369,8 @@ void Camera::setOrthogonalFrustum(float l, float r, float b, float t, float n, f
 	m_MatrixProjection[7]  =  -(t + b) / (t - b);
 	m_MatrixProjection[10] = -2 / (f - n);
 	m_MatrixProjection[11] = -(f + n) / (f - n);
+
+	setDirty(CAMERA_DIRTY_VIEW_PROJ);
 }
 
 void Camera::setCamera(float posX, float posY, float posZ, float targetX, float targetY, float targetZ) {
@@ -522,9 +539,22 @@ Node* Camera::getNode() const {
 void Camera::setNode(Node* node) {
 	if(node != m_pNode) {
 		m_pNode = node;
+		setDirty(CAMERA_DIRTY_VIEW);
 	}
 }
 
 void Camera::setDirty(int iDirty) {
+
+	// Everything derived from the view or the projection goes stale with it.
+	if(iDirty & CAMERA_DIRTY_VIEW)
+		iDirty |= CAMERA_DIRTY_VIEW_PROJ | CAMERA_DIRTY_INV_VIEW | CAMERA_DIRTY_INV_VIEW_PROJ | CAMERA_DIRTY_BOUNDS;
+	if(iDirty & (CAMERA_DIRTY_PROJ | CAMERA_DIRTY_VIEW_PROJ))
+		iDirty |= CAMERA_DIRTY_VIEW_PROJ | CAMERA_DIRTY_INV_VIEW_PROJ | CAMERA_DIRTY_BOUNDS;
+
 	m_iDirty |= iDirty;
+	m_iVersion = ++m_iVersionCounter;
+}
+
+unsigned int Camera::getVersion() const {
+	return m_iVersion;
 }
\ No newline at end of file
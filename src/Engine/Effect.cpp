@@ -1,11 +1,14 @@
 #include <Engine/Effect.h>
 #include <Common/RandomAccessFile.h>
+#include <Engine/GLStateCache.h>
+#include <Engine/UniformBlocks.h>
 
 static std::map<std::string, Effect*>	__effectCache;
 static Effect*							__currentEffect;
 
 Effect::Effect()
 : m_iProgram(0)
+, m_iUniformBlocks(0)
 {
 
 }
@@ -23,10 +26,11 @@ Effect::~Effect() {
 		// If our program object is currently bound, unbind it before we're destroyed.
 		if (__currentEffect == this) {
 
-			GL_ASSERT( glUseProgram(0) );
+			GLStateCache::useProgram(0);
 			__currentEffect = NULL;
 		}
 
+		GLStateCache::programDeleted(m_iProgram);
 		GL_ASSERT( glDeleteProgram(m_iProgram) );
 		m_iProgram = 0;
 	}
@@ -200,7 +204,7 @@ void Effect::QueryAndStoreUniforms(Effect* pEffect) {
 				pUniform->m_iLocation	= iUniformLocation;
 				pUniform->m_eType		= eUniformType;
 
-				if (eUniformType == GL_SAMPLER_2D || eUniformType == GL_SAMPLER_CUBE) {
+				if (eUniformType == GL_SAMPLER_2D || eUniformType == GL_SAMPLER_CUBE || eUniformType == GL_SAMPLER_2D_ARRAY) {
 
 					pUniform->m_iIndex = iSamplerIndex;
 					iSamplerIndex += iUniformSize;
@@ -217,6 +221,35 @@ void Effect::QueryAndStoreUniforms(Effect* pEffect) {
 	}
 }
 
+void Effect::QueryAndBindUniformBlocks(Effect* pEffect) {
+
+	// Point the autobinding blocks the program declares at their fixed
+	// binding points, see UniformBlocks.
+	GP_ASSERT( pEffect );
+
+	pEffect->m_iUniformBlocks = 0;
+	if(!GLEW_ARB_uniform_buffer_object)
+		return;
+
+	GLuint iProgramID = pEffect->m_iProgram;
+
+	GLuint iFrameBlock;
+	GL_ASSERT( iFrameBlock = glGetUniformBlockIndex(iProgramID, UniformBlocks::getBlockName(UniformBlocks::FRAME_BLOCK)) );
+	if(iFrameBlock != GL_INVALID_INDEX) {
+
+		GL_ASSERT( glUniformBlockBinding(iProgramID, iFrameBlock, UniformBlocks::FRAME_BLOCK_BINDING) );
+		pEffect->m_iUniformBlocks |= UniformBlocks::FRAME_BLOCK;
+	}
+
+	GLuint iObjectBlock;
+	GL_ASSERT( iObjectBlock = glGetUniformBlockIndex(iProgramID, UniformBlocks::getBlockName(UniformBlocks::OBJECT_BLOCK)) );
+	if(iObjectBlock != GL_INVALID_INDEX) {
+
+		GL_ASSERT( glUniformBlockBinding(iProgramID, iObjectBlock, UniformBlocks::OBJECT_BLOCK_BINDING) );
+		pEffect->m_iUniformBlocks |= UniformBlocks::OBJECT_BLOCK;
+	}
+}
+
 static void replaceIncludes(const char* pFilePath, const char* pSource, CCString& sOut) {
 
 	// Replace the #include "xxxx.xxx" with the sourced file contents of "pFilepath/xxxx.xxx"
@@ -288,6 +321,11 @@ Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, con
 	CCString sDefinesStr = "";
 	replaceDefines(defines, sDefinesStr);
 
+	// Lets shaders choose between autobindings.glsl and plain uniforms
+	if (UniformBlocks::isInitialized()) {
+		sDefinesStr += "\n#define UNIFORM_BLOCKS";
+	}
+
 	sShaderSource[0] = sDefinesStr.c_str();
 	sShaderSource[1] = "\n";
 
@@ -413,6 +451,7 @@ Effect* Effect::createFromSource(const char* vshPath, const char* vshSource, con
 
 	QueryAndStoreVertexAttribsMetaData(pEffect);
 	QueryAndStoreUniforms(pEffect);
+	QueryAndBindUniformBlocks(pEffect);
 
 	return pEffect;
 }
@@ -490,105 +529,126 @@ unsigned int Effect::getUniformCount() const {
 	return (unsigned int)m_mUniforms.size();
 }
 
+unsigned int Effect::getUniformBlocks() const {
+
+	return m_iUniformBlocks;
+}
+
 void Effect::setValue(Uniform* pUniform, float value) {
 
 	GP_ASSERT( pUniform );
-	GL_ASSERT( glUniform1f(pUniform->m_iLocation, value) );
+	if(GLStateCache::uniformChanged(pUniform->m_iLocation, &value, sizeof(value)))
+		GL_ASSERT( glUniform1f(pUniform->m_iLocation, value) );
 }
 
 void Effect::setValue(Uniform* pUniform, const float* values, unsigned int count) {
 
 	GP_ASSERT( pUniform );
 	GP_ASSERT( values );
-	GL_ASSERT( glUniform1fv(pUniform->m_iLocation, count, values) );
+	if(GLStateCache::uniformChanged(pUniform->m_iLocation, values, sizeof(float) * count, count))
+		GL_ASSERT( glUniform1fv(pUniform->m_iLocation, count, values) );
 }
 
 void Effect::setValue(Uniform* pUniform, int value) {
 
 	GP_ASSERT( pUniform);
-	GL_ASSERT( glUniform1i(pUniform->m_iLocation, value) );
+	if(GLStateCache::uniformChanged(pUniform->m_iLocation, &value, sizeof(value)))
+		GL_ASSERT( glUniform1i(pUniform->m_iLocation, value) );
 }
 
 void Effect::setValue(Uniform* pUniform, const int* values, unsigned int count) {
 
 	GP_ASSERT( pUniform);
 	GP_ASSERT( values );
-	GL_ASSERT( glUniform1iv(pUniform->m_iLocation, count, values) );
+	if(GLStateCache::uniformChanged(pUniform->m_iLocation, values, sizeof(int) * count, count))
+		GL_ASSERT( glUniform1iv(pUniform->m_iLocation, count, values) );
 }
 
 void Effect::setValue(Uniform* pUniform, const Matrix4& value) {
 
 	GP_ASSERT( pUniform );
-	GL_ASSERT( glUniformMatrix4fv(pUniform->m_iLocation, 1, GL_FALSE, value.m) );
+	if(GLStateCache::uniformChanged(pUniform->m_iLocation, value.m, sizeof(value.m)))
+		GL_ASSERT( glUniformMatrix4fv(pUniform->m_iLocation, 1, GL_FALSE, value.m) );
 }
 
 void Effect::setValue(Uniform* pUniform, const Matrix4* values, unsigned int count) {
 
 	GP_ASSERT( pUniform);
 	GP_ASSERT( values );
-	GL_ASSERT( glUniformMatrix4fv(pUniform->m_iLocation, count, GL_FALSE, (GLfloat*)values) );
+	if(GLStateCache::uniformChanged(pUniform->m_iLocation, values, sizeof(Matrix4) * count, count))
+		GL_ASSERT( glUniformMatrix4fv(pUniform->m_iLocation, count, GL_FALSE, (GLfloat*)values) );
 }
 
 void Effect::setValue(Uniform* pUniform, const Vector2& value) {
 
 	GP_ASSERT( pUniform);
-	GL_ASSERT( glUniform2f(pUniform->m_iLocation, value.x, value.y) );
+	if(GLStateCache::uniformChanged(pUniform->m_iLocation, &value, sizeof(value)))
+		GL_ASSERT( glUniform2f(pUniform->m_iLocation, value.x, value.y) );
 }
 
 void Effect::setValue(Uniform* pUniform, const Vector2* values, unsigned int count) {
 
 	GP_ASSERT( pUniform );
 	GP_ASSERT( values );
-	GL_ASSERT( glUniform2fv(pUniform->m_iLocation, count, (GLfloat*)values) );
+	if(GLStateCache::uniformChanged(pUniform->m_iLocation, values, sizeof(Vector2) * count, count))
+		GL_ASSERT( glUniform2fv(pUniform->m_iLocation, count, (GLfloat*)values) );
 }
 
 void Effect::setValue(Uniform* pUniform, const Vector3& value) {
 
 	GP_ASSERT( pUniform );
-	GL_ASSERT( glUniform3f(pUniform->m_iLocation, value.x, value.y, value.z) );
+	if(GLStateCache::uniformChanged(pUniform->m_iLocation, &value, sizeof(value)))
+		GL_ASSERT( glUniform3f(pUniform->m_iLocation, value.x, value.y, value.z) );
 }
 
 void Effect::setValue(Uniform* pUniform, const Vector3* values, unsigned int count) {
 
 	GP_ASSERT(	pUniform );
 	GP_ASSERT(	values );
-	GL_ASSERT(	glUniform3fv(pUniform->m_iLocation, count, (GLfloat*)values) );
+	if(GLStateCache::uniformChanged(pUniform->m_iLocation, values, sizeof(Vector3) * count, count))
+		GL_ASSERT(	glUniform3fv(pUniform->m_iLocation, count, (GLfloat*)values) );
 }
 
 void Effect::setValue(Uniform* pUniform, const Vector4& value) {
 
 	GP_ASSERT( pUniform );
-	GL_ASSERT( glUniform4f(pUniform->m_iLocation, value.x, value.y, value.z, value.w) );
+	if(GLStateCache::uniformChanged(pUniform->m_iLocation, &value, sizeof(value)))
+		GL_ASSERT( glUniform4f(pUniform->m_iLocation, value.x, value.y, value.z, value.w) );
 }
 
 void Effect::setValue(Uniform* pUniform, const Vector4* values, unsigned int count) {
 
 	GP_ASSERT( pUniform );
 	GP_ASSERT( values );
-	GL_ASSERT( glUniform4fv(pUniform->m_iLocation, count, (GLfloat*)values) );
+	if(GLStateCache::uniformChanged(pUniform->m_iLocation, values, sizeof(Vector4) * count, count))
+		GL_ASSERT( glUniform4fv(pUniform->m_iLocation, count, (GLfloat*)values) );
 }
 
 void Effect::setValue(Uniform* pUniform, const Texture::Sampler* sampler) {
 
 	GP_ASSERT( pUniform );
-	GP_ASSERT( pUniform->m_eType == GL_SAMPLER_2D || pUniform->m_eType == GL_SAMPLER_CUBE);
+	GP_ASSERT( pUniform->m_eType == GL_SAMPLER_2D || pUniform->m_eType == GL_SAMPLER_CUBE || pUniform->m_eType == GL_SAMPLER_2D_ARRAY);
 	GP_ASSERT( sampler );
 	GP_ASSERT(	(sampler->getTexture()->getType() == Texture::TEXTURE_2D && pUniform->m_eType == GL_SAMPLER_2D) 
 				||
-				(sampler->getTexture()->getType() == Texture::TEXTURE_CUBE && pUniform->m_eType == GL_SAMPLER_CUBE) );
+				(sampler->getTexture()->getType() == Texture::TEXTURE_CUBE && pUniform->m_eType == GL_SAMPLER_CUBE)
+				||
+				(sampler->getTexture()->getType() == Texture::TEXTURE_2D_ARRAY && pUniform->m_eType == GL_SAMPLER_2D_ARRAY) );
 
-	GL_ASSERT( glActiveTexture(GL_TEXTURE0 + pUniform->m_iIndex) );
+	GLStateCache::activeTexture(pUniform->m_iIndex);
 
 	// Bind the sampler - this binds the texture and applies sampler state
 	const_cast<Texture::Sampler*>(sampler)->bind();
 
-	GL_ASSERT( glUniform1i(pUniform->m_iLocation, pUniform->m_iIndex) );
+	GLint iUnit = pUniform->m_iIndex;
+	if(GLStateCache::uniformChanged(pUniform->m_iLocation, &iUnit, sizeof(iUnit)))
+		GL_ASSERT( glUniform1i(pUniform->m_iLocation, iUnit) );
 }
 
 void Effect::setValue(Uniform* pUniform, const Texture::Sampler** values, unsigned int count) {
 
 	GP_ASSERT(	pUniform );
-	GP_ASSERT(	pUniform->m_eType == GL_SAMPLER_2D || pUniform->m_eType == GL_SAMPLER_CUBE );
+	GP_ASSERT(	pUniform->m_eType == GL_SAMPLER_2D || pUniform->m_eType == GL_SAMPLER_CUBE || pUniform->m_eType == GL_SAMPLER_2D_ARRAY );
 	GP_ASSERT(	values );
 
 	// Set samplers as active and load texture unit array
@@ -597,9 +657,11 @@ void Effect::setValue(Uniform* pUniform, const Texture::Sampler** values, unsign
 
 		GP_ASSERT(	(const_cast<Texture::Sampler*>(values[i])->getTexture()->getType() == Texture::TEXTURE_2D && pUniform->m_eType == GL_SAMPLER_2D) 
 					||
-					(const_cast<Texture::Sampler*>(values[i])->getTexture()->getType() == Texture::TEXTURE_CUBE && pUniform->m_eType == GL_SAMPLER_CUBE));
+					(const_cast<Texture::Sampler*>(values[i])->getTexture()->getType() == Texture::TEXTURE_CUBE && pUniform->m_eType == GL_SAMPLER_CUBE)
+					||
+					(const_cast<Texture::Sampler*>(values[i])->getTexture()->getType() == Texture::TEXTURE_2D_ARRAY && pUniform->m_eType == GL_SAMPLER_2D_ARRAY));
 
-		GL_ASSERT( glActiveTexture(GL_TEXTURE0 + pUniform->m_iIndex + i) );
+		GLStateCache::activeTexture(pUniform->m_iIndex + i);
 
 		// Bind the sampler - this binds the texture and applies sampler state
 		const_cast<Texture::Sampler*>(values[i])->bind();
@@ -608,12 +670,13 @@ void Effect::setValue(Uniform* pUniform, const Texture::Sampler** values, unsign
 	}
 
 	// Pass texture unit array to GL
-	GL_ASSERT( glUniform1iv(pUniform->m_iLocation, count, units) );
+	if(GLStateCache::uniformChanged(pUniform->m_iLocation, units, sizeof(GLint) * count, count))
+		GL_ASSERT( glUniform1iv(pUniform->m_iLocation, count, units) );
 }
 
 void Effect::bind() {
 
-	GL_ASSERT( glUseProgram(m_iProgram) );
+	GLStateCache::useProgram(m_iProgram);
 	__currentEffect = this;
 }
 
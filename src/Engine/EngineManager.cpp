@@ -4,6 +4,11 @@
 #include "Engine/Camera.h"
 #include "Engine/FrameBuffer.h"
 #include "Engine/RenderState.h"
+#include "Engine/GPURingBuffer.h"
+#include "Engine/AnimationMixer.h"
+#include "Common/MathSIMD.h"
+#include "Common/BatchMath.h"
+#include "Common/QuaternionSoA.h"
 
 EngineManager*	EngineManager::m_pEngineManager;
 
@@ -24,10 +29,15 @@ EngineManager::EngineManager()
 
 		m_iFrameCount(0),
 		m_iFrameRate(0),
+		m_iWorldMatrixUpdateCount(0),
 		m_dLastElapsedFPSTimeMs(0.0f)
 {
 	GP_ASSERT(m_pEngineManager == NULL);
 	m_pEngineManager = this;
+
+	memset(&m_GLStateCounters, 0, sizeof(m_GLStateCounters));
+	memset(&m_UniformBlockStats, 0, sizeof(m_UniformBlockStats));
+	memset(&m_MeshBatchStats, 0, sizeof(m_MeshBatchStats));
 }
 
 EngineManager* EngineManager::getInstance() {
@@ -41,8 +51,17 @@ void EngineManager::startup(HWND pHWnd) {
 	GetClientRect(m_pHWnd, &rClientRect);
 	setViewport(rClientRect.right - rClientRect.left, rClientRect.bottom - rClientRect.top);
 
+	// Debug builds check that the SIMD backend picked for this CPU matches
+	// the scalar matrix kernels bit for bit
+	GP_ASSERT( MathSIMD::verify() );
+	GP_ASSERT( BatchMath::verify() );
+	GP_ASSERT( QuaternionSoA::verify() );
+	GP_ASSERT( AnimationMixer::verify() );
+
 	RenderState::initialize();
 	FrameBuffer::initialize();
+	GLStateCache::invalidate();
+	UniformBlocks::initialize();
 
 	m_pKeyboardManager = new KeyboardManager();
 	m_pMouseManager = new MouseManager();
@@ -67,6 +86,8 @@ HWND EngineManager::getWindowHandle() {
 void EngineManager::shutdown() {
 	if(m_iState != UNINITIALIZED) {
 
+		UniformBlocks::finalize();
+		MeshBatch::purgeStoragePool();
 		m_iState = UNINITIALIZED;
 	}
 }
@@ -122,6 +143,8 @@ void EngineManager::frame() {
 
 	if(m_iState == RUNNING) {
 		m_pTimer->startFrame();
+		GPURingBuffer::advanceFrame();
+		UniformBlocks::beginFrame();
 
 		update((float)m_pTimer->getDeltaTimeMs());
 		render((float)m_pTimer->getDeltaTimeMs());
@@ -130,6 +153,11 @@ void EngineManager::frame() {
 		m_pWidgetManager->update((float)m_pTimer->getDeltaTimeMs());
 #endif
 		updateFPS();
+		m_iWorldMatrixUpdateCount = Node::resetWorldMatrixUpdateCount();
+		m_GLStateCounters = GLStateCache::resetCounters();
+		m_UniformBlockStats = UniformBlocks::resetStats();
+		m_MeshBatchStats = MeshBatch::resetStats();
+		UniformBlocks::endFrame();
 
 		m_pTimer->endFrame();
 	}
@@ -235,6 +263,22 @@ unsigned int EngineManager::getFPS() {
 	return m_iFrameRate;
 }
 
+unsigned int EngineManager::getWorldMatrixUpdateCount() {
+	return m_iWorldMatrixUpdateCount;
+}
+
+const GLStateCache::Counters& EngineManager::getGLStateCounters() {
+	return m_GLStateCounters;
+}
+
+const UniformBlocks::Stats& EngineManager::getUniformBlockStats() {
+	return m_UniformBlockStats;
+}
+
+const MeshBatch::Stats& EngineManager::getMeshBatchStats() {
+	return m_MeshBatchStats;
+}
+
 #ifdef USE_YAGUI
 void EngineManager::addUIListener(YAGUICallback callbackProc) {
 
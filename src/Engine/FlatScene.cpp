@@ -0,0 +1,419 @@
+#include "Engine/FlatScene.h"
+#include "Engine/Scene.h"
+#include "Engine/Node.h"
+#include "Engine/Model.h"
+#include "Common/MathSIMD.h"
+
+// A handle is the slot in m_vHandleToIndex in the low bits and the number
+// of times the slot was reused above them
+#define HANDLE_SLOT_BITS		20
+#define HANDLE_SLOT_MASK		((1u << HANDLE_SLOT_BITS) - 1)
+#define HANDLE_GENERATION_MAX	((1u << (32 - HANDLE_SLOT_BITS)) - 2)	// the all ones generation would make INVALID_HANDLE
+
+// Reorders v so that v[k] = old v[vOrder[k]].
+template <typename T>
+static void permute(std::vector<T>& v, const std::vector<unsigned int>& vOrder) {
+
+	std::vector<T> vSorted;
+	vSorted.reserve(vOrder.size());
+	for(unsigned int i = 0; i < vOrder.size(); i++) {
+		vSorted.push_back(v[vOrder[i]]);
+	}
+
+	v.swap(vSorted);
+}
+
+FlatScene::FlatScene(Scene* pScene)
+	:	m_pScene(pScene),
+		m_bNeedsSort(false),
+		m_iWorldMatrixUpdateCount(0)
+{
+}
+
+FlatScene* FlatScene::create(Scene* pScene) {
+	GP_ASSERT( pScene );
+
+	return new FlatScene(pScene);
+}
+
+FlatScene::NodeHandle FlatScene::createNode(NodeHandle parent) {
+
+	int iParent = -1;
+	if(parent != INVALID_HANDLE) {
+		iParent = (int)getIndex(parent);
+	}
+
+	NodeHandle handle;
+	if(!m_vFreeHandles.empty()) {
+		// Handles of the slot's earlier nodes stop resolving
+		NodeHandle freed = m_vFreeHandles.back();
+		m_vFreeHandles.pop_back();
+
+		unsigned int iGeneration = freed >> HANDLE_SLOT_BITS;
+		iGeneration = (iGeneration < HANDLE_GENERATION_MAX) ? iGeneration + 1 : 0;
+		handle = (iGeneration << HANDLE_SLOT_BITS) | (freed & HANDLE_SLOT_MASK);
+	}
+	else {
+		GP_ASSERT( m_vHandleToIndex.size() <= HANDLE_SLOT_MASK );
+		handle = (NodeHandle)m_vHandleToIndex.size();
+		m_vHandleToIndex.push_back(0);
+	}
+
+	// Appending keeps parent-before-child, the parent already exists.
+	m_vHandleToIndex[handle & HANDLE_SLOT_MASK] = (unsigned int)m_vHandles.size();
+
+	m_vTranslations.push_back(Vector3::zero());
+	m_vRotations.push_back(Vector3::zero());
+	m_vScales.push_back(Vector3::one());
+	m_vLocalMatrices.push_back(Matrix4::identity());
+	m_vWorldMatrices.push_back(Matrix4::identity());
+	m_vParents.push_back(iParent);
+	m_vModels.push_back(NULL);
+	m_vBindingNodes.push_back(NULL);
+	m_vFlags.push_back(FLAG_DIRTY_WORLD | FLAG_VISIBLE);
+	m_vHandles.push_back(handle);
+
+	return handle;
+}
+
+void FlatScene::destroyNode(NodeHandle handle) {
+
+	if(m_bNeedsSort) {
+		sort();
+	}
+
+	unsigned int iIndex = getIndex(handle);
+
+	// Descendants follow their parent, one sweep collects the subtree.
+	std::vector<bool> vRemove(m_vHandles.size(), false);
+	vRemove[iIndex] = true;
+	for(unsigned int i = iIndex + 1; i < m_vHandles.size(); i++) {
+		int iParent = m_vParents[i];
+		if(iParent >= 0 && vRemove[iParent]) {
+			vRemove[i] = true;
+		}
+	}
+
+	compact(vRemove);
+}
+
+void FlatScene::destroyAllNodes() {
+
+	std::vector<bool> vRemove(m_vHandles.size(), true);
+	compact(vRemove);
+}
+
+bool FlatScene::isValid(NodeHandle handle) const {
+
+	unsigned int iSlot = handle & HANDLE_SLOT_MASK;
+	if(handle == INVALID_HANDLE || iSlot >= m_vHandleToIndex.size())
+		return false;
+
+	// The generation check rejects handles of destroyed nodes whose slot
+	// was given to a new one
+	unsigned int iIndex = m_vHandleToIndex[iSlot];
+	return iIndex < m_vHandles.size() && m_vHandles[iIndex] == handle;
+}
+
+unsigned int FlatScene::getNodeCount() const {
+	return (unsigned int)m_vHandles.size();
+}
+
+unsigned int FlatScene::getIndex(NodeHandle handle) const {
+	GP_ASSERT( isValid(handle) );
+
+	return m_vHandleToIndex[handle & HANDLE_SLOT_MASK];
+}
+
+void FlatScene::setParent(NodeHandle handle, NodeHandle parent) {
+
+	unsigned int iIndex = getIndex(handle);
+	int iParent = -1;
+
+	if(parent != INVALID_HANDLE) {
+		iParent = (int)getIndex(parent);
+
+		// Refuse to make a node a child of its own subtree.
+		for(int i = iParent; i >= 0; i = m_vParents[i]) {
+			if(i == (int)iIndex) {
+				GP_ASSERT( !"FlatScene::setParent() would create a cycle" );
+				return;
+			}
+		}
+	}
+
+	m_vParents[iIndex] = iParent;
+	m_vFlags[iIndex] |= FLAG_DIRTY_WORLD;
+
+	if(iParent > (int)iIndex) {
+		m_bNeedsSort = true;
+	}
+}
+
+FlatScene::NodeHandle FlatScene::getParent(NodeHandle handle) const {
+
+	int iParent = m_vParents[getIndex(handle)];
+	return (iParent >= 0) ? m_vHandles[iParent] : INVALID_HANDLE;
+}
+
+void FlatScene::setPosition(NodeHandle handle, const Vector3& vPosition) {
+
+	unsigned int iIndex = getIndex(handle);
+	m_vTranslations[iIndex] = vPosition;
+	m_vFlags[iIndex] |= FLAG_DIRTY_LOCAL;
+}
+
+const Vector3& FlatScene::getPosition(NodeHandle handle) const {
+	return m_vTranslations[getIndex(handle)];
+}
+
+void FlatScene::setRotation(NodeHandle handle, const Vector3& vAngles) {
+
+	unsigned int iIndex = getIndex(handle);
+	m_vRotations[iIndex] = vAngles;
+	m_vFlags[iIndex] |= FLAG_DIRTY_LOCAL;
+}
+
+const Vector3& FlatScene::getRotation(NodeHandle handle) const {
+	return m_vRotations[getIndex(handle)];
+}
+
+void FlatScene::setScale(NodeHandle handle, const Vector3& vScale) {
+
+	unsigned int iIndex = getIndex(handle);
+	m_vScales[iIndex] = vScale;
+	m_vFlags[iIndex] |= FLAG_DIRTY_LOCAL;
+}
+
+const Vector3& FlatScene::getScale(NodeHandle handle) const {
+	return m_vScales[getIndex(handle)];
+}
+
+const Matrix4& FlatScene::getWorldMatrix(NodeHandle handle) const {
+	return m_vWorldMatrices[getIndex(handle)];
+}
+
+void FlatScene::setModel(NodeHandle handle, Model* pModel) {
+
+	unsigned int iIndex = getIndex(handle);
+	Model* pOldModel = m_vModels[iIndex];
+
+	if(pModel != pOldModel) {
+		if(pOldModel) {
+			pOldModel->setNode(NULL);
+			SAFE_DELETE( pOldModel );
+		}
+
+		m_vModels[iIndex] = pModel;
+
+		Node* pBindingNode = m_vBindingNodes[iIndex];
+		if(pModel) {
+			if(pBindingNode == NULL) {
+				pBindingNode = Node::create("FlatSceneBinding");
+				pBindingNode->setScene(m_pScene);
+				pBindingNode->setResolvedWorldMatrix(m_vWorldMatrices[iIndex]);
+				m_vBindingNodes[iIndex] = pBindingNode;
+			}
+			pModel->setNode(pBindingNode);
+		}
+		else {
+			SAFE_DELETE( m_vBindingNodes[iIndex] );
+		}
+	}
+}
+
+Model* FlatScene::getModel(NodeHandle handle) const {
+	return m_vModels[getIndex(handle)];
+}
+
+void FlatScene::setVisible(NodeHandle handle, bool bVisible) {
+
+	unsigned int iIndex = getIndex(handle);
+	if(bVisible)
+		m_vFlags[iIndex] |= FLAG_VISIBLE;
+	else
+		m_vFlags[iIndex] &= ~FLAG_VISIBLE;
+}
+
+bool FlatScene::isVisible(NodeHandle handle) const {
+	return (m_vFlags[getIndex(handle)] & FLAG_VISIBLE) != 0;
+}
+
+void FlatScene::update() {
+
+	if(m_bNeedsSort) {
+		sort();
+	}
+
+	m_iWorldMatrixUpdateCount = 0;
+
+	for(unsigned int i = 0, iCount = (unsigned int)m_vHandles.size(); i < iCount; i++) {
+		unsigned char iFlags = m_vFlags[i];
+
+		if(iFlags & FLAG_DIRTY_LOCAL) {
+			Matrix4& local = m_vLocalMatrices[i];
+			local.setIdentity();
+			local.rotate(m_vRotations[i]);
+			local.setTranslate(m_vTranslations[i]);
+			local.scale(m_vScales[i]);
+
+			iFlags = (iFlags & ~FLAG_DIRTY_LOCAL) | FLAG_DIRTY_WORLD;
+		}
+
+		// Parents come first, their FLAG_WORLD_CHANGED is already from this sweep.
+		int iParent = m_vParents[i];
+		if(iParent >= 0 && (m_vFlags[iParent] & FLAG_WORLD_CHANGED)) {
+			iFlags |= FLAG_DIRTY_WORLD;
+		}
+
+		if(iFlags & FLAG_DIRTY_WORLD) {
+			if(iParent >= 0) {
+				MathSIMD::multiplyMatrix(m_vWorldMatrices[iParent].m, m_vLocalMatrices[i].m, m_vWorldMatrices[i].m);
+			}
+			else {
+				m_vWorldMatrices[i] = m_vLocalMatrices[i];
+			}
+
+			if(m_vBindingNodes[i]) {
+				m_vBindingNodes[i]->setResolvedWorldMatrix(m_vWorldMatrices[i]);
+			}
+
+			iFlags = (iFlags & ~FLAG_DIRTY_WORLD) | FLAG_WORLD_CHANGED;
+			++m_iWorldMatrixUpdateCount;
+		}
+		else {
+			iFlags &= ~FLAG_WORLD_CHANGED;
+		}
+
+		m_vFlags[i] = iFlags;
+	}
+}
+
+void FlatScene::render(bool bWireframe) {
+
+	for(unsigned int i = 0, iCount = (unsigned int)m_vHandles.size(); i < iCount; i++) {
+		Model* pModel = m_vModels[i];
+		if(pModel && (m_vFlags[i] & FLAG_VISIBLE)) {
+			pModel->draw(bWireframe);
+		}
+	}
+}
+
+unsigned int FlatScene::getWorldMatrixUpdateCount() const {
+	return m_iWorldMatrixUpdateCount;
+}
+
+void FlatScene::sort() {
+
+	unsigned int iCount = (unsigned int)m_vHandles.size();
+
+	// Temporary child lists, then a depth-first walk from the roots so that
+	// every subtree ends up contiguous right after its parent.
+	std::vector<int> vFirstChild(iCount, -1);
+	std::vector<int> vNextSibling(iCount, -1);
+	for(int i = (int)iCount - 1; i >= 0; i--) {
+		int iParent = m_vParents[i];
+		if(iParent >= 0) {
+			vNextSibling[i] = vFirstChild[iParent];
+			vFirstChild[iParent] = i;
+		}
+	}
+
+	std::vector<unsigned int> vOrder;
+	vOrder.reserve(iCount);
+	std::vector<int> vStack;
+	for(unsigned int iRoot = 0; iRoot < iCount; iRoot++) {
+		if(m_vParents[iRoot] >= 0)
+			continue;
+
+		vStack.push_back(iRoot);
+		while(!vStack.empty()) {
+			int i = vStack.back();
+			vStack.pop_back();
+			vOrder.push_back(i);
+
+			// Push in reverse so the first child is visited first.
+			int iChildrenStart = (int)vStack.size();
+			for(int c = vFirstChild[i]; c >= 0; c = vNextSibling[c]) {
+				vStack.push_back(c);
+			}
+			std::reverse(vStack.begin() + iChildrenStart, vStack.end());
+		}
+	}
+	GP_ASSERT( vOrder.size() == iCount );
+
+	std::vector<int> vNewIndex(iCount);
+	for(unsigned int k = 0; k < iCount; k++) {
+		vNewIndex[vOrder[k]] = k;
+	}
+
+	permute(m_vTranslations, vOrder);
+	permute(m_vRotations, vOrder);
+	permute(m_vScales, vOrder);
+	permute(m_vLocalMatrices, vOrder);
+	permute(m_vWorldMatrices, vOrder);
+	permute(m_vParents, vOrder);
+	permute(m_vModels, vOrder);
+	permute(m_vBindingNodes, vOrder);
+	permute(m_vFlags, vOrder);
+	permute(m_vHandles, vOrder);
+
+	for(unsigned int k = 0; k < iCount; k++) {
+		if(m_vParents[k] >= 0) {
+			m_vParents[k] = vNewIndex[m_vParents[k]];
+		}
+		m_vHandleToIndex[m_vHandles[k] & HANDLE_SLOT_MASK] = k;
+	}
+
+	m_bNeedsSort = false;
+}
+
+void FlatScene::compact(const std::vector<bool>& vRemove) {
+
+	unsigned int iCount = (unsigned int)m_vHandles.size();
+
+	std::vector<unsigned int> vKeep;
+	vKeep.reserve(iCount);
+	for(unsigned int i = 0; i < iCount; i++) {
+		if(!vRemove[i]) {
+			vKeep.push_back(i);
+			continue;
+		}
+
+		if(m_vModels[i]) {
+			m_vModels[i]->setNode(NULL);
+			SAFE_DELETE( m_vModels[i] );
+		}
+		SAFE_DELETE( m_vBindingNodes[i] );
+
+		m_vFreeHandles.push_back(m_vHandles[i]);
+	}
+
+	// A stable compaction keeps the parent-before-child order.
+	std::vector<int> vNewIndex(iCount, -1);
+	for(unsigned int k = 0; k < vKeep.size(); k++) {
+		vNewIndex[vKeep[k]] = k;
+	}
+
+	permute(m_vTranslations, vKeep);
+	permute(m_vRotations, vKeep);
+	permute(m_vScales, vKeep);
+	permute(m_vLocalMatrices, vKeep);
+	permute(m_vWorldMatrices, vKeep);
+	permute(m_vParents, vKeep);
+	permute(m_vModels, vKeep);
+	permute(m_vBindingNodes, vKeep);
+	permute(m_vFlags, vKeep);
+	permute(m_vHandles, vKeep);
+
+	for(unsigned int k = 0; k < vKeep.size(); k++) {
+		if(m_vParents[k] >= 0) {
+			m_vParents[k] = vNewIndex[m_vParents[k]];
+		}
+		m_vHandleToIndex[m_vHandles[k] & HANDLE_SLOT_MASK] = k;
+	}
+}
+
+FlatScene::~FlatScene() {
+	destroyAllNodes();
+}
@@ -0,0 +1,329 @@
+#include "Engine/GLStateCache.h"
+#include <cstring>
+
+bool								GLStateCache::m_bEnabled = true;
+GLStateCache::Counters				GLStateCache::m_Counters;
+
+GLuint								GLStateCache::m_hProgram = 0;
+bool								GLStateCache::m_bProgramKnown = false;
+GLStateCache::UniformTable*			GLStateCache::m_pUniforms = NULL;
+
+unsigned int						GLStateCache::m_iActiveUnit = 0;
+bool								GLStateCache::m_bActiveUnitKnown = false;
+GLuint								GLStateCache::m_hTextures[GLStateCache::MAX_TEXTURE_UNITS];
+bool								GLStateCache::m_bTextureKnown[GLStateCache::MAX_TEXTURE_UNITS];
+int									GLStateCache::m_iTexture2DEnabled[GLStateCache::MAX_TEXTURE_UNITS];
+
+int									GLStateCache::m_iCaps[GLStateCache::CAP_COUNT];
+GLenum								GLStateCache::m_eBlendSrc = GL_ONE;
+GLenum								GLStateCache::m_eBlendDst = GL_ZERO;
+bool								GLStateCache::m_bBlendFuncKnown = false;
+int									GLStateCache::m_iDepthMask = GLStateCache::STATE_UNKNOWN;
+
+std::map<GLuint, GLStateCache::UniformTable>	GLStateCache::m_mUniformTables;
+std::vector<GLStateCache::TextureParameters>	GLStateCache::m_vTextureParameters;
+
+unsigned int GLStateCache::Counters::getIssuedCount() const {
+
+	unsigned int iCount = 0;
+	for(unsigned int i = 0; i < CALL_TYPE_COUNT; i++) {
+		iCount += iIssued[i];
+	}
+	return iCount;
+}
+
+unsigned int GLStateCache::Counters::getFilteredCount() const {
+
+	unsigned int iCount = 0;
+	for(unsigned int i = 0; i < CALL_TYPE_COUNT; i++) {
+		iCount += iFiltered[i];
+	}
+	return iCount;
+}
+
+bool GLStateCache::filter(CallType eType, bool bRedundant) {
+
+	if(m_bEnabled && bRedundant) {
+		++m_Counters.iFiltered[eType];
+		return true;
+	}
+
+	++m_Counters.iIssued[eType];
+	return false;
+}
+
+void GLStateCache::useProgram(GLuint hProgram) {
+
+	if(filter(USE_PROGRAM, m_bProgramKnown && m_hProgram == hProgram))
+		return;
+
+	GL_ASSERT( glUseProgram(hProgram) );
+
+	m_hProgram = hProgram;
+	m_bProgramKnown = true;
+	m_pUniforms = (hProgram != 0) ? &m_mUniformTables[hProgram] : NULL;
+}
+
+void GLStateCache::activeTexture(unsigned int iUnit) {
+
+	GP_ASSERT( iUnit < MAX_TEXTURE_UNITS );
+
+	if(filter(ACTIVE_TEXTURE, m_bActiveUnitKnown && m_iActiveUnit == iUnit))
+		return;
+
+	GL_ASSERT( glActiveTexture(GL_TEXTURE0 + iUnit) );
+
+	m_iActiveUnit = iUnit;
+	m_bActiveUnitKnown = true;
+}
+
+void GLStateCache::bindTexture(GLenum eTarget, GLuint hTexture) {
+
+	// Only 2D bindings are shadowed, the other targets have their own
+	// binding point per unit.
+	bool bTracked = (eTarget == GL_TEXTURE_2D && m_bActiveUnitKnown);
+
+	if(filter(BIND_TEXTURE, bTracked && m_bTextureKnown[m_iActiveUnit] && m_hTextures[m_iActiveUnit] == hTexture))
+		return;
+
+	GL_ASSERT( glBindTexture(eTarget, hTexture) );
+
+	if(bTracked) {
+		m_hTextures[m_iActiveUnit] = hTexture;
+		m_bTextureKnown[m_iActiveUnit] = true;
+	}
+	else
+	if(eTarget == GL_TEXTURE_2D) {
+		// Went to a unit we don't know
+		memset(m_bTextureKnown, 0, sizeof(m_bTextureKnown));
+	}
+}
+
+int GLStateCache::getCapIndex(GLenum eCap) {
+
+	switch(eCap) {
+	case GL_BLEND:
+		return CAP_BLEND;
+	case GL_CULL_FACE:
+		return CAP_CULL_FACE;
+	case GL_DEPTH_TEST:
+		return CAP_DEPTH_TEST;
+	case GL_SCISSOR_TEST:
+		return CAP_SCISSOR_TEST;
+	default:
+		return -1;
+	}
+}
+
+void GLStateCache::setEnabled(GLenum eCap, bool bEnable) {
+
+	int iState = bEnable ? STATE_ON : STATE_OFF;
+
+	// GL_TEXTURE_2D is per texture unit, the rest is global
+	int* pState = NULL;
+	if(eCap == GL_TEXTURE_2D) {
+		if(m_bActiveUnitKnown)
+			pState = &m_iTexture2DEnabled[m_iActiveUnit];
+	}
+	else {
+		int iCap = getCapIndex(eCap);
+		if(iCap >= 0)
+			pState = &m_iCaps[iCap];
+	}
+
+	if(filter(ENABLE, pState && *pState == iState))
+		return;
+
+	if(bEnable)
+		GL_ASSERT( glEnable(eCap) );
+	else
+		GL_ASSERT( glDisable(eCap) );
+
+	if(pState) {
+		*pState = iState;
+	}
+	else
+	if(eCap == GL_TEXTURE_2D) {
+		memset(m_iTexture2DEnabled, 0, sizeof(m_iTexture2DEnabled));
+	}
+}
+
+void GLStateCache::blendFunc(GLenum eSrc, GLenum eDst) {
+
+	if(filter(BLEND_FUNC, m_bBlendFuncKnown && m_eBlendSrc == eSrc && m_eBlendDst == eDst))
+		return;
+
+	GL_ASSERT( glBlendFunc(eSrc, eDst) );
+
+	m_eBlendSrc = eSrc;
+	m_eBlendDst = eDst;
+	m_bBlendFuncKnown = true;
+}
+
+void GLStateCache::depthMask(bool bEnable) {
+
+	int iState = bEnable ? STATE_ON : STATE_OFF;
+
+	if(filter(DEPTH_MASK, m_iDepthMask == iState))
+		return;
+
+	GL_ASSERT( glDepthMask(bEnable ? GL_TRUE : GL_FALSE) );
+
+	m_iDepthMask = iState;
+}
+
+GLint* GLStateCache::getTextureParameter(GLuint hTexture, GLenum ePName) {
+
+	if(hTexture == 0)
+		return NULL;
+
+	// Texture names are small consecutive integers
+	if(hTexture >= m_vTextureParameters.size()) {
+		TextureParameters unknown = { 0, 0, 0, 0 };
+		m_vTextureParameters.resize(hTexture + 1, unknown);
+	}
+
+	TextureParameters& parameters = m_vTextureParameters[hTexture];
+	switch(ePName) {
+	case GL_TEXTURE_WRAP_S:
+		return &parameters.iWrapS;
+	case GL_TEXTURE_WRAP_T:
+		return &parameters.iWrapT;
+	case GL_TEXTURE_MIN_FILTER:
+		return &parameters.iMinFilter;
+	case GL_TEXTURE_MAG_FILTER:
+		return &parameters.iMagFilter;
+	default:
+		return NULL;
+	}
+}
+
+void GLStateCache::texParameter(GLenum eTarget, GLuint hTexture, GLenum ePName, GLint iValue) {
+
+	// 0 is never a valid value for the tracked parameters, it marks unknown.
+	GLint* pValue = getTextureParameter(hTexture, ePName);
+
+	if(filter(TEX_PARAMETER, pValue && *pValue == iValue))
+		return;
+
+	GL_ASSERT( glTexParameteri(eTarget, ePName, iValue) );
+
+	if(pValue) {
+		*pValue = iValue;
+	}
+}
+
+bool GLStateCache::uniformChanged(GLint iLocation, const void* pData, unsigned int iBytes, unsigned int iLocationCount) {
+
+	GP_ASSERT( pData );
+	GP_ASSERT( iLocationCount > 0 );
+
+	if(!m_bEnabled || m_pUniforms == NULL || iLocation < 0) {
+		++m_Counters.iIssued[UNIFORM];
+		return true;
+	}
+
+	UniformTable& table = *m_pUniforms;
+	if((unsigned int)iLocation + iLocationCount > table.size()) {
+		UniformSlot empty;
+		empty.iOwner = -1;
+		table.resize(iLocation + iLocationCount, empty);
+	}
+
+	UniformSlot& slot = table[iLocation];
+	if(	slot.iOwner == iLocation
+		&&
+		slot.vData.size() == iBytes
+		&&
+		memcmp(&slot.vData[0], pData, iBytes) == 0
+	) {
+		++m_Counters.iFiltered[UNIFORM];
+		return false;
+	}
+
+	// Arrays cover consecutive locations. A write into part of an array
+	// recorded earlier leaves that record stale.
+	for(GLint i = iLocation; i < iLocation + (GLint)iLocationCount; i++) {
+		GLint iOwner = table[i].iOwner;
+		if(iOwner >= 0 && iOwner != iLocation) {
+			table[iOwner].vData.clear();
+		}
+
+		table[i].iOwner = iLocation;
+		table[i].vData.clear();
+	}
+
+	const unsigned char* pBytes = (const unsigned char*)pData;
+	slot.vData.assign(pBytes, pBytes + iBytes);
+
+	++m_Counters.iIssued[UNIFORM];
+	return true;
+}
+
+void GLStateCache::programDeleted(GLuint hProgram) {
+
+	// The name may be handed out again for a new program
+	m_mUniformTables.erase(hProgram);
+
+	if(m_hProgram == hProgram) {
+		m_pUniforms = NULL;
+		m_bProgramKnown = false;
+	}
+}
+
+void GLStateCache::textureDeleted(GLuint hTexture) {
+
+	if(hTexture < m_vTextureParameters.size()) {
+		TextureParameters unknown = { 0, 0, 0, 0 };
+		m_vTextureParameters[hTexture] = unknown;
+	}
+
+	// Deleting a bound texture reverts its units to texture 0
+	for(unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++) {
+		if(m_bTextureKnown[i] && m_hTextures[i] == hTexture) {
+			m_hTextures[i] = 0;
+		}
+	}
+}
+
+void GLStateCache::invalidate() {
+
+	m_bProgramKnown = false;
+	m_pUniforms = NULL;
+	m_mUniformTables.clear();
+
+	m_bActiveUnitKnown = false;
+	memset(m_bTextureKnown, 0, sizeof(m_bTextureKnown));
+	memset(m_iTexture2DEnabled, 0, sizeof(m_iTexture2DEnabled));
+
+	memset(m_iCaps, 0, sizeof(m_iCaps));
+	m_bBlendFuncKnown = false;
+	m_iDepthMask = STATE_UNKNOWN;
+
+	m_vTextureParameters.clear();
+}
+
+void GLStateCache::setEnabled(bool bEnable) {
+
+	if(bEnable && !m_bEnabled) {
+		// Uniform writes are not recorded while disabled
+		invalidate();
+	}
+
+	m_bEnabled = bEnable;
+}
+
+bool GLStateCache::isEnabled() {
+	return m_bEnabled;
+}
+
+const GLStateCache::Counters& GLStateCache::getCounters() {
+	return m_Counters;
+}
+
+GLStateCache::Counters GLStateCache::resetCounters() {
+
+	Counters counters = m_Counters;
+	memset(&m_Counters, 0, sizeof(m_Counters));
+	return counters;
+}
@@ -0,0 +1,234 @@
+#include "Engine/GPURingBuffer.h"
+#include <cstring>
+
+// Nanoseconds to wait for a segment's fence per attempt
+#define FENCE_WAIT_TIMEOUT	1000000000ull
+
+unsigned int GPURingBuffer::m_iFrame = 0;
+
+GPURingBuffer::GPURingBuffer(GLenum eTarget, unsigned int iSegmentSize, unsigned int iSegmentCount)
+	:	m_eTarget(eTarget),
+		m_hBuffer(0),
+		m_iSegmentSize(iSegmentSize),
+		m_iSegmentCount(iSegmentCount),
+		m_iSegment(0),
+		m_iHead(0),
+		m_vFences(iSegmentCount, (GLsync)NULL),
+		m_iGeneration(0),
+		m_iOrphanCount(0),
+		m_iBegunFrame(m_iFrame),
+		m_bMapped(false)
+{
+
+}
+
+GPURingBuffer::~GPURingBuffer() {
+
+	GP_ASSERT( !m_bMapped );
+
+	deleteFences();
+
+	if(m_hBuffer) {
+		GL_ASSERT( glDeleteBuffers(1, &m_hBuffer) );
+		m_hBuffer = 0;
+	}
+}
+
+GPURingBuffer* GPURingBuffer::create(GLenum eTarget, unsigned int iSegmentSize, unsigned int iSegmentCount) {
+
+	GP_ASSERT( iSegmentSize > 0 );
+	GP_ASSERT( iSegmentCount > 0 );
+
+	GPURingBuffer* pRing = new GPURingBuffer(eTarget, iSegmentSize, iSegmentCount);
+
+	GL_ASSERT( glGenBuffers(1, &pRing->m_hBuffer) );
+	GL_ASSERT( glBindBuffer(eTarget, pRing->m_hBuffer) );
+	GL_ASSERT( glBufferData(eTarget, (GLsizeiptr)iSegmentSize * iSegmentCount, NULL, GL_STREAM_DRAW) );
+	GL_ASSERT( glBindBuffer(eTarget, 0) );
+
+	return pRing;
+}
+
+void GPURingBuffer::deleteFences() {
+
+	for(unsigned int i = 0; i < m_vFences.size(); i++) {
+		if(m_vFences[i]) {
+			GL_ASSERT( glDeleteSync(m_vFences[i]) );
+			m_vFences[i] = NULL;
+		}
+	}
+}
+
+void GPURingBuffer::advanceFrame() {
+	++m_iFrame;
+}
+
+void GPURingBuffer::beginFrame() {
+
+	GP_ASSERT( !m_bMapped );
+
+	// Already moved on this frame, the segment may hold ranges still to be drawn
+	if(m_iBegunFrame == m_iFrame)
+		return;
+	m_iBegunFrame = m_iFrame;
+
+	m_iSegment = (m_iSegment + 1) % m_iSegmentCount;
+	m_iHead = 0;
+
+	GLsync fence = m_vFences[m_iSegment];
+	if(fence) {
+		GLenum eResult;
+		do {
+			GL_ASSERT( eResult = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_TIMEOUT) );
+		} while(eResult == GL_TIMEOUT_EXPIRED);
+
+		GL_ASSERT( glDeleteSync(fence) );
+		m_vFences[m_iSegment] = NULL;
+	}
+	else
+	if(!GLEW_ARB_sync && m_iSegment == 0) {
+		// No fences, let the driver hand out fresh storage once per lap
+		orphan();
+	}
+}
+
+void GPURingBuffer::endFrame() {
+
+	if(!GLEW_ARB_sync || m_iHead == 0)
+		return;
+
+	// A fence still on the segment was placed earlier this frame, the new
+	// one signals after the draws since then too
+	if(m_vFences[m_iSegment]) {
+		GL_ASSERT( glDeleteSync(m_vFences[m_iSegment]) );
+	}
+	GL_ASSERT( m_vFences[m_iSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) );
+}
+
+void GPURingBuffer::orphan() {
+
+	GL_ASSERT( glBindBuffer(m_eTarget, m_hBuffer) );
+	GL_ASSERT( glBufferData(m_eTarget, (GLsizeiptr)m_iSegmentSize * m_iSegmentCount, NULL, GL_STREAM_DRAW) );
+
+	// The old storage stays alive for the draws still using it, the
+	// fences guarded ranges of it.
+	deleteFences();
+
+	m_iHead = 0;
+	++m_iGeneration;
+}
+
+void* GPURingBuffer::map(unsigned int iBytes, unsigned int iAlignment, unsigned int* pOffset) {
+
+	GP_ASSERT( !m_bMapped );
+	GP_ASSERT( iAlignment > 0 );
+	GP_ASSERT( pOffset );
+
+	if(iBytes == 0 || iBytes > m_iSegmentSize)
+		return NULL;
+
+	unsigned int iHead = ((m_iHead + iAlignment - 1) / iAlignment) * iAlignment;
+	if(iHead + iBytes > m_iSegmentSize) {
+		orphan();
+		++m_iOrphanCount;
+		iHead = 0;
+	}
+
+	unsigned int iOffset = m_iSegment * m_iSegmentSize + iHead;
+
+	GL_ASSERT( glBindBuffer(m_eTarget, m_hBuffer) );
+
+	void* pData;
+	GL_ASSERT( pData = glMapBufferRange(m_eTarget, iOffset, iBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT) );
+	if(pData == NULL)
+		return NULL;
+
+	m_iHead = iHead + iBytes;
+	m_bMapped = true;
+	*pOffset = iOffset;
+
+	return pData;
+}
+
+void GPURingBuffer::unmap() {
+
+	GP_ASSERT( m_bMapped );
+
+	GL_ASSERT( glBindBuffer(m_eTarget, m_hBuffer) );
+	GL_ASSERT( glUnmapBuffer(m_eTarget) );
+	m_bMapped = false;
+}
+
+bool GPURingBuffer::write(const void* pData, unsigned int iBytes, unsigned int iAlignment, unsigned int* pOffset) {
+
+	GP_ASSERT( pData );
+
+	void* pDst = map(iBytes, iAlignment, pOffset);
+	if(pDst == NULL)
+		return false;
+
+	memcpy(pDst, pData, iBytes);
+	unmap();
+
+	return true;
+}
+
+unsigned int GPURingBuffer::adopt(const GPURingBuffer* pSource, unsigned int iOffset, unsigned int iBytes) {
+
+	GP_ASSERT( pSource );
+	GP_ASSERT( !pSource->m_bMapped );
+	GP_ASSERT( !m_bMapped );
+	GP_ASSERT( m_iHead == 0 );
+	GP_ASSERT( iBytes <= m_iSegmentSize );
+
+	unsigned int iDstOffset = m_iSegment * m_iSegmentSize;
+	if(iBytes == 0)
+		return iDstOffset;
+
+	if(GLEW_ARB_copy_buffer) {
+		GL_ASSERT( glBindBuffer(GL_COPY_READ_BUFFER, pSource->m_hBuffer) );
+		GL_ASSERT( glBindBuffer(GL_COPY_WRITE_BUFFER, m_hBuffer) );
+		GL_ASSERT( glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, iOffset, iDstOffset, iBytes) );
+		GL_ASSERT( glBindBuffer(GL_COPY_READ_BUFFER, 0) );
+		GL_ASSERT( glBindBuffer(GL_COPY_WRITE_BUFFER, 0) );
+	}
+	else {
+		// Reading back waits for the GPU, only without ARB_copy_buffer
+		std::vector<unsigned char> vData(iBytes);
+		GL_ASSERT( glBindBuffer(pSource->m_eTarget, pSource->m_hBuffer) );
+		GL_ASSERT( glGetBufferSubData(pSource->m_eTarget, iOffset, iBytes, &vData[0]) );
+		GL_ASSERT( glBindBuffer(m_eTarget, m_hBuffer) );
+		GL_ASSERT( glBufferSubData(m_eTarget, iDstOffset, iBytes, &vData[0]) );
+	}
+
+	m_iHead = iBytes;
+	return iDstOffset;
+}
+
+bool GPURingBuffer::fits(unsigned int iBytes, unsigned int iAlignment) const {
+
+	GP_ASSERT( iAlignment > 0 );
+
+	unsigned int iHead = ((m_iHead + iAlignment - 1) / iAlignment) * iAlignment;
+	return iHead + iBytes <= m_iSegmentSize;
+}
+
+GLuint GPURingBuffer::getBuffer() const {
+	return m_hBuffer;
+}
+
+GLenum GPURingBuffer::getTarget() const {
+	return m_eTarget;
+}
+
+unsigned int GPURingBuffer::getSegmentSize() const {
+	return m_iSegmentSize;
+}
+
+unsigned int GPURingBuffer::getGeneration() const {
+	return m_iGeneration;
+}
+
+unsigned int GPURingBuffer::getOrphanCount() const {
+	return m_iOrphanCount;
+}
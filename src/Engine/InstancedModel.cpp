@@ -0,0 +1,407 @@
+#include "Engine/InstancedModel.h"
+#include "Engine/Model.h"
+#include "Engine/Mesh.h"
+#include "Engine/MeshPart.h"
+#include "Engine/Material.h"
+#include "Engine/Technique.h"
+#include "Engine/Pass.h"
+#include "Engine/Effect.h"
+#include "Engine/VertexAttributeBinding.h"
+#include <cstring>
+#include <cstddef>
+
+static bool isListPrimitive(GLenum ePrimitiveType) {
+	return ePrimitiveType == GL_TRIANGLES || ePrimitiveType == GL_LINES || ePrimitiveType == GL_POINTS;
+}
+
+InstancedModel::InstancedModel(Model* pModel, unsigned int iMaxInstances, bool bHardware)
+	:	m_pModel(pModel),
+		m_iMaxInstances(iMaxInstances),
+		m_iInstanceCount(0),
+		m_bHardware(bHardware),
+		m_hInstanceVBO(0),
+		m_bMergeDirty(false)
+{
+	m_vInstances.reserve(iMaxInstances);
+}
+
+InstancedModel::~InstancedModel() {
+
+	for(unsigned int i = 0; i < m_vBindings.size(); i++) {
+		SAFE_DELETE( m_vBindings[i].pBinding );
+	}
+	m_vBindings.clear();
+
+	if(m_hInstanceVBO) {
+		GL_ASSERT( glDeleteBuffers(1, &m_hInstanceVBO) );
+		m_hInstanceVBO = 0;
+	}
+}
+
+InstancedModel* InstancedModel::create(Model* pModel, unsigned int iMaxInstances) {
+
+	GP_ASSERT( pModel );
+	GP_ASSERT( iMaxInstances > 0 );
+
+	InstancedModel* pInstancedModel = new InstancedModel(pModel, iMaxInstances, isHardwareInstancingSupported());
+
+	if(pInstancedModel->m_bHardware) {
+		GL_ASSERT( glGenBuffers(1, &pInstancedModel->m_hInstanceVBO) );
+		GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, pInstancedModel->m_hInstanceVBO) );
+		GL_ASSERT( glBufferData(GL_ARRAY_BUFFER, iMaxInstances * sizeof(Instance), NULL, GL_STREAM_DRAW) );
+		GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+	}
+	else {
+		pInstancedModel->readSource();
+	}
+
+	return pInstancedModel;
+}
+
+bool InstancedModel::isHardwareInstancingSupported() {
+	return GLEW_ARB_instanced_arrays && GLEW_ARB_draw_instanced;
+}
+
+Model* InstancedModel::getModel() const {
+	return m_pModel;
+}
+
+unsigned int InstancedModel::getMaxInstances() const {
+	return m_iMaxInstances;
+}
+
+unsigned int InstancedModel::getInstanceCount() const {
+	return m_iInstanceCount;
+}
+
+bool InstancedModel::isHardwareInstanced() const {
+	return m_bHardware;
+}
+
+void InstancedModel::setInstances(const Matrix4* pWorldMatrices, const Vector4* pColors, unsigned int iCount) {
+
+	GP_ASSERT( pWorldMatrices || iCount == 0 );
+
+	m_iInstanceCount = std::min(iCount, m_iMaxInstances);
+	m_vInstances.resize(m_iInstanceCount);
+
+	for(unsigned int i = 0; i < m_iInstanceCount; i++) {
+		Instance& instance = m_vInstances[i];
+		memcpy(instance.world, pWorldMatrices[i].m, sizeof(instance.world));
+
+		const Vector4& color = pColors ? pColors[i] : Vector4::one();
+		instance.color[0] = color.x;
+		instance.color[1] = color.y;
+		instance.color[2] = color.z;
+		instance.color[3] = color.w;
+	}
+
+	if(m_iInstanceCount == 0)
+		return;
+
+	if(m_bHardware) {
+		// Orphan the previous contents, draws still reading them keep their copy
+		GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, m_hInstanceVBO) );
+		GL_ASSERT( glBufferData(GL_ARRAY_BUFFER, m_iMaxInstances * sizeof(Instance), NULL, GL_STREAM_DRAW) );
+		GL_ASSERT( glBufferSubData(GL_ARRAY_BUFFER, 0, m_iInstanceCount * sizeof(Instance), &m_vInstances[0]) );
+		GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+	}
+	else {
+		m_bMergeDirty = true;
+	}
+}
+
+VertexAttributeBinding* InstancedModel::getBinding(Pass* pPass) {
+
+	GP_ASSERT( pPass );
+	Effect* pEffect = pPass->getEffect();
+
+	PassBinding* pPassBinding = NULL;
+	for(unsigned int i = 0; i < m_vBindings.size(); i++) {
+		if(m_vBindings[i].pPass == pPass) {
+			pPassBinding = &m_vBindings[i];
+			break;
+		}
+	}
+
+	if(pPassBinding && pPassBinding->pEffect == pEffect)
+		return pPassBinding->pBinding;
+
+	Mesh* pMesh = m_pModel->getMesh();
+	VertexAttributeBinding* pBinding = NULL;
+
+	if(m_bHardware) {
+		pBinding = VertexAttributeBinding::createUnique(pMesh, pEffect);
+		if(pBinding) {
+			pBinding->setStreamAttribute(VERTEX_ATTRIBUTE_INSTANCE_WORLD_NAME, m_hInstanceVBO, 4, 4, sizeof(Instance), (const void*)offsetof(Instance, world), 1);
+			pBinding->setStreamAttribute(VERTEX_ATTRIBUTE_INSTANCE_COLOR_NAME, m_hInstanceVBO, 4, 1, sizeof(Instance), (const void*)offsetof(Instance, color), 1);
+		}
+	}
+	else {
+		pBinding = VertexAttributeBinding::create(pMesh->getVertexFormat(), &m_vMergedVertices[0], pEffect);
+		if(pBinding) {
+			pBinding->setStreamAttribute(VERTEX_ATTRIBUTE_INSTANCE_COLOR_NAME, 0, 4, 1, 0, &m_vMergedColors[0], 0);
+		}
+	}
+
+	if(pPassBinding) {
+		SAFE_DELETE( pPassBinding->pBinding );
+		pPassBinding->pEffect = pEffect;
+		pPassBinding->pBinding = pBinding;
+	}
+	else {
+		PassBinding passBinding;
+		passBinding.pPass = pPass;
+		passBinding.pEffect = pEffect;
+		passBinding.pBinding = pBinding;
+		m_vBindings.push_back(passBinding);
+	}
+
+	return pBinding;
+}
+
+void InstancedModel::draw() {
+
+	if(m_iInstanceCount == 0)
+		return;
+
+	if(m_bMergeDirty) {
+		merge();
+	}
+
+	unsigned int iPartCount = m_pModel->getMeshPartCount();
+
+	// Same part and pass walk as Model::draw()
+	for(int iPart = (iPartCount == 0) ? -1 : 0; iPart < (int)iPartCount; iPart++) {
+
+		Material* pMaterial = m_pModel->getMaterial(iPart);
+		if(pMaterial == NULL)
+			continue;
+
+		Technique* pTechnique = pMaterial->getTechnique();
+		GP_ASSERT( pTechnique );
+
+		for(unsigned int i = 0, iPassCount = pTechnique->getPassCount(); i < iPassCount; i++) {
+
+			Pass* pPass = pTechnique->getPassByIndex(i);
+			GP_ASSERT( pPass );
+
+			VertexAttributeBinding* pBinding = getBinding(pPass);
+			pPass->bind(pBinding);
+
+			if(!m_bHardware) {
+				// Merged vertices are already in world space
+				::VertexAttribute attrib = pPass->getEffect()->getVertexAttribute(VERTEX_ATTRIBUTE_INSTANCE_WORLD_NAME);
+				if(attrib != -1) {
+					for(unsigned int c = 0; c < 4; c++) {
+						GL_ASSERT( glVertexAttrib4f(attrib + c, (c == 0) ? 1.0f : 0.0f, (c == 1) ? 1.0f : 0.0f, (c == 2) ? 1.0f : 0.0f, (c == 3) ? 1.0f : 0.0f) );
+					}
+				}
+			}
+
+			drawPart(iPart);
+			pPass->unbind(pBinding);
+		}
+	}
+}
+
+void InstancedModel::drawPart(int iPartIndex) {
+
+	Mesh* pMesh = m_pModel->getMesh();
+	unsigned int iVertexCount = pMesh->getVertexCount();
+
+	if(m_bHardware) {
+		if(iPartIndex < 0) {
+			GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
+			GL_ASSERT( glDrawArraysInstancedARB(pMesh->getPrimitiveType(), 0, iVertexCount, m_iInstanceCount) );
+			return;
+		}
+
+		MeshPart* pMeshPart = pMesh->getMeshPart(iPartIndex);
+		GP_ASSERT( pMeshPart );
+
+		GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pMeshPart->getIndexBuffer()) );
+		GL_ASSERT( glDrawElementsInstancedARB(pMeshPart->getPrimitiveType(), pMeshPart->getIndexCount(), pMeshPart->getIndexFormat(), 0, m_iInstanceCount) );
+		GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
+		return;
+	}
+
+	// Merged batch, strips cannot be joined and take one draw per instance
+	GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
+
+	if(iPartIndex < 0) {
+		GLenum ePrimitiveType = pMesh->getPrimitiveType();
+		if(isListPrimitive(ePrimitiveType)) {
+			GL_ASSERT( glDrawArrays(ePrimitiveType, 0, iVertexCount * m_iInstanceCount) );
+		}
+		else {
+			for(unsigned int i = 0; i < m_iInstanceCount; i++) {
+				GL_ASSERT( glDrawArrays(ePrimitiveType, i * iVertexCount, iVertexCount) );
+			}
+		}
+		return;
+	}
+
+	MeshPart* pMeshPart = pMesh->getMeshPart(iPartIndex);
+	GP_ASSERT( pMeshPart );
+
+	GLenum ePrimitiveType = pMeshPart->getPrimitiveType();
+	unsigned int iIndexCount = m_vPartIndexCounts[iPartIndex];
+	const std::vector<unsigned int>& vIndices = m_vMergedIndices[iPartIndex];
+	if(iIndexCount == 0)
+		return;
+
+	if(isListPrimitive(ePrimitiveType)) {
+		GL_ASSERT( glDrawElements(ePrimitiveType, iIndexCount * m_iInstanceCount, GL_UNSIGNED_INT, &vIndices[0]) );
+	}
+	else {
+		for(unsigned int i = 0; i < m_iInstanceCount; i++) {
+			GL_ASSERT( glDrawElements(ePrimitiveType, iIndexCount, GL_UNSIGNED_INT, &vIndices[i * iIndexCount]) );
+		}
+	}
+}
+
+void InstancedModel::readSource() {
+
+	Mesh* pMesh = m_pModel->getMesh();
+	unsigned int iVertexCount = pMesh->getVertexCount();
+	unsigned int iVertexFloats = pMesh->getVertexSize() / sizeof(float);
+
+	// Mesh data only lives in its buffers, read it back once
+	m_vSourceVertices.resize(iVertexCount * iVertexFloats);
+	if(iVertexCount > 0) {
+		GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, pMesh->getVertexBuffer()) );
+		GL_ASSERT( glGetBufferSubData(GL_ARRAY_BUFFER, 0, iVertexCount * pMesh->getVertexSize(), &m_vSourceVertices[0]) );
+		GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+	}
+
+	m_vMergedVertices.resize(std::max(1u, m_iMaxInstances * iVertexCount * iVertexFloats));
+	m_vMergedColors.resize(std::max(1u, m_iMaxInstances * iVertexCount * 4));
+
+	// Indices only depend on the instance slot, offset them for every slot now
+	unsigned int iPartCount = pMesh->getMeshPartCount();
+	m_vMergedIndices.resize(iPartCount);
+	m_vPartIndexCounts.resize(iPartCount);
+
+	std::vector<unsigned char> vIndexData;
+	for(unsigned int iPart = 0; iPart < iPartCount; iPart++) {
+
+		MeshPart* pMeshPart = pMesh->getMeshPart(iPart);
+		GP_ASSERT( pMeshPart );
+
+		unsigned int iIndexCount = pMeshPart->getIndexCount();
+		unsigned int iIndexSize = 0;
+		switch(pMeshPart->getIndexFormat()) {
+		case Mesh::INDEX8:
+			iIndexSize = 1;
+			break;
+		case Mesh::INDEX16:
+			iIndexSize = 2;
+			break;
+		case Mesh::INDEX32:
+			iIndexSize = 4;
+			break;
+		}
+
+		if(iIndexCount == 0 || iIndexSize == 0) {
+			m_vPartIndexCounts[iPart] = 0;
+			continue;
+		}
+
+		vIndexData.resize(iIndexCount * iIndexSize);
+		GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pMeshPart->getIndexBuffer()) );
+		GL_ASSERT( glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, iIndexCount * iIndexSize, &vIndexData[0]) );
+		GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
+
+		std::vector<unsigned int>& vIndices = m_vMergedIndices[iPart];
+		vIndices.resize(m_iMaxInstances * iIndexCount);
+		m_vPartIndexCounts[iPart] = iIndexCount;
+
+		for(unsigned int k = 0; k < iIndexCount; k++) {
+			unsigned int iIndex;
+			switch(iIndexSize) {
+			case 1:
+				iIndex = vIndexData[k];
+				break;
+			case 2:
+				iIndex = ((unsigned short*)&vIndexData[0])[k];
+				break;
+			default:
+				iIndex = ((unsigned int*)&vIndexData[0])[k];
+				break;
+			}
+
+			for(unsigned int i = 0; i < m_iMaxInstances; i++) {
+				vIndices[i * iIndexCount + k] = iIndex + i * iVertexCount;
+			}
+		}
+	}
+}
+
+void InstancedModel::merge() {
+
+	m_bMergeDirty = false;
+
+	Mesh* pMesh = m_pModel->getMesh();
+	const VertexFormat& vertexFormat = pMesh->getVertexFormat();
+	unsigned int iVertexCount = pMesh->getVertexCount();
+	unsigned int iVertexFloats = vertexFormat.getVertexSize() / sizeof(float);
+
+	for(unsigned int i = 0; i < m_iInstanceCount; i++) {
+
+		const Instance& instance = m_vInstances[i];
+		const float* m = instance.world;
+
+		Matrix4 normalMatrix(instance.world);
+		normalMatrix.invert(&normalMatrix);
+		normalMatrix.transpose();
+
+		float* pDst = &m_vMergedVertices[i * iVertexCount * iVertexFloats];
+		memcpy(pDst, &m_vSourceVertices[0], iVertexCount * iVertexFloats * sizeof(float));
+
+		for(unsigned int v = 0; v < iVertexCount; v++, pDst += iVertexFloats) {
+
+			for(unsigned int e = 0, iElementCount = vertexFormat.getElementCount(); e < iElementCount; e++) {
+
+				// Packed elements are merged as they are
+				const VertexFormat::Element& element = vertexFormat.getElement(e);
+				if(element.dataType != VertexFormat::FLOAT)
+					continue;
+
+				float* p = (float*)((unsigned char*)pDst + vertexFormat.getElementOffset(e));
+
+				switch(element.type) {
+				case VertexFormat::POSITION:
+					{
+						float x = p[0], y = p[1], z = (element.size > 2) ? p[2] : 0.0f, w = (element.size > 3) ? p[3] : 1.0f;
+						p[0] = m[0]*x + m[1]*y + m[2]*z + m[3]*w;
+						p[1] = m[4]*x + m[5]*y + m[6]*z + m[7]*w;
+						if(element.size > 2)
+							p[2] = m[8]*x + m[9]*y + m[10]*z + m[11]*w;
+						if(element.size > 3)
+							p[3] = m[12]*x + m[13]*y + m[14]*z + m[15]*w;
+					}
+					break;
+				case VertexFormat::NORMAL:
+				case VertexFormat::TANGENT:
+				case VertexFormat::BINORMAL:
+					if(element.size >= 3) {
+						Vector3 n = normalMatrix * Vector3(p[0], p[1], p[2]);
+						n.normalize();
+						p[0] = n.x;
+						p[1] = n.y;
+						p[2] = n.z;
+					}
+					break;
+				default:
+					break;
+				}
+			}
+		}
+
+		float* pColor = &m_vMergedColors[i * iVertexCount * 4];
+		for(unsigned int v = 0; v < iVertexCount; v++, pColor += 4) {
+			memcpy(pColor, instance.color, sizeof(instance.color));
+		}
+	}
+}
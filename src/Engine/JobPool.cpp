@@ -0,0 +1,110 @@
+#include "Engine/JobPool.h"
+
+JobPool::JobPool(unsigned int iThreadCount)
+	:	m_iGeneration(0),
+		m_iBusyWorkers(0),
+		m_bQuit(false),
+		m_pFunction(NULL),
+		m_pContext(NULL),
+		m_iJobCount(0),
+		m_iNextJob(0)
+{
+	// The calling thread is the first one
+	for(unsigned int i = 1; i < iThreadCount; i++) {
+		m_vThreads.push_back(std::thread(&JobPool::workerMain, this));
+	}
+}
+
+JobPool::~JobPool() {
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_bQuit = true;
+	}
+	m_WakeCondition.notify_all();
+
+	for(unsigned int i = 0; i < m_vThreads.size(); i++) {
+		m_vThreads[i].join();
+	}
+	m_vThreads.clear();
+}
+
+JobPool* JobPool::create(unsigned int iThreadCount) {
+
+	GP_ASSERT( iThreadCount > 0 );
+	return new JobPool(iThreadCount);
+}
+
+unsigned int JobPool::getHardwareThreadCount() {
+
+	unsigned int iCount = std::thread::hardware_concurrency();
+	return (iCount > 0) ? iCount : 1;
+}
+
+unsigned int JobPool::getThreadCount() const {
+	return m_vThreads.size() + 1;
+}
+
+void JobPool::run(JobFunction pFunction, void* pContext, unsigned int iJobCount) {
+
+	GP_ASSERT( pFunction );
+
+	if(m_vThreads.empty() || iJobCount <= 1) {
+		for(unsigned int i = 0; i < iJobCount; i++) {
+			pFunction(pContext, i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_pFunction = pFunction;
+		m_pContext = pContext;
+		m_iJobCount = iJobCount;
+		m_iNextJob = 0;
+		m_iBusyWorkers = m_vThreads.size();
+		m_iGeneration++;
+	}
+	m_WakeCondition.notify_all();
+
+	execute();
+
+	// Every worker checks in, even those that found no job left
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	while(m_iBusyWorkers > 0) {
+		m_DoneCondition.wait(lock);
+	}
+}
+
+void JobPool::workerMain() {
+
+	unsigned int iGeneration = 0;
+	while(true) {
+
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			while(!m_bQuit && m_iGeneration == iGeneration) {
+				m_WakeCondition.wait(lock);
+			}
+
+			if(m_bQuit)
+				return;
+			iGeneration = m_iGeneration;
+		}
+
+		execute();
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if(--m_iBusyWorkers == 0) {
+			m_DoneCondition.notify_one();
+		}
+	}
+}
+
+void JobPool::execute() {
+
+	unsigned int iJob;
+	while((iJob = m_iNextJob++) < m_iJobCount) {
+		m_pFunction(m_pContext, iJob);
+	}
+}
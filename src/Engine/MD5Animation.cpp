@@ -1,23 +1,160 @@
 #include "Engine/MD5Animation.h"
 #include "Common/RandomAccessFile.h"
 #include "Engine/MD5Model.h"
+#include "Engine/MD5Binary.h"
+#include "Engine/MappedFile.h"
+
+static std::map<std::string, MD5Animation*>	__animationCache;
+
+// Baked md5anim payload: BinaryAnimInfo, a BinaryJointInfo per joint, a
+// BinaryBound per frame, then the clip's getData()
+struct BinaryAnimInfo {
+	int				iNumJoints;
+	int				iNumFrames;
+	int				iFrameRate;
+	unsigned int	iFormat;
+	unsigned int	iNumBounds;
+	float			vPositionMin[3];
+	float			vPositionScale[3];
+};
+
+struct BinaryJointInfo {
+	char			sName[MD5_BINARY_NAME_SIZE];
+	int				iParentID;
+	int				iFlags;
+	int				iStartIndex;
+};
+
+struct BinaryBound {
+	float			vMin[3];
+	float			vMax[3];
+};
 
 MD5Animation::MD5Animation()
-	: m_iMD5Version(0)
+	: m_pClip(NULL)
+	,  m_pMapping(NULL)
+	,  m_iRefCount(1)
+	,  m_iMD5Version(0)
 	,  m_iNumFrames(0)
 	,  m_iNumJoints(0)
 	,  m_iFrameRate(0)
 	,  m_iNumAnimatedComponents(0)
 	,  m_fAnimDuration(0.0f)
 	,  m_fFrameDuration(0.0f)
-	,  m_fAnimTime(0.0f)
 {
-	m_pAnimatedSkeleton = new FrameSkeleton();
 }
 
-MD5Animation::~MD5Animation() {}
+MD5Animation::~MD5Animation() {
 
-bool MD5Animation::loadAnimation(const char* sFileName) {
+	// Remove this animation from the cache.
+	if( !m_sCacheKey.empty() ) {
+		__animationCache.erase(m_sCacheKey);
+	}
+
+	clear();
+}
+
+MD5Animation* MD5Animation::create(const char* sFileName, AnimationClip::Format eFormat) {
+
+	GP_ASSERT( sFileName );
+
+	// The same file baked in another format is another animation
+	std::string sCacheKey = sFileName;
+	sCacheKey += (eFormat == AnimationClip::FORMAT_FLOAT) ? ";float" : ";quantized";
+
+	std::map<std::string, MD5Animation*>::iterator itr = __animationCache.find(sCacheKey);
+	if(itr != __animationCache.end()) {
+
+		MD5Animation* pAnimation = itr->second;
+		GP_ASSERT( pAnimation );
+		pAnimation->addRef();
+
+		return pAnimation;
+	}
+
+	// The baked file when it is up to date, otherwise the text baked anew
+	MD5Animation* pAnimation = new MD5Animation();
+	if( !pAnimation->loadBinary(sFileName, eFormat) ) {
+
+		if( !pAnimation->loadAnimation(sFileName, eFormat) || pAnimation->m_pClip == NULL ) {
+
+			SAFE_DELETE( pAnimation );
+			return NULL;
+		}
+		pAnimation->writeBinary(sFileName);
+	}
+
+	// Store this animation in the cache.
+	pAnimation->m_sCacheKey = sCacheKey;
+	__animationCache[sCacheKey] = pAnimation;
+
+	return pAnimation;
+}
+
+void MD5Animation::addRef() {
+	m_iRefCount++;
+}
+
+void MD5Animation::release() {
+
+	GP_ASSERT( m_iRefCount > 0 );
+	if( --m_iRefCount == 0 ) {
+		delete this;
+	}
+}
+
+bool MD5Animation::getBounds(float fTime, BoundingBox* pBox) const {
+
+	GP_ASSERT( pBox );
+
+	unsigned int iCount = m_vBounds.size();
+	if(iCount == 0 || m_fAnimDuration <= 0.0f)
+		return false;
+
+	float fWrapped = fmodf(fTime, m_fAnimDuration);
+	if(fWrapped < 0.0f) {
+		fWrapped += m_fAnimDuration;
+	}
+
+	unsigned int iFrame0 = std::min((unsigned int)(fWrapped * m_iFrameRate), iCount - 1);
+	unsigned int iFrame1 = (iFrame0 + 1 == iCount) ? 0 : iFrame0 + 1;
+
+	pBox->set(m_vBounds[iFrame0]->m_vMin, m_vBounds[iFrame0]->m_vMax);
+	pBox->merge(BoundingBox(m_vBounds[iFrame1]->m_vMin, m_vBounds[iFrame1]->m_vMax));
+	return true;
+}
+
+void MD5Animation::clear() {
+
+	for(unsigned int i = 0; i < m_vJointInfos.size(); i++) {
+		SAFE_DELETE( m_vJointInfos[i] );
+	}
+	for(unsigned int i = 0; i < m_vBounds.size(); i++) {
+		SAFE_DELETE( m_vBounds[i] );
+	}
+	for(unsigned int i = 0; i < m_vBaseFrames.size(); i++) {
+		SAFE_DELETE( m_vBaseFrames[i] );
+	}
+	for(unsigned int i = 0; i < m_vFrames.size(); i++) {
+		SAFE_DELETE( m_vFrames[i] );
+	}
+	for(unsigned int i = 0; i < m_vSkeletons.size(); i++) {
+		for(unsigned int j = 0; j < m_vSkeletons[i]->m_Joints.size(); j++) {
+			SAFE_DELETE( m_vSkeletons[i]->m_Joints[j] );
+		}
+		SAFE_DELETE( m_vSkeletons[i] );
+	}
+
+	m_vJointInfos.clear();
+	m_vBounds.clear();
+	m_vBaseFrames.clear();
+	m_vFrames.clear();
+	m_vSkeletons.clear();
+	SAFE_DELETE( m_pClip );
+	SAFE_DELETE( m_pMapping );
+}
+
+bool MD5Animation::loadAnimation(const char* sFileName, AnimationClip::Format eFormat) {
 
 	GP_ASSERT( sFileName );
 
@@ -25,11 +162,7 @@ bool MD5Animation::loadAnimation(const char* sFileName) {
 	bool bCanOpen = pRafIn->openForRead(sFileName);
 
 	if(bCanOpen) {
-		m_vJointInfos.clear();
-		m_vBounds.clear();
-		m_vBaseFrames.clear();
-		m_vFrames.clear();
-		m_pAnimatedSkeleton->m_Joints.clear();
+		clear();
 		m_iNumFrames = 0;
 
 		CCString singleLine;
@@ -143,12 +276,10 @@ bool MD5Animation::loadAnimation(const char* sFileName) {
 		}
 	}
 
-	// Make sure there are enough joints for the animated skeleton.
-	m_pAnimatedSkeleton = m_vSkeletons[0];
-
 	m_fFrameDuration = 1.0f / (float)m_iFrameRate;
 	m_fAnimDuration = m_fFrameDuration * (float)m_iNumFrames;
-	m_fAnimTime = 0.0f;
+
+	bakeClip( eFormat );
 
 	pRafIn->close();
 	SAFE_DELETE( pRafIn );
@@ -156,6 +287,121 @@ bool MD5Animation::loadAnimation(const char* sFileName) {
 	return true;
 }
 
+bool MD5Animation::loadBinary(const char* sFileName, AnimationClip::Format eFormat) {
+
+	MappedFile* pFile = MD5Binary::open(sFileName, MD5_BINARY_ANIM_MAGIC);
+	if(pFile == NULL)
+		return false;
+
+	MD5Binary::Reader reader(pFile->getData() + sizeof(MD5Binary::Header), pFile->getSize() - sizeof(MD5Binary::Header));
+	const BinaryAnimInfo* pInfo = reader.read<BinaryAnimInfo>();
+
+	// Baked in another format, the text is baked again in this one
+	if(pInfo == NULL || pInfo->iFormat != (unsigned int)eFormat || pInfo->iNumJoints <= 0 || pInfo->iNumFrames <= 0 || pInfo->iFrameRate <= 0) {
+		SAFE_DELETE( pFile );
+		return false;
+	}
+
+	const BinaryJointInfo* pJointInfos = reader.read<BinaryJointInfo>(pInfo->iNumJoints);
+	const BinaryBound* pBounds = reader.read<BinaryBound>(pInfo->iNumBounds);
+
+	const unsigned char* pClipData = reader.read<unsigned char>(AnimationClip::getDataSize(pInfo->iNumJoints, pInfo->iNumFrames, eFormat));
+
+	if(!reader.isValid()) {
+		SAFE_DELETE( pFile );
+		return false;
+	}
+
+	clear();
+
+	m_iMD5Version = 10;
+	m_iNumJoints = pInfo->iNumJoints;
+	m_iNumFrames = pInfo->iNumFrames;
+	m_iFrameRate = pInfo->iFrameRate;
+	m_fFrameDuration = 1.0f / (float)m_iFrameRate;
+	m_fAnimDuration = m_fFrameDuration * (float)m_iNumFrames;
+
+	for(int i = 0; i < m_iNumJoints; i++) {
+
+		JointInfo* pJointInfo = new JointInfo();
+		pJointInfo->m_sName = pJointInfos[i].sName;
+		pJointInfo->m_iParentID = pJointInfos[i].iParentID;
+		pJointInfo->m_iFlags = pJointInfos[i].iFlags;
+		pJointInfo->m_iStartIndex = pJointInfos[i].iStartIndex;
+		m_vJointInfos.push_back(pJointInfo);
+	}
+
+	for(unsigned int i = 0; i < pInfo->iNumBounds; i++) {
+
+		Bound* pBound = new Bound();
+		pBound->m_vMin = Vector3(pBounds[i].vMin[0], pBounds[i].vMin[1], pBounds[i].vMin[2]);
+		pBound->m_vMax = Vector3(pBounds[i].vMax[0], pBounds[i].vMax[1], pBounds[i].vMax[2]);
+		m_vBounds.push_back(pBound);
+	}
+
+	// The poses stay in the mapped file
+	Vector3 vPositionMin(pInfo->vPositionMin[0], pInfo->vPositionMin[1], pInfo->vPositionMin[2]);
+	Vector3 vPositionScale(pInfo->vPositionScale[0], pInfo->vPositionScale[1], pInfo->vPositionScale[2]);
+	m_pClip = AnimationClip::createInPlace(m_iNumJoints, m_iNumFrames, (float)m_iFrameRate, eFormat, vPositionMin, vPositionScale, pClipData);
+	m_pMapping = pFile;
+
+	return true;
+}
+
+bool MD5Animation::writeBinary(const char* sFileName) const {
+
+	if(m_pClip == NULL || !MD5Binary::isEnabled())
+		return false;
+
+	const Vector3& vPositionMin = m_pClip->getPositionMin();
+	const Vector3& vPositionScale = m_pClip->getPositionScale();
+
+	BinaryAnimInfo info;
+	info.iNumJoints = m_pClip->getJointCount();
+	info.iNumFrames = m_pClip->getFrameCount();
+	info.iFrameRate = m_iFrameRate;
+	info.iFormat = (unsigned int)m_pClip->getFormat();
+	info.iNumBounds = m_vBounds.size();
+	info.vPositionMin[0] = vPositionMin.x;
+	info.vPositionMin[1] = vPositionMin.y;
+	info.vPositionMin[2] = vPositionMin.z;
+	info.vPositionScale[0] = vPositionScale.x;
+	info.vPositionScale[1] = vPositionScale.y;
+	info.vPositionScale[2] = vPositionScale.z;
+
+	std::vector<unsigned char> vPayload;
+	vPayload.reserve(sizeof(BinaryAnimInfo) + m_vJointInfos.size() * sizeof(BinaryJointInfo) + m_vBounds.size() * sizeof(BinaryBound) + m_pClip->getDataSize());
+	MD5Binary::append(vPayload, &info);
+
+	for(unsigned int i = 0; i < m_vJointInfos.size(); i++) {
+
+		JointInfo* pJointInfo = m_vJointInfos[i];
+		BinaryJointInfo binaryJointInfo;
+		memset(binaryJointInfo.sName, 0, sizeof(binaryJointInfo.sName));
+		strncpy(binaryJointInfo.sName, pJointInfo->m_sName.c_str(), MD5_BINARY_NAME_SIZE - 1);
+		binaryJointInfo.iParentID = pJointInfo->m_iParentID;
+		binaryJointInfo.iFlags = pJointInfo->m_iFlags;
+		binaryJointInfo.iStartIndex = pJointInfo->m_iStartIndex;
+		MD5Binary::append(vPayload, &binaryJointInfo);
+	}
+
+	for(unsigned int i = 0; i < m_vBounds.size(); i++) {
+
+		BinaryBound bound;
+		bound.vMin[0] = m_vBounds[i]->m_vMin.x;
+		bound.vMin[1] = m_vBounds[i]->m_vMin.y;
+		bound.vMin[2] = m_vBounds[i]->m_vMin.z;
+		bound.vMax[0] = m_vBounds[i]->m_vMax.x;
+		bound.vMax[1] = m_vBounds[i]->m_vMax.y;
+		bound.vMax[2] = m_vBounds[i]->m_vMax.z;
+		MD5Binary::append(vPayload, &bound);
+	}
+
+	MD5Binary::append(vPayload, m_pClip->getData(), m_pClip->getDataSize());
+
+	return MD5Binary::write(sFileName, MD5_BINARY_ANIM_MAGIC, vPayload);
+}
+
 void MD5Animation::buildFrameSkeleton( FrameSkeletonList& skeletons, const JointInfoList& jointInfos, const BaseFrameList& baseFrames, const FrameData* pFrameData ) {
 
 	// Stores all the joints (pos & orient) for a single frame. 
@@ -218,43 +464,36 @@ void MD5Animation::buildFrameSkeleton( FrameSkeletonList& skeletons, const Joint
 	skeletons.push_back(pSkeleton);
 }
 
-void MD5Animation::update(float fDeltaTime) {
+void MD5Animation::bakeClip( AnimationClip::Format eFormat ) {
 
-	if( m_iNumFrames < 1) 
+	unsigned int iFrameCount = m_vSkeletons.size();
+	if ( iFrameCount == 0 || m_iNumJoints <= 0 || m_iFrameRate <= 0 )
 		return;
 
-	m_fAnimTime += fDeltaTime / 1000.0f;
-	while( m_fAnimTime > m_fAnimDuration ) m_fAnimTime -= m_fAnimDuration;
-	while( m_fAnimTime < 0.0f ) m_fAnimTime += m_fAnimDuration;
-
-	//Figure out which frame we're on
-	float fFrameNum = m_fAnimTime * (float)m_iFrameRate;
-	int iFrame0 = (int)floorf(fFrameNum);
-	int iFrame1 = (int)ceilf(fFrameNum);
-
-	iFrame0 = iFrame0 % m_iNumFrames;
-	iFrame1 = iFrame1 % m_iNumFrames;
-
-	float fInterpolate = fmodf( m_fAnimTime, m_fFrameDuration ) / m_fFrameDuration;
-	interpolateSkeletons( m_pAnimatedSkeleton, m_vSkeletons[iFrame0], m_vSkeletons[iFrame1], fInterpolate );
-}
-
-void MD5Animation::interpolateSkeletons( FrameSkeleton* pFinalSkeleton, const FrameSkeleton* pSkeleton0, const FrameSkeleton* pSkeleton1, float fInterpolate ) {
-
-	for ( int i = 0; i < m_iNumJoints; i++ ) {
+	// [frame][joint] poses out of the frame skeletons
+	std::vector<Vector3> vPositions( iFrameCount * m_iNumJoints );
+	std::vector<Quaternionf> vOrientations( iFrameCount * m_iNumJoints );
+	for ( unsigned int f = 0; f < iFrameCount; f++ ) {
+		for ( int j = 0; j < m_iNumJoints; j++ ) {
+			const SkeletonJoint* pJoint = m_vSkeletons[f]->m_Joints[j];
+			vPositions[ f * m_iNumJoints + j ] = pJoint->m_vPos;
+			vOrientations[ f * m_iNumJoints + j ] = pJoint->m_qOrient;
+		}
+	}
 
-		SkeletonJoint* pFinalJoint = pFinalSkeleton->m_Joints[i];
-		const SkeletonJoint* pJoint0 = pSkeleton0->m_Joints[i]; 
-		const SkeletonJoint* pJoint1 = pSkeleton1->m_Joints[i];
+	m_pClip = AnimationClip::create( m_iNumJoints, iFrameCount, (float)m_iFrameRate, &vPositions[0], &vOrientations[0], eFormat );
 
-		pFinalJoint->m_iParent = pJoint0->m_iParent;
+	// Only the clip is sampled from now on
+	for ( unsigned int i = 0; i < m_vSkeletons.size(); i++ ) {
+		for ( unsigned int j = 0; j < m_vSkeletons[i]->m_Joints.size(); j++ ) {
+			SAFE_DELETE( m_vSkeletons[i]->m_Joints[j] );
+		}
+		SAFE_DELETE( m_vSkeletons[i] );
+	}
+	m_vSkeletons.clear();
 
-		pFinalJoint->m_vPos = Lerp( pJoint0->m_vPos, pJoint1->m_vPos, fInterpolate );
-		pFinalJoint->m_qOrient = Slerp( pJoint0->m_qOrient, pJoint1->m_qOrient, fInterpolate );
-		//The following is "Not" the way to go.
-		//pFinalJoint->m_qOrient._x =  ( pJoint1->m_qOrient._x * fInterpolate ) + ( pJoint0->m_qOrient._x * (1-fInterpolate) );
-		//pFinalJoint->m_qOrient._y =  ( pJoint1->m_qOrient._y * fInterpolate ) + ( pJoint0->m_qOrient._y * (1-fInterpolate) );
-		//pFinalJoint->m_qOrient._z =  ( pJoint1->m_qOrient._z * fInterpolate ) + ( pJoint0->m_qOrient._z * (1-fInterpolate) );
-		//pFinalJoint->m_qOrient._w =  ( pJoint1->m_qOrient._w * fInterpolate ) + ( pJoint0->m_qOrient._w * (1-fInterpolate) );
+	for ( unsigned int i = 0; i < m_vFrames.size(); i++ ) {
+		SAFE_DELETE( m_vFrames[i] );
 	}
-}
\ No newline at end of file
+	m_vFrames.clear();
+}
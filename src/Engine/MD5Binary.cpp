@@ -0,0 +1,109 @@
+#include "Engine/MD5Binary.h"
+#include "Engine/MappedFile.h"
+#include <sys\stat.h>
+#include <stdio.h>
+#include <string.h>
+
+bool MD5Binary::m_bEnabled = true;
+
+void MD5Binary::setEnabled(bool bEnabled) {
+	m_bEnabled = bEnabled;
+}
+
+bool MD5Binary::isEnabled() {
+	return m_bEnabled;
+}
+
+std::string MD5Binary::getPath(const char* sSourceFile) {
+
+	GP_ASSERT( sSourceFile );
+
+	std::string sPath = sSourceFile;
+	sPath += 'b';
+	return sPath;
+}
+
+bool MD5Binary::getSourceStamp(const char* sSourceFile, unsigned int* pSize, unsigned int* pTime) {
+
+	struct _stat64 fileStat;
+	if(_stat64(sSourceFile, &fileStat) != 0)
+		return false;
+
+	*pSize = (unsigned int)fileStat.st_size;
+	*pTime = (unsigned int)fileStat.st_mtime;
+	return true;
+}
+
+MappedFile* MD5Binary::open(const char* sSourceFile, unsigned int iMagic) {
+
+	unsigned int iSourceSize = 0;
+	unsigned int iSourceTime = 0;
+	if(!m_bEnabled || !getSourceStamp(sSourceFile, &iSourceSize, &iSourceTime))
+		return NULL;
+
+	MappedFile* pFile = MappedFile::create(getPath(sSourceFile).c_str());
+	if(pFile == NULL)
+		return NULL;
+
+	bool bValid = false;
+	if(pFile->getSize() >= sizeof(Header)) {
+
+		const Header* pHeader = (const Header*)pFile->getData();
+		bValid =	pHeader->iMagic == iMagic &&
+					pHeader->iVersion == MD5_BINARY_VERSION &&
+					pHeader->iSourceSize == iSourceSize &&
+					pHeader->iSourceTime == iSourceTime &&
+					pHeader->iPayloadSize == pFile->getSize() - sizeof(Header) &&
+					pHeader->iChecksum == checksum(pFile->getData() + sizeof(Header), pHeader->iPayloadSize);
+	}
+
+	if(!bValid) {
+		SAFE_DELETE( pFile );
+	}
+
+	return pFile;
+}
+
+bool MD5Binary::write(const char* sSourceFile, unsigned int iMagic, const std::vector<unsigned char>& vPayload) {
+
+	Header header;
+	header.iMagic = iMagic;
+	header.iVersion = MD5_BINARY_VERSION;
+	header.iPayloadSize = vPayload.size();
+	header.iChecksum = checksum(vPayload.empty() ? NULL : &vPayload[0], vPayload.size());
+	if(!m_bEnabled || !getSourceStamp(sSourceFile, &header.iSourceSize, &header.iSourceTime))
+		return false;
+
+	FILE* pFile = fopen(getPath(sSourceFile).c_str(), "wb");
+	if(pFile == NULL)
+		return false;
+
+	bool bWritten =	fwrite(&header, sizeof(Header), 1, pFile) == 1 &&
+					(vPayload.empty() || fwrite(&vPayload[0], vPayload.size(), 1, pFile) == 1);
+	fclose(pFile);
+
+	// A partial file would only fail its checksum, but don't leave it behind
+	if(!bWritten) {
+		remove(getPath(sSourceFile).c_str());
+	}
+
+	return bWritten;
+}
+
+unsigned int MD5Binary::checksum(const unsigned char* pData, unsigned int iSize) {
+
+	// FNV-1a over 32 bit words, payloads are made of 4 byte fields
+	unsigned int iHash = 2166136261u;
+	unsigned int iWords = iSize / 4;
+	for(unsigned int i = 0; i < iWords; i++) {
+		unsigned int iWord;
+		memcpy(&iWord, pData + i * 4, 4);
+		iHash ^= iWord;
+		iHash *= 16777619u;
+	}
+	for(unsigned int i = iWords * 4; i < iSize; i++) {
+		iHash ^= pData[i];
+		iHash *= 16777619u;
+	}
+	return iHash;
+}
@@ -0,0 +1,91 @@
+#include "Engine/MD5LoadBenchmark.h"
+#include "Engine/MD5Model.h"
+#include "Engine/MD5Animation.h"
+#include "Engine/MD5Binary.h"
+#include "Engine/Node.h"
+#include "Engine/Timer.h"
+#include <cstdio>
+
+bool MD5LoadBenchmark::loadMesh(const char* sMeshPath) {
+
+	MD5Model* pModel = new MD5Model();
+	Node* pNode = pModel->loadModel(sMeshPath);
+	bool bLoaded = (pNode != NULL);
+
+	SAFE_DELETE( pNode );
+	SAFE_DELETE( pModel );
+
+	return bLoaded;
+}
+
+bool MD5LoadBenchmark::loadAnim(const char* sAnimPath) {
+
+	MD5Animation* pAnimation = MD5Animation::create(sAnimPath);
+	bool bLoaded = (pAnimation != NULL);
+
+	SAFE_RELEASE( pAnimation );
+
+	return bLoaded;
+}
+
+bool MD5LoadBenchmark::run(const char* sMeshPath, const char* sAnimPath, unsigned int iLoadCount, Result* pResult) {
+
+	GP_ASSERT( sMeshPath && sAnimPath );
+	GP_ASSERT( pResult );
+	GP_ASSERT( iLoadCount > 0 );
+
+	bool bWasEnabled = MD5Binary::isEnabled();
+	bool bLoaded = true;
+	Timer timer;
+
+	// Text only, nothing read or written baked
+	MD5Binary::setEnabled(false);
+
+	timer.start();
+	for(unsigned int i = 0; i < iLoadCount && bLoaded; i++) {
+		bLoaded = loadMesh(sMeshPath);
+	}
+	timer.stop();
+	pResult->dTextMeshMs = timer.getElapsedTimeInMilliSec() / iLoadCount;
+
+	timer.start();
+	for(unsigned int i = 0; i < iLoadCount && bLoaded; i++) {
+		bLoaded = loadAnim(sAnimPath);
+	}
+	timer.stop();
+	pResult->dTextAnimMs = timer.getElapsedTimeInMilliSec() / iLoadCount;
+
+	// Baked, the first loads write the files
+	MD5Binary::setEnabled(true);
+	bLoaded = bLoaded && loadMesh(sMeshPath) && loadAnim(sAnimPath);
+
+	timer.start();
+	for(unsigned int i = 0; i < iLoadCount && bLoaded; i++) {
+		bLoaded = loadMesh(sMeshPath);
+	}
+	timer.stop();
+	pResult->dBinaryMeshMs = timer.getElapsedTimeInMilliSec() / iLoadCount;
+
+	timer.start();
+	for(unsigned int i = 0; i < iLoadCount && bLoaded; i++) {
+		bLoaded = loadAnim(sAnimPath);
+	}
+	timer.stop();
+	pResult->dBinaryAnimMs = timer.getElapsedTimeInMilliSec() / iLoadCount;
+
+	pResult->iLoadCount = iLoadCount;
+	MD5Binary::setEnabled(bWasEnabled);
+
+	return bLoaded;
+}
+
+void MD5LoadBenchmark::runAll(const char* sMeshPath, const char* sAnimPath) {
+
+	Result result;
+	if(!run(sMeshPath, sAnimPath, 20, &result))
+		return;
+
+	printf("loads  mesh text(ms)  mesh baked(ms)  anim text(ms)  anim baked(ms)\n");
+	printf("%5u  %13.3f  %14.3f  %13.3f  %14.3f\n",
+		result.iLoadCount, result.dTextMeshMs, result.dBinaryMeshMs, result.dTextAnimMs, result.dBinaryAnimMs);
+}
@@ -4,9 +4,261 @@
 #include "Engine/MeshPart.h"
 #include "Engine/Model.h"
 #include "Engine/Node.h"
+#include "Engine/JobPool.h"
+#include "Engine/MD5Binary.h"
+#include "Engine/MappedFile.h"
+#include "Common/BatchMath.h"
+#include <algorithm>
+
+// Weights transformed per BatchMath call by skinVertices(), on the stack
+#define MD5_SKINNING_BATCH		256
+
+// Baked md5mesh payload: BinaryMeshInfo, a BinaryJoint per joint, the
+// inverse bind pose (12 floats per joint), the joint radii, then for each
+// mesh a BinaryMeshPart followed by its vertices, indices and weights
+struct BinaryMeshInfo {
+	int				iMD5Version;
+	int				iNumJoints;
+	int				iNumMeshes;
+};
+
+struct BinaryJoint {
+	char			sName[MD5_BINARY_NAME_SIZE];
+	int				iParentID;
+	float			vPos[3];
+	float			qOrient[4];		// x, y, z, w
+};
+
+struct BinaryMeshPart {
+	char			sShader[MD5_BINARY_SHADER_SIZE];
+	unsigned int	iNumVertices;
+	unsigned int	iNumTriangles;
+	unsigned int	iNumWeights;
+};
+
+struct BinaryVertex {
+	float			vPos[3];		// bind pose
+	float			vTex0[2];
+	int				iStartWeight;
+	int				iWeightCount;
+};
+
+struct BinaryWeight {
+	int				iJointID;
+	float			fBias;
+	float			vPos[3];
+};
+
+std::vector<MD5Model::SkinningJob>	MD5Model::m_vSkinningJobs;
+std::map<std::string, MD5Model::MeshData*>	MD5Model::m_MeshDataCache;
+
+MD5Model::MeshData::~MeshData() {
+
+	for(unsigned int i = 0; i < m_Joints.size(); i++) {
+		SAFE_DELETE( m_Joints[i] );
+	}
+	m_Joints.clear();
+
+	for(unsigned int i = 0; i < m_Meshes.size(); i++) {
+
+		Mesh_* pMesh = m_Meshes[i];
+		for(unsigned int j = 0; j < pMesh->m_Vertices.size(); j++) {
+			SAFE_DELETE( pMesh->m_Vertices[j] );
+		}
+		for(unsigned int j = 0; j < pMesh->m_Triangles.size(); j++) {
+			SAFE_DELETE( pMesh->m_Triangles[j] );
+		}
+		for(unsigned int j = 0; j < pMesh->m_Weights.size(); j++) {
+			SAFE_DELETE( pMesh->m_Weights[j] );
+		}
+		SAFE_DELETE( pMesh );
+	}
+	m_Meshes.clear();
+}
+
+MD5Model::~MD5Model() {
+
+	// The Model belongs to the node returned by loadModel()
+	if ( m_pMeshData ) {
+		releaseMeshData( m_pMeshData );
+		m_pMeshData = NULL;
+	}
+	SAFE_RELEASE( m_pMD5Animation );
+	SAFE_DELETE( m_pMixer );
+
+	if ( m_pPose ) {
+		for(unsigned int i = 0; i < m_pPose->m_Joints.size(); i++) {
+			SAFE_DELETE( m_pPose->m_Joints[i] );
+		}
+		SAFE_DELETE( m_pPose );
+	}
+}
 
 Node* MD5Model::loadModel(const char* sFileName) {
 
+	GP_ASSERT( sFileName );
+	GP_ASSERT( m_pMeshData == NULL );
+
+	m_pMeshData = acquireMeshData(sFileName);
+	if(m_pMeshData == NULL)
+		return NULL;
+
+	return createModel();
+}
+
+MD5Model::MeshData* MD5Model::acquireMeshData(const char* sFileName) {
+
+	std::map<std::string, MeshData*>::iterator itr = m_MeshDataCache.find(sFileName);
+	if(itr != m_MeshDataCache.end()) {
+
+		// Already read by another model
+		MeshData* pData = itr->second;
+		GP_ASSERT( pData );
+		pData->m_iRefCount++;
+
+		return pData;
+	}
+
+	// The baked file when it is up to date, otherwise the text baked anew
+	MeshData* pData = readBinaryMeshData(sFileName);
+	if(pData == NULL) {
+
+		pData = readMeshData(sFileName);
+		if(pData == NULL)
+			return NULL;
+
+		computeBindPose(pData);
+		writeBinaryMeshData(pData, sFileName);
+	}
+
+	// Where each Mesh_ starts in the VBO of a model
+	pData->m_iNumVertices = 0;
+	pData->m_vMeshVertexStart.resize(pData->m_iNumMeshes);
+	for(int i = 0; i < pData->m_iNumMeshes; i++) {
+		pData->m_vMeshVertexStart[i] = pData->m_iNumVertices;
+		pData->m_iNumVertices += pData->m_Meshes[i]->m_iNumVertices;
+	}
+	computeLeafJoints(pData);
+	computeSkinRuns(pData);
+
+	pData->m_sPath = sFileName;
+	m_MeshDataCache[pData->m_sPath] = pData;
+
+	return pData;
+}
+
+void MD5Model::computeLeafJoints(MeshData* pData) {
+
+	int iNumJoints = pData->m_iNumJoints;
+	std::vector<bool> vHasChildren(iNumJoints, false);
+	for(int i = 0; i < iNumJoints; i++) {
+
+		int iParent = pData->m_Joints[i]->m_iParentID;
+		if(iParent >= 0) {
+			vHasChildren[iParent] = true;
+		}
+	}
+
+	pData->m_vInnerJoints.clear();
+	pData->m_vLeafJoints.clear();
+	pData->m_vLeafJointFlags.assign(iNumJoints, 0);
+	DualQuaternionf dqIdentity;
+	dqIdentity.identity();
+	pData->m_vLeafBindTransforms.assign(iNumJoints, dqIdentity);
+
+	for(int i = 0; i < iNumJoints; i++) {
+
+		const Joint* pJoint = pData->m_Joints[i];
+		int iParent = pJoint->m_iParentID;
+		if(iParent < 0 || vHasChildren[i]) {
+			pData->m_vInnerJoints.push_back((unsigned short)i);
+			continue;
+		}
+
+		// The leaf's bind pose relative to its parent
+		const Joint* pParent = pData->m_Joints[iParent];
+		DualQuaternionf dqParent(pParent->m_Orient, pParent->m_Pos);
+		DualQuaternionf dqJoint(pJoint->m_Orient, pJoint->m_Pos);
+
+		pData->m_vLeafJoints.push_back((unsigned short)i);
+		pData->m_vLeafJointFlags[i] = 1;
+		pData->m_vLeafBindTransforms[i] = ~dqParent * dqJoint;
+	}
+}
+
+void MD5Model::computeSkinRuns(MeshData* pData) {
+
+	pData->m_vSkinX.clear();
+	pData->m_vSkinY.clear();
+	pData->m_vSkinZ.clear();
+	pData->m_vSkinBias.clear();
+	pData->m_vSkinVertex.clear();
+	pData->m_vSkinRuns.clear();
+	pData->m_vSkinBlockRuns.clear();
+
+	// Weights of the current block, per joint
+	std::vector< std::vector<const Weight*> > vJointWeights(pData->m_iNumJoints);
+	std::vector< std::vector<unsigned int> > vJointVertices(pData->m_iNumJoints);
+
+	unsigned int iVertex = 0;
+	for(int i = 0; i < pData->m_iNumMeshes; i++) {
+
+		const Mesh_* pMesh = pData->m_Meshes[i];
+		for(unsigned int j = 0; j < pMesh->m_iNumVertices; j++, iVertex++) {
+
+			const Vertex* pVertex = pMesh->m_Vertices[j];
+			for(int k = 0; k < pVertex->m_iWeightCount; k++) {
+
+				const Weight* pWeight = pMesh->m_Weights[pVertex->m_iStartWeight + k];
+				vJointWeights[pWeight->m_iJointID].push_back(pWeight);
+				vJointVertices[pWeight->m_iJointID].push_back(iVertex);
+			}
+
+			// Block complete, or the last vertex
+			if((iVertex + 1) % MD5_SKINNING_JOB_VERTICES != 0 && iVertex + 1 != pData->m_iNumVertices)
+				continue;
+
+			pData->m_vSkinBlockRuns.push_back(pData->m_vSkinRuns.size());
+			for(int iJoint = 0; iJoint < pData->m_iNumJoints; iJoint++) {
+
+				std::vector<const Weight*>& vWeights = vJointWeights[iJoint];
+				if(vWeights.empty())
+					continue;
+
+				SkinRun run;
+				run.iJoint = iJoint;
+				run.iFirst = pData->m_vSkinBias.size();
+				run.iCount = vWeights.size();
+				pData->m_vSkinRuns.push_back(run);
+
+				for(unsigned int w = 0; w < vWeights.size(); w++) {
+					pData->m_vSkinX.push_back(vWeights[w]->m_Pos.x);
+					pData->m_vSkinY.push_back(vWeights[w]->m_Pos.y);
+					pData->m_vSkinZ.push_back(vWeights[w]->m_Pos.z);
+					pData->m_vSkinBias.push_back(vWeights[w]->m_fBias);
+					pData->m_vSkinVertex.push_back(vJointVertices[iJoint][w]);
+				}
+
+				vWeights.clear();
+				vJointVertices[iJoint].clear();
+			}
+		}
+	}
+	pData->m_vSkinBlockRuns.push_back(pData->m_vSkinRuns.size());
+}
+
+void MD5Model::releaseMeshData(MeshData* pData) {
+
+	GP_ASSERT( pData && pData->m_iRefCount > 0 );
+	if(--pData->m_iRefCount > 0)
+		return;
+
+	m_MeshDataCache.erase(pData->m_sPath);
+	SAFE_DELETE( pData );
+}
+
+MD5Model::MeshData* MD5Model::readMeshData(const char* sFileName) {
+
 	GP_ASSERT( sFileName );
 
 	RandomAccessFile* pRafIn = new RandomAccessFile();
@@ -15,8 +267,7 @@ Node* MD5Model::loadModel(const char* sFileName) {
 	if(bCanOpen) {
 
 		// Now that we have a valid file and it's open, let's read in the info!
-		m_Joints.clear();
-		m_Meshes.clear();
+		MeshData* pData = new MeshData();
 
 		CCString singleLine;
 		while(!pRafIn->isEOF()) {
@@ -28,15 +279,15 @@ Node* MD5Model::loadModel(const char* sFileName) {
 			}
 			else
 			if(CCString::startsWith(singleLine.c_str(), "MD5Version")) {
-				sscanf(singleLine.c_str(), "MD5Version %d", &m_iMD5Version);
+				sscanf(singleLine.c_str(), "MD5Version %d", &pData->m_iMD5Version);
 			}
 			else
 			if(CCString::startsWith(singleLine.c_str(), "numJoints")) {
-				sscanf(singleLine.c_str(), "numJoints %d", &m_iNumJoints);
+				sscanf(singleLine.c_str(), "numJoints %d", &pData->m_iNumJoints);
 			}
 			else
 			if(CCString::startsWith(singleLine.c_str(), "numMeshes")) {	
-				sscanf(singleLine.c_str(), "numMeshes %d", &m_iNumMeshes);
+				sscanf(singleLine.c_str(), "numMeshes %d", &pData->m_iNumMeshes);
 			}
 			else
 			if(CCString::startsWith(singleLine.c_str(), "joints")) {	
@@ -44,7 +295,7 @@ Node* MD5Model::loadModel(const char* sFileName) {
 				Joint* joint = NULL;
 
 				// Read all joints
-				for(int i = 0; i < m_iNumJoints; i++) {
+				for(int i = 0; i < pData->m_iNumJoints; i++) {
 					singleLine = (char*)pRafIn->readLine();
 					singleLine.trim();
 
@@ -54,7 +305,7 @@ Node* MD5Model::loadModel(const char* sFileName) {
 																														&joint->m_Orient._x, &joint->m_Orient._y, &joint->m_Orient._z
 																												);
 					computeQuatW(joint->m_Orient);
-					m_Joints.push_back(joint);
+					pData->m_Joints.push_back(joint);
 				}
 			}
 			else
@@ -128,20 +379,20 @@ Node* MD5Model::loadModel(const char* sFileName) {
 					}
 				}
 
-				updateMesh(mesh);
+				updateMesh(pData->m_Joints, mesh);
 				updateNormals(mesh);
 
-				m_Meshes.push_back(mesh);
+				pData->m_Meshes.push_back(mesh);
 			}
 		}
 
-		GP_ASSERT( m_Joints.size() == m_iNumJoints );
-		GP_ASSERT( m_Meshes.size() == m_iNumMeshes );
+		GP_ASSERT( pData->m_Joints.size() == pData->m_iNumJoints );
+		GP_ASSERT( pData->m_Meshes.size() == pData->m_iNumMeshes );
 
 		pRafIn->close();
 		SAFE_DELETE( pRafIn );
 
-		return createModel();
+		return pData;
 	}
 
 	pRafIn->close();
@@ -150,12 +401,212 @@ Node* MD5Model::loadModel(const char* sFileName) {
 	return NULL;
 }
 
-bool MD5Model::loadAnim(const char* sFileName) {
+MD5Model::MeshData* MD5Model::readBinaryMeshData(const char* sFileName) {
+
+	MappedFile* pFile = MD5Binary::open(sFileName, MD5_BINARY_MESH_MAGIC);
+	if(pFile == NULL)
+		return NULL;
+
+	MD5Binary::Reader reader(pFile->getData() + sizeof(MD5Binary::Header), pFile->getSize() - sizeof(MD5Binary::Header));
+	const BinaryMeshInfo* pInfo = reader.read<BinaryMeshInfo>();
+	if(pInfo == NULL || pInfo->iNumJoints <= 0 || pInfo->iNumMeshes < 0) {
+		SAFE_DELETE( pFile );
+		return NULL;
+	}
+
+	MeshData* pData = new MeshData();
+	pData->m_iMD5Version = pInfo->iMD5Version;
+	pData->m_iNumJoints = pInfo->iNumJoints;
+	pData->m_iNumMeshes = pInfo->iNumMeshes;
+
+	const BinaryJoint* pJoints = reader.read<BinaryJoint>(pInfo->iNumJoints);
+	const float* pInverseBindPose = reader.read<float>(pInfo->iNumJoints * 12);
+	const float* pJointRadii = reader.read<float>(pInfo->iNumJoints);
+	if(reader.isValid()) {
+
+		pData->m_Joints.reserve(pInfo->iNumJoints);
+		for(int i = 0; i < pInfo->iNumJoints; i++) {
+
+			const BinaryJoint& binaryJoint = pJoints[i];
+			Joint* joint = new Joint();
+			joint->m_sName = binaryJoint.sName;
+			joint->m_iParentID = binaryJoint.iParentID;
+			joint->m_Pos = Vector3(binaryJoint.vPos[0], binaryJoint.vPos[1], binaryJoint.vPos[2]);
+			joint->m_Orient = Quaternionf(binaryJoint.qOrient[3], binaryJoint.qOrient[0], binaryJoint.qOrient[1], binaryJoint.qOrient[2]);
+			pData->m_Joints.push_back(joint);
+		}
+
+		pData->m_vInverseBindPose.assign(pInverseBindPose, pInverseBindPose + pInfo->iNumJoints * 12);
+		pData->m_vJointRadii.assign(pJointRadii, pJointRadii + pInfo->iNumJoints);
+	}
+
+	for(int i = 0; i < pInfo->iNumMeshes && reader.isValid(); i++) {
+
+		const BinaryMeshPart* pPart = reader.read<BinaryMeshPart>();
+		if(pPart == NULL)
+			break;
+
+		const BinaryVertex* pVertices = reader.read<BinaryVertex>(pPart->iNumVertices);
+		const GLuint* pIndices = reader.read<GLuint>(pPart->iNumTriangles * 3);
+		const BinaryWeight* pWeights = reader.read<BinaryWeight>(pPart->iNumWeights);
+		if(!reader.isValid())
+			break;
+
+		Mesh_* mesh = new Mesh_();
+		mesh->m_sShader = pPart->sShader;
+		mesh->m_iNumVertices = pPart->iNumVertices;
+		mesh->m_iNumTriangles = pPart->iNumTriangles;
+		mesh->m_iNumWeights = pPart->iNumWeights;
+
+		mesh->m_Vertices.reserve(pPart->iNumVertices);
+		mesh->m_PositionBuffer.reserve(pPart->iNumVertices);
+		mesh->m_Tex2DBuffer.reserve(pPart->iNumVertices);
+		for(unsigned int j = 0; j < pPart->iNumVertices; j++) {
+
+			const BinaryVertex& binaryVertex = pVertices[j];
+			Vertex* vert = new Vertex();
+			vert->m_Pos = Vector3(binaryVertex.vPos[0], binaryVertex.vPos[1], binaryVertex.vPos[2]);
+			vert->m_Tex0 = Vector2(binaryVertex.vTex0[0], binaryVertex.vTex0[1]);
+			vert->m_iStartWeight = binaryVertex.iStartWeight;
+			vert->m_iWeightCount = binaryVertex.iWeightCount;
+
+			mesh->m_Vertices.push_back(vert);
+			mesh->m_PositionBuffer.push_back(vert->m_Pos);
+			mesh->m_Tex2DBuffer.push_back(vert->m_Tex0);
+		}
+
+		mesh->m_IndexBuffer.assign(pIndices, pIndices + pPart->iNumTriangles * 3);
+		mesh->m_Triangles.reserve(pPart->iNumTriangles);
+		for(unsigned int j = 0; j < pPart->iNumTriangles; j++) {
+
+			Traingle* tri = new Traingle();
+			tri->m_iIndices[0] = (int)pIndices[j * 3 + 0];
+			tri->m_iIndices[1] = (int)pIndices[j * 3 + 1];
+			tri->m_iIndices[2] = (int)pIndices[j * 3 + 2];
+			mesh->m_Triangles.push_back(tri);
+		}
+
+		mesh->m_Weights.reserve(pPart->iNumWeights);
+		for(unsigned int j = 0; j < pPart->iNumWeights; j++) {
+
+			const BinaryWeight& binaryWeight = pWeights[j];
+			Weight* weight = new Weight();
+			weight->m_iJointID = binaryWeight.iJointID;
+			weight->m_fBias = binaryWeight.fBias;
+			weight->m_Pos = Vector3(binaryWeight.vPos[0], binaryWeight.vPos[1], binaryWeight.vPos[2]);
+			mesh->m_Weights.push_back(weight);
+		}
+
+		pData->m_Meshes.push_back(mesh);
+	}
+
+	// Everything was copied out of the mapping
+	bool bValid = reader.isValid() && pData->m_Meshes.size() == pInfo->iNumMeshes;
+	SAFE_DELETE( pFile );
+
+	if(!bValid) {
+		SAFE_DELETE( pData );
+	}
+
+	return pData;
+}
+
+bool MD5Model::writeBinaryMeshData(const MeshData* pData, const char* sFileName) {
+
+	if(!MD5Binary::isEnabled())
+		return false;
+
+	BinaryMeshInfo info;
+	info.iMD5Version = pData->m_iMD5Version;
+	info.iNumJoints = pData->m_iNumJoints;
+	info.iNumMeshes = pData->m_iNumMeshes;
+
+	std::vector<unsigned char> vPayload;
+	MD5Binary::append(vPayload, &info);
+
+	for(int i = 0; i < pData->m_iNumJoints; i++) {
+
+		const Joint* pJoint = pData->m_Joints[i];
+		BinaryJoint binaryJoint;
+		memset(binaryJoint.sName, 0, sizeof(binaryJoint.sName));
+		strncpy(binaryJoint.sName, ((Joint*)pJoint)->m_sName.c_str(), MD5_BINARY_NAME_SIZE - 1);
+		binaryJoint.iParentID = pJoint->m_iParentID;
+		binaryJoint.vPos[0] = pJoint->m_Pos.x;
+		binaryJoint.vPos[1] = pJoint->m_Pos.y;
+		binaryJoint.vPos[2] = pJoint->m_Pos.z;
+		binaryJoint.qOrient[0] = pJoint->m_Orient._x;
+		binaryJoint.qOrient[1] = pJoint->m_Orient._y;
+		binaryJoint.qOrient[2] = pJoint->m_Orient._z;
+		binaryJoint.qOrient[3] = pJoint->m_Orient._w;
+		MD5Binary::append(vPayload, &binaryJoint);
+	}
+
+	MD5Binary::append(vPayload, &pData->m_vInverseBindPose[0], pData->m_vInverseBindPose.size());
+	MD5Binary::append(vPayload, &pData->m_vJointRadii[0], pData->m_vJointRadii.size());
+
+	for(int i = 0; i < pData->m_iNumMeshes; i++) {
+
+		const Mesh_* pMesh = pData->m_Meshes[i];
+		BinaryMeshPart part;
+		memset(part.sShader, 0, sizeof(part.sShader));
+		strncpy(part.sShader, ((Mesh_*)pMesh)->m_sShader.c_str(), MD5_BINARY_SHADER_SIZE - 1);
+		part.iNumVertices = pMesh->m_iNumVertices;
+		part.iNumTriangles = pMesh->m_iNumTriangles;
+		part.iNumWeights = pMesh->m_iNumWeights;
+		MD5Binary::append(vPayload, &part);
+
+		for(unsigned int j = 0; j < pMesh->m_iNumVertices; j++) {
+
+			const Vertex* pVertex = pMesh->m_Vertices[j];
+			BinaryVertex binaryVertex;
+			binaryVertex.vPos[0] = pMesh->m_PositionBuffer[j].x;
+			binaryVertex.vPos[1] = pMesh->m_PositionBuffer[j].y;
+			binaryVertex.vPos[2] = pMesh->m_PositionBuffer[j].z;
+			binaryVertex.vTex0[0] = pVertex->m_Tex0.x;
+			binaryVertex.vTex0[1] = pVertex->m_Tex0.y;
+			binaryVertex.iStartWeight = pVertex->m_iStartWeight;
+			binaryVertex.iWeightCount = pVertex->m_iWeightCount;
+			MD5Binary::append(vPayload, &binaryVertex);
+		}
+
+		if(!pMesh->m_IndexBuffer.empty()) {
+			MD5Binary::append(vPayload, &pMesh->m_IndexBuffer[0], pMesh->m_IndexBuffer.size());
+		}
+
+		for(unsigned int j = 0; j < pMesh->m_iNumWeights; j++) {
+
+			const Weight* pWeight = pMesh->m_Weights[j];
+			BinaryWeight binaryWeight;
+			binaryWeight.iJointID = pWeight->m_iJointID;
+			binaryWeight.fBias = pWeight->m_fBias;
+			binaryWeight.vPos[0] = pWeight->m_Pos.x;
+			binaryWeight.vPos[1] = pWeight->m_Pos.y;
+			binaryWeight.vPos[2] = pWeight->m_Pos.z;
+			MD5Binary::append(vPayload, &binaryWeight);
+		}
+	}
+
+	return MD5Binary::write(sFileName, MD5_BINARY_MESH_MAGIC, vPayload);
+}
+
+bool MD5Model::loadAnim(const char* sFileName, AnimationClip::Format eFormat) {
 
 	GP_ASSERT( sFileName );
-	if( m_pMD5Animation->loadAnimation( sFileName ) ) {
+	GP_ASSERT( m_pPose );
+
+	SAFE_RELEASE( m_pMD5Animation );
+	m_bHasAnimation = false;
+	m_fAnimTime = 0.0f;
+	m_fSkippedTime = 0.0f;
+
+	m_pMD5Animation = MD5Animation::create( sFileName, eFormat );
+	if( m_pMD5Animation ) {
 
 		m_bHasAnimation = checkAnimation( m_pMD5Animation );
+		if( m_bHasAnimation ) {
+			samplePose( m_pMD5Animation->getClip(), m_fAnimTime );
+			updateAnimationBounds( m_fAnimTime );
+		}
 	}
 
 	return m_bHasAnimation;
@@ -163,13 +614,13 @@ bool MD5Model::loadAnim(const char* sFileName) {
 
 bool MD5Model::checkAnimation( MD5Animation* pMD5Animation ) {
 
-	if( m_iNumJoints != pMD5Animation->getNumJoints() )
+	if( m_pMeshData->m_iNumJoints != pMD5Animation->getNumJoints() )
 		return false;
 
 	// Check to make sure the joints match up
-	for( unsigned int i = 0; i < m_iNumJoints; i++) {
+	for( unsigned int i = 0; i < m_pMeshData->m_iNumJoints; i++) {
 
-		Joint* pMeshJoint = m_Joints[ i ];
+		Joint* pMeshJoint = m_pMeshData->m_Joints[ i ];
 		MD5Animation::JointInfo* pAnimJoint = (MD5Animation::JointInfo*)pMD5Animation->getJointInfo( i );
 
 		if(	strcmp( pMeshJoint->m_sName.c_str(), pAnimJoint->m_sName.c_str() ) != 0 
@@ -196,7 +647,7 @@ void MD5Model::computeQuatW( Quaternionf& qOrient ) {
 	}
 }
 
-bool MD5Model::updateMesh( Mesh_* mesh ) {
+bool MD5Model::updateMesh( const JointList& joints, Mesh_* mesh ) {
 
 	mesh->m_PositionBuffer.clear();
 	mesh->m_Tex2DBuffer.clear();
@@ -213,7 +664,7 @@ bool MD5Model::updateMesh( Mesh_* mesh ) {
 		for(int j = 0; j < pVertex->m_iWeightCount; j++) {
 
 			Weight* pWeight = mesh->m_Weights[pVertex->m_iStartWeight + j];
-			Joint* pJoint = m_Joints[pWeight->m_iJointID];
+			Joint* pJoint = joints[pWeight->m_iJointID];
 
 			// Convert the weight position from Joint local space to object space
 			Vector3 vRotatedPos = pWeight->m_Pos;
@@ -229,39 +680,81 @@ bool MD5Model::updateMesh( Mesh_* mesh ) {
 	return true;
 }
 
-bool MD5Model::updateMesh( const MD5Animation::FrameSkeleton* pFrameSkeleton ) {
+void MD5Model::skinVertices( const MD5Animation::FrameSkeleton* pFrameSkeleton, unsigned int iFirst, unsigned int iCount, BoundingBox* pBox ) {
 
-	Mesh* pMesh = m_pModel->getMesh();
-	GLvoid* pMapBuffer = pMesh->getMapBuffer();
-	float* pVertices = (float*)pMapBuffer;
-	for( unsigned int i = 0, m = 0; i < m_iNumMeshes; i++ ) {
+	GP_ASSERT( iFirst + iCount <= m_pMeshData->m_iNumVertices );
+	GP_ASSERT( iFirst % MD5_SKINNING_JOB_VERTICES == 0 );
+	GP_ASSERT( iCount == std::min( m_pMeshData->m_iNumVertices - iFirst, (unsigned int)MD5_SKINNING_JOB_VERTICES ) );
 
-		Mesh_* pMesh = (Mesh_*)m_Meshes[ i ];
-		for ( unsigned int j = 0; j < pMesh->m_iNumVertices; j++ ) {
+	unsigned int iEnd = iFirst + iCount;
+	float* pDst = &m_vStaging[ iFirst * m_iStride ];
+	for ( unsigned int v = 0; v < iCount; v++ ) {
+		pDst[ v * m_iStride + 0 ] = 0.0f;
+		pDst[ v * m_iStride + 1 ] = 0.0f;
+		pDst[ v * m_iStride + 2 ] = 0.0f;
+	}
+
+	// Each joint's weights through its matrix, added to their vertices
+	const MeshData* pData = m_pMeshData;
+	unsigned int iBlock = iFirst / MD5_SKINNING_JOB_VERTICES;
+	float xs[ MD5_SKINNING_BATCH ], ys[ MD5_SKINNING_BATCH ], zs[ MD5_SKINNING_BATCH ];
+
+	for ( unsigned int r = pData->m_vSkinBlockRuns[ iBlock ]; r < pData->m_vSkinBlockRuns[ iBlock + 1 ]; r++ ) {
 
-			Vertex* pVertex = pMesh->m_Vertices[ j ];
-			Vector3 vPos = Vector3(0.0f, 0.0f, 0.0f);
+		const SkinRun& run = pData->m_vSkinRuns[ r ];
+		const MD5Animation::SkeletonJoint* pSkeletonJoint = pFrameSkeleton->m_Joints[ run.iJoint ];
 
-			for( int k = 0; k < pVertex->m_iWeightCount; k++ ) {
+		Matrix4 jointMatrix;
+		jointToMatrix( pSkeletonJoint->m_qOrient, pSkeletonJoint->m_vPos, jointMatrix.m );
 
-				const Weight* pWeight = pMesh->m_Weights[ pVertex->m_iStartWeight + k ];
-				const MD5Animation::SkeletonJoint* pSkeletonJoint = pFrameSkeleton->m_Joints[ pWeight->m_iJointID ];
+		for ( unsigned int i = run.iFirst, iRunEnd = run.iFirst + run.iCount; i < iRunEnd; i += MD5_SKINNING_BATCH ) {
 
-				Vector3 vRotatedPos = pWeight->m_Pos;
-				pSkeletonJoint->m_qOrient.rotate( vRotatedPos );
+			unsigned int n = std::min( iRunEnd - i, (unsigned int)MD5_SKINNING_BATCH );
+			BatchMath::transformPoints( jointMatrix, &pData->m_vSkinX[ i ], &pData->m_vSkinY[ i ], &pData->m_vSkinZ[ i ], xs, ys, zs, n );
 
-				vPos += ( pSkeletonJoint->m_vPos + vRotatedPos ) * pWeight->m_fBias;
-				pVertices[ 0 + m * m_iStride ] = vPos.x;
-				pVertices[ 1 + m * m_iStride ] = vPos.y;
-				pVertices[ 2 + m * m_iStride ] = vPos.z;
+			for ( unsigned int k = 0; k < n; k++ ) {
+
+				float fBias = pData->m_vSkinBias[ i + k ];
+				float* pPos = &m_vStaging[ pData->m_vSkinVertex[ i + k ] * m_iStride ];
+				pPos[ 0 ] += xs[ k ] * fBias;
+				pPos[ 1 ] += ys[ k ] * fBias;
+				pPos[ 2 ] += zs[ k ] * fBias;
 			}
+		}
+	}
+
+	// Last Mesh_ starting at or before iFirst
+	const std::vector<unsigned int>& vMeshVertexStart = pData->m_vMeshVertexStart;
+	unsigned int iMesh = (unsigned int)( std::upper_bound( vMeshVertexStart.begin(), vMeshVertexStart.end(), iFirst ) - vMeshVertexStart.begin() ) - 1;
+
+	for ( unsigned int v = iFirst; v < iEnd; iMesh++ ) {
+
+		const Mesh_* pMesh = pData->m_Meshes[ iMesh ];
+		for ( unsigned int j = v - vMeshVertexStart[ iMesh ]; j < pMesh->m_iNumVertices && v < iEnd; j++, v++ ) {
 
-			m++;
+			const Vertex* pVertex = pMesh->m_Vertices[ j ];
+			pDst[ 3 ] = pVertex->m_Tex0.x;
+			pDst[ 4 ] = pVertex->m_Tex0.y;
+
+			pBox->merge( Vector3( pDst[ 0 ], pDst[ 1 ], pDst[ 2 ] ) );
+			pDst += m_iStride;
 		}
 	}
+}
+
+void MD5Model::uploadVertices( const BoundingBox& poseBox ) {
+
+	// The mapped buffer was invalidated, the staging copy holds every vertex
+	Mesh* pMesh = m_pModel->getMesh();
+	GLvoid* pMapBuffer = pMesh->getMapBuffer();
+	memcpy( pMapBuffer, &m_vStaging[ 0 ], m_vStaging.size() * sizeof(float) );
 	pMesh->unmapBuffer();
 
-	return true;
+	// Keep the culling bounds on the animated pose
+	BoundingSphere poseSphere;
+	poseSphere.set( poseBox );
+	pMesh->setBoundingBox( poseBox );
+	pMesh->setBoundingSphere( poseSphere );
 }
 
 bool MD5Model::updateNormals( Mesh_* mesh ) {
@@ -271,21 +764,31 @@ bool MD5Model::updateNormals( Mesh_* mesh ) {
 
 Node* MD5Model::createModel() {
 
+	// The palette has to fit the vertex uniforms, otherwise skin on the CPU
+	if(m_eSkinningMode == SKINNING_GPU && (unsigned int)m_pMeshData->m_iNumJoints > getMaxGPUJoints()) {
+		m_eSkinningMode = SKINNING_CPU;
+	}
+	bool bGPUSkinning = (m_eSkinningMode == SKINNING_GPU);
+
 	VertexFormat::Element vertexElements[] = 
 	{
 		VertexFormat::Element(VertexFormat::POSITION, VertexFormat::THREE),
 		//VertexFormat::Element(VertexFormat::NORMAL, VertexFormat::THREE),
-		VertexFormat::Element(VertexFormat::TEXCOORD0, VertexFormat::TWO)
+		VertexFormat::Element(VertexFormat::TEXCOORD0, VertexFormat::TWO),
+		// GPU skinning only
+		VertexFormat::Element(VertexFormat::BLENDINDICES, VertexFormat::FOUR),
+		VertexFormat::Element(VertexFormat::BLENDWEIGHTS, VertexFormat::FOUR)
 	};
 
-	int iNumOfVertices = 0;
-	for(int i = 0; i < m_iNumMeshes; i++) {
-		int iSize = ((Mesh_*)m_Meshes[i])->m_iNumVertices;
-		iNumOfVertices += iSize;
-	}
+	int iNumOfVertices = m_pMeshData->m_iNumVertices;
 
 	unsigned int vertexElementCount = sizeof(vertexElements) / sizeof(VertexFormat::Element);
-	Mesh* mesh = Mesh::createMesh(VertexFormat(vertexElements, vertexElementCount), iNumOfVertices, true);
+	if(!bGPUSkinning) {
+		vertexElementCount -= 2;
+	}
+
+	// The bind pose stays in the VBO when the GPU skins it
+	Mesh* mesh = Mesh::createMesh(VertexFormat(vertexElements, vertexElementCount), iNumOfVertices, !bGPUSkinning);
 	if(mesh == NULL) {
 		return  NULL;
 	}
@@ -297,13 +800,19 @@ Node* MD5Model::createModel() {
 		m_iStride += vElement.size;
 	}
 
+	if(!bGPUSkinning) {
+		m_vStaging.resize(iNumOfVertices * m_iStride);
+	}
+
+	BoundingBox bindPoseBox;
 	GLvoid* pMapBuffer = mesh->getMapBuffer();
 	float* pVertices = (float*)pMapBuffer;
-	for(unsigned int i = 0, k = 0; i < m_iNumMeshes; i++) {
+	for(unsigned int i = 0, k = 0; i < m_pMeshData->m_iNumMeshes; i++) {
 
-		Mesh_* pMesh = (Mesh_*)m_Meshes[i];
+		Mesh_* pMesh = (Mesh_*)m_pMeshData->m_Meshes[i];
 		for(unsigned int j = 0; j < pMesh->m_iNumVertices; j++) {
 
+			bindPoseBox.merge(pMesh->m_PositionBuffer[j]);
 			memcpy(&pVertices[0 + k * m_iStride], &pMesh->m_PositionBuffer[j], sizeof(float) * 3);
 			//pVertices[ 0 + k * m_iStride ] = pMesh->m_PositionBuffer[j].x;
 			//pVertices[ 1 + k * m_iStride ] = pMesh->m_PositionBuffer[j].y;
@@ -313,6 +822,10 @@ Node* MD5Model::createModel() {
 			//pVertices[ 3 + k * m_iStride ] = pMesh->m_Tex2DBuffer[j].x;
 			//pVertices[ 4 + k * m_iStride ] = pMesh->m_Tex2DBuffer[j].y;
 
+			if(bGPUSkinning) {
+				computeBlendWeights(pMesh, pMesh->m_Vertices[j], &pVertices[5 + k * m_iStride], &pVertices[9 + k * m_iStride]);
+			}
+
 			k++;
 		}
 
@@ -321,17 +834,23 @@ Node* MD5Model::createModel() {
 	}
 	mesh->unmapBuffer();
 
+	// Filled through the mapped buffer, so the mesh can't see the positions.
+	mesh->setBoundingBox(bindPoseBox);
+	BoundingSphere bindPoseSphere;
+	bindPoseSphere.set(bindPoseBox);
+	mesh->setBoundingSphere(bindPoseSphere);
+
 	int iPrevMeshPositionBufferSize = 0;
-	for(unsigned int i = 0; i < m_iNumMeshes; i++) {
+	for(unsigned int i = 0; i < m_pMeshData->m_iNumMeshes; i++) {
 
-		Mesh_* pMesh = (Mesh_*)m_Meshes[i];
+		Mesh_* pMesh = (Mesh_*)m_pMeshData->m_Meshes[i];
 		
 		int iIndexCount = pMesh->m_iNumTriangles * 3;
 		MeshPart* meshPart = mesh->addMeshPart(Mesh::TRIANGLES, Mesh::INDEX16, iIndexCount, false);
 		unsigned short* pIndices = (unsigned short*)meshPart->getMapBuffer();
 
 		if(i > 0) {
-			iPrevMeshPositionBufferSize += ((Mesh_*)m_Meshes[i-1])->m_iNumVertices;
+			iPrevMeshPositionBufferSize += ((Mesh_*)m_pMeshData->m_Meshes[i-1])->m_iNumVertices;
 		}
 
 		for(int j = 0; j < iIndexCount; j++) {
@@ -351,15 +870,411 @@ Node* MD5Model::createModel() {
 	pNode->setModel(pModel);
 	m_pModel = pModel;
 
+	// The model's own pose, the bind pose until an animation plays
+	int iNumJoints = m_pMeshData->m_iNumJoints;
+	m_pPose = new MD5Animation::FrameSkeleton();
+	for(int i = 0; i < iNumJoints; i++) {
+
+		const Joint* pJoint = m_pMeshData->m_Joints[i];
+		MD5Animation::SkeletonJoint* pSkeletonJoint = new MD5Animation::SkeletonJoint();
+		pSkeletonJoint->m_iParent = pJoint->m_iParentID;
+		pSkeletonJoint->m_vPos = pJoint->m_Pos;
+		pSkeletonJoint->m_qOrient = pJoint->m_Orient;
+		m_pPose->m_Joints.push_back(pSkeletonJoint);
+	}
+	m_vPosePositions.resize(iNumJoints);
+	m_vPoseOrientations.resize(iNumJoints);
+
+	if(bGPUSkinning) {
+
+		// Identity palette for the bind pose
+		m_vMatrixPalette.resize(iNumJoints * 3);
+		for(int i = 0; i < iNumJoints; i++) {
+			m_vMatrixPalette[i * 3 + 0] = Vector4(1.0f, 0.0f, 0.0f, 0.0f);
+			m_vMatrixPalette[i * 3 + 1] = Vector4(0.0f, 1.0f, 0.0f, 0.0f);
+			m_vMatrixPalette[i * 3 + 2] = Vector4(0.0f, 0.0f, 1.0f, 0.0f);
+		}
+		pModel->setMatrixPalette(&m_vMatrixPalette[0], m_vMatrixPalette.size());
+	}
+
 	return pNode;
 }
 
+void MD5Model::skipUpdate( float fDeltaTime ) {
+
+	// Only the bounds follow, for culling
+	m_fSkippedTime += fDeltaTime;
+	updateAnimationBounds( m_fAnimTime + m_fSkippedTime / 1000.0f );
+}
+
+void MD5Model::setLeafJointsDropped( bool bDropped ) {
+	m_bLeafJointsDropped = bDropped;
+}
+
+bool MD5Model::getLeafJointsDropped() const {
+	return m_bLeafJointsDropped;
+}
+
+Node* MD5Model::getNode() const {
+	return m_pModel ? m_pModel->getNode() : NULL;
+}
+
 void MD5Model::update( float fDeltaTime ) {
 
-	if ( m_bHasAnimation ) {
-		m_pMD5Animation->update(fDeltaTime);
+	MD5Model* pModel = this;
+	updateAll( &pModel, 1, fDeltaTime, NULL );
+}
+
+void MD5Model::updateAll( MD5Model** ppModels, unsigned int iCount, float fDeltaTime, JobPool* pPool ) {
+
+	GP_ASSERT( ppModels || iCount == 0 );
+
+	// Animations first, GPU skinned models are done after this
+	AnimateContext context;
+	context.ppModels = ppModels;
+	context.fDeltaTime = fDeltaTime;
+	runJobs( pPool, animateJob, &context, iCount );
+
+	// Then the vertices of the CPU skinned ones, in fixed size ranges
+	m_vSkinningJobs.clear();
+	for ( unsigned int i = 0; i < iCount; i++ ) {
 
-		const MD5Animation::FrameSkeleton* pFrameSkeleton = m_pMD5Animation->getSkeletion();
-		updateMesh( pFrameSkeleton );
+		MD5Model* pModel = ppModels[ i ];
+		if ( !pModel->isAnimated() || pModel->m_eSkinningMode != SKINNING_CPU )
+			continue;
+
+		unsigned int iNumVertices = pModel->m_pMeshData->m_iNumVertices;
+		for ( unsigned int iFirst = 0; iFirst < iNumVertices; iFirst += MD5_SKINNING_JOB_VERTICES ) {
+
+			SkinningJob job;
+			job.pModel = pModel;
+			job.iFirst = iFirst;
+			job.iCount = std::min( iNumVertices - iFirst, (unsigned int)MD5_SKINNING_JOB_VERTICES );
+			m_vSkinningJobs.push_back( job );
+		}
+	}
+	runJobs( pPool, skinJob, &m_vSkinningJobs, m_vSkinningJobs.size() );
+
+	// One upload per model, GL stays on the calling thread
+	for ( unsigned int i = 0; i < m_vSkinningJobs.size(); ) {
+
+		MD5Model* pModel = m_vSkinningJobs[ i ].pModel;
+		BoundingBox poseBox;
+		for ( ; i < m_vSkinningJobs.size() && m_vSkinningJobs[ i ].pModel == pModel; i++ ) {
+			poseBox.merge( m_vSkinningJobs[ i ].box );
+		}
+		pModel->uploadVertices( poseBox );
+	}
+}
+
+void MD5Model::animateJob( void* pContext, unsigned int iJob ) {
+
+	const AnimateContext* pAnimateContext = (const AnimateContext*)pContext;
+	MD5Model* pModel = pAnimateContext->ppModels[ iJob ];
+	// Still mixing on the update that fades the last clip out, which ends on
+	// the bind pose
+	AnimationMixer* pMixer = pModel->m_pMixer;
+	pModel->m_bMixing = pMixer && pMixer->isActive();
+
+	// Catch up on the skipped updates
+	float fDeltaTime = pAnimateContext->fDeltaTime + pModel->m_fSkippedTime;
+	pModel->m_fSkippedTime = 0.0f;
+	if ( !pModel->isAnimated() )
+		return;
+
+	if ( pModel->m_bMixing ) {
+
+		pMixer->update( fDeltaTime );
+		pModel->setPose( pMixer->getPositions(), pMixer->getOrientations() );
 	}
+	else {
+		// Wrapped here as well, so the time keeps its precision
+		const AnimationClip* pClip = pModel->m_pMD5Animation->getClip();
+		pModel->m_fAnimTime = fmodf( pModel->m_fAnimTime + fDeltaTime / 1000.0f, pClip->getDuration() );
+		pModel->samplePose( pClip, pModel->m_fAnimTime );
+	}
+
+	if ( pModel->m_eSkinningMode == SKINNING_GPU ) {
+		pModel->updatePalette( pModel->m_pPose );
+	}
+}
+
+void MD5Model::skinJob( void* pContext, unsigned int iJob ) {
+
+	SkinningJob& job = ( *(std::vector<SkinningJob>*)pContext )[ iJob ];
+	job.box.setEmpty();
+	job.pModel->skinVertices( job.pModel->m_pPose, job.iFirst, job.iCount, &job.box );
+}
+
+void MD5Model::runJobs( JobPool* pPool, void (*pFunction)(void*, unsigned int), void* pContext, unsigned int iJobCount ) {
+
+	if ( pPool ) {
+		pPool->run( pFunction, pContext, iJobCount );
+		return;
+	}
+
+	for ( unsigned int i = 0; i < iJobCount; i++ ) {
+		pFunction( pContext, i );
+	}
+}
+
+unsigned int MD5Model::getVertexCount() const {
+	return m_pMeshData ? m_pMeshData->m_iNumVertices : 0;
+}
+
+AnimationMixer* MD5Model::getMixer() {
+
+	if ( m_pMixer )
+		return m_pMixer;
+
+	GP_ASSERT( m_pMeshData && m_pMeshData->m_iNumJoints > 0 );
+
+	int iNumJoints = m_pMeshData->m_iNumJoints;
+	std::vector<int> vParents( iNumJoints );
+	std::vector<Vector3> vPositions( iNumJoints );
+	std::vector<Quaternionf> vOrientations( iNumJoints );
+
+	for ( int i = 0; i < iNumJoints; i++ ) {
+
+		const Joint* pJoint = m_pMeshData->m_Joints[ i ];
+		vParents[ i ] = pJoint->m_iParentID;
+		vPositions[ i ] = pJoint->m_Pos;
+		vOrientations[ i ] = pJoint->m_Orient;
+	}
+
+	m_pMixer = AnimationMixer::create( iNumJoints, &vParents[ 0 ], &vPositions[ 0 ], &vOrientations[ 0 ] );
+	return m_pMixer;
+}
+
+bool MD5Model::isAnimated() const {
+	return m_bHasAnimation || m_bMixing;
+}
+
+void MD5Model::samplePose( const AnimationClip* pClip, float fTime ) {
+
+	const std::vector<unsigned short>& vInnerJoints = m_pMeshData->m_vInnerJoints;
+	if ( m_bLeafJointsDropped && !m_pMeshData->m_vLeafJoints.empty() ) {
+
+		pClip->sample( fTime, &m_vPosePositions[ 0 ], &m_vPoseOrientations[ 0 ], &vInnerJoints[ 0 ], vInnerJoints.size() );
+		poseLeafJoints( &m_vPosePositions[ 0 ], &m_vPoseOrientations[ 0 ] );
+	}
+	else {
+		pClip->sample( fTime, &m_vPosePositions[ 0 ], &m_vPoseOrientations[ 0 ] );
+	}
+	setPose( &m_vPosePositions[ 0 ], &m_vPoseOrientations[ 0 ] );
+}
+
+void MD5Model::poseLeafJoints( Vector3* pPositions, Quaternionf* pOrientations ) const {
+
+	const std::vector<unsigned short>& vLeafJoints = m_pMeshData->m_vLeafJoints;
+	for ( unsigned int i = 0; i < vLeafJoints.size(); i++ ) {
+
+		unsigned int iJoint = vLeafJoints[ i ];
+		int iParent = m_pMeshData->m_Joints[ iJoint ]->m_iParentID;
+
+		// The parent's pose applied after the bind offset
+		DualQuaternionf dqLeaf = DualQuaternionf( pOrientations[ iParent ], pPositions[ iParent ] ) * m_pMeshData->m_vLeafBindTransforms[ iJoint ];
+		pPositions[ iJoint ] = dqLeaf.translation();
+		pOrientations[ iJoint ] = dqLeaf.rotation();
+	}
+}
+
+void MD5Model::setPose( const Vector3* pPositions, const Quaternionf* pOrientations ) {
+
+	MD5Animation::SkeletonJointList& joints = m_pPose->m_Joints;
+	for ( unsigned int i = 0; i < joints.size(); i++ ) {
+		joints[ i ]->m_vPos = pPositions[ i ];
+		joints[ i ]->m_qOrient = pOrientations[ i ];
+	}
+}
+
+void MD5Model::setSkinningMode( SkinningMode eMode ) {
+
+	GP_ASSERT( m_pModel == NULL );
+	m_eSkinningMode = eMode;
+}
+
+MD5Model::SkinningMode MD5Model::getSkinningMode() const {
+	return m_eSkinningMode;
+}
+
+unsigned int MD5Model::getMaxGPUJoints() {
+
+	GLint iComponents = 0;
+	GL_ASSERT( glGetIntegerv(GL_MAX_VERTEX_UNIFORM_COMPONENTS, &iComponents) );
+
+	int iVectors = iComponents / 4 - MD5_RESERVED_UNIFORM_VECTORS;
+	if ( iVectors < 3 )
+		return 0;
+
+	return std::min( (unsigned int)iVectors / 3, (unsigned int)MD5_MAX_GPU_JOINTS );
+}
+
+void MD5Model::jointToMatrix( const Quaternionf& qOrient, const Vector3& vPos, float* pRows ) {
+
+	// Rows of the rotation q.p.q* followed by the translation, as in Matrix4::m
+	float xx = qOrient._x * qOrient._x, yy = qOrient._y * qOrient._y, zz = qOrient._z * qOrient._z;
+	float xy = qOrient._x * qOrient._y, xz = qOrient._x * qOrient._z, yz = qOrient._y * qOrient._z;
+	float wx = qOrient._w * qOrient._x, wy = qOrient._w * qOrient._y, wz = qOrient._w * qOrient._z;
+
+	pRows[ 0 ] = 1.0f - 2.0f * (yy + zz);
+	pRows[ 1 ] = 2.0f * (xy - wz);
+	pRows[ 2 ] = 2.0f * (xz + wy);
+	pRows[ 3 ] = vPos.x;
+
+	pRows[ 4 ] = 2.0f * (xy + wz);
+	pRows[ 5 ] = 1.0f - 2.0f * (xx + zz);
+	pRows[ 6 ] = 2.0f * (yz - wx);
+	pRows[ 7 ] = vPos.y;
+
+	pRows[ 8 ] = 2.0f * (xz - wy);
+	pRows[ 9 ] = 2.0f * (yz + wx);
+	pRows[ 10 ] = 1.0f - 2.0f * (xx + yy);
+	pRows[ 11 ] = vPos.z;
+}
+
+void MD5Model::computeBindPose( MeshData* pData ) {
+
+	pData->m_vInverseBindPose.resize( pData->m_iNumJoints * 12 );
+	pData->m_vJointRadii.assign( pData->m_iNumJoints, -1.0f );
+
+	for ( int i = 0; i < pData->m_iNumJoints; i++ ) {
+
+		const Joint* pJoint = pData->m_Joints[ i ];
+		float bind[ 12 ];
+		jointToMatrix( pJoint->m_Orient, pJoint->m_Pos, bind );
+
+		// Rigid inverse, transposed rotation and the translation rotated back
+		float* pInverse = &pData->m_vInverseBindPose[ i * 12 ];
+		for ( int r = 0; r < 3; r++ ) {
+			pInverse[ r * 4 + 0 ] = bind[ 0 + r ];
+			pInverse[ r * 4 + 1 ] = bind[ 4 + r ];
+			pInverse[ r * 4 + 2 ] = bind[ 8 + r ];
+			pInverse[ r * 4 + 3 ] = -( bind[ 0 + r ] * bind[ 3 ] + bind[ 4 + r ] * bind[ 7 ] + bind[ 8 + r ] * bind[ 11 ] );
+		}
+	}
+
+	// A joint moves its vertices rigidly, they stay within this distance of it
+	for ( unsigned int i = 0; i < pData->m_iNumMeshes; i++ ) {
+
+		const Mesh_* pMesh = pData->m_Meshes[ i ];
+		for ( unsigned int j = 0; j < pMesh->m_iNumVertices; j++ ) {
+
+			const Vertex* pVertex = pMesh->m_Vertices[ j ];
+			for ( int k = 0; k < pVertex->m_iWeightCount; k++ ) {
+
+				int iJoint = pMesh->m_Weights[ pVertex->m_iStartWeight + k ]->m_iJointID;
+				float fDistance = ( pMesh->m_PositionBuffer[ j ] - pData->m_Joints[ iJoint ]->m_Pos ).length();
+				pData->m_vJointRadii[ iJoint ] = std::max( pData->m_vJointRadii[ iJoint ], fDistance );
+			}
+		}
+	}
+}
+
+void MD5Model::computeBlendWeights( const Mesh_* pMesh, const Vertex* pVertex, float* pIndices, float* pWeights ) const {
+
+	for ( int i = 0; i < 4; i++ ) {
+		pIndices[ i ] = 0.0f;
+		pWeights[ i ] = 0.0f;
+	}
+
+	// Keep the four strongest influences, strongest first
+	for ( int j = 0; j < pVertex->m_iWeightCount; j++ ) {
+
+		const Weight* pWeight = pMesh->m_Weights[ pVertex->m_iStartWeight + j ];
+
+		int iSlot = 4;
+		while ( iSlot > 0 && pWeights[ iSlot - 1 ] < pWeight->m_fBias )
+			iSlot--;
+		if ( iSlot == 4 )
+			continue;
+
+		for ( int k = 3; k > iSlot; k-- ) {
+			pIndices[ k ] = pIndices[ k - 1 ];
+			pWeights[ k ] = pWeights[ k - 1 ];
+		}
+		pIndices[ iSlot ] = (float)pWeight->m_iJointID;
+		pWeights[ iSlot ] = pWeight->m_fBias;
+	}
+
+	// Dropped influences are spread over the kept ones
+	float fSum = pWeights[ 0 ] + pWeights[ 1 ] + pWeights[ 2 ] + pWeights[ 3 ];
+	if ( fSum > 0.0f ) {
+		for ( int i = 0; i < 4; i++ ) {
+			pWeights[ i ] /= fSum;
+		}
+	}
+}
+
+bool MD5Model::updatePalette( const MD5Animation::FrameSkeleton* pFrameSkeleton ) {
+
+	// The md5anim's bounds when it plays, the joint spheres for the mixer
+	bool bAnimationBounds = updateAnimationBounds( m_fAnimTime );
+	// A leaf that follows its parent as in the bind pose skins as the parent does
+	bool bRigidLeaves = m_bLeafJointsDropped && !m_bMixing;
+
+	BoundingBox poseBox;
+	for ( int i = 0; i < m_pMeshData->m_iNumJoints; i++ ) {
+
+		const MD5Animation::SkeletonJoint* pSkeletonJoint = pFrameSkeleton->m_Joints[ i ];
+		if ( bRigidLeaves && m_pMeshData->m_vLeafJointFlags[ i ] ) {
+
+			int iParent = m_pMeshData->m_Joints[ i ]->m_iParentID;
+			for ( int r = 0; r < 3; r++ ) {
+				m_vMatrixPalette[ i * 3 + r ] = m_vMatrixPalette[ iParent * 3 + r ];
+			}
+		}
+		else {
+			float pose[ 12 ];
+			jointToMatrix( pSkeletonJoint->m_qOrient, pSkeletonJoint->m_vPos, pose );
+
+			// pose * inverse bind pose, both 3x4 with an implicit ( 0 0 0 1 ) row
+			const float* pInverse = &m_pMeshData->m_vInverseBindPose[ i * 12 ];
+			for ( int r = 0; r < 3; r++ ) {
+
+				const float* pRow = &pose[ r * 4 ];
+				m_vMatrixPalette[ i * 3 + r ] = Vector4(
+					pRow[ 0 ] * pInverse[ 0 ] + pRow[ 1 ] * pInverse[ 4 ] + pRow[ 2 ] * pInverse[ 8 ],
+					pRow[ 0 ] * pInverse[ 1 ] + pRow[ 1 ] * pInverse[ 5 ] + pRow[ 2 ] * pInverse[ 9 ],
+					pRow[ 0 ] * pInverse[ 2 ] + pRow[ 1 ] * pInverse[ 6 ] + pRow[ 2 ] * pInverse[ 10 ],
+					pRow[ 0 ] * pInverse[ 3 ] + pRow[ 1 ] * pInverse[ 7 ] + pRow[ 2 ] * pInverse[ 11 ] + pRow[ 3 ]
+				);
+			}
+		}
+
+		// Blended vertices lie between the spheres of their joints
+		float fRadius = m_pMeshData->m_vJointRadii[ i ];
+		if ( !bAnimationBounds && fRadius >= 0.0f ) {
+			Vector3 vExtent( fRadius, fRadius, fRadius );
+			poseBox.merge( pSkeletonJoint->m_vPos - vExtent );
+			poseBox.merge( pSkeletonJoint->m_vPos + vExtent );
+		}
+	}
+
+	if ( bAnimationBounds )
+		return true;
+
+	// No vertex is skinned here, cull on the joint spheres instead
+	Mesh* pMesh = m_pModel->getMesh();
+	BoundingSphere poseSphere;
+	poseSphere.set( poseBox );
+	pMesh->setBoundingBox( poseBox );
+	pMesh->setBoundingSphere( poseSphere );
+
+	return true;
+}
+
+bool MD5Model::updateAnimationBounds( float fTime ) {
+
+	BoundingBox poseBox;
+	if ( m_bMixing || !m_bHasAnimation || !m_pMD5Animation->getBounds( fTime, &poseBox ) )
+		return false;
+
+	Mesh* pMesh = m_pModel->getMesh();
+	BoundingSphere poseSphere;
+	poseSphere.set( poseBox );
+	pMesh->setBoundingBox( poseBox );
+	pMesh->setBoundingSphere( poseSphere );
+
+	return true;
 }
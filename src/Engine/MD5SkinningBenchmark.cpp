@@ -0,0 +1,82 @@
+#include "Engine/MD5SkinningBenchmark.h"
+#include "Engine/MD5Model.h"
+#include "Engine/JobPool.h"
+#include "Engine/Node.h"
+#include "Engine/Timer.h"
+#include <cstdio>
+
+bool MD5SkinningBenchmark::run(const char* sMeshPath, const char* sAnimPath, unsigned int iInstanceCount, unsigned int iThreadCount, unsigned int iFrameCount, Result* pResult) {
+
+	GP_ASSERT( sMeshPath && sAnimPath );
+	GP_ASSERT( pResult );
+	GP_ASSERT( iInstanceCount > 0 && iFrameCount > 0 );
+
+	std::vector<MD5Model*> vModels;
+	std::vector<Node*> vNodes;
+	unsigned int iVertexCount = 0;
+	bool bLoaded = true;
+
+	for(unsigned int i = 0; i < iInstanceCount && bLoaded; i++) {
+
+		MD5Model* pModel = new MD5Model();
+		Node* pNode = pModel->loadModel(sMeshPath);
+		vModels.push_back(pModel);
+		vNodes.push_back(pNode);
+
+		bLoaded = (pNode != NULL) && pModel->loadAnim(sAnimPath);
+		if(bLoaded) {
+			iVertexCount += pModel->getVertexCount();
+		}
+	}
+
+	if(bLoaded) {
+
+		JobPool* pPool = JobPool::create(iThreadCount);
+		const float fDeltaTimeMs = 1000.0f / 60.0f;
+
+		MD5Model::updateAll(&vModels[0], vModels.size(), fDeltaTimeMs, pPool);
+		GL_ASSERT( glFinish() );
+
+		Timer timer;
+		timer.start();
+		for(unsigned int f = 0; f < iFrameCount; f++) {
+			MD5Model::updateAll(&vModels[0], vModels.size(), fDeltaTimeMs, pPool);
+		}
+		GL_ASSERT( glFinish() );
+		timer.stop();
+
+		SAFE_DELETE( pPool );
+
+		pResult->iInstanceCount = iInstanceCount;
+		pResult->iThreadCount = iThreadCount;
+		pResult->iFrameCount = iFrameCount;
+		pResult->iVertexCount = iVertexCount;
+		pResult->dUpdateMs = timer.getElapsedTimeInMilliSec() / iFrameCount;
+		pResult->dVerticesPerSec = (pResult->dUpdateMs > 0.0) ? iVertexCount * 1000.0 / pResult->dUpdateMs : 0.0;
+	}
+
+	for(unsigned int i = 0; i < vModels.size(); i++) {
+		SAFE_DELETE( vNodes[i] );
+		SAFE_DELETE( vModels[i] );
+	}
+
+	return bLoaded;
+}
+
+void MD5SkinningBenchmark::runAll(const char* sMeshPath, const char* sAnimPath) {
+
+	const unsigned int iThreadCounts[] = { 1, 2, 4, 8 };
+	const unsigned int iInstanceCount = 16;
+	const unsigned int iFrameCount = 60;
+
+	printf("instances  threads  vertices  update(ms)  vertices/s\n");
+	for(unsigned int i = 0; i < sizeof(iThreadCounts) / sizeof(iThreadCounts[0]); i++) {
+
+		Result result;
+		if(!run(sMeshPath, sAnimPath, iInstanceCount, iThreadCounts[i], iFrameCount, &result))
+			continue;
+
+		printf("%9u  %7u  %8u  %10.3f  %10.0f\n",
+			result.iInstanceCount, result.iThreadCount, result.iVertexCount, result.dUpdateMs, result.dVerticesPerSec);
+	}
+}
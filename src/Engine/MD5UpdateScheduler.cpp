@@ -0,0 +1,128 @@
+#include "Engine/MD5UpdateScheduler.h"
+#include "Engine/MD5Model.h"
+#include "Engine/Camera.h"
+#include "Engine/Node.h"
+#include "Common/Frustum.h"
+
+MD5UpdateScheduler::MD5UpdateScheduler(const Settings& settings)
+	:	m_Settings(settings)
+{
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+MD5UpdateScheduler::~MD5UpdateScheduler() {
+}
+
+MD5UpdateScheduler* MD5UpdateScheduler::create(const Settings& settings) {
+
+	GP_ASSERT( settings.iReducedInterval > 0 );
+	return new MD5UpdateScheduler(settings);
+}
+
+void MD5UpdateScheduler::setSettings(const Settings& settings) {
+
+	GP_ASSERT( settings.iReducedInterval > 0 );
+	m_Settings = settings;
+}
+
+const MD5UpdateScheduler::Settings& MD5UpdateScheduler::getSettings() const {
+	return m_Settings;
+}
+
+void MD5UpdateScheduler::add(MD5Model* pModel) {
+
+	GP_ASSERT( pModel );
+
+	Entry entry;
+	entry.pModel = pModel;
+	entry.iFramesWaiting = 0;
+	m_vEntries.push_back(entry);
+}
+
+void MD5UpdateScheduler::remove(MD5Model* pModel) {
+
+	for(unsigned int i = 0; i < m_vEntries.size(); i++) {
+		if(m_vEntries[i].pModel == pModel) {
+			m_vEntries.erase(m_vEntries.begin() + i);
+			return;
+		}
+	}
+}
+
+unsigned int MD5UpdateScheduler::getModelCount() const {
+	return m_vEntries.size();
+}
+
+void MD5UpdateScheduler::update(float fDeltaTime, Camera* pCamera, JobPool* pPool) {
+
+	memset(&m_Stats, 0, sizeof(m_Stats));
+
+	const Frustum* pFrustum = pCamera ? &pCamera->getFrustum() : NULL;
+	Node* pCameraNode = pCamera ? pCamera->getNode() : NULL;
+	Vector3 vEye = pCameraNode ? pCameraNode->getTranslationWorld() : Vector3(0.0f, 0.0f, 0.0f);
+
+	m_vDueEntries.clear();
+	for(unsigned int i = 0; i < m_vEntries.size(); i++) {
+
+		Entry& entry = m_vEntries[i];
+		MD5Model* pModel = entry.pModel;
+		Node* pNode = pModel->getNode();
+		entry.iFramesWaiting++;
+
+		// The node bounds follow the animation even while it is skipped
+		if(pFrustum && pNode && !pNode->isVisible(*pFrustum)) {
+			pModel->skipUpdate(fDeltaTime);
+			m_Stats.iCulled++;
+			continue;
+		}
+
+		float fDistance = (pCameraNode && pNode) ? vEye.distance(pNode->getTranslationWorld()) : 0.0f;
+		if(fDistance >= m_Settings.fFrozenDistance) {
+			pModel->skipUpdate(fDeltaTime);
+			m_Stats.iFrozen++;
+			continue;
+		}
+
+		unsigned int iInterval = (fDistance >= m_Settings.fReducedDistance) ? m_Settings.iReducedInterval : 1;
+		if(entry.iFramesWaiting < iInterval) {
+			pModel->skipUpdate(fDeltaTime);
+			m_Stats.iReduced++;
+			continue;
+		}
+
+		pModel->setLeafJointsDropped(fDistance >= m_Settings.fLeafDistance);
+		m_vDueEntries.push_back(&entry);
+	}
+
+	// Over the budget, the longest waiting go first
+	unsigned int iUpdateCount = m_vDueEntries.size();
+	if(m_Settings.iUpdateBudget > 0 && iUpdateCount > m_Settings.iUpdateBudget) {
+
+		iUpdateCount = m_Settings.iUpdateBudget;
+		std::nth_element(m_vDueEntries.begin(), m_vDueEntries.begin() + iUpdateCount, m_vDueEntries.end(), waitsLonger);
+
+		for(unsigned int i = iUpdateCount; i < m_vDueEntries.size(); i++) {
+			m_vDueEntries[i]->pModel->skipUpdate(fDeltaTime);
+		}
+		m_Stats.iDeferred = m_vDueEntries.size() - iUpdateCount;
+	}
+
+	m_vDueModels.clear();
+	for(unsigned int i = 0; i < iUpdateCount; i++) {
+		m_vDueEntries[i]->iFramesWaiting = 0;
+		m_vDueModels.push_back(m_vDueEntries[i]->pModel);
+	}
+	m_Stats.iUpdated = iUpdateCount;
+
+	if(iUpdateCount > 0) {
+		MD5Model::updateAll(&m_vDueModels[0], iUpdateCount, fDeltaTime, pPool);
+	}
+}
+
+const MD5UpdateScheduler::Stats& MD5UpdateScheduler::getStats() const {
+	return m_Stats;
+}
+
+bool MD5UpdateScheduler::waitsLonger(const Entry* pA, const Entry* pB) {
+	return pA->iFramesWaiting > pB->iFramesWaiting;
+}
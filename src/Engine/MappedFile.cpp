@@ -0,0 +1,65 @@
+#include "Engine/MappedFile.h"
+
+MappedFile::MappedFile()
+	:	m_hFile(INVALID_HANDLE_VALUE),
+		m_hMapping(NULL),
+		m_pData(NULL),
+		m_iSize(0)
+{
+}
+
+MappedFile::~MappedFile() {
+
+	if(m_pData) {
+		UnmapViewOfFile(m_pData);
+		m_pData = NULL;
+	}
+	if(m_hMapping) {
+		CloseHandle(m_hMapping);
+		m_hMapping = NULL;
+	}
+	if(m_hFile != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+}
+
+MappedFile* MappedFile::create(const char* sFileName) {
+
+	GP_ASSERT( sFileName );
+
+	MappedFile* pFile = new MappedFile();
+	pFile->m_hFile = CreateFileA(sFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(pFile->m_hFile == INVALID_HANDLE_VALUE) {
+		SAFE_DELETE( pFile );
+		return NULL;
+	}
+
+	// Files this big are no baked assets
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(pFile->m_hFile, &size) || size.QuadPart == 0 || size.HighPart != 0) {
+		SAFE_DELETE( pFile );
+		return NULL;
+	}
+	pFile->m_iSize = size.LowPart;
+
+	pFile->m_hMapping = CreateFileMappingA(pFile->m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(pFile->m_hMapping) {
+		pFile->m_pData = (const unsigned char*)MapViewOfFile(pFile->m_hMapping, FILE_MAP_READ, 0, 0, 0);
+	}
+
+	if(pFile->m_pData == NULL) {
+		SAFE_DELETE( pFile );
+		return NULL;
+	}
+
+	return pFile;
+}
+
+const unsigned char* MappedFile::getData() const {
+	return m_pData;
+}
+
+unsigned int MappedFile::getSize() const {
+	return m_iSize;
+}
@@ -283,6 +283,12 @@ void MaterialParameter::bind(Effect* pEffect) {
 		}
 	}
 
+	// Members of a uniform block are fed by UniformBlocks, don't evaluate
+	// the value for nothing.
+	if (m_pUniform->getLocation() < 0) {
+		return;
+	}
+
 	switch (m_Type) {
 
 		case MaterialParameter::FLOAT:
@@ -3,6 +3,8 @@
 #include "Engine/VertexAttributeBinding.h"
 #include "Engine/Texture.h"
 
+std::atomic<unsigned int> Mesh::m_iBoundsVersionCounter(0);
+
 Mesh::Mesh(const VertexFormat& vertexFormat) 
 	:	m_VertexFormat(vertexFormat),
 		m_iVertexCount(0),
@@ -10,7 +12,10 @@ Mesh::Mesh(const VertexFormat& vertexFormat)
 		m_PrimitiveType(TRIANGLES),
 		m_bDynamic(false),
 		m_ppMeshParts(NULL),
-		m_iPartCount(0)
+		m_iPartCount(0),
+		m_BoundingBox(),
+		m_BoundingSphere(),
+		m_iBoundsVersion(++m_iBoundsVersionCounter)
 {
 
 }
@@ -62,7 +67,22 @@ GLvoid* Mesh::getMapBuffer() {
 
 	GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, m_hVBO) );
 	GLvoid* pVBOMapBuffer = NULL;
-	pVBOMapBuffer = glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+
+	if(m_bDynamic) {
+		// Hand the old storage to the draws still reading it instead of
+		// waiting for them
+		GLsizeiptr iSize = m_VertexFormat.getVertexSize() * m_iVertexCount;
+		if(GLEW_ARB_map_buffer_range) {
+			pVBOMapBuffer = glMapBufferRange(GL_ARRAY_BUFFER, 0, iSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		}
+		else {
+			GL_ASSERT( glBufferData(GL_ARRAY_BUFFER, iSize, NULL, GL_DYNAMIC_DRAW) );
+			pVBOMapBuffer = glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+		}
+	}
+	else {
+		pVBOMapBuffer = glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+	}
 
 	return pVBOMapBuffer;
 }
@@ -85,6 +105,7 @@ void Mesh::setVertexData(const float* vertexData, unsigned int vertexStart, unsi
 	GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, m_hVBO) );
 	if(vertexStart == 0 && vertexCount == 0) {
 		GL_ASSERT( glBufferData(GL_ARRAY_BUFFER, m_VertexFormat.getVertexSize() * m_iVertexCount, vertexData, m_bDynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW) );
+		computeBounds(vertexData, m_iVertexCount, false);
 	}
 	else {
 		if(vertexCount == 0) {
@@ -92,10 +113,89 @@ void Mesh::setVertexData(const float* vertexData, unsigned int vertexStart, unsi
 		}
 
 		GL_ASSERT( glBufferSubData(GL_ARRAY_BUFFER, vertexStart * m_VertexFormat.getVertexSize(), vertexCount * m_VertexFormat.getVertexSize(), vertexData) );
+		computeBounds(vertexData, vertexCount, !(vertexStart == 0 && vertexCount == m_iVertexCount));
 	}
 	GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, 0) );
 }
 
+void Mesh::computeBounds(const float* vertexData, unsigned int vertexCount, bool bMerge) {
+
+	if(!vertexData)
+		return;
+
+	// Locate the position element, elements are tightly packed
+	unsigned int iElement = 0;
+	for(; iElement < m_VertexFormat.getElementCount(); iElement++) {
+		if(m_VertexFormat.getElement(iElement).type == VertexFormat::POSITION)
+			break;
+	}
+	if(iElement == m_VertexFormat.getElementCount())
+		return;
+
+	const VertexFormat::Element& position = m_VertexFormat.getElement(iElement);
+	if(position.dataType != VertexFormat::FLOAT)
+		return;
+
+	unsigned int iOffset = m_VertexFormat.getElementOffset(iElement) / sizeof(float);
+	unsigned int iStride = m_VertexFormat.getVertexSize() / sizeof(float);
+
+	BoundingBox box;
+	const float* p = vertexData + iOffset;
+	for(unsigned int i = 0; i < vertexCount; i++, p += iStride) {
+		box.merge(Vector3(p[0], p[1], position.size > 2 ? p[2] : 0.0f));
+	}
+
+	m_iBoundsVersion = ++m_iBoundsVersionCounter;
+
+	if(bMerge) {
+		m_BoundingBox.merge(box);
+		m_BoundingSphere.set(m_BoundingBox);
+		return;
+	}
+
+	m_BoundingBox = box;
+
+	// Tighter than the box's circumsphere: keep the box center but only
+	// reach as far as the furthest vertex.
+	if(box.isEmpty()) {
+		m_BoundingSphere.set(box);
+		return;
+	}
+
+	Vector3 center = box.getCenter();
+	float fMaxDistSq = 0.0f;
+	p = vertexData + iOffset;
+	for(unsigned int i = 0; i < vertexCount; i++, p += iStride) {
+		Vector3 v(p[0] - center.x, p[1] - center.y, position.size > 2 ? p[2] - center.z : -center.z);
+		float fDistSq = v.dot(v);
+		if(fDistSq > fMaxDistSq)
+			fMaxDistSq = fDistSq;
+	}
+	m_BoundingSphere.set(center, sqrtf(fMaxDistSq));
+}
+
+const BoundingBox& Mesh::getBoundingBox() const {
+	return m_BoundingBox;
+}
+
+void Mesh::setBoundingBox(const BoundingBox& box) {
+	m_BoundingBox = box;
+	m_iBoundsVersion = ++m_iBoundsVersionCounter;
+}
+
+const BoundingSphere& Mesh::getBoundingSphere() const {
+	return m_BoundingSphere;
+}
+
+void Mesh::setBoundingSphere(const BoundingSphere& sphere) {
+	m_BoundingSphere = sphere;
+	m_iBoundsVersion = ++m_iBoundsVersionCounter;
+}
+
+unsigned int Mesh::getBoundsVersion() const {
+	return m_iBoundsVersion;
+}
+
 MeshPart* Mesh::addMeshPart(PrimitiveType primitiveType, IndexFormat indexFormat, unsigned int indexCount, bool isDynamic) {
 
 	MeshPart* meshPart = MeshPart::create(this, m_iPartCount, primitiveType, indexFormat, indexCount, isDynamic);
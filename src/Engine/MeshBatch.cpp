@@ -3,10 +3,49 @@
 #include "Engine/Texture.h"
 #include "Engine/Material.h"
 #include "Engine/Technique.h"
+#include "Engine/GPURingBuffer.h"
+#include <climits>
 
-MeshBatch::MeshBatch(const VertexFormat& vertexFormat, Mesh::PrimitiveType primitiveType, Material* pMaterial, bool bIndexed, unsigned int iInitialCapacity, unsigned int iGrowSize) 
+// Ring segments hold this many ranges at the batch capacity
+#define MESH_BATCH_STREAM_RANGES	4
+
+// Alignment of the ranges within the rings
+#define MESH_BATCH_STREAM_ALIGNMENT	16
+
+// Client storage blocks kept for reuse
+#define MESH_BATCH_POOL_BLOCKS		16
+
+bool MeshBatch::m_bStreamingEnabled = true;
+std::vector<MeshBatch::StorageBlock>	MeshBatch::m_vStoragePool;
+MeshBatch::Stats	MeshBatch::m_Stats;
+
+template <class D, class S>
+static void copyIndices(D* pDst, const S* pSrc, unsigned int iCount, unsigned int iBase) {
+	for (unsigned int i = 0; i < iCount; ++i) {
+		pDst[i] = (D)(pSrc[i] + iBase);
+	}
+}
+
+static unsigned int readIndex(const void* pIndices, unsigned int iIndexSize, unsigned int i) {
+	if(iIndexSize == sizeof(unsigned int))
+		return ((const unsigned int*)pIndices)[i];
+
+	return ((const unsigned short*)pIndices)[i];
+}
+
+static void writeIndex(void* pIndices, unsigned int iIndexSize, unsigned int i, unsigned int iValue) {
+	if(iIndexSize == sizeof(unsigned int))
+		((unsigned int*)pIndices)[i] = iValue;
+	else
+		((unsigned short*)pIndices)[i] = (unsigned short)iValue;
+}
+
+MeshBatch::MeshBatch(const VertexFormat& vertexFormat, Mesh::PrimitiveType primitiveType, Material* pMaterial, bool bIndexed, unsigned int iInitialCapacity, unsigned int iGrowSize, Mesh::IndexFormat indexFormat) 
 	: m_VertexFormat(vertexFormat),
 	  m_PrimitiveType(primitiveType),
+	  m_IndexFormat(indexFormat == Mesh::INDEX32 ? Mesh::INDEX32 : Mesh::INDEX16),
+	  m_iIndexSize(indexFormat == Mesh::INDEX32 ? sizeof(unsigned int) : sizeof(unsigned short)),
+	  m_iMaxChunkVertices((bIndexed && indexFormat != Mesh::INDEX32) ? USHRT_MAX + 1 : UINT_MAX),
 	  m_pMaterial(pMaterial),
 	  m_bIndexed(bIndexed),
 	  m_iCapacity(0),
@@ -19,20 +58,46 @@ MeshBatch::MeshBatch(const VertexFormat& vertexFormat, Mesh::PrimitiveType primi
 	  m_pVerticesPtr(NULL),
 	  m_pIndices(NULL),
 	  m_pIndicesPtr(NULL),
+	  m_iVertexStorageSize(0),
+	  m_iIndexStorageSize(0),
 
 	  m_pVertexAttributeBinding(NULL),
-	  m_pTexture(NULL)
+	  m_pTexture(NULL),
+
+	  m_iChunkVertexStart(0),
+	  m_iChunkIndexStart(0),
+	  m_iLastIndex(0),
+
+	  m_bStreaming(m_bStreamingEnabled && GLEW_ARB_map_buffer_range),
+	  m_pVertexRing(NULL),
+	  m_pIndexRing(NULL),
+	  m_iRangeVertexOffset(0),
+	  m_iRangeIndexOffset(0),
+	  m_bMapped(false),
+	  m_bFenced(true)
 {
+	// 8-bit indices would split every 256 vertices
+	GP_ASSERT( indexFormat != Mesh::INDEX8 );
 	resize(iInitialCapacity);
 }
 
 MeshBatch::~MeshBatch() {
 
-	SAFE_DELETE_ARRAY(m_pVertices);
-	SAFE_DELETE_ARRAY(m_pIndices);
+	if(m_bStreaming) {
+		if(m_bMapped) {
+			unmapRange();
+		}
+
+		SAFE_DELETE(m_pVertexRing);
+		SAFE_DELETE(m_pIndexRing);
+	}
+	else {
+		releaseStorage(m_pVertices, m_iVertexStorageSize);
+		releaseStorage(m_pIndices, m_iIndexStorageSize);
+	}
 }
 
-MeshBatch* MeshBatch::create(const VertexFormat& vertexFormat, Mesh::PrimitiveType primitiveType, const char* materialUrl, bool bIndexed, unsigned int iInitialCapacity, unsigned int iGrowSize) {
+MeshBatch* MeshBatch::create(const VertexFormat& vertexFormat, Mesh::PrimitiveType primitiveType, const char* materialUrl, bool bIndexed, unsigned int iInitialCapacity, unsigned int iGrowSize, Mesh::IndexFormat indexFormat) {
 
 	Material* pMaterial = Material::create(materialUrl);
 	if (pMaterial == NULL) {
@@ -41,13 +106,13 @@ MeshBatch* MeshBatch::create(const VertexFormat& vertexFormat, Mesh::PrimitiveTy
 		return NULL;
 	}
 
-	MeshBatch* meshBatch = new MeshBatch(vertexFormat, primitiveType, pMaterial, bIndexed, iInitialCapacity, iGrowSize);
+	MeshBatch* meshBatch = new MeshBatch(vertexFormat, primitiveType, pMaterial, bIndexed, iInitialCapacity, iGrowSize, indexFormat);
 	return meshBatch;
 }
 
-MeshBatch* MeshBatch::create(const VertexFormat& vertexFormat, Mesh::PrimitiveType primitiveType, Material* pMaterial,  bool bIndexed, unsigned int iInitialCapacity, unsigned int iGrowSize) {
+MeshBatch* MeshBatch::create(const VertexFormat& vertexFormat, Mesh::PrimitiveType primitiveType, Material* pMaterial,  bool bIndexed, unsigned int iInitialCapacity, unsigned int iGrowSize, Mesh::IndexFormat indexFormat) {
 
-	MeshBatch* meshBatch = new MeshBatch(vertexFormat, primitiveType, pMaterial, bIndexed, iInitialCapacity, iGrowSize);
+	MeshBatch* meshBatch = new MeshBatch(vertexFormat, primitiveType, pMaterial, bIndexed, iInitialCapacity, iGrowSize, indexFormat);
 	return meshBatch;
 }
 
@@ -55,6 +120,26 @@ const VertexFormat& MeshBatch::getVertexFormat() const {
 	return m_VertexFormat;
 }
 
+Mesh::IndexFormat MeshBatch::getIndexFormat() const {
+	return m_IndexFormat;
+}
+
+unsigned int MeshBatch::getChunkCount() const {
+	return m_vChunks.size();
+}
+
+bool MeshBatch::isStreaming() const {
+	return m_bStreaming;
+}
+
+void MeshBatch::setStreamingEnabled(bool bEnable) {
+	m_bStreamingEnabled = bEnable;
+}
+
+bool MeshBatch::isStreamingEnabled() {
+	return m_bStreamingEnabled;
+}
+
 unsigned int MeshBatch::getCapacity() const {
 	return m_iCapacity;
 }
@@ -63,68 +148,138 @@ void MeshBatch::setCapacity(unsigned int iCapacity) {
 	resize(iCapacity);
 }
 
-bool MeshBatch::resize(unsigned int iCapacity) {
+void MeshBatch::reserve(unsigned int iVertexCount, unsigned int iIndexCount) {
 
-	if(iCapacity <= 0) {
-		//GP_ERROR("Invalid capacity");
-		return false;
+	unsigned int iCapacity = getCapacityForVertices(std::max(iVertexCount, iIndexCount));
+	if(iCapacity > m_iCapacity) {
+		resize(iCapacity);
 	}
+}
 
-	if(iCapacity == m_iCapacity)
-		return true;
-
-	// Store old batch data.
-	unsigned char* oldVertices = m_pVertices;
-	unsigned short* oldIndices = m_pIndices;
+unsigned int MeshBatch::getVertexCapacity(unsigned int iCapacity) const {
 
-	unsigned int vertexCapacity = 0;
 	switch(m_PrimitiveType) {
 		case Mesh::LINES:
-			vertexCapacity = iCapacity * 2;
-		break;
+			return iCapacity * 2;
 		case Mesh::LINE_STRIP:
-			vertexCapacity = iCapacity + 1;
-		break;
+			return iCapacity + 1;
 		case Mesh::TRIANGLES:
-			vertexCapacity = iCapacity * 3;
-		break;
+			return iCapacity * 3;
 		case Mesh::TRIANGLE_STRIP:
-			vertexCapacity = iCapacity + 2;
-		break;
+			return iCapacity + 2;
 		case Mesh::POINTS:
-			vertexCapacity = iCapacity;
-		break;
+			return iCapacity;
 		default:
 			//GP_ERROR("Invalid Primitive Type (%d).", m_PrimitiveType);
-			return false;
+			return 0;
+	}
+}
+
+unsigned int MeshBatch::getCapacityForVertices(unsigned int iVertexCount) const {
+
+	switch(m_PrimitiveType) {
+		case Mesh::LINES:
+			return (iVertexCount + 1) / 2;
+		case Mesh::LINE_STRIP:
+			return (iVertexCount > 1) ? iVertexCount - 1 : 1;
+		case Mesh::TRIANGLES:
+			return (iVertexCount + 2) / 3;
+		case Mesh::TRIANGLE_STRIP:
+			return (iVertexCount > 2) ? iVertexCount - 2 : 1;
+		default:
+			return iVertexCount;
 	}
+}
+
+bool MeshBatch::grow(unsigned int iVertexCount, unsigned int iIndexCount) {
+
+	if(m_iGrowSize == 0)
+		return false;	// growing disabled
+
+	// Geometric, so a batch filled from empty copies its contents a
+	// logarithmic number of times, and at least what this add() needs
+	unsigned int iCapacity = m_iCapacity + std::max(m_iCapacity, m_iGrowSize);
+	iCapacity = std::max(iCapacity, getCapacityForVertices(std::max(iVertexCount, iIndexCount)));
+
+	return resize(iCapacity);
+}
+
+bool MeshBatch::resize(unsigned int iCapacity) {
+
+	if(iCapacity <= 0) {
+		//GP_ERROR("Invalid capacity");
+		return false;
+	}
+
+	if(iCapacity == m_iCapacity)
+		return true;
+
+	unsigned int vertexCapacity = getVertexCapacity(iCapacity);
+	if(vertexCapacity == 0)
+		return false;
 
 	// We have no way of knowing how many vertices will be stored in the batch
 	// (we only know how many indices will be stored). Assume the worst case
-	// for now, which is the same number of vertices as indices.
+	// for now, which is the same number of vertices as indices. Vertices
+	// past the index range go to further chunks.
 	unsigned int indexCapacity = vertexCapacity;
-	if(m_bIndexed && indexCapacity > USHRT_MAX) {
-		//GP_ERROR("Index capacity is greater than the maximum unsigned short value (%d > %d).", indexCapacity, USHRT_MAX);
-		return false;
+
+	++m_Stats.iResizes;
+
+	if(m_bStreaming) {
+
+		m_iCapacity = iCapacity;
+		m_iVertexCapacity = vertexCapacity;
+		m_iIndexCapacity = indexCapacity;
+
+		unsigned int iSegmentSize = MESH_BATCH_STREAM_RANGES * vertexCapacity * m_VertexFormat.getVertexSize();
+		if(m_pVertexRing == NULL) {
+			createRings(iSegmentSize);
+		}
+
+		// An open range keeps its size unless nothing was written to it yet
+		if(m_bMapped && m_iVertexCount == 0) {
+			unmapRange();
+			mapRange();
+		}
+
+		return true;
 	}
 
-	// Allocate new data and reset pointers.
 	unsigned int iVSize = vertexCapacity * m_VertexFormat.getVertexSize();
-	m_pVertices = new unsigned char[iVSize];
+	unsigned int iISize = m_bIndexed ? indexCapacity * m_iIndexSize : 0;
+	unsigned char* pOldVertices = m_pVertices;
 
-	if(m_bIndexed) {
-		m_pIndices = new unsigned short[indexCapacity];
-	}
+	// Storage from before a shrink or from the pool may already be large enough
+	if(iVSize > m_iVertexStorageSize) {
+
+		unsigned int iSize;
+		unsigned char* pVertices = acquireStorage(iVSize, &iSize);
 
-	// Copy old data back in
-	if(oldVertices) {
-		memcpy(m_pVertices, oldVertices, std::min(vertexCapacity, m_iVertexCapacity) * m_VertexFormat.getVertexSize());
-		SAFE_DELETE_ARRAY(oldVertices);
+		// Copy old data back in
+		if(m_pVertices) {
+			memcpy(pVertices, m_pVertices, std::min(vertexCapacity, m_iVertexCapacity) * m_VertexFormat.getVertexSize());
+			releaseStorage(m_pVertices, m_iVertexStorageSize);
+		}
+
+		m_pVerticesPtr = pVertices + (m_pVerticesPtr - m_pVertices);
+		m_pVertices = pVertices;
+		m_iVertexStorageSize = iSize;
 	}
 
-	if(oldIndices) {
-		memcpy(m_pIndices, oldIndices, std::min(indexCapacity, m_iIndexCapacity));
-		SAFE_DELETE_ARRAY(oldIndices);
+	if(iISize > m_iIndexStorageSize) {
+
+		unsigned int iSize;
+		unsigned char* pIndices = acquireStorage(iISize, &iSize);
+
+		if(m_pIndices) {
+			memcpy(pIndices, m_pIndices, std::min(indexCapacity, m_iIndexCapacity) * m_iIndexSize);
+			releaseStorage(m_pIndices, m_iIndexStorageSize);
+		}
+
+		m_pIndicesPtr = pIndices + (m_pIndicesPtr - m_pIndices);
+		m_pIndices = pIndices;
+		m_iIndexStorageSize = iSize;
 	}
 
 	// Assign new capacities
@@ -132,12 +287,201 @@ bool MeshBatch::resize(unsigned int iCapacity) {
 	m_iVertexCapacity = vertexCapacity;
 	m_iIndexCapacity = indexCapacity;
 
-	// Update our vertex attribute bindings now that our client array pointers have changed
-	updateVertexAttributeBinding();
+	// Update our vertex attribute bindings if our client array pointers have changed
+	if(m_pVertices != pOldVertices) {
+		updateVertexAttributeBinding();
+	}
 
 	return true;
 }
 
+unsigned char* MeshBatch::acquireStorage(unsigned int iBytes, unsigned int* pSize) {
+
+	GP_ASSERT( pSize );
+
+	// Best fit, blocks more than twice the size are left for larger batches
+	int iBest = -1;
+	for(unsigned int i = 0; i < m_vStoragePool.size(); i++) {
+		unsigned int iSize = m_vStoragePool[i].iSize;
+		if(iSize >= iBytes && iSize <= 2 * iBytes && (iBest < 0 || iSize < m_vStoragePool[iBest].iSize)) {
+			iBest = i;
+		}
+	}
+
+	if(iBest >= 0) {
+		StorageBlock block = m_vStoragePool[iBest];
+		m_vStoragePool[iBest] = m_vStoragePool.back();
+		m_vStoragePool.pop_back();
+
+		++m_Stats.iPoolReuses;
+		*pSize = block.iSize;
+		return block.pData;
+	}
+
+	++m_Stats.iAllocations;
+	m_Stats.iAllocatedBytes += iBytes;
+
+	*pSize = iBytes;
+	return new unsigned char[iBytes];
+}
+
+void MeshBatch::releaseStorage(unsigned char* pData, unsigned int iSize) {
+
+	if(pData == NULL)
+		return;
+
+	if(m_vStoragePool.size() < MESH_BATCH_POOL_BLOCKS) {
+		StorageBlock block;
+		block.pData = pData;
+		block.iSize = iSize;
+		m_vStoragePool.push_back(block);
+		return;
+	}
+
+	// Pool full, drop its smallest block or this one
+	unsigned int iSmallest = 0;
+	for(unsigned int i = 1; i < m_vStoragePool.size(); i++) {
+		if(m_vStoragePool[i].iSize < m_vStoragePool[iSmallest].iSize) {
+			iSmallest = i;
+		}
+	}
+
+	if(m_vStoragePool[iSmallest].iSize < iSize) {
+		SAFE_DELETE_ARRAY(m_vStoragePool[iSmallest].pData);
+		m_vStoragePool[iSmallest].pData = pData;
+		m_vStoragePool[iSmallest].iSize = iSize;
+	}
+	else {
+		SAFE_DELETE_ARRAY(pData);
+	}
+}
+
+void MeshBatch::purgeStoragePool() {
+
+	for(unsigned int i = 0; i < m_vStoragePool.size(); i++) {
+		SAFE_DELETE_ARRAY(m_vStoragePool[i].pData);
+	}
+	m_vStoragePool.clear();
+}
+
+MeshBatch::Stats MeshBatch::resetStats() {
+
+	Stats stats = m_Stats;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	return stats;
+}
+
+void MeshBatch::addData(const void* pVertices, unsigned int iVertexCount, const void* pIndices, unsigned int iSourceIndexSize, unsigned int iIndexCount) {
+	GP_ASSERT(pVertices);
+
+	if (iVertexCount > m_iMaxChunkVertices)
+	{
+		GP_ASSERT(!"More vertices than the index format can address");
+		return;
+	}
+
+	// Indices past the range of the format would wrap, continue in a new chunk
+	if (m_iVertexCount - m_iChunkVertexStart + iVertexCount > m_iMaxChunkVertices)
+		closeChunk();
+
+	bool bJoin;
+	unsigned int newVertexCount;
+	unsigned int newIndexCount;
+
+	// Do we need to grow the batch?
+	for (;;)
+	{
+		// need an extra 2 indices for connecting strips with degenerate triangles
+		bJoin = (m_PrimitiveType == Mesh::TRIANGLE_STRIP && m_bIndexed && iIndexCount > 0 && m_iVertexCount > m_iChunkVertexStart);
+		newVertexCount = m_iVertexCount + iVertexCount;
+		newIndexCount = m_iIndexCount + iIndexCount + (bJoin ? 2 : 0);
+
+		if (newVertexCount <= m_iVertexCapacity && (!m_bIndexed || newIndexCount <= m_iIndexCapacity))
+			break;
+
+		if (m_bStreaming && m_iVertexCount > 0)
+		{
+			// Leave the filled range as it is and continue in a fresh one
+			nextRange();
+			continue;
+		}
+		if (!grow(newVertexCount, newIndexCount))
+			return; // growing disabled or failed, just clip batch
+	}
+
+	// Copy vertex data.
+	GP_ASSERT(m_pVerticesPtr);
+	unsigned int vBytes = iVertexCount * m_VertexFormat.getVertexSize();
+	memcpy(m_pVerticesPtr, pVertices, vBytes);
+
+	// Copy index data.
+	if (m_bIndexed && iIndexCount > 0)
+	{
+		GP_ASSERT(pIndices);
+		GP_ASSERT(m_pIndicesPtr);
+
+		// Chunk relative index of the first new vertex
+		unsigned int iBase = m_iVertexCount - m_iChunkVertexStart;
+
+		if (bJoin)
+		{
+			// Create a degenerate triangle to connect separate triangle strips
+			// by duplicating the previous and next vertices.
+			writeIndex(m_pIndicesPtr, m_iIndexSize, 0, m_iLastIndex);
+			writeIndex(m_pIndicesPtr, m_iIndexSize, 1, readIndex(pIndices, iSourceIndexSize, 0) + iBase);
+			m_pIndicesPtr += 2 * m_iIndexSize;
+		}
+
+		if (iBase == 0 && iSourceIndexSize == m_iIndexSize)
+		{
+			// Simply copy values directly.
+			memcpy(m_pIndicesPtr, pIndices, iIndexCount * m_iIndexSize);
+		}
+		else if (m_iIndexSize == sizeof(unsigned short))
+		{
+			if (iSourceIndexSize == sizeof(unsigned short))
+				copyIndices((unsigned short*)m_pIndicesPtr, (const unsigned short*)pIndices, iIndexCount, iBase);
+			else
+				copyIndices((unsigned short*)m_pIndicesPtr, (const unsigned int*)pIndices, iIndexCount, iBase);
+		}
+		else
+		{
+			if (iSourceIndexSize == sizeof(unsigned short))
+				copyIndices((unsigned int*)m_pIndicesPtr, (const unsigned short*)pIndices, iIndexCount, iBase);
+			else
+				copyIndices((unsigned int*)m_pIndicesPtr, (const unsigned int*)pIndices, iIndexCount, iBase);
+		}
+
+		m_iLastIndex = readIndex(pIndices, iSourceIndexSize, iIndexCount - 1) + iBase;
+		GP_ASSERT(m_iLastIndex < m_iMaxChunkVertices);
+
+		m_pIndicesPtr += iIndexCount * m_iIndexSize;
+	}
+	m_iIndexCount = m_bIndexed ? newIndexCount : 0;
+
+	m_pVerticesPtr += vBytes;
+	m_iVertexCount = newVertexCount;
+}
+
+void MeshBatch::closeChunk() {
+
+	if(m_iVertexCount > m_iChunkVertexStart && (!m_bIndexed || m_iIndexCount > m_iChunkIndexStart)) {
+		Chunk chunk;
+		chunk.iVertexOffset = m_iRangeVertexOffset + m_iChunkVertexStart * m_VertexFormat.getVertexSize();
+		chunk.iIndexOffset = m_iRangeIndexOffset + m_iChunkIndexStart * m_iIndexSize;
+		chunk.iVertexCount = m_iVertexCount - m_iChunkVertexStart;
+		chunk.iIndexCount = m_iIndexCount - m_iChunkIndexStart;
+
+		if(m_vChunks.size() == m_vChunks.capacity()) {
+			++m_Stats.iAllocations;
+		}
+		m_vChunks.push_back(chunk);
+	}
+
+	m_iChunkVertexStart = m_iVertexCount;
+	m_iChunkIndexStart = m_iIndexCount;
+}
+
 void MeshBatch::updateVertexAttributeBinding() {
 
 	GP_ASSERT( m_pMaterial );
@@ -153,7 +497,13 @@ void MeshBatch::updateVertexAttributeBinding() {
 			Pass* pPass = pTechnique->getPassByIndex(j);
 			GP_ASSERT( pPass );
 
-			VertexAttributeBinding* pVAB = VertexAttributeBinding::create(m_VertexFormat, m_pVertices, pPass->getEffect());
+			VertexAttributeBinding* pVAB;
+			if(m_bStreaming) {
+				pVAB = VertexAttributeBinding::createStreamed(m_VertexFormat, m_pVertexRing->getBuffer(), pPass->getEffect());
+			}
+			else {
+				pVAB = VertexAttributeBinding::create(m_VertexFormat, m_pVertices, pPass->getEffect());
+			}
 			pPass->setVertexAttributeBinding(pVAB);
 		}
 	}
@@ -206,27 +556,169 @@ void MeshBatch::unbindTexture() {
 void MeshBatch::start() {
 	m_iVertexCount = 0;
 	m_iIndexCount = 0;
+	m_iChunkVertexStart = 0;
+	m_iChunkIndexStart = 0;
+
+	if(m_bStreaming) {
+		if(m_bMapped) {
+			unmapRange();
+		}
+		m_vChunks.clear();
+
+		// Moves on at the first start() of a frame, and waits only when the
+		// GPU is still reading the ranges of frames ago
+		m_pVertexRing->beginFrame();
+		if(m_pIndexRing) {
+			m_pIndexRing->beginFrame();
+		}
+		m_bFenced = false;
+
+		mapRange();
+		return;
+	}
+
+	m_vChunks.clear();
 	m_pVerticesPtr = m_pVertices;
 	m_pIndicesPtr = m_pIndices;
 }
 
 void MeshBatch::stop() {
 
+	if(m_bStreaming) {
+		if(m_bMapped) {
+			unmapRange();
+		}
+		return;
+	}
+
+	closeChunk();
 }
 
-void MeshBatch::render() {
-	
-	if(m_iVertexCount == 0 || (m_bIndexed && m_iIndexCount == 0))
-		return;// Nothing to draw
+void MeshBatch::createRings(unsigned int iSegmentSize) {
 
-	// Not using VBOs, so unbind the element array buffer.
-	// ARRAY_BUFFER will be unbound automatically during pass->bind().
-	GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0 ) );
+	GP_ASSERT( !m_bMapped );
+
+	unsigned int iVertexSize = m_VertexFormat.getVertexSize();
 
-	if (m_bIndexed)
+	// Spans of the old rings holding the chunks still to be drawn, written
+	// in order within the current segments
+	unsigned int iPendingVertexBytes = 0;
+	unsigned int iPendingIndexBytes = 0;
+	if(!m_vChunks.empty()) {
+		const Chunk& first = m_vChunks.front();
+		const Chunk& last = m_vChunks.back();
+		iPendingVertexBytes = last.iVertexOffset + last.iVertexCount * iVertexSize - first.iVertexOffset;
+		iPendingIndexBytes = last.iIndexOffset + last.iIndexCount * m_iIndexSize - first.iIndexOffset;
+	}
+
+	GPURingBuffer* pOldVertexRing = m_pVertexRing;
+	GPURingBuffer* pOldIndexRing = m_pIndexRing;
+
+	// Room for the pending chunks and a full range after them
+	iSegmentSize = std::max(iSegmentSize, iPendingVertexBytes + m_iVertexCapacity * iVertexSize + MESH_BATCH_STREAM_ALIGNMENT);
+	m_pVertexRing = GPURingBuffer::create(GL_ARRAY_BUFFER, iSegmentSize);
+	++m_Stats.iAllocations;
+	m_Stats.iAllocatedBytes += iSegmentSize;
+
+	m_pIndexRing = NULL;
+	if(m_bIndexed) {
+		// Indices are never more than vertices, scaled by their size
+		unsigned int iIndexSegmentSize = std::max(iSegmentSize / iVertexSize * m_iIndexSize, iPendingIndexBytes + m_iIndexCapacity * m_iIndexSize + MESH_BATCH_STREAM_ALIGNMENT);
+		m_pIndexRing = GPURingBuffer::create(GL_ELEMENT_ARRAY_BUFFER, iIndexSegmentSize);
+		++m_Stats.iAllocations;
+		m_Stats.iAllocatedBytes += iIndexSegmentSize;
+	}
+
+	// The pending chunks move along with their data. The old storage stays
+	// alive for the draws already issued from it.
+	if(!m_vChunks.empty()) {
+		unsigned int iOldVertexBase = m_vChunks[0].iVertexOffset;
+		unsigned int iOldIndexBase = m_vChunks[0].iIndexOffset;
+		unsigned int iVertexBase = m_pVertexRing->adopt(pOldVertexRing, iOldVertexBase, iPendingVertexBytes);
+		unsigned int iIndexBase = m_pIndexRing ? m_pIndexRing->adopt(pOldIndexRing, iOldIndexBase, iPendingIndexBytes) : iOldIndexBase;
+
+		for(unsigned int i = 0; i < m_vChunks.size(); i++) {
+			m_vChunks[i].iVertexOffset = m_vChunks[i].iVertexOffset - iOldVertexBase + iVertexBase;
+			m_vChunks[i].iIndexOffset = m_vChunks[i].iIndexOffset - iOldIndexBase + iIndexBase;
+		}
+	}
+
+	SAFE_DELETE(pOldVertexRing);
+	SAFE_DELETE(pOldIndexRing);
+
+	// The bindings read from the vertex ring
+	updateVertexAttributeBinding();
+}
+
+void MeshBatch::mapRange() {
+
+	GP_ASSERT( m_bStreaming );
+	GP_ASSERT( !m_bMapped );
+
+	unsigned int iVertexBytes = m_iVertexCapacity * m_VertexFormat.getVertexSize();
+	unsigned int iIndexBytes = m_iIndexCapacity * m_iIndexSize;
+
+	bool bTooLarge = iVertexBytes > m_pVertexRing->getSegmentSize() || (m_pIndexRing && iIndexBytes > m_pIndexRing->getSegmentSize());
+	bool bFull = !m_pVertexRing->fits(iVertexBytes, MESH_BATCH_STREAM_ALIGNMENT) || (m_pIndexRing && !m_pIndexRing->fits(iIndexBytes, MESH_BATCH_STREAM_ALIGNMENT));
+
+	if(bTooLarge || bFull) {
+		// Mapping now would orphan the rings under the chunks still to be
+		// drawn. They move to larger rings instead and the batch goes on,
+		// so nothing is drawn before render().
+		createRings(std::max(2 * m_pVertexRing->getSegmentSize(), MESH_BATCH_STREAM_RANGES * iVertexBytes));
+	}
+
+	m_pVertices = (unsigned char*)m_pVertexRing->map(iVertexBytes, MESH_BATCH_STREAM_ALIGNMENT, &m_iRangeVertexOffset);
+	GP_ASSERT( m_pVertices );
+
+	if(m_pIndexRing) {
+		m_pIndices = (unsigned char*)m_pIndexRing->map(iIndexBytes, MESH_BATCH_STREAM_ALIGNMENT, &m_iRangeIndexOffset);
+		GP_ASSERT( m_pIndices );
+	}
+
+	m_pVerticesPtr = m_pVertices;
+	m_pIndicesPtr = m_pIndices;
+	m_iVertexCount = 0;
+	m_iIndexCount = 0;
+	m_iChunkVertexStart = 0;
+	m_iChunkIndexStart = 0;
+	m_bMapped = true;
+}
+
+void MeshBatch::unmapRange() {
+
+	GP_ASSERT( m_bMapped );
+
+	closeChunk();
+
+	m_pVertexRing->unmap();
+	if(m_pIndexRing) {
+		m_pIndexRing->unmap();
+	}
+
+	m_pVertices = m_pVerticesPtr = NULL;
+	m_pIndices = m_pIndicesPtr = NULL;
+	m_bMapped = false;
+}
+
+void MeshBatch::nextRange() {
+
+	unmapRange();
+	mapRange();
+}
+
+void MeshBatch::drawChunks() {
+
+	if(m_vChunks.empty())
+		return;
+
+	// Chunk index offsets are relative to the index ring, or to the client indices
+	VBOHandle hIndexBuffer = m_pIndexRing ? m_pIndexRing->getBuffer() : 0;
+	const unsigned char* pIndexBase = m_bStreaming ? NULL : m_pIndices;
+
+	if (m_bIndexed && !m_bStreaming)
 		GP_ASSERT(m_pIndices);
 
-	// Bind the material
 	Technique* pTechnique = m_pMaterial->getTechnique();
 	GP_ASSERT( pTechnique );
 
@@ -236,16 +728,56 @@ void MeshBatch::render() {
 		Pass* pPass = pTechnique->getPassByIndex(i);
 		GP_ASSERT( pPass );
 
-		pPass->bind();
+		VertexAttributeBinding* pVAB = pPass->getVertexAttributeBinding();
+		GP_ASSERT( pVAB );
 
-		if(m_bIndexed) {
-			GL_ASSERT( glDrawElements(m_PrimitiveType, m_iIndexCount, GL_UNSIGNED_SHORT, (GLvoid*)m_pIndices) );
-		}
-		else {
-			GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
-			GL_ASSERT( glDrawArrays(m_PrimitiveType, 0, m_iVertexCount) );
+		for (unsigned int c = 0; c < m_vChunks.size(); c++) {
+
+			const Chunk& chunk = m_vChunks[c];
+			pVAB->setBaseOffset(chunk.iVertexOffset);
+
+			if(c == 0) {
+				pPass->bind();
+			}
+			else {
+				pVAB->bind();
+			}
+
+			if(m_bIndexed) {
+				GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, hIndexBuffer) );
+				GL_ASSERT( glDrawElements(m_PrimitiveType, chunk.iIndexCount, m_IndexFormat, (const GLvoid*)(pIndexBase + chunk.iIndexOffset)) );
+			}
+			else {
+				GL_ASSERT( glDrawArrays(m_PrimitiveType, 0, chunk.iVertexCount) );
+			}
 		}
 
+		GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
 		pPass->unbind();
 	}
 }
+
+void MeshBatch::render() {
+
+	if(m_bStreaming) {
+		GP_ASSERT( !m_bMapped );	// stop() first
+
+		drawChunks();
+
+		if(!m_bFenced) {
+			m_pVertexRing->endFrame();
+			if(m_pIndexRing) {
+				m_pIndexRing->endFrame();
+			}
+			m_bFenced = true;
+		}
+		return;
+	}
+
+	// Whatever was added since the last stop()
+	closeChunk();
+
+	// Not using VBOs, the element array buffer stays unbound and
+	// ARRAY_BUFFER will be unbound automatically during pass->bind().
+	drawChunks();
+}
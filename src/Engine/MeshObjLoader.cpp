@@ -2,6 +2,7 @@
 #include "Engine/Model.h"
 #include "Engine/VertexFormat.h"
 #include "Engine/Mesh.h"
+#include "Common/BatchMath.h"
 
 MeshObjLoader::MeshObjLoader() 
 	:	m_bObjectHasUV(false),
@@ -23,10 +24,8 @@ bool MeshObjLoader::loadObject(const char* sFileName) {
 
 	if(bCanOpen) {
 		// Now that we have a valid file and it's open, let's read in the info!
+		// The vertex normals for lighting are computed per object as it is filled in
 		return readObjFile();
-
-		// Now that we have the file read in, let's compute the vertex normals for lighting
-		//computeNormals();
 	}
 	else
 		return false;
@@ -261,6 +260,14 @@ void MeshObjLoader::fillInObjectInfo() {
 		if(m_vVertexNormals.size() > 0)
 			newObject.pNormals[i] = m_vVertexNormals[i];
 	}
+
+	// .obj normals need not be unit length, without any they are computed
+	if(newObject.numOfVertices) {
+		if(m_vVertexNormals.size() > 0)
+			normalizeNormals(&newObject);
+		else
+			computeNormals(&newObject);
+	}
 	
 	// Go through all of the texture coordinates in the object (if any)
 	for(i = 0; i < newObject.numOfTextureVertices; i++) {
@@ -289,89 +296,73 @@ void MeshObjLoader::fillInObjectInfo() {
 
 ///////////////////////////////// COMPUTER NORMALS \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\*
 /////
-/////	This function computes the normals and vertex normals of the objects
+/////	This function computes the vertex normals of an object
 /////
 ///////////////////////////////// COMPUTER NORMALS \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\*
-void MeshObjLoader::computeNormals() {
-
-	SVector3 vVector1, vVector2, vNormal, vPoly[3];
+void MeshObjLoader::computeNormals(S3DObject* pObject) {
 
-	// If there are no objects, we can skip this part
-	if(m_Model.numOfObjects <= 0)
-		return;
+	GP_ASSERT( pObject && pObject->pNormals );
 
 	// What are vertex normals?  And how are they different from other normals?
 	// Well, if you find the normal to a triangle, you are finding a "Face Normal".
 	// If you give OpenGL a face normal for lighting, it will make your object look
 	// really flat and not very round.  If we find the normal for each vertex, it makes
 	// the smooth lighting look.  This also covers up blocky looking objects and they appear
-	// to have more polygons than they do.    Basically, what you do is first
-	// calculate the face normals, then you take the average of all the normals around each
-	// vertex.  It's just averaging.  That way you get a better approximation for that vertex.
-	
-	// Go through each of the objects to calculate their normals
-	for(int index = 0; index < m_Model.numOfObjects; index++)
-	{
-		// Get the current object
-		S3DObject *pObject = &(m_Model.vObjects[index]);
-
-		// Here we allocate all the memory we need to calculate the normals
-		SVector3 *pNormals		= new SVector3 [pObject->numOfFaces];
-		SVector3 *pTempNormals	= new SVector3 [pObject->numOfFaces];
-		pObject->pNormals		= new SVector3 [pObject->numOfVertices];
-
-		// Go though all of the faces of this object
-		for(int i=0; i < pObject->numOfFaces; i++)
-		{												
-			// To cut down LARGE code, we extract the 3 points of this face
-			vPoly[0] = pObject->pVertices[pObject->pFaces[i].vertexIndex[0]];
-			vPoly[1] = pObject->pVertices[pObject->pFaces[i].vertexIndex[1]];
-			vPoly[2] = pObject->pVertices[pObject->pFaces[i].vertexIndex[2]];
-
-			// Now let's calculate the face normals (Get 2 vectors and find the cross product of those 2)
-
-			vVector1 = Vector(vPoly[0], vPoly[2]);		// Get the vector of the polygon (we just need 2 sides for the normal)
-			vVector2 = Vector(vPoly[2], vPoly[1]);		// Get a second vector of the polygon
-
-			vNormal  = Cross(vVector1, vVector2);		// Return the cross product of the 2 vectors (normalize vector, but not a unit vector)
-			pTempNormals[i] = vNormal;					// Save the un-normalized normal for the vertex normals
-			vNormal  = Normalize(vNormal);				// Normalize the cross product to give us the polygons normal
-
-			pNormals[i] = vNormal;						// Assign the normal to the list of normals
+	// to have more polygons than they do.    Basically, what you do is sum the
+	// un-normalized face normals around each vertex and normalize the sum, larger
+	// faces weighing more.
+
+	// Summed per vertex in x, y and z streams, normalized in one batch
+	std::vector<float> xs(pObject->numOfVertices, 0.0f);
+	std::vector<float> ys(pObject->numOfVertices, 0.0f);
+	std::vector<float> zs(pObject->numOfVertices, 0.0f);
+
+	// Go though all of the faces of this object
+	for(int i = 0; i < pObject->numOfFaces; i++) {
+
+		const int* pIndices = pObject->pFaces[i].vertexIndex;
+		SVector3 vPoly[3];
+		vPoly[0] = pObject->pVertices[pIndices[0]];
+		vPoly[1] = pObject->pVertices[pIndices[1]];
+		vPoly[2] = pObject->pVertices[pIndices[2]];
+
+		// Get 2 vectors of the polygon and their cross product, negated so the normals point out
+		SVector3 vNormal = Cross(Vector(vPoly[0], vPoly[2]), Vector(vPoly[2], vPoly[1]));
+		for(int j = 0; j < 3; j++) {
+			xs[pIndices[j]] -= vNormal.x;
+			ys[pIndices[j]] -= vNormal.y;
+			zs[pIndices[j]] -= vNormal.z;
 		}
+	}
 
-		//////////////// Now Get The Vertex Normals /////////////////
-
-		SVector3 vSum;
-		SVector3 vZero = vSum;
-		int shared=0;
-
-		for (int i = 0; i < pObject->numOfVertices; i++)			// Go through all of the vertices
-		{
-			for (int j = 0; j < pObject->numOfFaces; j++)	// Go through all of the triangles
-			{												// Check if the vertex is shared by another face
-				if (pObject->pFaces[j].vertexIndex[0] == i || 
-					pObject->pFaces[j].vertexIndex[1] == i || 
-					pObject->pFaces[j].vertexIndex[2] == i)
-				{
-					vSum = AddVector(vSum, pTempNormals[j]);// Add the un-normalized normal of the shared face
-					shared++;								// Increase the number of shared triangles
-				}
-			}      
+	BatchMath::normalizeVectors(&xs[0], &ys[0], &zs[0], pObject->numOfVertices);
+
+	for(int i = 0; i < pObject->numOfVertices; i++) {
+		pObject->pNormals[i].x = xs[i];
+		pObject->pNormals[i].y = ys[i];
+		pObject->pNormals[i].z = zs[i];
+	}
+}
 
-			// Get the normal by dividing the sum by the shared.  We negate the shared so it has the normals pointing out.
-			pObject->pNormals[i] = DivideVectorByScaler(vSum, float(-shared));
+void MeshObjLoader::normalizeNormals(S3DObject* pObject) {
 
-			// Normalize the normal for the final vertex normal
-			pObject->pNormals[i] = Normalize(pObject->pNormals[i]);	
+	GP_ASSERT( pObject && pObject->pNormals );
 
-			vSum = vZero;									// Reset the sum
-			shared = 0;										// Reset the shared
-		}
+	std::vector<float> xs(pObject->numOfVertices);
+	std::vector<float> ys(pObject->numOfVertices);
+	std::vector<float> zs(pObject->numOfVertices);
+	for(int i = 0; i < pObject->numOfVertices; i++) {
+		xs[i] = pObject->pNormals[i].x;
+		ys[i] = pObject->pNormals[i].y;
+		zs[i] = pObject->pNormals[i].z;
+	}
+
+	BatchMath::normalizeVectors(&xs[0], &ys[0], &zs[0], pObject->numOfVertices);
 
-		// Free our memory and start over on the next object
-		delete [] pTempNormals;
-		delete [] pNormals;
+	for(int i = 0; i < pObject->numOfVertices; i++) {
+		pObject->pNormals[i].x = xs[i];
+		pObject->pNormals[i].y = ys[i];
+		pObject->pNormals[i].z = zs[i];
 	}
 }
 
@@ -121,7 +121,21 @@ GLvoid* MeshPart::getMapBuffer() {
 
 	GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_hIBO) );
 	GLvoid* pIBOMapBuffer = NULL;
-	pIBOMapBuffer = glMapBuffer(GL_ELEMENT_ARRAY_BUFFER, GL_WRITE_ONLY);
+
+	if(m_bDynamic) {
+		// Same as Mesh::getMapBuffer(), never wait for the GPU
+		GLsizeiptr iSize = m_iIndexCount * ((m_IndexFormat == Mesh::INDEX8) ? 1 : (m_IndexFormat == Mesh::INDEX16) ? 2 : 4);
+		if(GLEW_ARB_map_buffer_range) {
+			pIBOMapBuffer = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, iSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		}
+		else {
+			GL_ASSERT( glBufferData(GL_ELEMENT_ARRAY_BUFFER, iSize, NULL, GL_DYNAMIC_DRAW) );
+			pIBOMapBuffer = glMapBuffer(GL_ELEMENT_ARRAY_BUFFER, GL_WRITE_ONLY);
+		}
+	}
+	else {
+		pIBOMapBuffer = glMapBuffer(GL_ELEMENT_ARRAY_BUFFER, GL_WRITE_ONLY);
+	}
 
 	return pIBOMapBuffer;
 }
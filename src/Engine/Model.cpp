@@ -13,7 +13,9 @@ Model::Model(Mesh* pMesh)
 	m_pVertexAttributeBinding(NULL),
 	m_pMaterial(NULL),
 	m_pPartMaterials(NULL),
-	m_pNode(NULL)
+	m_pNode(NULL),
+	m_pMatrixPalette(NULL),
+	m_iMatrixPaletteSize(0)
 {
 	GP_ASSERT( pMesh );
 	m_iPartCount = pMesh->getMeshPartCount();
@@ -35,9 +37,23 @@ unsigned int Model::getMeshPartCount() const {
 	return m_pMesh->getMeshPartCount();
 }
 
-//Node* Model::getNode() const {
-//
-//}
+Node* Model::getNode() const {
+	return m_pNode;
+}
+
+void Model::setMatrixPalette(const Vector4* pPalette, unsigned int iVectorCount) {
+	GP_ASSERT( pPalette == NULL || (iVectorCount > 0 && iVectorCount % 3 == 0) );
+	m_pMatrixPalette = pPalette;
+	m_iMatrixPaletteSize = pPalette ? iVectorCount : 0;
+}
+
+const Vector4* Model::getMatrixPalette() const {
+	return m_pMatrixPalette;
+}
+
+unsigned int Model::getMatrixPaletteSize() const {
+	return m_iMatrixPaletteSize;
+}
 
 void Model::setVertexAttributeBinding(VertexAttributeBinding* vaBinding) {
 	GP_ASSERT( vaBinding );
@@ -67,94 +83,84 @@ void Model::draw(bool bWireframe) {
 	m_pVertexAttributeBinding->unbind();
 	unbindTexture();
 #else
-	if(getMeshPartCount() == 0) {// No mesh parts (i.e index buffers).
-		if(m_pMaterial) {
+	unsigned int iPartCount = getMeshPartCount();
 
-			Technique* pTechnique = m_pMaterial->getTechnique();
-			GP_ASSERT( pTechnique );
+	// Without mesh parts (i.e index buffers) the whole mesh is drawn once with the shared material.
+	for(int iPart = (iPartCount == 0) ? -1 : 0; iPart < (int)iPartCount; iPart++) {
 
-			unsigned int iPassCount = pTechnique->getPassCount();
-			for(int i = 0; i < iPassCount; i++) {
+		// Get the material for this mesh part.
+		Material* pMaterial = getMaterial(iPart);
+		if(pMaterial == NULL)
+			continue;
 
-				Pass* pPass = pTechnique->getPassByIndex(i);
-				GP_ASSERT( pPass );
+		Technique* pTechnique = pMaterial->getTechnique();
+		GP_ASSERT( pTechnique );
 
-				pPass->bind();
-				GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
-
-				if(	bWireframe 
-					&& 
-					(m_pMesh->getPrimitiveType() == Mesh::TRIANGLES || m_pMesh->getPrimitiveType() == Mesh::TRIANGLE_STRIP)
-				) {
-						unsigned int vertexCount = m_pMesh->getVertexCount();
-						for(unsigned int i = 0; i < vertexCount; i += 3) {
-							GL_ASSERT( glDrawArrays(GL_LINE_LOOP, i, 3) );
-						}
-				}
-				else 
-				{
-					GL_ASSERT( glDrawArrays(m_pMesh->getPrimitiveType(), 0, m_pMesh->getVertexCount()) );
-				}
-				
-				pPass->unbind();
-			}
+		unsigned int iPassCount = pTechnique->getPassCount();
+		for(unsigned int i = 0; i < iPassCount; i++) {
+
+			Pass* pPass = pTechnique->getPassByIndex(i);
+			GP_ASSERT( pPass );
+
+			pPass->bind();
+			drawPart(iPart, bWireframe);
+			pPass->unbind();
 		}
 	}
-	else {
-		for(int i = 0; i < getMeshPartCount(); i++) {
-			MeshPart* meshPart = m_pMesh->getMeshPart(i);
-			GP_ASSERT( meshPart );
+#endif
+}
 
-			// Get the material for this mesh part.
-			Material* pMaterial = getMaterial(i);
-			if(pMaterial) {
+void Model::drawPart(int iPartIndex, bool bWireframe) {
 
-				Technique* pTechnique = pMaterial->getTechnique();
-				GP_ASSERT( pTechnique );
+	bool bWireframeTriangles = bWireframe && (m_pMesh->getPrimitiveType() == Mesh::TRIANGLES || m_pMesh->getPrimitiveType() == Mesh::TRIANGLE_STRIP);
 
-				unsigned int iPassCount = pTechnique->getPassCount();
-				for(int i = 0; i < iPassCount; i++) {
+	if(iPartIndex < 0) {
+		GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
 
-					Pass* pPass = pTechnique->getPassByIndex(i);
-					GP_ASSERT( pPass );
-					
-					pPass->bind();
-					GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshPart->getIndexBuffer()) );
-
-					if(bWireframe && (m_pMesh->getPrimitiveType() == Mesh::TRIANGLES || m_pMesh->getPrimitiveType() == Mesh::TRIANGLE_STRIP)) {
-						unsigned int indexCount = meshPart->getIndexCount();
-						unsigned int indexSize = 0;
-						switch(meshPart->getIndexFormat()) {
-						case Mesh::INDEX8:
-							indexSize = 1;
-							break;
-						case Mesh::INDEX16:
-							indexSize = 2;
-							break;
-						case Mesh::INDEX32:
-							indexSize = 4;
-							break;
-						default:
-							//GP_ERROR("Unsupported index format (%d).", part->getIndexFormat());
-							continue;
-						}
-
-						for (unsigned int k = 0; k < indexCount; k += 3) {
-							GL_ASSERT( glDrawElements(GL_LINE_LOOP, 3, meshPart->getIndexFormat(), ((const GLvoid*)(k*indexSize))) );
-						}
-					}
-					else {
-						GL_ASSERT( glDrawElements(meshPart->getPrimitiveType(), meshPart->getIndexCount(), meshPart->getIndexFormat(), 0) );
-					}
+		if(bWireframeTriangles) {
+			unsigned int vertexCount = m_pMesh->getVertexCount();
+			for(unsigned int i = 0; i < vertexCount; i += 3) {
+				GL_ASSERT( glDrawArrays(GL_LINE_LOOP, i, 3) );
+			}
+		}
+		else {
+			GL_ASSERT( glDrawArrays(m_pMesh->getPrimitiveType(), 0, m_pMesh->getVertexCount()) );
+		}
+		return;
+	}
 
-					GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
+	MeshPart* meshPart = m_pMesh->getMeshPart(iPartIndex);
+	GP_ASSERT( meshPart );
+
+	GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshPart->getIndexBuffer()) );
+
+	if(bWireframeTriangles) {
+		unsigned int indexCount = meshPart->getIndexCount();
+		unsigned int indexSize = 0;
+		switch(meshPart->getIndexFormat()) {
+		case Mesh::INDEX8:
+			indexSize = 1;
+			break;
+		case Mesh::INDEX16:
+			indexSize = 2;
+			break;
+		case Mesh::INDEX32:
+			indexSize = 4;
+			break;
+		default:
+			//GP_ERROR("Unsupported index format (%d).", part->getIndexFormat());
+			break;
+		}
 
-					pPass->unbind();
-				}
-			}
+		for (unsigned int k = 0; indexSize && k < indexCount; k += 3) {
+			GL_ASSERT( glDrawElements(GL_LINE_LOOP, 3, meshPart->getIndexFormat(), ((const GLvoid*)(k*indexSize))) );
 		}
 	}
-#endif
+	else {
+		GL_ASSERT( glDrawElements(meshPart->getPrimitiveType(), meshPart->getIndexCount(), meshPart->getIndexFormat(), 0) );
+	}
+
+	GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
 }
 
 void Model::setTexture(const char* path, bool generateMipmaps) {
@@ -181,6 +187,21 @@ void Model::unbindTexture() {
 void Model::setNode(Node* node) {
 	if(node != m_pNode) {
 		m_pNode = node;
+
+		// Point the autobindings of materials set earlier at the new node.
+		if(m_pNode) {
+			if(m_pMaterial) {
+				setMaterialNodeBinding(m_pMaterial);
+			}
+
+			if(m_pPartMaterials) {
+				for(unsigned int i = 0; i < m_iPartCount; i++) {
+					if(m_pPartMaterials[i]) {
+						setMaterialNodeBinding(m_pPartMaterials[i]);
+					}
+				}
+			}
+		}
 	}
 }
 
@@ -2,7 +2,12 @@
 #include "Engine/Node.h"
 #include "Engine/Model.h"
 #include "Engine/Camera.h"
+#include "Engine/Mesh.h"
 #include "Common/Matrices.h"
+#include "Common/Frustum.h"
+#include "Common/DynamicAABBTree.h"
+
+std::atomic<unsigned int> Node::m_iWorldMatrixUpdateCount(0);
 
 Node::Node(const char* id)
 	:	m_pScene(NULL),
@@ -15,7 +20,25 @@ Node::Node(const char* id)
 		m_pNextSibling(NULL),
 		m_pPrevSibling(NULL),
 
-		m_MatrixWorld()
+		m_MatrixWorld(),
+		m_iDirtyBits(NODE_DIRTY_ALL),
+
+		m_MatrixWorldView(),
+		m_MatrixWorldViewProjection(),
+		m_MatrixInverseTransposeWorld(),
+		m_MatrixInverseTransposeWorldView(),
+		m_pCacheCamera(NULL),
+		m_iCacheCameraVersion(0),
+
+		m_WorldBoundingBox(),
+		m_WorldBoundingSphere(),
+		m_iBoundsVersion(0),
+
+		m_pSpatialIndex(NULL),
+		m_iSpatialProxy(DynamicAABBTree::NULL_PROXY),
+
+		m_iObjectBlockSerial(0),
+		m_iObjectBlockOffset(0)
 {
 	if(id) {
 		setID(id);
@@ -49,6 +72,12 @@ void Node::setParent(Node* pParent) {
 
 	Scene* pScene = pParent->getScene();
 	setScene(pScene);
+
+	transformChanged();
+
+	if(pScene) {
+		pScene->indexNode(this, true);
+	}
 }
 
 Node* Node::getFirstChild() const {
@@ -144,6 +173,8 @@ void Node::remove() {
 	m_pPrevSibling = NULL;
 
 	m_pParent = NULL;
+
+	transformChanged();
 }
 
 void Node::removeAllChildren() {
@@ -183,36 +214,106 @@ Matrix4& Node::getProjectionMatrix() const {
 
 const Matrix4& Node::getWorldMatrix() const {
 
-	// If we have a parent, multiply our parent world transform by our local
-	// transform to obtain our final resolved world transform.
-	Node* parent = getParent();
-	if (parent) {
-		m_MatrixWorld = parent->getWorldMatrix() * ((m_pCamera) ? getTransformedViewMatrix() : getTransformedModelMatrix());
-		//Matrix4::multiply(((m_pCamera) ? getTransformedViewMatrix() : getTransformedModelMatrix()), parent->getWorldMatrix(), &m_MatrixWorld);
-	}
-	else
-	{
-		m_MatrixWorld = (m_pCamera)?getTransformedViewMatrix():getTransformedModelMatrix();
+	if(m_iDirtyBits & NODE_DIRTY_WORLD) {
+
+		// If we have a parent, multiply our parent world transform by our local
+		// transform to obtain our final resolved world transform.
+		Node* parent = getParent();
+		if (parent) {
+			m_MatrixWorld = parent->getWorldMatrix() * ((m_pCamera) ? getTransformedViewMatrix() : getTransformedModelMatrix());
+			//Matrix4::multiply(((m_pCamera) ? getTransformedViewMatrix() : getTransformedModelMatrix()), parent->getWorldMatrix(), &m_MatrixWorld);
+		}
+		else
+		{
+			m_MatrixWorld = (m_pCamera)?getTransformedViewMatrix():getTransformedModelMatrix();
+		}
+
+		m_iDirtyBits &= ~NODE_DIRTY_WORLD;
+		++m_iWorldMatrixUpdateCount;
 	}
 
 	return m_MatrixWorld;
 }
 
-const Matrix4& Node::getWorldViewMatrix() const {
+void Node::transformChanged() {
 
-	static Matrix4 worldViewMat;
+	// The object block written for the old matrices is stale
+	m_iObjectBlockSerial = 0;
 
-	worldViewMat = getViewMatrix() * getWorldMatrix();
+	// A dirty node always has a dirty subtree (children are only cleaned
+	// after their parent), so there is nothing left to propagate.
+	if(m_iDirtyBits & NODE_DIRTY_WORLD)
+		return;
+
+	m_iDirtyBits |= NODE_DIRTY_ALL;
 
-	return worldViewMat;
+	if(m_pCamera) {
+		m_pCamera->setDirty(CAMERA_DIRTY_VIEW | CAMERA_DIRTY_VIEW_PROJ | CAMERA_DIRTY_INV_VIEW | CAMERA_DIRTY_INV_VIEW_PROJ | CAMERA_DIRTY_BOUNDS);
+	}
+
+	if(m_pSpatialIndex) {
+		m_pSpatialIndex->markDirty(m_iSpatialProxy);
+	}
+
+	for(Node* node = m_pFirstChild; node != NULL; node = node->getNextSibling()) {
+		node->transformChanged();
+	}
+}
+
+void Node::setResolvedWorldMatrix(const Matrix4& world) {
+
+	m_MatrixWorld = world;
+	m_iDirtyBits = NODE_DIRTY_ALL & ~NODE_DIRTY_WORLD;
+	m_iObjectBlockSerial = 0;
+}
+
+unsigned int Node::getWorldMatrixUpdateCount() {
+	return m_iWorldMatrixUpdateCount;
+}
+
+unsigned int Node::resetWorldMatrixUpdateCount() {
+	return m_iWorldMatrixUpdateCount.exchange(0);
+}
+
+Camera* Node::validateCameraCache() const {
+
+	Scene* pScene = getScene();
+	Camera* pCamera = pScene ? pScene->getActiveCamera() : NULL;
+	unsigned int iVersion = pCamera ? pCamera->getVersion() : 0;
+
+	if(pCamera != m_pCacheCamera || iVersion != m_iCacheCameraVersion) {
+		m_pCacheCamera = pCamera;
+		m_iCacheCameraVersion = iVersion;
+		m_iDirtyBits |= NODE_DIRTY_CAMERA;
+	}
+
+	return pCamera;
+}
+
+const Matrix4& Node::getWorldViewMatrix() const {
+
+	validateCameraCache();
+	if(m_iDirtyBits & NODE_DIRTY_WORLD_VIEW) {
+		m_MatrixWorldView = getViewMatrix() * getWorldMatrix();
+		m_iDirtyBits &= ~NODE_DIRTY_WORLD_VIEW;
+	}
+
+	return m_MatrixWorldView;
 }
 
 const Matrix4& Node::getViewProjectionMatrix() const {
 
-	static Matrix4 viewProjMat;
-	viewProjMat = getProjectionMatrix() * getViewMatrix();
+	// Cached by the camera itself, shared by every node.
+	Scene* pScene = getScene();
+	Camera* pCamera = pScene ? pScene->getActiveCamera() : NULL;
+	GP_ASSERT( pCamera );
 
-	return viewProjMat;
+	if (pCamera) {
+		return pCamera->getViewProjectionMatrix();
+	}
+	else {
+		return Matrix4::identity();
+	}
 }
 
 const Matrix4& Node::getInverseViewProjectionMatrix() const {
@@ -228,30 +329,47 @@ const Matrix4& Node::getInverseViewProjectionMatrix() const {
 
 const Matrix4& Node::getWorldViewProjectionMatrix() const {
 
-	// Always re-calculate worldViewProjection matrix since it's extremely difficult
-	// to track whether the camera has changed (it may frequently change every frame).
-	static Matrix4 worldViewProjMat;
-	worldViewProjMat = getProjectionMatrix() * getViewMatrix() * getWorldMatrix();
+	// Recomputed only when this node or the active camera moved since the
+	// last call. Stored transposed, the way it is uploaded.
+	Camera* pCamera = validateCameraCache();
+	if(m_iDirtyBits & NODE_DIRTY_WORLD_VIEW_PROJ) {
+		if (pCamera) {
+			m_MatrixWorldViewProjection = pCamera->getViewProjectionMatrix() * getWorldMatrix();
+		}
+		else {
+			m_MatrixWorldViewProjection = getWorldMatrix();
+		}
+
+		m_MatrixWorldViewProjection.transpose();
+		m_iDirtyBits &= ~NODE_DIRTY_WORLD_VIEW_PROJ;
+	}
 
-	return worldViewProjMat.getTranspose();
+	return m_MatrixWorldViewProjection;
 }
 
 const Matrix4& Node::getInverseTransposeWorldMatrix() const {
 
-	static Matrix4 invTransWorld;
-	invTransWorld = getWorldMatrix();
-	invTransWorld.invert(&invTransWorld);
-	invTransWorld.transpose();
-	return invTransWorld;
+	if(m_iDirtyBits & NODE_DIRTY_INV_TRANS_WORLD) {
+		m_MatrixInverseTransposeWorld = getWorldMatrix();
+		m_MatrixInverseTransposeWorld.invert(&m_MatrixInverseTransposeWorld);
+		m_MatrixInverseTransposeWorld.transpose();
+		m_iDirtyBits &= ~NODE_DIRTY_INV_TRANS_WORLD;
+	}
+
+	return m_MatrixInverseTransposeWorld;
 }
 
 const Matrix4& Node::getInverseTransposeWorldViewMatrix() const {
 
-	static Matrix4 invTransWorldView;
-	Matrix4::multiply(getViewMatrix(), getWorldMatrix(), &invTransWorldView);
-	invTransWorldView.invert(&invTransWorldView);
-	invTransWorldView.transpose();
-	return invTransWorldView;
+	validateCameraCache();
+	if(m_iDirtyBits & NODE_DIRTY_INV_TRANS_WORLD_VIEW) {
+		Matrix4::multiply(getViewMatrix(), getWorldMatrix(), &m_MatrixInverseTransposeWorldView);
+		m_MatrixInverseTransposeWorldView.invert(&m_MatrixInverseTransposeWorldView);
+		m_MatrixInverseTransposeWorldView.transpose();
+		m_iDirtyBits &= ~NODE_DIRTY_INV_TRANS_WORLD_VIEW;
+	}
+
+	return m_MatrixInverseTransposeWorldView;
 }
 
 Vector3 Node::getTranslationWorld() const {
@@ -373,6 +491,12 @@ void Node::setModel(Model* pModel) {
 		if(m_pModel) {
 			m_pModel->setNode(this);
 		}
+
+		m_iDirtyBits |= NODE_DIRTY_BOUNDS;
+
+		if(m_pScene) {
+			m_pScene->indexNode(this, false);
+		}
 	}
 }
 
@@ -392,7 +516,58 @@ void Node::setCamera(Camera* pCamera) {
 		if(m_pCamera) {
 			m_pCamera->setNode(this);
 		}
+
+		// Camera nodes resolve their world matrix from the view transform.
+		transformChanged();
+	}
+}
+
+void Node::validateBounds() const {
+
+	Mesh* pMesh = m_pModel ? m_pModel->getMesh() : NULL;
+	unsigned int iVersion = pMesh ? pMesh->getBoundsVersion() : 0;
+
+	if(!(m_iDirtyBits & NODE_DIRTY_BOUNDS) && iVersion == m_iBoundsVersion)
+		return;
+
+	if(pMesh) {
+		pMesh->getBoundingBox().transform(getWorldMatrix(), &m_WorldBoundingBox);
+		pMesh->getBoundingSphere().transform(getWorldMatrix(), &m_WorldBoundingSphere);
 	}
+	else {
+		m_WorldBoundingBox.setEmpty();
+		m_WorldBoundingSphere.set(m_WorldBoundingBox);
+	}
+
+	m_iBoundsVersion = iVersion;
+	m_iDirtyBits &= ~NODE_DIRTY_BOUNDS;
+}
+
+const BoundingBox& Node::getWorldBoundingBox() const {
+
+	validateBounds();
+	return m_WorldBoundingBox;
+}
+
+const BoundingSphere& Node::getWorldBoundingSphere() const {
+
+	validateBounds();
+	return m_WorldBoundingSphere;
+}
+
+bool Node::isVisible(const Frustum& frustum) const {
+
+	validateBounds();
+
+	// Nothing known about the extent, never cull.
+	if(m_WorldBoundingBox.isEmpty())
+		return true;
+
+	// The sphere rejects most outliers cheaply, the box is tighter.
+	if(!m_WorldBoundingSphere.isEmpty() && !frustum.intersects(m_WorldBoundingSphere))
+		return false;
+
+	return frustum.intersects(m_WorldBoundingBox);
 }
 
 void Node::render(bool bWireframe) {
@@ -408,6 +583,9 @@ void Node::render(bool bWireframe) {
 Node::~Node() {
 	removeAllChildren();
 
+	if(m_pSpatialIndex)
+		m_pSpatialIndex->destroyProxy(m_iSpatialProxy);
+
 	if(m_pModel)
 		m_pModel->setNode(NULL);
 	if(m_pCamera)
@@ -78,26 +78,38 @@ Effect*	Pass::getEffect() const {
 	return m_pEffect;
 }
 
-void Pass::bind() {
+void Pass::bind(bool bBindEffect) {
+
+	bind(m_pVertexAttributeBinding, bBindEffect);
+}
+
+void Pass::unbind() {
+
+	unbind(m_pVertexAttributeBinding);
+}
+
+void Pass::bind(VertexAttributeBinding* pBinding, bool bBindEffect) {
 
 	GP_ASSERT( m_pEffect );
 
 	// Bind our effect.
-	m_pEffect->bind();
+	if(bBindEffect) {
+		m_pEffect->bind();
+	}
 	
 	// Bind our render state
 	RenderState::bind(this);
 
 	// If we have a vertex attribute binding, bind it
-	if(m_pVertexAttributeBinding) {
-		m_pVertexAttributeBinding->bind();
+	if(pBinding) {
+		pBinding->bind();
 	}
 }
 
-void Pass::unbind() {
+void Pass::unbind(VertexAttributeBinding* pBinding) {
 
 	// If we have a vertex attribute binding, unbind it
-	if(m_pVertexAttributeBinding) {
-		m_pVertexAttributeBinding->unbind();
+	if(pBinding) {
+		pBinding->unbind();
 	}
 }
\ No newline at end of file
@@ -0,0 +1,325 @@
+#include "Engine/RenderQueue.h"
+#include "Engine/Model.h"
+#include "Engine/Mesh.h"
+#include "Engine/Material.h"
+#include "Engine/Technique.h"
+#include "Engine/Pass.h"
+#include "Engine/Effect.h"
+
+// Key layout, see RenderQueue.h
+#define KEY_BLENDED_BIT		(1ull << 63)
+#define KEY_DEPTH_BITS		16
+
+#define KEY_PASS_SHIFT		44
+#define KEY_EFFECT_SHIFT	34
+#define KEY_TEXTURE_SHIFT	24
+#define KEY_MATERIAL_SHIFT	13
+#define KEY_MESH_SHIFT		0
+
+#define KEY_PASS_MASK		0x7ull
+#define KEY_EFFECT_MASK		0x3FFull
+#define KEY_TEXTURE_MASK	0x3FFull
+#define KEY_MATERIAL_MASK	0x7FFull
+#define KEY_MESH_MASK		0x1FFFull
+
+// Where the depth goes in each bucket, the state fields move up over it
+// in the opaque one
+#define KEY_OPAQUE_STATE_SHIFT	(KEY_DEPTH_BITS)
+#define KEY_BLENDED_DEPTH_SHIFT	(KEY_PASS_SHIFT + 3)
+#define KEY_DEPTH_MASK		0xFFFFull
+
+static unsigned int quantizeDepth(float fDepth) {
+
+	// Positive IEEE floats order like their bit patterns, the top 16 bits
+	// keep the exponent and 7 bits of mantissa.
+	if(!(fDepth > 0.0f))
+		return 0;
+
+	union { float f; unsigned int i; } bits;
+	bits.f = fDepth;
+	return bits.i >> 16;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// RenderQueue::IDTable
+///////////////////////////////////////////////////////////////////////////
+RenderQueue::IDTable::IDTable()
+	:	m_vKeys(64, (const void*)NULL),
+		m_vIDs(64, 0),
+		m_iCount(0)
+{
+
+}
+
+void RenderQueue::IDTable::clear() {
+
+	if(m_iCount == 0)
+		return;
+
+	std::fill(m_vKeys.begin(), m_vKeys.end(), (const void*)NULL);
+	m_iCount = 0;
+}
+
+unsigned int RenderQueue::IDTable::getID(const void* p) {
+
+	// NULL (e.g. no texture) is always id 0
+	if(p == NULL)
+		return 0;
+
+	if((m_iCount + 1) * 2 > m_vKeys.size())
+		grow();
+
+	size_t iMask = m_vKeys.size() - 1;
+	size_t iSlot = (((size_t)p >> 4) * 2654435761u) & iMask;
+	while(m_vKeys[iSlot] != NULL) {
+		if(m_vKeys[iSlot] == p)
+			return m_vIDs[iSlot];
+		iSlot = (iSlot + 1) & iMask;
+	}
+
+	m_vKeys[iSlot] = p;
+	m_vIDs[iSlot] = ++m_iCount;
+	return m_iCount;
+}
+
+void RenderQueue::IDTable::grow() {
+
+	std::vector<const void*> vKeys(m_vKeys.size() * 2, (const void*)NULL);
+	std::vector<unsigned int> vIDs(m_vIDs.size() * 2, 0);
+
+	size_t iMask = vKeys.size() - 1;
+	for(size_t i = 0; i < m_vKeys.size(); i++) {
+
+		if(m_vKeys[i] == NULL)
+			continue;
+
+		size_t iSlot = (((size_t)m_vKeys[i] >> 4) * 2654435761u) & iMask;
+		while(vKeys[iSlot] != NULL) {
+			iSlot = (iSlot + 1) & iMask;
+		}
+		vKeys[iSlot] = m_vKeys[i];
+		vIDs[iSlot] = m_vIDs[i];
+	}
+
+	m_vKeys.swap(vKeys);
+	m_vIDs.swap(vIDs);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// RenderQueue
+///////////////////////////////////////////////////////////////////////////
+RenderQueue::RenderQueue()
+	:	m_vItems(),
+		m_vKeys(),
+		m_vOrder(),
+		m_vSortKeys(),
+		m_vSortKeysOut(),
+		m_vSortOrder(),
+		m_bSortingEnabled(true),
+		m_bSorted(false)
+{
+	memset(&m_UnsortedStats, 0, sizeof(m_UnsortedStats));
+	memset(&m_SortedStats, 0, sizeof(m_SortedStats));
+}
+
+RenderQueue::~RenderQueue() {
+
+}
+
+RenderQueue* RenderQueue::create() {
+	return new RenderQueue();
+}
+
+void RenderQueue::clear() {
+
+	m_vItems.clear();
+	m_vKeys.clear();
+	m_vOrder.clear();
+	m_bSorted = false;
+
+	m_EffectIDs.clear();
+	m_TextureIDs.clear();
+	m_MaterialIDs.clear();
+	m_MeshIDs.clear();
+}
+
+void RenderQueue::submit(Model* pModel, float fDepth) {
+
+	GP_ASSERT( pModel );
+
+	Mesh* pMesh = pModel->getMesh();
+	unsigned long long iMeshID = m_MeshIDs.getID(pMesh) & KEY_MESH_MASK;
+	unsigned long long iDepth = quantizeDepth(fDepth);
+
+	// Same expansion as Model::draw()
+	unsigned int iPartCount = pModel->getMeshPartCount();
+	for(int iPart = (iPartCount == 0) ? -1 : 0; iPart < (int)iPartCount; iPart++) {
+
+		Material* pMaterial = pModel->getMaterial(iPart);
+		if(pMaterial == NULL)
+			continue;
+
+		Technique* pTechnique = pMaterial->getTechnique();
+		GP_ASSERT( pTechnique );
+
+		unsigned long long iMaterialID = m_MaterialIDs.getID(pMaterial) & KEY_MATERIAL_MASK;
+
+		unsigned int iPassCount = pTechnique->getPassCount();
+		for(unsigned int i = 0; i < iPassCount; i++) {
+
+			Pass* pPass = pTechnique->getPassByIndex(i);
+			GP_ASSERT( pPass );
+
+			Item item;
+			item.pModel = pModel;
+			item.pPass = pPass;
+			item.pEffect = pPass->getEffect();
+			item.pTexture = pPass->getPrimaryTexture();
+			item.pMesh = pMesh;
+			item.iPartIndex = iPart;
+
+			unsigned long long iPass = (i < KEY_PASS_MASK) ? i : KEY_PASS_MASK;
+			unsigned long long iState =	(iPass << KEY_PASS_SHIFT) |
+										((m_EffectIDs.getID(item.pEffect) & KEY_EFFECT_MASK) << KEY_EFFECT_SHIFT) |
+										((m_TextureIDs.getID(item.pTexture) & KEY_TEXTURE_MASK) << KEY_TEXTURE_SHIFT) |
+										(iMaterialID << KEY_MATERIAL_SHIFT) |
+										(iMeshID << KEY_MESH_SHIFT);
+
+			// Blended passes go after the opaque ones and back to front,
+			// state only orders items at the same depth
+			unsigned long long iKey;
+			if(pPass->isBlendEnabled()) {
+				iKey = KEY_BLENDED_BIT | ((KEY_DEPTH_MASK - iDepth) << KEY_BLENDED_DEPTH_SHIFT) | iState;
+			}
+			else {
+				iKey = (iState << KEY_OPAQUE_STATE_SHIFT) | iDepth;
+			}
+
+			m_vItems.push_back(item);
+			m_vKeys.push_back(iKey);
+		}
+	}
+
+	m_bSorted = false;
+}
+
+unsigned int RenderQueue::getItemCount() const {
+	return m_vItems.size();
+}
+
+void RenderQueue::sort() {
+
+	unsigned int iCount = m_vItems.size();
+
+	m_vOrder.resize(iCount);
+	for(unsigned int i = 0; i < iCount; i++) {
+		m_vOrder[i] = i;
+	}
+
+	// LSD radix sort on 8 bit digits, carrying the item order along. Digits
+	// every key shares (e.g. unused id bits) are skipped.
+	m_vSortKeys.assign(m_vKeys.begin(), m_vKeys.end());
+	m_vSortKeysOut.resize(iCount);
+	m_vSortOrder.resize(iCount);
+
+	unsigned int iHistogram[256];
+	for(unsigned int iShift = 0; iShift < 64; iShift += 8) {
+
+		memset(iHistogram, 0, sizeof(iHistogram));
+		for(unsigned int i = 0; i < iCount; i++) {
+			++iHistogram[(m_vSortKeys[i] >> iShift) & 0xFF];
+		}
+
+		if(iCount == 0 || iHistogram[(m_vSortKeys[0] >> iShift) & 0xFF] == iCount)
+			continue;
+
+		unsigned int iOffset = 0;
+		for(unsigned int b = 0; b < 256; b++) {
+			unsigned int iBucket = iHistogram[b];
+			iHistogram[b] = iOffset;
+			iOffset += iBucket;
+		}
+
+		for(unsigned int i = 0; i < iCount; i++) {
+			unsigned int iDst = iHistogram[(m_vSortKeys[i] >> iShift) & 0xFF]++;
+			m_vSortKeysOut[iDst] = m_vSortKeys[i];
+			m_vSortOrder[iDst] = m_vOrder[i];
+		}
+
+		m_vSortKeys.swap(m_vSortKeysOut);
+		m_vOrder.swap(m_vSortOrder);
+	}
+
+	m_bSorted = true;
+}
+
+void RenderQueue::computeStats(const unsigned int* pOrder, Stats* pStats) const {
+
+	memset(pStats, 0, sizeof(Stats));
+
+	const Item* pPrevious = NULL;
+	for(unsigned int i = 0; i < m_vItems.size(); i++) {
+
+		const Item& item = m_vItems[pOrder ? pOrder[i] : i];
+
+		if(!pPrevious || item.pEffect != pPrevious->pEffect)		++pStats->iEffectChanges;
+		if(!pPrevious || item.pPass != pPrevious->pPass)			++pStats->iPassChanges;
+		if(!pPrevious || item.pTexture != pPrevious->pTexture)		++pStats->iTextureChanges;
+		if(!pPrevious || item.pMesh != pPrevious->pMesh)			++pStats->iMeshChanges;
+
+		pPrevious = &item;
+	}
+
+	pStats->iDrawCount = m_vItems.size();
+}
+
+void RenderQueue::execute(bool bWireframe) {
+
+	if(m_bSortingEnabled && !m_bSorted)
+		sort();
+
+	const unsigned int* pOrder = (m_bSortingEnabled && !m_vOrder.empty()) ? &m_vOrder[0] : NULL;
+
+	computeStats(NULL, &m_UnsortedStats);
+	computeStats(pOrder, &m_SortedStats);
+
+	Effect* pCurrentEffect = NULL;
+	Pass* pCurrentPass = NULL;
+	for(unsigned int i = 0; i < m_vItems.size(); i++) {
+
+		const Item& item = m_vItems[pOrder ? pOrder[i] : i];
+
+		// Consecutive items of one pass share its parameters (materials are
+		// bound to a single node), only the geometry changes.
+		if(item.pPass != pCurrentPass) {
+
+			if(pCurrentPass)
+				pCurrentPass->unbind();
+
+			item.pPass->bind(item.pEffect != pCurrentEffect);
+			pCurrentEffect = item.pEffect;
+			pCurrentPass = item.pPass;
+		}
+
+		item.pModel->drawPart(item.iPartIndex, bWireframe);
+	}
+
+	if(pCurrentPass)
+		pCurrentPass->unbind();
+}
+
+void RenderQueue::setSortingEnabled(bool bEnable) {
+	m_bSortingEnabled = bEnable;
+}
+
+bool RenderQueue::isSortingEnabled() const {
+	return m_bSortingEnabled;
+}
+
+const RenderQueue::Stats& RenderQueue::getUnsortedStats() const {
+	return m_UnsortedStats;
+}
+
+const RenderQueue::Stats& RenderQueue::getSortedStats() const {
+	return m_SortedStats;
+}
@@ -4,6 +4,9 @@
 #include "Engine/Technique.h"
 #include "Engine/MaterialParameter.h"
 #include "Engine/Scene.h"
+#include "Engine/Model.h"
+#include "Engine/GLStateCache.h"
+#include "Engine/UniformBlocks.h"
 
 // Render state override bits
 #define RS_BLEND		1
@@ -213,7 +216,7 @@ void RenderState::applyAutoBinding(const char* pUniformName, const char* pAutoBi
 		else
 		if (strcmp(pAutoBinding, "MATRIX_PALETTE") == 0)
 		{
-
+			pMaterialParameter->bindValue(this, &RenderState::autoBindingGetMatrixPalette, &RenderState::autoBindingGetMatrixPaletteSize);
 		}
 		else
 		if (strcmp(pAutoBinding, "SCENE_AMBIENT_COLOR") == 0)
@@ -283,29 +286,29 @@ Vector3 RenderState::autoBindingGetCameraViewPosition() const
 	return m_pNodeBinding ? m_pNodeBinding->getActiveCameraTranslationView() : Vector3::zero();
 }
 
-//const Vector4* RenderState::autoBindingGetMatrixPalette() const
-//{
-//	Model* model = dynamic_cast<Model*>(m_pNodeBinding->getDrawable());
-//	if (model)
-//	{
-//		MeshSkin* skin = model->getSkin();
-//		if (skin)
-//			return skin->getMatrixPalette();
-//	}
-//	return NULL;
-//}
-//
-//unsigned int RenderState::autoBindingGetMatrixPaletteSize() const
-//{
-//	Model* model = dynamic_cast<Model*>(m_pNodeBinding->getDrawable());
-//	if (model)
-//	{
-//		MeshSkin* skin = model->getSkin();
-//		if (skin)
-//			return skin->getMatrixPaletteSize();
-//	}
-//	return 0;
-//}
+const Vector4* RenderState::autoBindingGetMatrixPalette() const
+{
+	// One identity joint for nodes without a skinned model, the uniform
+	// still needs valid data
+	static const Vector4 identityPalette[3] = {
+		Vector4(1.0f, 0.0f, 0.0f, 0.0f),
+		Vector4(0.0f, 1.0f, 0.0f, 0.0f),
+		Vector4(0.0f, 0.0f, 1.0f, 0.0f)
+	};
+
+	Model* pModel = m_pNodeBinding ? m_pNodeBinding->getModel() : NULL;
+	if (pModel && pModel->getMatrixPalette())
+		return pModel->getMatrixPalette();
+	return identityPalette;
+}
+
+unsigned int RenderState::autoBindingGetMatrixPaletteSize() const
+{
+	Model* pModel = m_pNodeBinding ? m_pNodeBinding->getModel() : NULL;
+	if (pModel && pModel->getMatrixPalette())
+		return pModel->getMatrixPaletteSize();
+	return 3;
+}
 
 const Vector3& RenderState::autoBindingGetAmbientColor() const
 {
@@ -333,9 +336,14 @@ void RenderState::bind(Pass* pPass) {
 	// Restore renderer state to its default, except for explicitly specified states
 	StateBlock::restore(lStateOverrideBits);
 
+	// Autobindings the effect reads from uniform blocks cost a range bind
+	Effect* pEffect = pPass->getEffect();
+	if(pEffect->getUniformBlocks() != 0) {
+		UniformBlocks::bind(m_pNodeBinding, pEffect->getUniformBlocks());
+	}
+
 	// Apply parameter bindings and renderer state for the entire hierarchy, top-down.
 	pParentRS = NULL;
-	Effect* pEffect = pPass->getEffect();
 	while (pParentRS = getTopmost(pParentRS)) {
 
 		for (size_t i = 0, count = pParentRS->m_vParameters.size(); i < count; i++) {
@@ -395,6 +403,34 @@ MaterialParameter* RenderState::getParameter(const char* sName) const {
 	return pMaterialParameter;
 }
 
+Texture* RenderState::getPrimaryTexture() const {
+
+	for(const RenderState* rs = this; rs != NULL; rs = rs->m_pParent) {
+		for(size_t i = 0; i < rs->m_vParameters.size(); i++) {
+
+			Texture::Sampler* pSampler = rs->m_vParameters[i]->getSampler();
+			if(pSampler) {
+				return pSampler->getTexture();
+			}
+		}
+	}
+
+	return NULL;
+}
+
+bool RenderState::isBlendEnabled() const {
+
+	// bind() applies the state blocks from the topmost parent down, the
+	// nearest one setting blend wins
+	for(const RenderState* rs = this; rs != NULL; rs = rs->m_pParent) {
+		if(rs->m_pStateBlock && (rs->m_pStateBlock->m_lBits & RS_BLEND)) {
+			return rs->m_pStateBlock->m_bBlendEnabled;
+		}
+	}
+
+	return false;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 //RenderState
 ///////////////////////////////////////////////////////////////////////////
@@ -409,7 +445,7 @@ RenderState::StateBlock::StateBlock()
 		m_eBlendDst(RenderState::BLEND_ZERO),
 		m_bCullFaceEnabled(false),
 		m_bDepthTestEnabled(false),
-		m_bDepthWriteEnabled(false),
+		m_bDepthWriteEnabled(true),
 		m_lBits(0L)
 {
 
@@ -449,10 +485,7 @@ void RenderState::StateBlock::bindNoRestore() {
 		&& 
 		(m_bBlendEnabled != m_pDefaultState->m_bBlendEnabled)
 	) {
-			if(m_bBlendEnabled)
-				GL_ASSERT( glEnable(GL_BLEND) );
-			else
-				GL_ASSERT( glDisable(GL_BLEND) );
+			GLStateCache::setEnabled(GL_BLEND, m_bBlendEnabled);
 
 			m_pDefaultState->m_bBlendEnabled = m_bBlendEnabled;
 	}
@@ -464,7 +497,7 @@ void RenderState::StateBlock::bindNoRestore() {
 			m_eBlendDst != m_pDefaultState->m_eBlendDst
 		)
 	) {
-		GL_ASSERT( glBlendFunc((GLenum)m_eBlendSrc, (GLenum)m_eBlendDst) );
+		GLStateCache::blendFunc((GLenum)m_eBlendSrc, (GLenum)m_eBlendDst);
 
 		m_pDefaultState->m_eBlendSrc = m_eBlendSrc;
 		m_pDefaultState->m_eBlendDst = m_eBlendDst;
@@ -474,10 +507,7 @@ void RenderState::StateBlock::bindNoRestore() {
 		&&
 		(m_bCullFaceEnabled != m_pDefaultState->m_bCullFaceEnabled)
 	) {
-		if(m_bCullFaceEnabled)
-			GL_ASSERT( glEnable(GL_CULL_FACE) );
-		else
-			GL_ASSERT( glDisable(GL_CULL_FACE) );
+		GLStateCache::setEnabled(GL_CULL_FACE, m_bCullFaceEnabled);
 
 		m_pDefaultState->m_bCullFaceEnabled = m_bCullFaceEnabled;
 	}
@@ -486,10 +516,7 @@ void RenderState::StateBlock::bindNoRestore() {
 		&&
 		(m_bDepthTestEnabled != m_pDefaultState->m_bDepthTestEnabled)
 		) {
-			if (m_bDepthTestEnabled)
-				GL_ASSERT( glEnable(GL_DEPTH_TEST) );
-			else
-				GL_ASSERT( glDisable(GL_DEPTH_TEST) );
+			GLStateCache::setEnabled(GL_DEPTH_TEST, m_bDepthTestEnabled);
 
 			m_pDefaultState->m_bDepthTestEnabled = m_bDepthTestEnabled;
 	}
@@ -498,7 +525,7 @@ void RenderState::StateBlock::bindNoRestore() {
 		&&
 		(m_bDepthWriteEnabled != m_pDefaultState->m_bDepthWriteEnabled)
 		) {
-			GL_ASSERT( glDepthMask( m_bDepthWriteEnabled ? GL_TRUE : GL_FALSE) );
+			GLStateCache::depthMask(m_bDepthWriteEnabled);
 
 			m_pDefaultState->m_bDepthWriteEnabled = m_bDepthWriteEnabled;
 	}
@@ -518,14 +545,14 @@ void RenderState::StateBlock::restore(long stateOverrideBits) {
 	// Restore any state that is not overridden and is not default
 	if (!(stateOverrideBits & RS_BLEND) && (m_pDefaultState->m_lBits & RS_BLEND)) {
 
-		GL_ASSERT( glDisable(GL_BLEND) );
+		GLStateCache::setEnabled(GL_BLEND, false);
 		m_pDefaultState->m_lBits &= ~RS_BLEND;
 		m_pDefaultState->m_bBlendEnabled = false;
 	}
 
 	if (!(stateOverrideBits & RS_BLEND_FUNC) && (m_pDefaultState->m_lBits & RS_BLEND_FUNC)) {
 
-		GL_ASSERT( glBlendFunc(GL_ONE, GL_ZERO) );
+		GLStateCache::blendFunc(GL_ONE, GL_ZERO);
 
 		m_pDefaultState->m_lBits &= ~RS_BLEND_FUNC;
 		m_pDefaultState->m_eBlendSrc = RenderState::BLEND_ONE;
@@ -534,7 +561,7 @@ void RenderState::StateBlock::restore(long stateOverrideBits) {
 
 	if (!(stateOverrideBits & RS_CULL_FACE) && (m_pDefaultState->m_lBits & RS_CULL_FACE)) {
 
-		GL_ASSERT( glDisable(GL_CULL_FACE) );
+		GLStateCache::setEnabled(GL_CULL_FACE, false);
 
 		m_pDefaultState->m_lBits &= ~RS_CULL_FACE;
 		m_pDefaultState->m_bCullFaceEnabled = false;
@@ -542,7 +569,7 @@ void RenderState::StateBlock::restore(long stateOverrideBits) {
 
 	if (!(stateOverrideBits & RS_DEPTH_TEST) && (m_pDefaultState->m_lBits & RS_DEPTH_TEST)) {
 
-		GL_ASSERT( glDisable(RS_DEPTH_TEST) );
+		GLStateCache::setEnabled(GL_DEPTH_TEST, false);
 
 		m_pDefaultState->m_lBits &= ~RS_DEPTH_TEST;
 		m_pDefaultState->m_bDepthTestEnabled = false;
@@ -550,10 +577,10 @@ void RenderState::StateBlock::restore(long stateOverrideBits) {
 
 	if (!(stateOverrideBits & RS_DEPTH_WRITE) && (m_pDefaultState->m_lBits & RS_DEPTH_WRITE)) {
 
-		GL_ASSERT( glDepthMask(GL_TRUE) );
+		GLStateCache::depthMask(true);
 
 		m_pDefaultState->m_lBits &= ~RS_DEPTH_WRITE;
-		m_pDefaultState->m_bDepthWriteEnabled = false;
+		m_pDefaultState->m_bDepthWriteEnabled = true;
 	}
 }
 
@@ -566,7 +593,7 @@ void RenderState::StateBlock::enableDepthWrite() {
 	// next frame leaves depth writing disabled.
 	if (!m_pDefaultState->m_bDepthWriteEnabled) {
 
-		GL_ASSERT( glDepthMask(GL_TRUE) );
+		GLStateCache::depthMask(true);
 		m_pDefaultState->m_lBits &= ~RS_DEPTH_WRITE;
 		m_pDefaultState->m_bDepthWriteEnabled = true;
 	}
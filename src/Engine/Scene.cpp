@@ -1,13 +1,57 @@
 #include "Engine/Scene.h"
 #include "Engine/Node.h"
 #include "Engine/Camera.h"
+#include "Engine/Model.h"
+#include "Engine/Mesh.h"
+#include "Engine/RenderQueue.h"
+#include "Common/Frustum.h"
+#include "Common/Ray.h"
+#include "Common/DynamicAABBTree.h"
+#include <cfloat>
+
+// Stand-in box for models without bounds, they must never be culled
+static const float UNBOUNDED_EXTENT = 1.0e12f;
+
+static BoundingBox getIndexBox(const Node* pNode) {
+
+	const BoundingBox& box = pNode->getWorldBoundingBox();
+	if(box.isEmpty()) {
+		return BoundingBox(	Vector3(-UNBOUNDED_EXTENT, -UNBOUNDED_EXTENT, -UNBOUNDED_EXTENT),
+							Vector3(UNBOUNDED_EXTENT, UNBOUNDED_EXTENT, UNBOUNDED_EXTENT));
+	}
+
+	return box;
+}
+
+static bool hasDynamicBounds(const Node* pNode) {
+
+	Model* pModel = pNode->getModel();
+	Mesh* pMesh = pModel ? pModel->getMesh() : NULL;
+	return pMesh && pMesh->isDynamic();
+}
+
+static float raycastNode(void* pUserData, const Ray& ray, float fMaxDistance, void* pContext) {
+
+	const BoundingBox& box = ((Node*)pUserData)->getWorldBoundingBox();
+
+	float fDistance;
+	if(!ray.intersects(box, &fDistance))
+		return -1.0f;
+
+	return fDistance;
+}
 
 Scene::Scene()
 	:	m_sID(""),
 		m_pActiveCamera(NULL),
 		m_pFirstNode(NULL),
 		m_pLastNode(NULL),
-		m_iNodeCount(0)
+		m_iNodeCount(0),
+		m_bFrustumCulling(true),
+		m_iVisibleNodeCount(0),
+		m_iCulledNodeCount(0),
+		m_pSpatialIndex(NULL),
+		m_pRenderQueue(NULL)
 {
 
 }
@@ -65,6 +109,7 @@ void Scene::addNode(Node* pNode) {
 	}
 
 	pNode->setScene(this);
+	indexNode(pNode, true);
 
 	++m_iNodeCount;
 
@@ -145,9 +190,294 @@ void Scene::setAmbientColor(float red, float green, float blue) {
 
 void Scene::render() {
 
+	m_iVisibleNodeCount = 0;
+	m_iCulledNodeCount = 0;
+
+	const Frustum* pFrustum = (m_bFrustumCulling && m_pActiveCamera) ? &m_pActiveCamera->getFrustum() : NULL;
+
+	if(m_pRenderQueue) {
+		m_pRenderQueue->clear();
+	}
+
+	if(pFrustum && m_pSpatialIndex) {
+		queryNodes(*pFrustum, m_vQueryNodes);
+
+		for(unsigned int i = 0; i < m_vQueryNodes.size(); i++) {
+			drawNode(m_vQueryNodes[i], !true);
+		}
+
+		m_iVisibleNodeCount = m_vQueryNodes.size();
+		m_iCulledNodeCount = m_pSpatialIndex->getProxyCount() - m_iVisibleNodeCount;
+	}
+	else {
+		for(Node* node = m_pFirstNode; node != NULL; node = node->getNextSibling()) {
+			renderNode(node, !true, pFrustum);
+ 		}
+	}
+
+	if(m_pRenderQueue) {
+		m_pRenderQueue->execute(!true);
+	}
+}
+
+void Scene::drawNode(Node* pNode, bool bWireframe) {
+
+	if(m_pRenderQueue) {
+		// Distance from the eye, both positions in world space
+		Node* pCameraNode = m_pActiveCamera ? m_pActiveCamera->getNode() : NULL;
+		float fDepth = pCameraNode ? (pNode->getTranslationWorld() - pCameraNode->getTranslationWorld()).length() : 0.0f;
+		m_pRenderQueue->submit(pNode->getModel(), fDepth);
+	}
+	else {
+		pNode->getModel()->draw(bWireframe);
+	}
+}
+
+void Scene::renderNode(Node* pNode, bool bWireframe, const Frustum* pFrustum) {
+
+	// Same traversal as Node::render(). Bounds are per model rather than per
+	// subtree, so children of a culled model are still tested on their own.
+	Model* pModel = pNode->getModel();
+	if(pModel) {
+		if(pFrustum && !pNode->isVisible(*pFrustum)) {
+			++m_iCulledNodeCount;
+		}
+		else {
+			drawNode(pNode, bWireframe);
+			++m_iVisibleNodeCount;
+		}
+
+		for(Node* node = pNode->getFirstChild(); node != NULL; node = node->getNextSibling()) {
+			renderNode(node, bWireframe, pFrustum);
+		}
+	}
+}
+
+void Scene::setFrustumCulling(bool bEnable) {
+	m_bFrustumCulling = bEnable;
+}
+
+bool Scene::isFrustumCulling() const {
+	return m_bFrustumCulling;
+}
+
+unsigned int Scene::getVisibleNodeCount() const {
+	return m_iVisibleNodeCount;
+}
+
+unsigned int Scene::getCulledNodeCount() const {
+	return m_iCulledNodeCount;
+}
+
+void Scene::setSpatialIndexEnabled(bool bEnable) {
+
+	if(bEnable == (m_pSpatialIndex != NULL))
+		return;
+
+	if(bEnable) {
+		m_pSpatialIndex = new DynamicAABBTree();
+		for(Node* node = m_pFirstNode; node != NULL; node = node->getNextSibling()) {
+			indexNode(node, true);
+		}
+	}
+	else {
+		for(Node* node = m_pFirstNode; node != NULL; node = node->getNextSibling()) {
+			unindexNode(node);
+		}
+		SAFE_DELETE( m_pSpatialIndex );
+	}
+}
+
+void Scene::setRenderQueueEnabled(bool bEnable) {
+
+	if(bEnable && m_pRenderQueue == NULL) {
+		m_pRenderQueue = RenderQueue::create();
+	}
+	else if(!bEnable) {
+		SAFE_DELETE( m_pRenderQueue );
+	}
+}
+
+RenderQueue* Scene::getRenderQueue() const {
+	return m_pRenderQueue;
+}
+
+bool Scene::isSpatialIndexEnabled() const {
+	return m_pSpatialIndex != NULL;
+}
+
+DynamicAABBTree* Scene::getSpatialIndex() const {
+	return m_pSpatialIndex;
+}
+
+void Scene::indexNode(Node* pNode, bool bRecursive) {
+
+	if(m_pSpatialIndex == NULL)
+		return;
+
+	// Still registered with another scene's index
+	if(pNode->m_pSpatialIndex && pNode->m_pSpatialIndex != m_pSpatialIndex) {
+		pNode->m_pSpatialIndex->destroyProxy(pNode->m_iSpatialProxy);
+		pNode->m_pSpatialIndex = NULL;
+		pNode->m_iSpatialProxy = DynamicAABBTree::NULL_PROXY;
+	}
+
+	if(pNode->getModel()) {
+		if(pNode->m_pSpatialIndex) {
+			m_pSpatialIndex->markDirty(pNode->m_iSpatialProxy);
+		}
+		else {
+			pNode->m_iSpatialProxy = m_pSpatialIndex->createProxy(getIndexBox(pNode), pNode);
+			pNode->m_pSpatialIndex = m_pSpatialIndex;
+
+			if(hasDynamicBounds(pNode))
+				m_pSpatialIndex->markDirty(pNode->m_iSpatialProxy);
+		}
+	}
+	else if(pNode->m_pSpatialIndex) {
+		m_pSpatialIndex->destroyProxy(pNode->m_iSpatialProxy);
+		pNode->m_pSpatialIndex = NULL;
+		pNode->m_iSpatialProxy = DynamicAABBTree::NULL_PROXY;
+	}
+
+	if(bRecursive) {
+		for(Node* node = pNode->getFirstChild(); node != NULL; node = node->getNextSibling()) {
+			indexNode(node, true);
+		}
+	}
+}
+
+void Scene::unindexNode(Node* pNode) {
+
+	if(pNode->m_pSpatialIndex) {
+		pNode->m_pSpatialIndex->destroyProxy(pNode->m_iSpatialProxy);
+		pNode->m_pSpatialIndex = NULL;
+		pNode->m_iSpatialProxy = DynamicAABBTree::NULL_PROXY;
+	}
+
+	for(Node* node = pNode->getFirstChild(); node != NULL; node = node->getNextSibling()) {
+		unindexNode(node);
+	}
+}
+
+void Scene::updateSpatialIndex() {
+
+	if(m_pSpatialIndex == NULL)
+		return;
+
+	m_pSpatialIndex->takeDirtyProxies(m_vDirtyProxies);
+
+	for(unsigned int i = 0; i < m_vDirtyProxies.size(); i++) {
+
+		int iProxy = m_vDirtyProxies[i];
+		Node* pNode = (Node*)m_pSpatialIndex->getUserData(iProxy);
+		m_pSpatialIndex->moveProxy(iProxy, getIndexBox(pNode));
+
+		// Deforming meshes (MD5) change their bounds without a transform
+		// change, keep them on the list.
+		if(hasDynamicBounds(pNode))
+			m_pSpatialIndex->markDirty(iProxy);
+	}
+}
+
+void Scene::collectNodes(Node* pNode, std::vector<Node*>& vNodes) const {
+
+	if(pNode->getModel())
+		vNodes.push_back(pNode);
+
+	for(Node* node = pNode->getFirstChild(); node != NULL; node = node->getNextSibling()) {
+		collectNodes(node, vNodes);
+	}
+}
+
+void Scene::queryNodes(const Frustum& frustum, std::vector<Node*>& vNodes) {
+
+	vNodes.clear();
+
+	if(m_pSpatialIndex) {
+		updateSpatialIndex();
+
+		m_vQueryResults.clear();
+		m_pSpatialIndex->query(frustum, m_vQueryResults);
+
+		for(unsigned int i = 0; i < m_vQueryResults.size(); i++) {
+			Node* pNode = (Node*)m_vQueryResults[i];
+			if(pNode->isVisible(frustum))
+				vNodes.push_back(pNode);
+		}
+		return;
+	}
+
 	for(Node* node = m_pFirstNode; node != NULL; node = node->getNextSibling()) {
-		node->render(!true);
- 	}
+		collectNodes(node, vNodes);
+	}
+
+	unsigned int iCount = 0;
+	for(unsigned int i = 0; i < vNodes.size(); i++) {
+		if(vNodes[i]->isVisible(frustum))
+			vNodes[iCount++] = vNodes[i];
+	}
+	vNodes.resize(iCount);
+}
+
+void Scene::queryNodes(const BoundingSphere& sphere, std::vector<Node*>& vNodes) {
+
+	vNodes.clear();
+
+	if(m_pSpatialIndex) {
+		updateSpatialIndex();
+
+		m_vQueryResults.clear();
+		m_pSpatialIndex->query(sphere, m_vQueryResults);
+
+		for(unsigned int i = 0; i < m_vQueryResults.size(); i++) {
+			Node* pNode = (Node*)m_vQueryResults[i];
+			const BoundingBox& box = pNode->getWorldBoundingBox();
+			if(box.isEmpty() || box.intersects(sphere))
+				vNodes.push_back(pNode);
+		}
+		return;
+	}
+
+	for(Node* node = m_pFirstNode; node != NULL; node = node->getNextSibling()) {
+		collectNodes(node, vNodes);
+	}
+
+	unsigned int iCount = 0;
+	for(unsigned int i = 0; i < vNodes.size(); i++) {
+		const BoundingBox& box = vNodes[i]->getWorldBoundingBox();
+		if(box.isEmpty() || box.intersects(sphere))
+			vNodes[iCount++] = vNodes[i];
+	}
+	vNodes.resize(iCount);
+}
+
+Node* Scene::pickNode(const Ray& ray, float* pDistance) {
+
+	if(m_pSpatialIndex) {
+		updateSpatialIndex();
+		return (Node*)m_pSpatialIndex->raycast(ray, FLT_MAX, raycastNode, NULL, pDistance);
+	}
+
+	m_vQueryNodes.clear();
+	for(Node* node = m_pFirstNode; node != NULL; node = node->getNextSibling()) {
+		collectNodes(node, m_vQueryNodes);
+	}
+
+	Node* pClosest = NULL;
+	float fClosest = FLT_MAX;
+	for(unsigned int i = 0; i < m_vQueryNodes.size(); i++) {
+		float fDistance = raycastNode(m_vQueryNodes[i], ray, fClosest, NULL);
+		if(fDistance >= 0.0f && fDistance < fClosest) {
+			fClosest = fDistance;
+			pClosest = m_vQueryNodes[i];
+		}
+	}
+
+	if(pDistance && pClosest)
+		*pDistance = fClosest;
+
+	return pClosest;
 }
 
 Scene::~Scene() {
@@ -156,4 +486,6 @@ Scene::~Scene() {
 	}
 
 	removeAllNodes();
+	SAFE_DELETE( m_pSpatialIndex );
+	SAFE_DELETE( m_pRenderQueue );
 }
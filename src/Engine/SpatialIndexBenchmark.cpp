@@ -0,0 +1,198 @@
+#include "Engine/SpatialIndexBenchmark.h"
+#include "Engine/Timer.h"
+#include "Common/DynamicAABBTree.h"
+#include <cmath>
+#include <cstdio>
+#include <cfloat>
+
+static unsigned int s_iSeed = 1;
+
+static float randomFloat(float fMin, float fMax) {
+
+	s_iSeed = s_iSeed * 1664525u + 1013904223u;
+	return fMin + (fMax - fMin) * ((s_iSeed >> 8) / 16777216.0f);
+}
+
+static Vector3 randomVector(float fMin, float fMax) {
+
+	float x = randomFloat(fMin, fMax);
+	float y = randomFloat(fMin, fMax);
+	float z = randomFloat(fMin, fMax);
+	return Vector3(x, y, z);
+}
+
+static double stopMs(Timer& timer) {
+
+	timer.stop();
+	return timer.getElapsedTimeInMilliSec();
+}
+
+void SpatialIndexBenchmark::run(unsigned int iProxyCount, unsigned int iQueryCount, Result* pResult) {
+
+	GP_ASSERT( pResult );
+
+	s_iSeed = 1;
+	float fHalfWorld = 5.0f * powf((float)iProxyCount, 1.0f / 3.0f);
+
+	std::vector<BoundingBox> vBoxes(iProxyCount);
+	for(unsigned int i = 0; i < iProxyCount; i++) {
+		Vector3 vCenter = randomVector(-fHalfWorld, fHalfWorld);
+		Vector3 vExtent = randomVector(0.25f, 1.0f);
+		vBoxes[i].set(vCenter - vExtent, vCenter + vExtent);
+	}
+
+	// Queries, frustums look down -Z from random points
+	std::vector<Frustum> vFrustums(iQueryCount);
+	std::vector<Ray> vRays(iQueryCount);
+	std::vector<BoundingSphere> vSpheres(iQueryCount);
+	for(unsigned int i = 0; i < iQueryCount; i++) {
+
+		float n = 1.0f, f = 50.0f;
+		Matrix4 projection(	1.0f, 0.0f, 0.0f, 0.0f,
+							0.0f, 1.0f, 0.0f, 0.0f,
+							0.0f, 0.0f, -(f + n) / (f - n), -2.0f * f * n / (f - n),
+							0.0f, 0.0f, -1.0f, 0.0f);
+		Vector3 vEye = randomVector(-fHalfWorld, fHalfWorld);
+		Matrix4 view;
+		view.translate(-vEye.x, -vEye.y, -vEye.z);
+		vFrustums[i].set(projection * view);
+
+		vRays[i].set(randomVector(-fHalfWorld, fHalfWorld), randomVector(-1.0f, 1.0f));
+		vSpheres[i].set(randomVector(-fHalfWorld, fHalfWorld), 10.0f);
+	}
+
+	Timer timer;
+	std::vector<void*> vResults;
+	std::vector<int> vProxies(iProxyCount);
+	unsigned int iMismatch = 0;
+
+	pResult->iProxyCount = iProxyCount;
+	pResult->iQueryCount = iQueryCount;
+
+	// Build
+	DynamicAABBTree tree;
+	timer.start();
+	for(unsigned int i = 0; i < iProxyCount; i++) {
+		vProxies[i] = tree.createProxy(vBoxes[i], &vBoxes[i]);
+	}
+	pResult->dBuildMs = stopMs(timer);
+	pResult->iTreeHeight = tree.getHeight();
+
+	// Refit, small moves mostly stay inside the fat boxes
+	timer.start();
+	for(unsigned int i = 0; i < iProxyCount; i += 10) {
+		Vector3 vMove = randomVector(-0.2f, 0.2f);
+		vBoxes[i].min += vMove;
+		vBoxes[i].max += vMove;
+		tree.moveProxy(vProxies[i], vBoxes[i]);
+	}
+	pResult->dRefitMs = stopMs(timer);
+
+	// Frustum
+	std::vector<unsigned int> vTreeCounts(iQueryCount);
+	timer.start();
+	for(unsigned int q = 0; q < iQueryCount; q++) {
+		vResults.clear();
+		tree.query(vFrustums[q], vResults);
+
+		unsigned int iCount = 0;
+		for(unsigned int i = 0; i < vResults.size(); i++) {
+			if(vFrustums[q].intersects(*(BoundingBox*)vResults[i]))
+				++iCount;
+		}
+		vTreeCounts[q] = iCount;
+	}
+	pResult->dTreeFrustumMs = stopMs(timer);
+
+	timer.start();
+	for(unsigned int q = 0; q < iQueryCount; q++) {
+		unsigned int iCount = 0;
+		for(unsigned int i = 0; i < iProxyCount; i++) {
+			if(vFrustums[q].intersects(vBoxes[i]))
+				++iCount;
+		}
+		if(iCount != vTreeCounts[q])
+			++iMismatch;
+	}
+	pResult->dBruteFrustumMs = stopMs(timer);
+
+	// Ray, closest hit
+	std::vector<float> vTreeDistances(iQueryCount);
+	timer.start();
+	for(unsigned int q = 0; q < iQueryCount; q++) {
+		float fDistance = -1.0f;
+		struct Exact {
+			static float test(void* pUserData, const Ray& ray, float fMaxDistance, void* pContext) {
+				float t;
+				return ray.intersects(*(BoundingBox*)pUserData, &t) ? t : -1.0f;
+			}
+		};
+		tree.raycast(vRays[q], FLT_MAX, Exact::test, NULL, &fDistance);
+		vTreeDistances[q] = fDistance;
+	}
+	pResult->dTreeRayMs = stopMs(timer);
+
+	timer.start();
+	for(unsigned int q = 0; q < iQueryCount; q++) {
+		float fClosest = FLT_MAX;
+		for(unsigned int i = 0; i < iProxyCount; i++) {
+			float t;
+			if(vRays[q].intersects(vBoxes[i], &t) && t < fClosest)
+				fClosest = t;
+		}
+		if(fClosest == FLT_MAX)
+			fClosest = -1.0f;
+		if(fClosest != vTreeDistances[q])
+			++iMismatch;
+	}
+	pResult->dBruteRayMs = stopMs(timer);
+
+	// Radius
+	timer.start();
+	for(unsigned int q = 0; q < iQueryCount; q++) {
+		vResults.clear();
+		tree.query(vSpheres[q], vResults);
+
+		unsigned int iCount = 0;
+		for(unsigned int i = 0; i < vResults.size(); i++) {
+			if(((BoundingBox*)vResults[i])->intersects(vSpheres[q]))
+				++iCount;
+		}
+		vTreeCounts[q] = iCount;
+	}
+	pResult->dTreeRadiusMs = stopMs(timer);
+
+	timer.start();
+	for(unsigned int q = 0; q < iQueryCount; q++) {
+		unsigned int iCount = 0;
+		for(unsigned int i = 0; i < iProxyCount; i++) {
+			if(vBoxes[i].intersects(vSpheres[q]))
+				++iCount;
+		}
+		if(iCount != vTreeCounts[q])
+			++iMismatch;
+	}
+	pResult->dBruteRadiusMs = stopMs(timer);
+
+	pResult->iMismatchCount = iMismatch;
+}
+
+void SpatialIndexBenchmark::runAll() {
+
+	const unsigned int iCounts[] = { 1000, 10000, 100000 };
+	const unsigned int iQueryCount = 100;
+
+	printf("proxies  height  build(ms)  refit(ms)  frustum tree/brute(ms)  ray tree/brute(ms)  radius tree/brute(ms)  mismatches\n");
+	for(unsigned int i = 0; i < sizeof(iCounts) / sizeof(iCounts[0]); i++) {
+
+		Result result;
+		run(iCounts[i], iQueryCount, &result);
+
+		printf("%7u  %6d  %9.3f  %9.3f  %10.3f / %9.3f  %8.3f / %9.3f  %9.3f / %9.3f  %10u\n",
+			result.iProxyCount, result.iTreeHeight, result.dBuildMs, result.dRefitMs,
+			result.dTreeFrustumMs, result.dBruteFrustumMs,
+			result.dTreeRayMs, result.dBruteRayMs,
+			result.dTreeRadiusMs, result.dBruteRadiusMs,
+			result.iMismatchCount);
+	}
+}
@@ -0,0 +1,310 @@
+#include "Engine/SpriteAtlas.h"
+#include "Engine/Image.h"
+#include "Engine/GLStateCache.h"
+#include <cstring>
+
+SpriteAtlas::SpriteAtlas(unsigned int iPageWidth, unsigned int iPageHeight, unsigned int iPadding)
+	:	m_iPageWidth(iPageWidth),
+		m_iPageHeight(iPageHeight),
+		m_iPadding(iPadding)
+{
+
+}
+
+SpriteAtlas::~SpriteAtlas() {
+
+	for(unsigned int i = 0; i < m_vPages.size(); i++) {
+		SAFE_DELETE( m_vPages[i] );
+	}
+	m_vPages.clear();
+}
+
+SpriteAtlas* SpriteAtlas::create(unsigned int iPageWidth, unsigned int iPageHeight, unsigned int iPadding) {
+
+	GP_ASSERT( iPageWidth > 0 && iPageHeight > 0 );
+	return new SpriteAtlas(iPageWidth, iPageHeight, iPadding);
+}
+
+void SpriteAtlas::addPage() {
+
+	Page* pPage = new Page();
+	pPage->vPixels.resize(m_iPageWidth * m_iPageHeight * 4, 0);
+	pPage->iUsedArea = 0;
+
+	SkylineNode node;
+	node.x = 0;
+	node.y = 0;
+	node.iWidth = m_iPageWidth;
+	pPage->vSkyline.push_back(node);
+
+	m_vPages.push_back(pPage);
+}
+
+bool SpriteAtlas::fit(const Page& page, unsigned int iNode, unsigned int iWidth, unsigned int iHeight, unsigned int* pY) const {
+
+	const std::vector<SkylineNode>& vSkyline = page.vSkyline;
+
+	unsigned int x = vSkyline[iNode].x;
+	if(x + iWidth > m_iPageWidth)
+		return false;
+
+	// The rectangle rests on the highest segment it spans
+	unsigned int y = 0;
+	unsigned int iWidthLeft = iWidth;
+	for(unsigned int i = iNode; iWidthLeft > 0; i++) {
+
+		GP_ASSERT( i < vSkyline.size() );
+		y = std::max(y, vSkyline[i].y);
+		if(y + iHeight > m_iPageHeight)
+			return false;
+
+		if(vSkyline[i].iWidth >= iWidthLeft)
+			break;
+		iWidthLeft -= vSkyline[i].iWidth;
+	}
+
+	*pY = y;
+	return true;
+}
+
+bool SpriteAtlas::pack(Page& page, unsigned int iWidth, unsigned int iHeight, unsigned int* pX, unsigned int* pY) {
+
+	std::vector<SkylineNode>& vSkyline = page.vSkyline;
+
+	// Bottom-left: lowest resulting top edge, then the narrowest segment
+	int iBest = -1;
+	unsigned int iBestTop = 0;
+	unsigned int iBestWidth = 0;
+	unsigned int iBestY = 0;
+
+	for(unsigned int i = 0; i < vSkyline.size(); i++) {
+
+		unsigned int y;
+		if(!fit(page, i, iWidth, iHeight, &y))
+			continue;
+
+		unsigned int iTop = y + iHeight;
+		if(iBest < 0 || iTop < iBestTop || (iTop == iBestTop && vSkyline[i].iWidth < iBestWidth)) {
+			iBest = i;
+			iBestTop = iTop;
+			iBestWidth = vSkyline[i].iWidth;
+			iBestY = y;
+		}
+	}
+
+	if(iBest < 0)
+		return false;
+
+	// Raise the skyline over the new rectangle
+	SkylineNode node;
+	node.x = vSkyline[iBest].x;
+	node.y = iBestY + iHeight;
+	node.iWidth = iWidth;
+	vSkyline.insert(vSkyline.begin() + iBest, node);
+
+	// Cut the segments it now covers
+	for(unsigned int i = iBest + 1; i < vSkyline.size(); ) {
+
+		unsigned int iPreviousEnd = vSkyline[i - 1].x + vSkyline[i - 1].iWidth;
+		if(vSkyline[i].x >= iPreviousEnd)
+			break;
+
+		unsigned int iShrink = iPreviousEnd - vSkyline[i].x;
+		if(vSkyline[i].iWidth <= iShrink) {
+			vSkyline.erase(vSkyline.begin() + i);
+			continue;
+		}
+
+		vSkyline[i].x += iShrink;
+		vSkyline[i].iWidth -= iShrink;
+		break;
+	}
+
+	// Merge neighbours of the same height
+	for(unsigned int i = 0; i + 1 < vSkyline.size(); ) {
+		if(vSkyline[i].y == vSkyline[i + 1].y) {
+			vSkyline[i].iWidth += vSkyline[i + 1].iWidth;
+			vSkyline.erase(vSkyline.begin() + i + 1);
+		}
+		else {
+			i++;
+		}
+	}
+
+	page.iUsedArea += iWidth * iHeight;
+
+	*pX = node.x;
+	*pY = iBestY;
+	return true;
+}
+
+void SpriteAtlas::blit(Page& page, unsigned int x, unsigned int y, const unsigned char* pPixels, unsigned int iWidth, unsigned int iHeight, Texture::Format format) {
+
+	unsigned int iComponents;
+	switch(format) {
+		case Texture::RGB:
+			iComponents = 3;
+		break;
+		case Texture::ALPHA:
+			iComponents = 1;
+		break;
+		default:
+			iComponents = 4;
+		break;
+	}
+
+	for(unsigned int row = 0; row < iHeight; row++) {
+
+		const unsigned char* pSrc = pPixels + row * iWidth * iComponents;
+		unsigned char* pDst = &page.vPixels[((y + row) * m_iPageWidth + x) * 4];
+
+		if(iComponents == 4) {
+			memcpy(pDst, pSrc, iWidth * 4);
+			continue;
+		}
+
+		for(unsigned int col = 0; col < iWidth; col++, pDst += 4, pSrc += iComponents) {
+			if(iComponents == 3) {
+				pDst[0] = pSrc[0];
+				pDst[1] = pSrc[1];
+				pDst[2] = pSrc[2];
+				pDst[3] = 255;
+			}
+			else {
+				// Alpha only images tint white
+				pDst[0] = pDst[1] = pDst[2] = 255;
+				pDst[3] = pSrc[0];
+			}
+		}
+	}
+}
+
+int SpriteAtlas::add(const unsigned char* pPixels, unsigned int iWidth, unsigned int iHeight, Texture::Format format) {
+
+	GP_ASSERT( pPixels );
+
+	// The padding stays transparent, on the right and top of each image
+	unsigned int iPaddedWidth = iWidth + m_iPadding;
+	unsigned int iPaddedHeight = iHeight + m_iPadding;
+	if(iWidth == 0 || iHeight == 0 || iPaddedWidth > m_iPageWidth || iPaddedHeight > m_iPageHeight)
+		return -1;
+
+	unsigned int iPage = 0;
+	unsigned int x, y;
+	for(; iPage < m_vPages.size(); iPage++) {
+		if(pack(*m_vPages[iPage], iPaddedWidth, iPaddedHeight, &x, &y))
+			break;
+	}
+
+	if(iPage == m_vPages.size()) {
+		addPage();
+		if(!pack(*m_vPages[iPage], iPaddedWidth, iPaddedHeight, &x, &y))
+			return -1;
+	}
+
+	blit(*m_vPages[iPage], x, y, pPixels, iWidth, iHeight, format);
+
+	Region region;
+	region.iPage = iPage;
+	region.u1 = (float)x / m_iPageWidth;
+	region.v1 = (float)y / m_iPageHeight;
+	region.u2 = (float)(x + iWidth) / m_iPageWidth;
+	region.v2 = (float)(y + iHeight) / m_iPageHeight;
+	region.iWidth = iWidth;
+	region.iHeight = iHeight;
+	m_vRegions.push_back(region);
+
+	return (int)m_vRegions.size() - 1;
+}
+
+int SpriteAtlas::add(const Image* pImage) {
+
+	GP_ASSERT( pImage );
+
+	Texture::Format format = (pImage->getFormat() == Image::RGB) ? Texture::RGB : Texture::RGBA;
+	return add(pImage->getPixelData(), pImage->getWidth(), pImage->getHeight(), format);
+}
+
+int SpriteAtlas::add(const char* sPath) {
+
+	GP_ASSERT( sPath );
+
+	Image* pImage = Image::createImage(sPath);
+	if(pImage == NULL)
+		return -1;
+
+	int iRegion = add(pImage);
+	SAFE_DELETE( pImage );
+
+	return iRegion;
+}
+
+int SpriteAtlas::add(Texture* pTexture) {
+
+	GP_ASSERT( pTexture );
+	GP_ASSERT( pTexture->getType() == Texture::TEXTURE_2D );
+
+	unsigned int iWidth = pTexture->getWidth();
+	unsigned int iHeight = pTexture->getHeight();
+	if(iWidth + m_iPadding > m_iPageWidth || iHeight + m_iPadding > m_iPageHeight)
+		return -1;
+
+	std::vector<unsigned char> vPixels(iWidth * iHeight * 4);
+
+	GLStateCache::bindTexture(GL_TEXTURE_2D, pTexture->getHandle());
+	GL_ASSERT( glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, &vPixels[0]) );
+	GLStateCache::bindTexture(GL_TEXTURE_2D, 0);
+
+	return add(&vPixels[0], iWidth, iHeight, Texture::RGBA);
+}
+
+unsigned int SpriteAtlas::getRegionCount() const {
+	return m_vRegions.size();
+}
+
+const SpriteAtlas::Region& SpriteAtlas::getRegion(unsigned int iIndex) const {
+
+	GP_ASSERT( iIndex < m_vRegions.size() );
+	return m_vRegions[iIndex];
+}
+
+unsigned int SpriteAtlas::getPageCount() const {
+	return m_vPages.size();
+}
+
+unsigned int SpriteAtlas::getPageWidth() const {
+	return m_iPageWidth;
+}
+
+unsigned int SpriteAtlas::getPageHeight() const {
+	return m_iPageHeight;
+}
+
+float SpriteAtlas::getOccupancy(unsigned int iPage) const {
+
+	GP_ASSERT( iPage < m_vPages.size() );
+	return (float)m_vPages[iPage]->iUsedArea / (float)(m_iPageWidth * m_iPageHeight);
+}
+
+Texture* SpriteAtlas::createPageTexture(unsigned int iPage, bool generateMipmaps) const {
+
+	GP_ASSERT( iPage < m_vPages.size() );
+	return Texture::create(Texture::RGBA, m_iPageWidth, m_iPageHeight, &m_vPages[iPage]->vPixels[0], generateMipmaps);
+}
+
+Texture* SpriteAtlas::createTextureArray(bool generateMipmaps) const {
+
+	if(m_vPages.empty() || !Texture::isArraySupported())
+		return NULL;
+
+	Texture* pTexture = Texture::createArray(Texture::RGBA, m_iPageWidth, m_iPageHeight, m_vPages.size(), NULL);
+	for(unsigned int i = 0; i < m_vPages.size(); i++) {
+		pTexture->setLayerData(i, &m_vPages[i]->vPixels[0]);
+	}
+
+	if(generateMipmaps) {
+		pTexture->generateMipmaps();
+	}
+
+	return pTexture;
+}
@@ -4,6 +4,9 @@
 #include "Engine/Effect.h"
 #include "Engine/Material.h"
 #include "Engine/MaterialParameter.h"
+#include "Engine/GLStateCache.h"
+#include "Common/BatchMath.h"
+#include <cstring>
 
 // Default size of a newly created sprite batch
 #define SPRITE_BATCH_DEFAULT_SIZE 128
@@ -21,12 +24,64 @@
 #define SPRITE_VSH "data/shaders/sprite.vert"
 #define SPRITE_FSH "data/shaders/sprite.frag"
 
+// Defines of the effect for TEXTURE_2D_ARRAY textures
+#define SPRITE_ARRAY_DEFINES "TEXTURE_ARRAY"
+
 static Effect* __spriteEffect = NULL;
+static Effect* __spriteArrayEffect = NULL;
+
+// Rounds to nearest, overflows to infinity, flushes below the half subnormals
+static unsigned short toHalf(float f) {
+
+	unsigned int x;
+	memcpy(&x, &f, sizeof(x));
+
+	unsigned short sign = (unsigned short)((x >> 16) & 0x8000);
+	int exponent = (int)((x >> 23) & 0xff) - 127 + 15;
+	unsigned int mantissa = x & 0x7fffff;
+
+	if(exponent >= 31) {
+		bool bNaN = ((x & 0x7f800000) == 0x7f800000) && mantissa != 0;
+		return sign | 0x7c00 | (bNaN ? 0x200 : 0);
+	}
+
+	if(exponent <= 0) {
+		if(exponent < -10)
+			return sign;
+
+		// Subnormal, the implicit bit becomes explicit
+		mantissa |= 0x800000;
+		unsigned int shift = 14 - exponent;
+		unsigned int half = mantissa >> shift;
+		if((mantissa >> (shift - 1)) & 1)
+			half++;
+		return sign | (unsigned short)half;
+	}
+
+	// A carry out of the mantissa correctly bumps the exponent
+	unsigned int half = ((unsigned int)exponent << 10) | (mantissa >> 13);
+	if(mantissa & 0x1000)
+		half++;
+	return sign | (unsigned short)half;
+}
+
+static unsigned short toUnorm16(float f) {
+	f = (f < 0.0f) ? 0.0f : ((f > 1.0f) ? 1.0f : f);
+	return (unsigned short)(f * 65535.0f + 0.5f);
+}
+
+static unsigned char toUnorm8(float f) {
+	f = (f < 0.0f) ? 0.0f : ((f > 1.0f) ? 1.0f : f);
+	return (unsigned char)(f * 255.0f + 0.5f);
+}
 
 SpriteBatch::SpriteBatch() 
 	:	m_pMeshBatch(NULL),
 		m_fTextureWidthRatio(0.0f),
 		m_fTextureHeightRatio(0.0f),
+		m_fLayer(0.0f),
+		m_iVertexLayout(VERTEX_FLOAT),
+		m_bLayered(false),
 		m_ClipRect()
 {
 
@@ -50,47 +105,51 @@ SpriteBatch::~SpriteBatch() {
 	//}
 }
 
-SpriteBatch* SpriteBatch::create(const char* pTexturePath, Effect* pEffect, unsigned int iInitialCapacity) {
+SpriteBatch* SpriteBatch::create(const char* pTexturePath, Effect* pEffect, unsigned int iInitialCapacity, unsigned int iVertexLayout) {
 	
 	Texture* pTexture = Texture::createEx(pTexturePath);
-	SpriteBatch* pSpriteBatch = SpriteBatch::create(pTexture, pEffect, iInitialCapacity);
+	SpriteBatch* pSpriteBatch = SpriteBatch::create(pTexture, pEffect, iInitialCapacity, iVertexLayout);
 
 	return pSpriteBatch;
 }
 
-SpriteBatch* SpriteBatch::create(Texture* pTexture, Effect* pEffect, unsigned int iInitialCapacity) {
+SpriteBatch* SpriteBatch::create(Texture* pTexture, Effect* pEffect, unsigned int iInitialCapacity, unsigned int iVertexLayout) {
 
 	GP_ASSERT( pTexture );
-	GP_ASSERT( pTexture->getType() == Texture::TEXTURE_2D );
+	GP_ASSERT( pTexture->getType() == Texture::TEXTURE_2D || pTexture->getType() == Texture::TEXTURE_2D_ARRAY );
+
+	bool bArray = (pTexture->getType() == Texture::TEXTURE_2D_ARRAY);
 
 	bool bCustomEffect = (pEffect == NULL);
 	if (bCustomEffect) {
 		
 		// Create our static sprite effect.
-		if (__spriteEffect == NULL) {
+		Effect*& pSpriteEffect = bArray ? __spriteArrayEffect : __spriteEffect;
+		if (pSpriteEffect == NULL) {
 
-			__spriteEffect = Effect::createFromFile(SPRITE_VSH, SPRITE_FSH);
-			if (__spriteEffect == NULL) {
+			pSpriteEffect = Effect::createFromFile(SPRITE_VSH, SPRITE_FSH, bArray ? SPRITE_ARRAY_DEFINES : NULL);
+			if (pSpriteEffect == NULL) {
 
 				GP_ERROR("Unable to load sprite effect.");
 				return NULL;
 			}
 
-			pEffect = __spriteEffect;
+			pEffect = pSpriteEffect;
 		}
 		else {
 
-			pEffect = __spriteEffect;
+			pEffect = pSpriteEffect;
 			//__spriteEffect->addRef();
 		}
 	}
 
 	// Search for the first sampler uniform in the effect.
+	GLenum eSamplerType = bArray ? GL_SAMPLER_2D_ARRAY : GL_SAMPLER_2D;
 	Uniform* pSamplerUniform = NULL;
 	for (unsigned int i = 0, count = pEffect->getUniformCount(); i < count;  i++) {
 
 		Uniform* pUniform = pEffect->getUniform(i);
-		if (pUniform && pUniform->getType() == GL_SAMPLER_2D) {
+		if (pUniform && pUniform->getType() == eSamplerType) {
 
 			pSamplerUniform = pUniform;
 			break;
@@ -98,7 +157,7 @@ SpriteBatch* SpriteBatch::create(Texture* pTexture, Effect* pEffect, unsigned in
 	}
 	if (!pSamplerUniform) {
 
-		GP_ERROR("No uniform of type GL_SAMPLER_2D found in sprite effect.");
+		GP_ERROR("No sampler uniform matching the texture found in sprite effect.");
 		SAFE_DELETE( pEffect );
 		//SAFE_RELEASE(pEffect);
 		return NULL;
@@ -116,15 +175,46 @@ SpriteBatch* SpriteBatch::create(Texture* pTexture, Effect* pEffect, unsigned in
 	Texture::Sampler* pSampler = Texture::Sampler::create(pTexture);
 	pMaterial->getParameter(pSamplerUniform->getName())->setValue(pSampler);
 
+	// Resolve the layout for this device and texture
+	if(iVertexLayout & VERTEX_UNORM16_UV) {
+		iVertexLayout &= ~VERTEX_UNORM16_UV;
+		if(bArray || (iVertexLayout & VERTEX_HALF_UV)) {
+			iVertexLayout |= VERTEX_HALF_UV;		// the layer is not normalized
+		}
+		else {
+			iVertexLayout |= VERTEX_UNORM16_UV;
+		}
+	}
+	if((iVertexLayout & VERTEX_HALF_UV) && !(GLEW_ARB_half_float_vertex || GLEW_VERSION_3_0)) {
+		iVertexLayout &= ~VERTEX_HALF_UV;
+	}
+
 	//// Define the vertex format for the batch
-	VertexFormat::Element vertexElements[] = {
+	VertexFormat::Element vertexElements[3];
+	vertexElements[0] = VertexFormat::Element(VertexFormat::POSITION, (iVertexLayout & VERTEX_2D) ? 2 : 3);
+
+	if(iVertexLayout & VERTEX_HALF_UV) {
+		// Padded to 4 bytes
+		vertexElements[1] = VertexFormat::Element(VertexFormat::TEXCOORD0, bArray ? 4 : 2, VertexFormat::HALF_FLOAT);
+	}
+	else
+	if(iVertexLayout & VERTEX_UNORM16_UV) {
+		vertexElements[1] = VertexFormat::Element(VertexFormat::TEXCOORD0, 2, VertexFormat::UNSIGNED_SHORT, true);
+	}
+	else {
+		vertexElements[1] = VertexFormat::Element(VertexFormat::TEXCOORD0, bArray ? 3 : 2);
+	}
+
+	if(iVertexLayout & VERTEX_PACKED_COLOR) {
+		vertexElements[2] = VertexFormat::Element(VertexFormat::COLOR, 4, VertexFormat::UNSIGNED_BYTE, true);
+	}
+	else {
+		vertexElements[2] = VertexFormat::Element(VertexFormat::COLOR, 4);
+	}
 
-		VertexFormat::Element(VertexFormat::POSITION, 3),
-		VertexFormat::Element(VertexFormat::TEXCOORD0, 2),
-		VertexFormat::Element(VertexFormat::COLOR, 4)
-	};
 	unsigned int elementCount = sizeof(vertexElements) / sizeof(VertexFormat::Element);
 	VertexFormat* vertexFormat = new VertexFormat(vertexElements, elementCount);
+	GP_ASSERT( iVertexLayout != VERTEX_FLOAT || vertexFormat->getVertexSize() == (bArray ? sizeof(SpriteLayerVertex) : sizeof(SpriteVertex)) );
 
 	// Create the mesh batch
 	MeshBatch* pMeshBatch = MeshBatch::create(*vertexFormat, Mesh::TRIANGLE_STRIP, pMaterial, true, (iInitialCapacity > 0) ? iInitialCapacity : SPRITE_BATCH_DEFAULT_SIZE);
@@ -135,6 +225,8 @@ SpriteBatch* SpriteBatch::create(Texture* pTexture, Effect* pEffect, unsigned in
 	pSpriteBatch->m_pSampler = pSampler;
 	pSpriteBatch->m_bCustomEffect = bCustomEffect;
 	pSpriteBatch->m_pMeshBatch = pMeshBatch;
+	pSpriteBatch->m_iVertexLayout = iVertexLayout;
+	pSpriteBatch->m_bLayered = bArray;
 	pSpriteBatch->m_fTextureWidthRatio = 1.0f/(float)pTexture->getWidth();
 	pSpriteBatch->m_fTextureHeightRatio = 1.0f/(float)pTexture->getHeight();
 
@@ -151,8 +243,8 @@ void SpriteBatch::start() {
 		m_pMeshBatch->start();
 
 		// Enable & Set the type of Blending.
-		GL_ASSERT( glEnable(GL_BLEND) );
-		GL_ASSERT( glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) );
+		GLStateCache::setEnabled(GL_BLEND, true);
+		GLStateCache::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 		//GL_ASSERT( glBlendFunc(GL_ONE, GL_ONE) );
 	}
 }
@@ -164,7 +256,7 @@ void SpriteBatch::stop() {
 		m_pMeshBatch->render();
 
 		// Disable Blending
-		GL_ASSERT( glDisable(GL_BLEND) );
+		GLStateCache::setEnabled(GL_BLEND, false);
 	}
 }
 
@@ -230,8 +322,7 @@ void SpriteBatch::draw(float x, float y, float z, float width, float height, flo
 
 	static unsigned short indices[4] = { 0, 1, 2, 3 };
 
-	if(m_pMeshBatch != NULL)
-		m_pMeshBatch->add(vtx, 4, indices, 4);
+	draw(vtx, 4, indices, 4);
 }
 
 void SpriteBatch::draw(Vector3& dst, const Vector4& src, Vector2& scale, const Vector4& color, const Vector2& rotationPoint, float rotationAngle) {
@@ -289,8 +380,7 @@ void SpriteBatch::draw(float x, float y, float z, float width, float height, flo
 
 	static unsigned short indices[4] = { 0, 1, 2, 3 };
 
-	if(m_pMeshBatch != NULL)
-		m_pMeshBatch->add(vtx, 4, indices, 4);
+	draw(vtx, 4, indices, 4);
 }
 
 void SpriteBatch::draw(float x, float y, float width, float height, float u1, float v1, float u2, float v2, const Vector4& color, const Vector4& clip) {
@@ -387,8 +477,99 @@ void SpriteBatch::draw(SpriteBatch::SpriteVertex* pVertices, unsigned int iVerte
     GP_ASSERT(pVertices);
     GP_ASSERT(pIndices);
 
-	if(m_pMeshBatch != NULL)
+	if(m_pMeshBatch == NULL)
+		return;
+
+	if(m_iVertexLayout == VERTEX_FLOAT && !m_bLayered) {
 		m_pMeshBatch->add(pVertices, iVertexCount, pIndices, iIndexCount);
+		return;
+	}
+
+	// Kept between calls, grows only for larger vertex counts
+	unsigned int iBytes = iVertexCount * m_pMeshBatch->getVertexFormat().getVertexSize();
+	if(m_vPacked.size() < iBytes) {
+		m_vPacked.resize(iBytes);
+	}
+
+	pack(pVertices, iVertexCount, &m_vPacked[0]);
+	m_pMeshBatch->addVertices(&m_vPacked[0], iVertexCount, pIndices, iIndexCount);
+}
+
+void SpriteBatch::pack(const SpriteVertex* pVertices, unsigned int iVertexCount, unsigned char* pOut) const {
+
+	for(unsigned int i = 0; i < iVertexCount; i++) {
+
+		const SpriteVertex& v = pVertices[i];
+
+		float* pPosition = (float*)pOut;
+		pPosition[0] = v.X;
+		pPosition[1] = v.Y;
+		if(m_iVertexLayout & VERTEX_2D) {
+			pOut += 2 * sizeof(float);
+		}
+		else {
+			pPosition[2] = v.Z;
+			pOut += 3 * sizeof(float);
+		}
+
+		unsigned short* pTexCoord = (unsigned short*)pOut;
+		if(m_iVertexLayout & VERTEX_HALF_UV) {
+			pTexCoord[0] = toHalf(v.U);
+			pTexCoord[1] = toHalf(v.V);
+			if(m_bLayered) {
+				pTexCoord[2] = toHalf(m_fLayer);
+				pTexCoord[3] = 0;
+				pOut += 4 * sizeof(unsigned short);
+			}
+			else {
+				pOut += 2 * sizeof(unsigned short);
+			}
+		}
+		else
+		if(m_iVertexLayout & VERTEX_UNORM16_UV) {
+			pTexCoord[0] = toUnorm16(v.U);
+			pTexCoord[1] = toUnorm16(v.V);
+			pOut += 2 * sizeof(unsigned short);
+		}
+		else {
+			float* pFloats = (float*)pOut;
+			pFloats[0] = v.U;
+			pFloats[1] = v.V;
+			if(m_bLayered) {
+				pFloats[2] = m_fLayer;
+				pOut += 3 * sizeof(float);
+			}
+			else {
+				pOut += 2 * sizeof(float);
+			}
+		}
+
+		if(m_iVertexLayout & VERTEX_PACKED_COLOR) {
+			pOut[0] = toUnorm8(v.R);
+			pOut[1] = toUnorm8(v.G);
+			pOut[2] = toUnorm8(v.B);
+			pOut[3] = toUnorm8(v.A);
+			pOut += 4;
+		}
+		else {
+			float* pFloats = (float*)pOut;
+			pFloats[0] = v.R;
+			pFloats[1] = v.G;
+			pFloats[2] = v.B;
+			pFloats[3] = v.A;
+			pOut += 4 * sizeof(float);
+		}
+	}
+}
+
+unsigned int SpriteBatch::getVertexLayout() const {
+	return m_iVertexLayout;
+}
+
+unsigned int SpriteBatch::getVertexSize() const {
+
+	GP_ASSERT( m_pMeshBatch );
+	return m_pMeshBatch->getVertexFormat().getVertexSize();
 }
 
 void SpriteBatch::draw(const Vector3& position, const Vector3& right, const Vector3& forward, float width, float height, float u1, float v1, float u2, float v2, const Vector4& color, const Vector2& rotationPoint, float rotationAngle) {
@@ -423,37 +604,45 @@ void SpriteBatch::draw(const Vector3& position, const Vector3& right, const Vect
     rp += tForward;
 
     // Rotate all points the specified amount about the given point (about the up vector).
-    static Vector3 u;
+    // Pre-multiplying by the rotation turns by -rotationAngle, around rp in one transform.
+    Vector3 u;
     Vector3::cross(right, forward, &u);
-    static Matrix4 rotation;
-    rotation.rotate(rotationAngle, u);
-
-    p0 -= rp;
-    p0 *= rotation;
-    p0 += rp;
-
-    p1 -= rp;
-    p1 *= rotation;
-    p1 += rp;
+    Matrix4 transform;
+    transform.rotate(-rotationAngle, u);
+    transform.setTranslate(rp - transform * rp);
 
-    p2 -= rp;
-    p2 *= rotation;
-    p2 += rp;
-
-    p3 -= rp;
-    p3 *= rotation;
-    p3 += rp;
+    float xs[4] = { p0.x, p1.x, p2.x, p3.x };
+    float ys[4] = { p0.y, p1.y, p2.y, p3.y };
+    float zs[4] = { p0.z, p1.z, p2.z, p3.z };
+    BatchMath::transformPoints(transform, xs, ys, zs, xs, ys, zs, 4);
 
     // Add the sprite vertex data to the batch.
     static SpriteVertex v[4];
-    SPRITE_ADD_VERTEX(v[0], p0.x, p0.y, p0.z, u1, v1, color.x, color.y, color.z, color.w);
-    SPRITE_ADD_VERTEX(v[1], p1.x, p1.y, p1.z, u2, v1, color.x, color.y, color.z, color.w);
-    SPRITE_ADD_VERTEX(v[2], p2.x, p2.y, p2.z, u1, v2, color.x, color.y, color.z, color.w);
-    SPRITE_ADD_VERTEX(v[3], p3.x, p3.y, p3.z, u2, v2, color.x, color.y, color.z, color.w);
+    SPRITE_ADD_VERTEX(v[0], xs[0], ys[0], zs[0], u1, v1, color.x, color.y, color.z, color.w);
+    SPRITE_ADD_VERTEX(v[1], xs[1], ys[1], zs[1], u2, v1, color.x, color.y, color.z, color.w);
+    SPRITE_ADD_VERTEX(v[2], xs[2], ys[2], zs[2], u1, v2, color.x, color.y, color.z, color.w);
+    SPRITE_ADD_VERTEX(v[3], xs[3], ys[3], zs[3], u2, v2, color.x, color.y, color.z, color.w);
     
     static const unsigned short indices[4] = { 0, 1, 2, 3 };
-	if(m_pMeshBatch != NULL)
-		m_pMeshBatch->add(v, 4, const_cast<unsigned short*>(indices), 4);
+	draw(v, 4, const_cast<unsigned short*>(indices), 4);
+}
+
+void SpriteBatch::draw(float x, float y, float width, float height, const SpriteAtlas::Region& region, const Vector4& color) {
+
+	float fLayer = m_fLayer;
+	m_fLayer = (float)region.iPage;
+
+	draw(x, y, width, height, region.u1, region.v1, region.u2, region.v2, color);
+
+	m_fLayer = fLayer;
+}
+
+void SpriteBatch::setLayer(unsigned int iLayer) {
+	m_fLayer = (float)iLayer;
+}
+
+unsigned int SpriteBatch::getLayer() const {
+	return (unsigned int)m_fLayer;
 }
 
 void SpriteBatch::setClip(int x, int y, int width, int height) {
@@ -0,0 +1,119 @@
+#include "Engine/SpriteBatchBenchmark.h"
+#include "Engine/SpriteBatch.h"
+#include "Engine/MeshBatch.h"
+#include "Engine/Texture.h"
+#include "Engine/Timer.h"
+#include <cstdio>
+
+bool SpriteBatchBenchmark::run(unsigned int iSpriteCount, unsigned int iFrameCount, bool bStreaming, Result* pResult, unsigned int iVertexLayout) {
+
+	GP_ASSERT( pResult );
+	GP_ASSERT( iFrameCount > 0 );
+
+	unsigned char white[4] = { 255, 255, 255, 255 };
+	Texture* pTexture = Texture::create(Texture::RGBA, 1, 1, white);
+	if(pTexture == NULL)
+		return false;
+
+	bool bStreamingEnabled = MeshBatch::isStreamingEnabled();
+	MeshBatch::setStreamingEnabled(bStreaming);
+	SpriteBatch* pSpriteBatch = SpriteBatch::create(pTexture, NULL, 0, iVertexLayout);
+	MeshBatch::setStreamingEnabled(bStreamingEnabled);
+
+	if(pSpriteBatch == NULL) {
+		SAFE_DELETE( pTexture );
+		return false;
+	}
+
+	// A TEXTURE_2D batch carries no layer
+	GP_ASSERT( pSpriteBatch->getVertexSize() == getExpectedVertexSize(pSpriteBatch->getVertexLayout()) );
+
+	Vector4 color(1.0f, 1.0f, 1.0f, 0.5f);
+	unsigned int iColumns = 256;
+
+	// Every sprite passes the clip test
+	pSpriteBatch->setClip(0, 0, 4 * (iColumns + iFrameCount), 4 * (iSpriteCount / iColumns + 1));
+
+	// Warm up, lets the batch reach its capacity and the rings overflowed
+	// while growing be enlarged by the next start()
+	for(unsigned int f = 0; f < 2; f++) {
+		pSpriteBatch->start();
+		for(unsigned int i = 0; i < iSpriteCount; i++) {
+			pSpriteBatch->draw((float)(i % iColumns), (float)(i / iColumns), 4.0f, 4.0f, 0.0f, 0.0f, 1.0f, 1.0f, color);
+		}
+		pSpriteBatch->stop();
+	}
+	GL_ASSERT( glFinish() );
+	MeshBatch::resetStats();
+
+	Timer submitTimer;
+	Timer totalTimer;
+	double dSubmitMs = 0.0;
+
+	totalTimer.start();
+	for(unsigned int f = 0; f < iFrameCount; f++) {
+
+		submitTimer.start();
+		pSpriteBatch->start();
+		for(unsigned int i = 0; i < iSpriteCount; i++) {
+			pSpriteBatch->draw((float)((i + f) % iColumns), (float)(i / iColumns), 4.0f, 4.0f, 0.0f, 0.0f, 1.0f, 1.0f, color);
+		}
+		pSpriteBatch->stop();
+		submitTimer.stop();
+
+		dSubmitMs += submitTimer.getElapsedTimeInMilliSec();
+	}
+	GL_ASSERT( glFinish() );
+	totalTimer.stop();
+	MeshBatch::Stats stats = MeshBatch::resetStats();
+
+	pResult->iSpriteCount = iSpriteCount;
+	pResult->iFrameCount = iFrameCount;
+	pResult->bStreaming = bStreaming;
+	pResult->iVertexLayout = pSpriteBatch->getVertexLayout();
+	pResult->iVertexSize = pSpriteBatch->getVertexSize();
+	pResult->iExpectedVertexSize = getExpectedVertexSize(pResult->iVertexLayout);
+	pResult->dSubmitMs = dSubmitMs / iFrameCount;
+	pResult->dTotalMs = totalTimer.getElapsedTimeInMilliSec() / iFrameCount;
+	pResult->dSpritesPerMs = (pResult->dTotalMs > 0.0) ? iSpriteCount / pResult->dTotalMs : 0.0;
+	pResult->iSteadyAllocations = stats.iAllocations;
+
+	// The batch's sampler owns the texture
+	SAFE_DELETE( pSpriteBatch );
+
+	return true;
+}
+
+unsigned int SpriteBatchBenchmark::getExpectedVertexSize(unsigned int iVertexLayout) {
+
+	unsigned int iSize = (iVertexLayout & SpriteBatch::VERTEX_2D) ? 2 * sizeof(float) : 3 * sizeof(float);
+	iSize += (iVertexLayout & (SpriteBatch::VERTEX_HALF_UV | SpriteBatch::VERTEX_UNORM16_UV)) ? 2 * sizeof(unsigned short) : 2 * sizeof(float);
+	iSize += (iVertexLayout & SpriteBatch::VERTEX_PACKED_COLOR) ? 4 : 4 * sizeof(float);
+
+	return iSize;
+}
+
+void SpriteBatchBenchmark::runAll() {
+
+	const unsigned int iCounts[] = { 1000, 10000, 50000 };
+	const unsigned int iFrameCount = 60;
+
+	// Streaming float, streaming compact, client float
+	const bool bStreaming[] = { true, true, false };
+	const unsigned int iLayouts[] = { SpriteBatch::VERTEX_FLOAT, SpriteBatch::VERTEX_COMPACT, SpriteBatch::VERTEX_FLOAT };
+
+	printf("sprites  mode       vertex(B)  submit(ms)  total(ms)  sprites/ms  allocations\n");
+	for(unsigned int i = 0; i < sizeof(iCounts) / sizeof(iCounts[0]); i++) {
+		for(unsigned int j = 0; j < sizeof(iLayouts) / sizeof(iLayouts[0]); j++) {
+
+			Result result;
+			if(!run(iCounts[i], iFrameCount, bStreaming[j], &result, iLayouts[j]))
+				continue;
+
+			printf("%7u  %-9s  %9u  %10.3f  %9.3f  %10.1f  %11u%s\n",
+				result.iSpriteCount, result.bStreaming ? "streaming" : "client", result.iVertexSize,
+				result.dSubmitMs, result.dTotalMs, result.dSpritesPerMs, result.iSteadyAllocations,
+				(result.iVertexSize != result.iExpectedVertexSize) ? "  (vertex size unexpected)" : "");
+		}
+	}
+}
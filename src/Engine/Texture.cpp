@@ -1,6 +1,7 @@
 #include "ENGINE/Base.h"
 #include "ENGINE/Image.h"
 #include "ENGINE/Texture.h"
+#include "ENGINE/GLStateCache.h"
 
 static std::vector<Texture*> __textureCache;
 static GLuint __currentTextureID;
@@ -9,14 +10,17 @@ Texture::Texture() :	m_hTexture(0),
 						m_Format(UNKNOWN),
 						m_iWidth(0),
 						m_iHeight(0),
+						m_iLayers(1),
 						m_bMipmapped(false),
 						m_bCached(false),
-						m_bCompressed(false)
+						m_bCompressed(false),
+						m_eType(TEXTURE_2D)
 {
 }
 
 Texture::~Texture() {
 	if(m_hTexture) {
+		GLStateCache::textureDeleted(m_hTexture);
 		GL_ASSERT( glDeleteTextures(1, &m_hTexture) );
 		m_hTexture = 0;
 	}
@@ -104,13 +108,13 @@ Texture* Texture::createTGA(const char* path, bool generateMipmaps) {
 	// Create and load the texture.
 	GLuint textureID;
 	GL_ASSERT( glGenTextures(1, &textureID) );
-	GL_ASSERT( glBindTexture(GL_TEXTURE_2D, textureID) ); // Set our Tex handle as current
+	GLStateCache::bindTexture(GL_TEXTURE_2D, textureID); // Set our Tex handle as current
 
 	// Specify filtering and edge actions
-	GL_ASSERT( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR) );
-	GL_ASSERT( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR) );
-	GL_ASSERT( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP) );
-	GL_ASSERT( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP) );
+	GLStateCache::texParameter(GL_TEXTURE_2D, textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	GLStateCache::texParameter(GL_TEXTURE_2D, textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	GLStateCache::texParameter(GL_TEXTURE_2D, textureID, GL_TEXTURE_WRAP_S, GL_CLAMP);
+	GLStateCache::texParameter(GL_TEXTURE_2D, textureID, GL_TEXTURE_WRAP_T, GL_CLAMP);
 
 	Texture::Format format = Texture::UNKNOWN;
 	
@@ -125,8 +129,8 @@ Texture* Texture::createTGA(const char* path, bool generateMipmaps) {
 	// Create the texture
 	GL_ASSERT( glTexImage2D(GL_TEXTURE_2D, 0, (GLuint)format, Img.GetWidth(), Img.GetHeight(), 0, (GLuint)format, GL_UNSIGNED_BYTE, Img.GetImg()) );
 	
-	GL_ASSERT( glBindTexture(GL_TEXTURE_2D, 0) );
-	GL_ASSERT( glDisable(GL_TEXTURE_2D) );
+	GLStateCache::bindTexture(GL_TEXTURE_2D, 0);
+	GLStateCache::setEnabled(GL_TEXTURE_2D, false);
 
 	texture = new Texture();
 	texture->m_hTexture = textureID;
@@ -228,13 +232,13 @@ Texture* Texture::create(Format format, unsigned int width, unsigned int height,
 	GL_ASSERT( glGenTextures(1, &textureID) );
 
 	// Binding the texture to GL_TEXTURE_2D is like telling OpenGL that the texture with this ID is now the current 2D texture in use
-	GL_ASSERT( glBindTexture(GL_TEXTURE_2D, textureID) );
+	GLStateCache::bindTexture(GL_TEXTURE_2D, textureID);
 
 	// Specify filtering and edge actions
-	GL_ASSERT( glTexParameteri(GL_TEXTURE_2D,	GL_TEXTURE_MIN_FILTER, GL_LINEAR) );
-	GL_ASSERT( glTexParameteri(GL_TEXTURE_2D,	GL_TEXTURE_MAG_FILTER, GL_LINEAR) );
-	GL_ASSERT( glTexParameteri(GL_TEXTURE_2D,	GL_TEXTURE_WRAP_S, GL_CLAMP) );
-	GL_ASSERT( glTexParameteri(GL_TEXTURE_2D,	GL_TEXTURE_WRAP_T, GL_CLAMP) );
+	GLStateCache::texParameter(GL_TEXTURE_2D, textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	GLStateCache::texParameter(GL_TEXTURE_2D, textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	GLStateCache::texParameter(GL_TEXTURE_2D, textureID, GL_TEXTURE_WRAP_S, GL_CLAMP);
+	GLStateCache::texParameter(GL_TEXTURE_2D, textureID, GL_TEXTURE_WRAP_T, GL_CLAMP);
 
 	//GL_ASSERT( glPixelStorei(GL_UNPACK_ALIGNMENT, 1) );
 
@@ -246,7 +250,7 @@ Texture* Texture::create(Format format, unsigned int width, unsigned int height,
 	// Specify filtering and edge actions
 	// Set initial minification filter based on whether or not mipmaping was enabled.
 	//GL_ASSERT( glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, generateMipmaps ? GL_NEAREST_MIPMAP_LINEAR : GL_LINEAR) );
-	GL_ASSERT( glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, generateMipmaps ? GL_NEAREST_MIPMAP_LINEAR : GL_LINEAR) );
+	GLStateCache::texParameter(GL_TEXTURE_2D, textureID, GL_TEXTURE_MIN_FILTER, generateMipmaps ? GL_NEAREST_MIPMAP_LINEAR : GL_LINEAR);
 
 	Texture* texture = new Texture();
 	texture->m_hTexture = textureID;
@@ -259,12 +263,65 @@ Texture* Texture::create(Format format, unsigned int width, unsigned int height,
 	}
 
 	// Restore the texture id
-	GL_ASSERT( glBindTexture(GL_TEXTURE_2D, __currentTextureID) );
-	GL_ASSERT( glDisable(GL_TEXTURE_2D) );
+	GLStateCache::bindTexture(GL_TEXTURE_2D, __currentTextureID);
+	GLStateCache::setEnabled(GL_TEXTURE_2D, false);
 
 	return texture;
 }
 
+bool Texture::isArraySupported() {
+	return GLEW_EXT_texture_array || GLEW_VERSION_3_0;
+}
+
+Texture* Texture::createArray(Format format, unsigned int width, unsigned int height, unsigned int iLayers, unsigned char* data, bool generateMipmaps) {
+
+	GP_ASSERT( iLayers > 0 );
+	GP_ASSERT( isArraySupported() );
+
+	GLuint textureID;
+	GL_ASSERT( glGenTextures(1, &textureID) );
+
+	// Array bindings are not shadowed, nothing to restore on the 2D binding point
+	GLStateCache::bindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+
+	GLStateCache::texParameter(GL_TEXTURE_2D_ARRAY, textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	GLStateCache::texParameter(GL_TEXTURE_2D_ARRAY, textureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	GLStateCache::texParameter(GL_TEXTURE_2D_ARRAY, textureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	GLStateCache::texParameter(GL_TEXTURE_2D_ARRAY, textureID, GL_TEXTURE_MIN_FILTER, generateMipmaps ? GL_NEAREST_MIPMAP_LINEAR : GL_LINEAR);
+
+	GL_ASSERT( glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GLenum(format), width, height, iLayers, 0, GLenum(format), GL_UNSIGNED_BYTE, data) );
+
+	Texture* texture = new Texture();
+	texture->m_hTexture = textureID;
+	texture->m_Format = format;
+	texture->m_iWidth = width;
+	texture->m_iHeight = height;
+	texture->m_iLayers = iLayers;
+	texture->m_eType = TEXTURE_2D_ARRAY;
+	if(generateMipmaps) {
+		texture->generateMipmaps();
+	}
+
+	GLStateCache::bindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	return texture;
+}
+
+void Texture::setLayerData(unsigned int iLayer, unsigned char* data) {
+
+	GP_ASSERT( m_eType == TEXTURE_2D_ARRAY );
+	GP_ASSERT( iLayer < m_iLayers );
+	GP_ASSERT( data );
+
+	GLStateCache::bindTexture(GL_TEXTURE_2D_ARRAY, m_hTexture);
+	GL_ASSERT( glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, iLayer, m_iWidth, m_iHeight, 1, GLenum(m_Format), GL_UNSIGNED_BYTE, data) );
+
+	if(m_bMipmapped) {
+		GL_ASSERT( glGenerateMipmap(GL_TEXTURE_2D_ARRAY) );
+	}
+	GLStateCache::bindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
 Texture* Texture::create(TextureHandle handle, int width, int height, Format format) {
 	GP_ASSERT( handle );
 
@@ -289,10 +346,14 @@ unsigned int Texture::getHeight() const {
 	return m_iHeight;
 }
 
+unsigned int Texture::getLayerCount() const {
+	return m_iLayers;
+}
+
 void Texture::generateMipmaps() {
 	if(!m_bMipmapped) {
-		GL_ASSERT( glBindTexture(GL_TEXTURE_2D, m_hTexture) );
-		GL_ASSERT( glGenerateMipmap(GL_TEXTURE_2D) );
+		GLStateCache::bindTexture((GLenum)m_eType, m_hTexture);
+		GL_ASSERT( glGenerateMipmap((GLenum)m_eType) );
 
 		m_bMipmapped = true;
 	}
@@ -317,28 +378,32 @@ Texture::Type Texture::getType() const {
 
 void Texture::setWrapMode(Wrap wrapS, Wrap wrapT)
 {
-	GL_ASSERT( glBindTexture(GL_TEXTURE_2D, m_hTexture) );
-	GL_ASSERT( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, (GLenum)wrapS) );
-	GL_ASSERT( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, (GLenum)wrapT) );
+	GLStateCache::bindTexture((GLenum)m_eType, m_hTexture);
+	GLStateCache::texParameter((GLenum)m_eType, m_hTexture, GL_TEXTURE_WRAP_S, (GLenum)wrapS);
+	GLStateCache::texParameter((GLenum)m_eType, m_hTexture, GL_TEXTURE_WRAP_T, (GLenum)wrapT);
 }
 
 void Texture::setFilterMode(Filter minificationFilter, Filter magnificationFilter)
 {
-	GL_ASSERT( glBindTexture(GL_TEXTURE_2D, m_hTexture) );
-	GL_ASSERT( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (GLenum)minificationFilter) );
-	GL_ASSERT( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, (GLenum)magnificationFilter) );
+	GLStateCache::bindTexture((GLenum)m_eType, m_hTexture);
+	GLStateCache::texParameter((GLenum)m_eType, m_hTexture, GL_TEXTURE_MIN_FILTER, (GLenum)minificationFilter);
+	GLStateCache::texParameter((GLenum)m_eType, m_hTexture, GL_TEXTURE_MAG_FILTER, (GLenum)magnificationFilter);
 }
 
 void Texture::bind() {
 	GP_ASSERT( m_hTexture );
 
-	GL_ASSERT( glEnable(GL_TEXTURE_2D) );
-	GL_ASSERT( glBindTexture(GL_TEXTURE_2D, m_hTexture) );
+	if(m_eType == TEXTURE_2D) {
+		GLStateCache::setEnabled(GL_TEXTURE_2D, true);
+	}
+	GLStateCache::bindTexture((GLenum)m_eType, m_hTexture);
 }
 
 void Texture::unbind() {
-	GL_ASSERT( glBindTexture(GL_TEXTURE_2D, 0) );
-	GL_ASSERT( glDisable(GL_TEXTURE_2D) );
+	GLStateCache::bindTexture((GLenum)m_eType, 0);
+	if(m_eType == TEXTURE_2D) {
+		GLStateCache::setEnabled(GL_TEXTURE_2D, false);
+	}
 }
 
 Texture::Sampler::Sampler(Texture* pTexture) 
@@ -386,10 +451,12 @@ void Texture::Sampler::bind() {
 	GP_ASSERT( m_pTexture );
 
 	m_pTexture->bind();
-	GL_ASSERT( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, (GLenum)m_WrapS) );
-	GL_ASSERT( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, (GLenum)m_WrapT) );
-	GL_ASSERT( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (GLenum)m_minFilter) );
-	GL_ASSERT( glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, (GLenum)m_magFilter) );
+
+	GLenum eTarget = (GLenum)m_pTexture->m_eType;
+	GLStateCache::texParameter(eTarget, m_pTexture->m_hTexture, GL_TEXTURE_WRAP_S, (GLenum)m_WrapS);
+	GLStateCache::texParameter(eTarget, m_pTexture->m_hTexture, GL_TEXTURE_WRAP_T, (GLenum)m_WrapT);
+	GLStateCache::texParameter(eTarget, m_pTexture->m_hTexture, GL_TEXTURE_MIN_FILTER, (GLenum)m_minFilter);
+	GLStateCache::texParameter(eTarget, m_pTexture->m_hTexture, GL_TEXTURE_MAG_FILTER, (GLenum)m_magFilter);
 }
 
 void Texture::Sampler::unbind() {
@@ -13,6 +13,11 @@ Transform::Transform()
 
 void Transform::setDirty(unsigned int iDirtyBits) {
 	m_iDirty |= iDirtyBits;
+	transformChanged();
+}
+
+void Transform::transformChanged() {
+
 }
 
 void Transform::scale(float fScale) {
@@ -250,18 +255,22 @@ const Matrix4& Transform::getTransformedModelMatrix() const {
 
 void Transform::setIdentity() {
 	m_Matrix = Matrix4::identity();
+	transformChanged();
 }
 
 void Transform::setAxisX(const Vector3& vLeft) {
 	m_Matrix.setColumn(0, vLeft);
+	transformChanged();
 }
 
 void Transform::setAxisY(const Vector3& vUp) {
 	m_Matrix.setColumn(1, vUp);
+	transformChanged();
 }
 
 void Transform::setAxisZ(const Vector3& vForward) {
 	m_Matrix.setColumn(2, vForward);
+	transformChanged();
 }
 
 void Transform::setPosition(const Vector3& vPosition) {
@@ -5,6 +5,7 @@
 #include "Engine/UI/WWidgetManager.h"
 #include "Engine/UI/WComponentFactory.h"
 #include "Engine/TGA.h"
+#include "Engine/GLStateCache.h"
 
 #define CORE_TEXTURE_UI		"data/core.tga"
 #define CORE_FONT_UI				"Rosemary_DroidSans"
@@ -179,11 +180,11 @@ void WWidgetManager::setGLStates() {
 	Camera* pCamera = EngineManager::getInstance()->getUICamera();
 	pCamera->forceType(Camera::ORTHOGRAPHIC);
 
-	glEnable(GL_DEPTH_TEST);
+	GLStateCache::setEnabled(GL_DEPTH_TEST, true);
 	glDepthFunc(GL_LEQUAL);
 	glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	GLStateCache::setEnabled(GL_BLEND, true);
+	GLStateCache::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	setClip(((WContainer*)m_pBaseWindow)->getLeft(), ((WContainer*)m_pBaseWindow)->getTop(), ((WContainer*)m_pBaseWindow)->getWidth(), ((WContainer*)m_pBaseWindow)->getHeight());
 }
@@ -0,0 +1,209 @@
+#include "Engine/UniformBlocks.h"
+#include "Engine/GPURingBuffer.h"
+#include "Engine/Node.h"
+#include "Engine/Camera.h"
+#include "Engine/Scene.h"
+#include <cstring>
+
+GPURingBuffer*				UniformBlocks::m_pRing = NULL;
+unsigned int				UniformBlocks::m_iAlignment = 256;
+unsigned int				UniformBlocks::m_iSerial = 1;
+unsigned int				UniformBlocks::m_iRingGeneration = 0;
+
+const Camera*				UniformBlocks::m_pFrameCamera = NULL;
+unsigned int				UniformBlocks::m_iFrameCameraVersion = 0;
+Vector3						UniformBlocks::m_FrameAmbientColor;
+unsigned int				UniformBlocks::m_iFrameOffset = 0;
+bool						UniformBlocks::m_bFrameValid = false;
+
+unsigned int				UniformBlocks::m_iBoundOffsets[2];
+bool						UniformBlocks::m_bBoundValid[2];
+
+UniformBlocks::Stats		UniformBlocks::m_Stats;
+
+bool UniformBlocks::isSupported() {
+	return GLEW_ARB_uniform_buffer_object && GLEW_ARB_map_buffer_range;
+}
+
+void UniformBlocks::initialize(unsigned int iSegmentSize) {
+
+	if(m_pRing || !isSupported())
+		return;
+
+	GLint iAlignment = 0;
+	GL_ASSERT( glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &iAlignment) );
+	m_iAlignment = (iAlignment > 0) ? (unsigned int)iAlignment : 256;
+
+	m_pRing = GPURingBuffer::create(GL_UNIFORM_BUFFER, iSegmentSize);
+	m_iRingGeneration = m_pRing->getGeneration();
+	m_bFrameValid = false;
+	memset(m_bBoundValid, 0, sizeof(m_bBoundValid));
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+void UniformBlocks::finalize() {
+
+	SAFE_DELETE( m_pRing );
+	m_bFrameValid = false;
+	++m_iSerial;
+}
+
+bool UniformBlocks::isInitialized() {
+	return m_pRing != NULL;
+}
+
+const char* UniformBlocks::getBlockName(Block eBlock) {
+
+	switch(eBlock) {
+	case FRAME_BLOCK:
+		return "FrameBlock";
+	case OBJECT_BLOCK:
+		return "ObjectBlock";
+	default:
+		return NULL;
+	}
+}
+
+void UniformBlocks::beginFrame() {
+
+	if(m_pRing == NULL)
+		return;
+
+	m_pRing->beginFrame();
+
+	// Everything is written again into the new segment
+	m_iRingGeneration = m_pRing->getGeneration();
+	m_bFrameValid = false;
+	memset(m_bBoundValid, 0, sizeof(m_bBoundValid));
+	++m_iSerial;
+}
+
+void UniformBlocks::endFrame() {
+
+	if(m_pRing) {
+		m_pRing->endFrame();
+	}
+}
+
+void UniformBlocks::validateFrame(const Node* pNode) {
+
+	Scene* pScene = pNode->getScene();
+	const Camera* pCamera = pScene ? pScene->getActiveCamera() : NULL;
+	unsigned int iVersion = pCamera ? pCamera->getVersion() : 0;
+	Vector3 ambientColor = pScene ? pScene->getAmbientColor() : Vector3::zero();
+
+	if(	m_bFrameValid
+		&&
+		pCamera == m_pFrameCamera
+		&&
+		iVersion == m_iFrameCameraVersion
+		&&
+		ambientColor.x == m_FrameAmbientColor.x && ambientColor.y == m_FrameAmbientColor.y && ambientColor.z == m_FrameAmbientColor.z
+	) {
+		return;
+	}
+
+	FrameData data;
+	memcpy(data.view, pNode->getViewMatrix().m, sizeof(data.view));
+	memcpy(data.projection, pNode->getProjectionMatrix().m, sizeof(data.projection));
+	memcpy(data.viewProjection, pNode->getViewProjectionMatrix().m, sizeof(data.viewProjection));
+
+	Vector3 position = pNode->getActiveCameraTranslationWorld();
+	data.cameraWorldPosition[0] = position.x;
+	data.cameraWorldPosition[1] = position.y;
+	data.cameraWorldPosition[2] = position.z;
+	data.cameraWorldPosition[3] = 1.0f;
+
+	position = pNode->getActiveCameraTranslationView();
+	data.cameraViewPosition[0] = position.x;
+	data.cameraViewPosition[1] = position.y;
+	data.cameraViewPosition[2] = position.z;
+	data.cameraViewPosition[3] = 1.0f;
+
+	data.ambientColor[0] = ambientColor.x;
+	data.ambientColor[1] = ambientColor.y;
+	data.ambientColor[2] = ambientColor.z;
+	data.ambientColor[3] = 1.0f;
+
+	if(!m_pRing->write(&data, sizeof(data), m_iAlignment, &m_iFrameOffset))
+		return;
+
+	if(m_pRing->getGeneration() != m_iRingGeneration) {
+		m_iRingGeneration = m_pRing->getGeneration();
+		memset(m_bBoundValid, 0, sizeof(m_bBoundValid));
+	}
+
+	m_pFrameCamera = pCamera;
+	m_iFrameCameraVersion = iVersion;
+	m_FrameAmbientColor = ambientColor;
+	m_bFrameValid = true;
+	++m_Stats.iFrameWrites;
+
+	// Object blocks hold camera relative matrices
+	++m_iSerial;
+}
+
+void UniformBlocks::bindRange(BindingPoint eBindingPoint, unsigned int iOffset, unsigned int iSize) {
+
+	if(m_bBoundValid[eBindingPoint] && m_iBoundOffsets[eBindingPoint] == iOffset) {
+		++m_Stats.iRangeBindsFiltered;
+		return;
+	}
+
+	GL_ASSERT( glBindBufferRange(GL_UNIFORM_BUFFER, eBindingPoint, m_pRing->getBuffer(), iOffset, iSize) );
+
+	m_iBoundOffsets[eBindingPoint] = iOffset;
+	m_bBoundValid[eBindingPoint] = true;
+	++m_Stats.iRangeBinds;
+}
+
+void UniformBlocks::bind(const Node* pNode, unsigned int iBlocks) {
+
+	if(m_pRing == NULL || pNode == NULL || iBlocks == 0)
+		return;
+
+	validateFrame(pNode);
+
+	if(iBlocks & OBJECT_BLOCK) {
+
+		if(pNode->m_iObjectBlockSerial != m_iSerial) {
+
+			ObjectData data;
+			memcpy(data.world, pNode->getWorldMatrix().m, sizeof(data.world));
+			memcpy(data.worldView, pNode->getWorldViewMatrix().m, sizeof(data.worldView));
+			memcpy(data.worldViewProjection, pNode->getWorldViewProjectionMatrix().m, sizeof(data.worldViewProjection));
+			memcpy(data.inverseTransposeWorld, pNode->getInverseTransposeWorldMatrix().m, sizeof(data.inverseTransposeWorld));
+			memcpy(data.inverseTransposeWorldView, pNode->getInverseTransposeWorldViewMatrix().m, sizeof(data.inverseTransposeWorldView));
+
+			unsigned int iOffset;
+			if(!m_pRing->write(&data, sizeof(data), m_iAlignment, &iOffset))
+				return;
+
+			if(m_pRing->getGeneration() != m_iRingGeneration) {
+
+				// The write orphaned the buffer, the frame block went with it
+				m_iRingGeneration = m_pRing->getGeneration();
+				memset(m_bBoundValid, 0, sizeof(m_bBoundValid));
+				m_bFrameValid = false;
+				validateFrame(pNode);
+			}
+
+			pNode->m_iObjectBlockSerial = m_iSerial;
+			pNode->m_iObjectBlockOffset = iOffset;
+			++m_Stats.iObjectWrites;
+		}
+
+		bindRange(OBJECT_BLOCK_BINDING, pNode->m_iObjectBlockOffset, sizeof(ObjectData));
+	}
+
+	if(iBlocks & FRAME_BLOCK) {
+		bindRange(FRAME_BLOCK_BINDING, m_iFrameOffset, sizeof(FrameData));
+	}
+}
+
+UniformBlocks::Stats UniformBlocks::resetStats() {
+
+	Stats stats = m_Stats;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	return stats;
+}
@@ -1,31 +1,58 @@
 #include "Engine/VertexAttributeBinding.h"
 #include "Engine/Effect.h"
+#include <unordered_map>
+
+// Shared bindings, one per (mesh, effect) pair
+struct BindingKey {
+	const Mesh*		pMesh;
+	const Effect*	pEffect;
+
+	bool operator==(const BindingKey& other) const {
+		return pMesh == other.pMesh && pEffect == other.pEffect;
+	}
+};
+
+struct BindingKeyHash {
+	size_t operator()(const BindingKey& key) const {
+		size_t h = (size_t)key.pMesh;
+		h ^= (size_t)key.pEffect + 0x9e3779b9 + (h << 6) + (h >> 2);
+		return h;
+	}
+};
+
+typedef std::unordered_map<BindingKey, VertexAttributeBinding*, BindingKeyHash> BindingCache;
 
 static GLuint __maxVertexAttributes = 0;
-static std::vector<VertexAttributeBinding*>	__vertexAttributeBindingCache;
+static BindingCache __vertexAttributeBindingCache;
+static int __hardwareVAOs = -1;		// unknown until the first binding is created
 
 VertexAttributeBinding::VertexAttributeBinding()
-	:	m_pAttributes(NULL)
-	,	m_pMesh(NULL)
-	,	m_pEffect(NULL)
+	:
 #ifdef USE_VAO
-	,	m_hVAO(0)
+		m_hVAO(0),
 #endif
+		m_pAttributes(NULL)
+	,	m_iBaseOffset(0)
+	,	m_pMesh(NULL)
+	,	m_pEffect(NULL)
 {
 
 }
 
 VertexAttributeBinding::~VertexAttributeBinding() {
 
-	// Delete from the vertex attribute binding cache.
-	if(__vertexAttributeBindingCache.size() > 0) {
-		std::vector<VertexAttributeBinding*>::iterator itr = std::find(__vertexAttributeBindingCache.begin(), __vertexAttributeBindingCache.end(), this);
-		if(itr != __vertexAttributeBindingCache.end()) {
+	// Delete from the vertex attribute binding cache. Unique bindings share
+	// the key of a cached one without being it.
+	if(m_pMesh) {
+		BindingKey key = { m_pMesh, m_pEffect };
+		BindingCache::iterator itr = __vertexAttributeBindingCache.find(key);
+		if(itr != __vertexAttributeBindingCache.end() && itr->second == this) {
 			__vertexAttributeBindingCache.erase(itr);
 		}
 	}
 
-	SAFE_DELETE(m_pMesh);//SAFE_RELEASE(m_pMesh);
+	// The mesh belongs to its Model, several bindings can share it.
+	m_pMesh = NULL;
 	SAFE_DELETE_ARRAY(m_pAttributes);
 
 #ifdef USE_VAO
@@ -41,22 +68,18 @@ VertexAttributeBinding*	VertexAttributeBinding::create(Mesh* mesh, Effect* pEffe
 	GP_ASSERT( mesh );
 
 	//Search for an existing Vertex Attribute Binding that can be used
-	VertexAttributeBinding* b;
-	for(int i = 0, count = __vertexAttributeBindingCache.size(); i < count; i++) {
-		b = __vertexAttributeBindingCache[i];
-		GP_ASSERT( b );
-		if(b->m_pMesh == mesh && b->m_pEffect == pEffect) {
-			
-			//Found a match
-			return b;
-		}
+	BindingKey key = { mesh, pEffect };
+	BindingCache::iterator itr = __vertexAttributeBindingCache.find(key);
+	if(itr != __vertexAttributeBindingCache.end()) {
+		GP_ASSERT( itr->second );
+		return itr->second;
 	}
 
-	b = create(mesh, mesh->getVertexFormat(), 0, pEffect);
+	VertexAttributeBinding* b = create(mesh, mesh->getVertexFormat(), 0, pEffect);
 
 	//Add the new Vertex Attribute Cache to the Cache
 	if(b) {
-		__vertexAttributeBindingCache.push_back(b);
+		__vertexAttributeBindingCache[key] = b;
 	}
 
 	return b;
@@ -66,6 +89,46 @@ VertexAttributeBinding*	VertexAttributeBinding::create(const VertexFormat& verte
 	return create(NULL, vertexFormat, vertexPointer, pEffect);
 }
 
+VertexAttributeBinding*	VertexAttributeBinding::createStreamed(const VertexFormat& vertexFormat, VBOHandle hBuffer, Effect* pEffect) {
+
+	VertexAttributeBinding* b = create(NULL, vertexFormat, 0, pEffect);
+	if(b) {
+		// Pointers hold the element offsets, bind() adds the base offset
+		GP_ASSERT( b->m_pAttributes );
+		for(unsigned int i = 0; i < __maxVertexAttributes; i++) {
+			VertexAttribute& a = b->m_pAttributes[i];
+			if(a.m_bEnabled) {
+				a.m_bStream = true;
+				a.m_hBuffer = hBuffer;
+			}
+		}
+	}
+
+	return b;
+}
+
+void VertexAttributeBinding::setBaseOffset(unsigned int iOffset) {
+	m_iBaseOffset = iOffset;
+}
+
+bool VertexAttributeBinding::isHardwareVAOSupported() {
+#ifdef USE_VAO
+	if(__hardwareVAOs < 0) {
+		__hardwareVAOs = ((GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object) && glGenVertexArrays && glBindVertexArray) ? 1 : 0;
+	}
+
+	return __hardwareVAOs != 0;
+#else
+	return false;
+#endif
+}
+
+VertexAttributeBinding*	VertexAttributeBinding::createUnique(Mesh* mesh, Effect* pEffect) {
+
+	GP_ASSERT( mesh );
+	return create(mesh, mesh->getVertexFormat(), 0, pEffect);
+}
+
 VertexAttributeBinding*	VertexAttributeBinding::create(Mesh* mesh, const VertexFormat& vertexFormat, void* vertexPointer, Effect* pEffect) {
 
 	GP_ASSERT( pEffect );
@@ -86,7 +149,7 @@ VertexAttributeBinding*	VertexAttributeBinding::create(Mesh* mesh, const VertexF
 	VertexAttributeBinding* b = new VertexAttributeBinding();
 
 #ifdef USE_VAO
-	if(mesh && glGenVertexArrays) {
+	if(mesh && isHardwareVAOSupported()) {
 		GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, 0) );
 		GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
 		
@@ -117,6 +180,9 @@ VertexAttributeBinding*	VertexAttributeBinding::create(Mesh* mesh, const VertexF
 			vertexAttribs[i].m_bNormalized = false;
 			vertexAttribs[i].m_iStride = 0;
 			vertexAttribs[i].m_pPointer = 0;
+			vertexAttribs[i].m_bStream = false;
+			vertexAttribs[i].m_hBuffer = 0;
+			vertexAttribs[i].m_iDivisor = 0;
 		}
 
 		b->m_pAttributes = vertexAttribs;
@@ -188,10 +254,10 @@ VertexAttributeBinding*	VertexAttributeBinding::create(Mesh* mesh, const VertexF
 		}
 		else {
 			void* pointer = vertexPointer ? (void*)((unsigned char*)vertexPointer + offset) : (void*)offset;
-			b->setVertexAttributeBinding(attrib, (GLint)e.size, GL_FLOAT, false, (GLsizei)vertexFormat.getVertexSize(), pointer);
+			b->setVertexAttributeBinding(attrib, (GLint)e.size, (GLenum)e.dataType, e.normalized ? GL_TRUE : GL_FALSE, (GLsizei)vertexFormat.getVertexSize(), pointer);
 		}
 
-		offset += e.size * sizeof(float);
+		offset += e.getByteSize();
 	}
 
 	if(mesh) {
@@ -299,24 +365,10 @@ void VertexAttributeBinding::bind() {
 			}
 		}
 		else {
-			GL_ASSERT( m_pAttributes );
-			for(unsigned int i = 0; i < __maxVertexAttributes; i++) {
-				VertexAttribute& a = m_pAttributes[i];
-				if(a.m_bEnabled) {
-					GL_ASSERT( glVertexAttribPointer(i, a.m_iSize, a.m_Type, a.m_bNormalized, a.m_iStride, a.m_pPointer) );
-					GL_ASSERT( glEnableVertexAttribArray(i) );
-				}
-			}
+			bindAttributes();
 		}
 #else
-		GL_ASSERT( m_pAttributes );
-		for(unsigned int i = 0; i < __maxVertexAttributes; i++) {
-			VertexAttribute& a = m_pAttributes[i];
-			if(a.m_bEnabled) {
-				GL_ASSERT( glVertexAttribPointer(i, a.m_iSize, a.m_Type, a.m_bNormalized, a.m_iStride, a.m_pPointer) );
-				GL_ASSERT( glEnableVertexAttribArray(i) );
-			}
-		}
+		bindAttributes();
 #endif
 	}
 }
@@ -379,20 +431,108 @@ void VertexAttributeBinding::unbind() {
 			}
 		}
 		else {
-			GL_ASSERT( m_pAttributes );
-			for(unsigned int i = 0; i < __maxVertexAttributes; i++) {
-				if(m_pAttributes[i].m_bEnabled) {
-					GL_ASSERT( glDisableVertexAttribArray(i) );
-				}
-			}
+			unbindAttributes();
 		}
 #else
-		GL_ASSERT( m_pAttributes );
-		for(unsigned int i = 0; i < __maxVertexAttributes; i++) {
-			if(m_pAttributes[i].m_bEnabled) {
-				GL_ASSERT( glDisableVertexAttribArray(i) );
+		unbindAttributes();
+#endif
+	}
+}
+
+void VertexAttributeBinding::bindAttributes() {
+
+	GP_ASSERT( m_pAttributes );
+
+	// Stream attributes switch the array buffer, the mesh buffer is restored after them
+	VBOHandle hMeshBuffer = m_pMesh ? m_pMesh->getVertexBuffer() : 0;
+	VBOHandle hBound = hMeshBuffer;
+
+	for(unsigned int i = 0; i < __maxVertexAttributes; i++) {
+		VertexAttribute& a = m_pAttributes[i];
+		if(!a.m_bEnabled)
+			continue;
+
+		VBOHandle hBuffer = a.m_bStream ? a.m_hBuffer : hMeshBuffer;
+		if(hBuffer != hBound) {
+			GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, hBuffer) );
+			hBound = hBuffer;
+		}
+
+		GL_ASSERT( glVertexAttribPointer(i, a.m_iSize, a.m_Type, a.m_bNormalized, a.m_iStride, (unsigned char*)a.m_pPointer + m_iBaseOffset) );
+		GL_ASSERT( glEnableVertexAttribArray(i) );
+
+		if(a.m_iDivisor) {
+			GL_ASSERT( glVertexAttribDivisorARB(i, a.m_iDivisor) );
+		}
+	}
+
+	if(hBound != hMeshBuffer) {
+		GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, hMeshBuffer) );
+	}
+}
+
+void VertexAttributeBinding::unbindAttributes() {
+
+	GP_ASSERT( m_pAttributes );
+
+	for(unsigned int i = 0; i < __maxVertexAttributes; i++) {
+		VertexAttribute& a = m_pAttributes[i];
+		if(!a.m_bEnabled)
+			continue;
+
+		GL_ASSERT( glDisableVertexAttribArray(i) );
+
+		// Without a VAO the divisor is global state, reset it for the next binding
+		if(a.m_iDivisor) {
+			GL_ASSERT( glVertexAttribDivisorARB(i, 0) );
+		}
+	}
+}
+
+bool VertexAttributeBinding::setStreamAttribute(const char* sName, VBOHandle hBuffer, GLint iSize, unsigned int iColumns, GLsizei iStride, const void* pointer, GLuint iDivisor) {
+
+	GP_ASSERT( sName );
+	GP_ASSERT( m_pEffect );
+	GP_ASSERT( iColumns > 0 );
+	GP_ASSERT( iDivisor == 0 || GLEW_ARB_instanced_arrays );
+
+	::VertexAttribute attrib = m_pEffect->getVertexAttribute(sName);
+	if(attrib == -1)
+		return false;
+
+	GP_ASSERT( attrib + iColumns <= __maxVertexAttributes );
+
+	const unsigned char* pColumn = (const unsigned char*)pointer;
+
+#ifdef USE_VAO
+	if(m_hVAO) {
+		//Hardware mode
+		GL_ASSERT( glBindVertexArray(m_hVAO) );
+		GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, hBuffer) );
+
+		for(unsigned int c = 0; c < iColumns; c++) {
+			GL_ASSERT( glVertexAttribPointer(attrib + c, iSize, GL_FLOAT, GL_FALSE, iStride, pColumn + c * iSize * sizeof(float)) );
+			GL_ASSERT( glEnableVertexAttribArray(attrib + c) );
+			if(iDivisor) {
+				GL_ASSERT( glVertexAttribDivisorARB(attrib + c, iDivisor) );
 			}
 		}
+
+		GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+		GL_ASSERT( glBindVertexArray(0) );
+		return true;
+	}
 #endif
+
+	//Software mode
+	for(unsigned int c = 0; c < iColumns; c++) {
+		setVertexAttributeBinding(attrib + c, iSize, GL_FLOAT, GL_FALSE, iStride, (GLvoid*)(pColumn + c * iSize * sizeof(float)));
+
+		VertexAttribute& a = m_pAttributes[attrib + c];
+		a.m_bStream = true;
+		a.m_hBuffer = hBuffer;
+		a.m_iDivisor = iDivisor;
 	}
+
+	return true;
 }
@@ -12,7 +12,7 @@ VertexFormat::VertexFormat(const Element* elements, unsigned int elementCount)
 		memcpy(&element, &elements[i], sizeof(Element));
 		m_vElements.push_back(element);
 
-		m_iVertexSize += element.size * sizeof(float);
+		m_iVertexSize += element.getByteSize();
 	}
 }
 
@@ -30,6 +30,17 @@ unsigned int VertexFormat::getElementCount() const {
 	return (unsigned int)m_vElements.size();
 }
 
+unsigned int VertexFormat::getElementOffset(unsigned int index) const {
+	GP_ASSERT(index < m_vElements.size());
+
+	unsigned int offset = 0;
+	for(unsigned int i = 0; i < index; i++) {
+		offset += m_vElements[i].getByteSize();
+	}
+
+	return offset;
+}
+
 unsigned int VertexFormat::getVertexSize() const {
 	return m_iVertexSize;
 }
@@ -51,19 +62,33 @@ bool VertexFormat::operator != (VertexFormat& f) const {
 }
 
 VertexFormat::Element::Element() 
-	: type(POSITION), size(0)
+	: type(POSITION), size(0), dataType(FLOAT), normalized(false)
 {
 
 }
 		
-VertexFormat::Element::Element(TYPE type, unsigned int size) 
-	: type(type), size(size)
+VertexFormat::Element::Element(TYPE type, unsigned int size, DATA_TYPE dataType, bool normalized) 
+	: type(type), size(size), dataType(dataType), normalized(normalized)
 {
 
 }
 
+unsigned int VertexFormat::Element::getByteSize() const {
+
+	switch(dataType) {
+		case UNSIGNED_BYTE:
+			return size;
+		case HALF_FLOAT:
+		case UNSIGNED_SHORT:
+		case SHORT:
+			return size * 2;
+		default:
+			return size * sizeof(float);
+	}
+}
+
 bool VertexFormat::Element::operator == (VertexFormat::Element& e) const {
-	return (type == e.type && size == e.size);
+	return (type == e.type && size == e.size && dataType == e.dataType && normalized == e.normalized);
 }
 
 bool VertexFormat::Element::operator != (VertexFormat::Element& e) const {